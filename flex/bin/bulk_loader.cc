@@ -18,6 +18,7 @@
 
 #include <glog/logging.h>
 
+#include <boost/algorithm/string.hpp>
 #include <boost/program_options.hpp>
 
 #include "flex/engines/graph_db/database/graph_db.h"
@@ -38,7 +39,13 @@ int main(int argc, char** argv) {
       "bulk-load,l", bpo::value<std::string>(), "bulk-load config file")(
       "buffer-pool-size,B",
       bpo::value<uint64_t>()->default_value(pool_size_Byte),
-      "size of buffer pool");
+      "size of buffer pool")(
+      "compress-nbr",
+      "write neighbor lists of the snapshot sorted and delta bit-packed")(
+      "vertex-order", bpo::value<std::string>(),
+      "vid ordering, e.g. degree or "
+      "PERSON:rcm,COMMENT:group_by_creator,POST:group_by_creator; one of "
+      "none/degree/rcm/group_by_creator/hub_cluster");
   google::InitGoogleLogging(argv[0]);
   FLAGS_logtostderr = true;
 
@@ -57,6 +64,9 @@ int main(int argc, char** argv) {
   }
 
   uint32_t parallelism = vm["parallelism"].as<uint32_t>();
+#if !OV
+  gs::compress_nbr_list_on_dump() = vm.count("compress-nbr") > 0;
+#endif
   std::string data_path = "";
   std::string bulk_load_config_path = "";
   std::string graph_schema_path = "";
@@ -93,6 +103,21 @@ int main(int argc, char** argv) {
   auto schema = gs::Schema::LoadFromYaml(graph_schema_path);
   auto loading_config =
       gs::LoadingConfig::ParseFromYaml(schema, bulk_load_config_path);
+  if (vm.count("vertex-order")) {
+    // 命令行中的ordering覆盖配置文件中的设置
+    std::vector<std::string> items;
+    boost::split(items, vm["vertex-order"].as<std::string>(),
+                 boost::is_any_of(","));
+    for (auto& item : items) {
+      auto pos = item.find(':');
+      if (pos == std::string::npos) {
+        loading_config.SetVertexOrdering(item);
+      } else if (!loading_config.SetVertexOrdering(item.substr(0, pos),
+                                                   item.substr(pos + 1))) {
+        return -1;
+      }
+    }
+  }
 
   std::filesystem::path data_dir_path(data_path);
   if (!std::filesystem::exists(data_dir_path)) {
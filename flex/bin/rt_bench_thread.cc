@@ -164,7 +164,15 @@ class BatchTest {
     gs::MutablePropertyFragment& graph = gs::GraphDB::get().graph();
     auto person_label_id = graph.schema().get_vertex_label_id("PERSON");
     auto txn = gs::GraphDB::get().GetSession(0).GetReadTransaction();
-    txn.BatchGetVertexIndices(person_label_id, {1129, 4194, 8333});
+    std::vector<gs::oid_t> oids = {1129, 4194, 8333, -1};
+    auto [vids, exists] = txn.BatchGetVertexIndices(person_label_id, oids);
+    for (size_t i = 0; i < oids.size(); i++) {
+      gs::vid_t vid;
+      bool found = txn.GetVertexIndex(person_label_id, oids[i], vid);
+      CHECK_EQ(found, exists[i]);
+      if (found)
+        CHECK_EQ(vid, vids[i]);
+    }
     LOG(INFO) << "BatchGetVertexIndices: Test Success";
   }
 
@@ -242,6 +250,32 @@ class BatchTest {
     LOG(INFO) << "BatchGetOutgoingEdges: Test Success";
   }
 
+  // 测试PrefetchOutgoingEdges接口
+  void test_PrefetchOutgoingEdges() {
+    gs::MutablePropertyFragment& graph = gs::GraphDB::get().graph();
+    auto person_label_id = graph.schema().get_vertex_label_id("PERSON");
+    auto knows_label_id = graph.schema().get_edge_label_id("KNOWS");
+
+    auto txn = gs::GraphDB::get().GetSession(0).GetReadTransaction();
+    std::vector<gs::vid_t> vids = {1, 2, 3};
+    auto prefetcher = txn.PrefetchOutgoingEdges<gs::Date>(
+        person_label_id, person_label_id, knows_label_id, vids);
+    auto expected = txn.BatchGetOutgoingEdges<gs::Date>(
+        person_label_id, person_label_id, knows_label_id, vids);
+    auto results = prefetcher->get();
+    assert(results.size() == expected.size());
+    for (size_t i = 0; i < results.size(); i++) {
+      assert(results[i].estimated_degree() == expected[i].estimated_degree());
+      while (results[i].is_valid() && expected[i].is_valid()) {
+        assert(results[i].get_neighbor() == expected[i].get_neighbor());
+        results[i].next();
+        expected[i].next();
+      }
+      assert(results[i].is_valid() == expected[i].is_valid());
+    }
+    LOG(INFO) << "PrefetchOutgoingEdges: Test Success";
+  }
+
   // 测试BatchGetVertexPropsFromVid接口
   void test_BatchGetVertexPropsFromVid() {
     gs::MutablePropertyFragment& graph = gs::GraphDB::get().graph();
@@ -256,9 +290,10 @@ class BatchTest {
     auto person_creationDate_col = std::dynamic_pointer_cast<gs::DateColumn>(
         gs::GraphDB::get().GetSession(0).get_vertex_property_column(
             person_label_id, "creationDate"));
-    auto person_browserUsed_col = std::dynamic_pointer_cast<gs::StringColumn>(
+    // browserUsed可能是字典编码的列，直接通过ColumnBase读取
+    auto person_browserUsed_col =
         gs::GraphDB::get().GetSession(0).get_vertex_property_column(
-            person_label_id, "browserUsed"));
+            person_label_id, "browserUsed");
 
     for (size_t i = 0; i < vids.size(); i++) {
       auto creationDate = person_creationDate_col->get(vids[i]);
@@ -814,6 +849,7 @@ int main(int argc, char** argv) {
   //   test.test_BatchGetVertexIds();
   //   test.test_BatchGetOutgoingEdges();
   //   test.test_BatchGetIncomingEdges();
+  //   test.test_PrefetchOutgoingEdges();
   //   test.test_BatchGetVertexPropsFromVid();
   //   // return 1;
   // }
@@ -16,8 +16,11 @@
 #include "grape/util.h"
 
 #include "flex/engines/graph_db/database/graph_db.h"
-#include "flex/engines/http_server/graph_db_service.h"
-#include "flex/engines/http_server/options.h"
+#include "flex/engines/graph_db/server/options.h"
+#include "flex/engines/graph_db/server/service.h"
+
+#include <algorithm>
+#include <vector>
 
 #include <boost/program_options.hpp>
 #include <seastar/core/alien.hh>
@@ -42,7 +45,32 @@ int main(int argc, char** argv) {
       "log-data-path,l", bpo::value<std::string>(), "log data directory path")(
       "buffer-pool-size,B",
       bpo::value<uint64_t>()->default_value(pool_size_Byte),
-      "size of buffer pool");
+      "size of buffer pool")(
+      "wal-sync-mode", bpo::value<std::string>()->default_value("group"),
+      "how commits are persisted to wal: none, sync, group or async")(
+      "wal-group-delay-us", bpo::value<uint32_t>()->default_value(100),
+      "max delay of a group commit window in microseconds")(
+      "shard-worker-num", bpo::value<uint32_t>()->default_value(0),
+      "query worker threads per shard, 0 runs queries on the shard")(
+      "ic-app-id-end", bpo::value<uint32_t>()->default_value(ic_app_id_end),
+      "app ids in [1, ic-app-id-end) are IC queries")(
+      "is-app-id-end", bpo::value<uint32_t>()->default_value(is_app_id_end),
+      "app ids in [ic-app-id-end, is-app-id-end) are IS queries, the rest "
+      "are IU")(
+      "query-class-weight",
+      bpo::value<std::vector<uint32_t>>()->multitoken(),
+      "scheduling weights of IC, IS and IU queries")(
+      "query-class-concurrency",
+      bpo::value<std::vector<uint32_t>>()->multitoken(),
+      "max running IC, IS and IU queries per shard")(
+      "shard-max-running",
+      bpo::value<uint32_t>()->default_value(shard_max_running),
+      "max running queries per shard")(
+      "shard-max-queued",
+      bpo::value<uint32_t>()->default_value(shard_max_queued),
+      "max queued queries per shard, 503 is returned when it is full")(
+      "slow-query-threshold-us", bpo::value<uint64_t>()->default_value(0),
+      "log queries slower than this with their input, 0 turns it off");
 
   google::InitGoogleLogging(argv[0]);
   FLAGS_logtostderr = true;
@@ -64,6 +92,30 @@ int main(int argc, char** argv) {
   uint32_t shard_num = vm["shard-num"].as<uint32_t>();
   uint16_t http_port = vm["http-port"].as<uint16_t>();
 
+  shard_worker_num = vm["shard-worker-num"].as<uint32_t>();
+  ic_app_id_end = vm["ic-app-id-end"].as<uint32_t>();
+  is_app_id_end = vm["is-app-id-end"].as<uint32_t>();
+  // 三个值依次为IC, IS, IU
+  auto read_class_option = [&](const char* name, uint32_t* target) {
+    if (!vm.count(name)) {
+      return true;
+    }
+    auto& values = vm[name].as<std::vector<uint32_t>>();
+    if (values.size() != 3) {
+      LOG(ERROR) << name << " needs 3 values for IC, IS and IU";
+      return false;
+    }
+    std::copy(values.begin(), values.end(), target);
+    return true;
+  };
+  if (!read_class_option("query-class-weight", query_class_weight) ||
+      !read_class_option("query-class-concurrency", query_class_concurrency)) {
+    return -1;
+  }
+  shard_max_running = vm["shard-max-running"].as<uint32_t>();
+  shard_max_queued = vm["shard-max-queued"].as<uint32_t>();
+  slow_query_threshold_us = vm["slow-query-threshold-us"].as<uint64_t>();
+
   std::string graph_schema_path = "";
   std::string data_path = "";
   std::string log_data_path = "";
@@ -123,7 +175,12 @@ int main(int argc, char** argv) {
 
   // init access logger
   gbp::get_log_dir() = log_data_path;
-  db.Init(schema, data_path, shard_num);
+  db.SetWalSyncMode(
+      gs::StringToWalSyncMode(vm["wal-sync-mode"].as<std::string>()),
+      vm["wal-group-delay-us"].as<uint32_t>());
+  // 有工作线程时每个工作线程使用自己的session
+  db.Init(schema, data_path,
+          shard_worker_num > 0 ? shard_num * shard_worker_num : shard_num);
 
   t0 += grape::GetCurrentTime();
 
@@ -162,9 +219,9 @@ int main(int argc, char** argv) {
   gbp::warmup_mark().store(1);
   // start service
   LOG(INFO) << "GraphScope http server start to listen on port " << http_port;
-  server::GraphDBService::get().init(shard_num, http_port, enable_dpdk);
+  server::service::get().init(shard_num, http_port, enable_dpdk);
 
-  server::GraphDBService::get().run_and_wait_for_exit();
+  server::service::get().run_and_wait_for_exit();
 
   return 0;
 }
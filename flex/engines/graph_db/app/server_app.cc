@@ -17,17 +17,91 @@
 
 namespace gs {
 
+// 通过LFIndexer查找，不扫描顶点，避免管理请求把缓冲池中的页换出
 static uint32_t get_vertex_vid(const gs::ReadTransaction& txn, uint8_t label,
                                int64_t id) {
-  uint32_t vid = std::numeric_limits<uint32_t>::max();
+  vid_t vid;
+  if (!txn.GetVertexIndex(label, id, vid)) {
+    return std::numeric_limits<uint32_t>::max();
+  }
+  return vid;
+}
+
+static void put_vertex_fields(const gs::ReadTransaction& txn, uint8_t label,
+                              vid_t vid, Encoder& output) {
   auto vit = txn.GetVertexIterator(label);
-  for (; vit.IsValid(); vit.Next()) {
-    if (vit.GetId() == id) {
-      vid = vit.GetIndex();
-      break;
+  vit.Goto(vid);
+  int field_num = vit.FieldNum();
+  for (int i = 0; i < field_num; ++i) {
+#if OV
+    output.put_string(vit.GetField(i).to_string());
+#else
+    auto item = vit.GetField(i);
+    output.put_buffer_object(item);
+#endif
+  }
+}
+
+#if !OV
+// 边属性表中一列的值，格式与Any::to_string相同
+static std::string edge_field_to_string(const gbp::BufferBlock& item,
+                                        PropertyType type) {
+  switch (type) {
+  case PropertyType::kInt32:
+    return std::to_string(gbp::BufferBlock::Ref<int>(item));
+  case PropertyType::kInt64:
+    return std::to_string(gbp::BufferBlock::Ref<int64_t>(item));
+  case PropertyType::kDate:
+    return gbp::BufferBlock::Ref<Date>(item).to_string();
+  case PropertyType::kDouble:
+    return std::to_string(gbp::BufferBlock::Ref<double>(item));
+  case PropertyType::kString:
+    return std::string(&item.Obj<char>(), item.Size());
+  default:
+    return "";
+  }
+}
+#endif
+
+// 点查一条边的数据，优先使用src的出边，邻接表有序时二分查找。属性存放在
+// 边属性表中的边，邻接表中只有边id，按边id读出各列，以'|'分隔
+static bool get_edge_data_string(const gs::ReadTransaction& txn,
+                                 uint8_t src_label, vid_t src,
+                                 uint8_t dst_label, vid_t dst,
+                                 uint8_t edge_label, std::string& data) {
+  Any value;
+  if (!txn.FindEdge(src_label, src, dst_label, dst, edge_label, value)) {
+    return false;
+  }
+  auto* edge_table = txn.GetEdgeTable(src_label, dst_label, edge_label);
+  if (edge_table == nullptr) {
+    data = value.to_string();
+    return true;
+  }
+  edge_id_t eid = value.AsInt64();
+  data.clear();
+#if OV
+  size_t col_num = txn.schema()
+                       .get_edge_properties(src_label, dst_label, edge_label)
+                       .size();
+  for (size_t i = 0; i < col_num; ++i) {
+    if (i != 0) {
+      data += '|';
     }
+    data += edge_table->at(eid, i).to_string();
   }
-  return vid;
+#else
+  auto& types =
+      txn.schema().get_edge_properties(src_label, dst_label, edge_label);
+  auto row = edge_table->get_row(eid);
+  for (size_t i = 0; i < row.size(); ++i) {
+    if (i != 0) {
+      data += '|';
+    }
+    data += edge_field_to_string(row[i], types[i]);
+  }
+#endif
+  return true;
 }
 
 void generate_label_tuples(
@@ -97,25 +171,99 @@ bool ServerApp::Query(Decoder& input, Encoder& output) {
     CHECK(input.empty());
     auto txn = graph_.GetReadTransaction();
     uint8_t vertex_label_id = txn.schema().get_vertex_label_id(vertex_label);
-    auto vit = txn.GetVertexIterator(vertex_label_id);
-    for (; vit.IsValid(); vit.Next()) {
-      if (vit.GetId() == vertex_id) {
-        output.put_int(1);
-        int field_num = vit.FieldNum();
-        for (int i = 0; i < field_num; ++i) {
+    uint32_t vid = get_vertex_vid(txn, vertex_label_id, vertex_id);
+    if (vid == std::numeric_limits<uint32_t>::max()) {
+      output.put_int(0);
+      return false;
+    }
+    output.put_int(1);
+    put_vertex_fields(txn, vertex_label_id, vid, output);
+    return true;
+  } else if (op == "QUERY_VERTICES") {
+    // label, n, id_1, ..., id_n；每个id输出是否存在以及属性
+    std::string vertex_label = std::string(input.get_string());
+    int id_num = input.get_int();
+    std::vector<oid_t> vertex_ids(id_num);
+    for (int i = 0; i < id_num; ++i) {
+      vertex_ids[i] = input.get_long();
+    }
+    CHECK(input.empty());
+    auto txn = graph_.GetReadTransaction();
+    if (!txn.schema().contains_vertex_label(vertex_label)) {
+      output.put_int(0);
+      return false;
+    }
+    uint8_t vertex_label_id = txn.schema().get_vertex_label_id(vertex_label);
 #if OV
-          output.put_string(vit.GetField(i).to_string());
+    std::vector<vid_t> vids(id_num);
+    std::vector<bool> exists(id_num);
+    for (int i = 0; i < id_num; ++i) {
+      exists[i] =
+          txn.GetVertexIndex(vertex_label_id, vertex_ids[i], vids[i]);
+    }
 #else
-          auto item = vit.GetField(i);
-          output.put_buffer_object(item);
+    auto [vids, exists] =
+        txn.BatchGetVertexIndices(vertex_label_id, vertex_ids);
 #endif
-        }
-        return true;
+    output.put_int(id_num);
+    for (int i = 0; i < id_num; ++i) {
+      if (!exists[i]) {
+        output.put_int(0);
+        continue;
       }
+      output.put_int(1);
+      put_vertex_fields(txn, vertex_label_id, vids[i], output);
     }
-
-    output.put_int(0);
-    return false;
+    return true;
+  } else if (op == "QUERY_EDGES") {
+    // src_label, dst_label, edge_label, n, (src_id, dst_id) * n；每对端点
+    // 输出是否存在以及边数据
+    std::string src_label = std::string(input.get_string());
+    std::string dst_label = std::string(input.get_string());
+    std::string edge_label = std::string(input.get_string());
+    int edge_num = input.get_int();
+    std::vector<oid_t> src_ids(edge_num), dst_ids(edge_num);
+    for (int i = 0; i < edge_num; ++i) {
+      src_ids[i] = input.get_long();
+      dst_ids[i] = input.get_long();
+    }
+    CHECK(input.empty());
+    auto txn = graph_.GetReadTransaction();
+    if (!txn.schema().contains_vertex_label(src_label) ||
+        !txn.schema().contains_vertex_label(dst_label) ||
+        !txn.schema().contains_edge_label(edge_label)) {
+      output.put_int(0);
+      return false;
+    }
+    uint8_t src_label_id = txn.schema().get_vertex_label_id(src_label);
+    uint8_t dst_label_id = txn.schema().get_vertex_label_id(dst_label);
+    uint8_t edge_label_id = txn.schema().get_edge_label_id(edge_label);
+#if OV
+    std::vector<vid_t> src_vids(edge_num), dst_vids(edge_num);
+    std::vector<bool> src_exists(edge_num), dst_exists(edge_num);
+    for (int i = 0; i < edge_num; ++i) {
+      src_exists[i] = txn.GetVertexIndex(src_label_id, src_ids[i], src_vids[i]);
+      dst_exists[i] = txn.GetVertexIndex(dst_label_id, dst_ids[i], dst_vids[i]);
+    }
+#else
+    auto [src_vids, src_exists] =
+        txn.BatchGetVertexIndices(src_label_id, src_ids);
+    auto [dst_vids, dst_exists] =
+        txn.BatchGetVertexIndices(dst_label_id, dst_ids);
+#endif
+    output.put_int(edge_num);
+    std::string data;
+    for (int i = 0; i < edge_num; ++i) {
+      if (src_exists[i] && dst_exists[i] &&
+          get_edge_data_string(txn, src_label_id, src_vids[i], dst_label_id,
+                               dst_vids[i], edge_label_id, data)) {
+        output.put_int(1);
+        output.put_string(data);
+      } else {
+        output.put_int(0);
+      }
+    }
+    return true;
   } else if (op == "QUERY_EDGE") {
     std::string src_label = std::string(input.get_string());
     int64_t src_id = input.get_long();
@@ -156,40 +304,18 @@ bool ServerApp::Query(Decoder& input, Encoder& output) {
         return false;
       }
 
-      auto ieit = txn.GetInEdgeIterator(dst_label_id, dst_vid, src_label_id,
-                                        edge_label_id);
-      while (ieit.IsValid()) {
-        if (ieit.GetNeighbor() == src_vid) {
-          output.put_int(1);
-          output.put_string(src_label);
-          output.put_string(dst_label);
-          output.put_string(edge_label);
-          output.put_int(1);
-          output.put_long(src_id);
-          output.put_long(dst_id);
-          // output.put_string(ieit.GetData().to_string());
-          assert(false);
-          return true;
-        }
-        ieit.Next();
-      }
-
-      auto oeit = txn.GetOutEdgeIterator(src_label_id, src_vid, dst_label_id,
-                                         edge_label_id);
-      while (oeit.IsValid()) {
-        if (oeit.GetNeighbor() == dst_vid) {
-          output.put_int(1);
-          output.put_string(src_label);
-          output.put_string(dst_label);
-          output.put_string(edge_label);
-          output.put_int(1);
-          output.put_long(src_id);
-          output.put_long(dst_id);
-          // output.put_string(oeit.GetData().to_string());
-          assert(false);
-          return true;
-        }
-        oeit.Next();
+      std::string data;
+      if (get_edge_data_string(txn, src_label_id, src_vid, dst_label_id,
+                               dst_vid, edge_label_id, data)) {
+        output.put_int(1);
+        output.put_string(src_label);
+        output.put_string(dst_label);
+        output.put_string(edge_label);
+        output.put_int(1);
+        output.put_long(src_id);
+        output.put_long(dst_id);
+        output.put_string(data);
+        return true;
       }
 
       output.put_int(0);
@@ -239,37 +365,51 @@ bool ServerApp::Query(Decoder& input, Encoder& output) {
         }
 
         std::vector<std::tuple<int64_t, int64_t, std::string>> match_edges;
-        for (uint32_t v = dst_range.from; v != dst_range.to; ++v) {
-          int64_t v_oid = txn.GetVertexId(dst_label_id, v);
-          auto ieit = txn.GetInEdgeIterator(dst_label_id, v, src_label_id,
-                                            edge_label_id);
-          while (ieit.IsValid()) {
-            uint32_t u = ieit.GetNeighbor();
-            if (src_range.contains(u)) {
-              int64_t u_oid = txn.GetVertexId(src_label_id, u);
-              // match_edges.emplace_back(u_oid, v_oid,
-              //                          ieit.GetData().to_string());
-              assert(false);
+        std::string data;
+        auto add_match = [&](uint32_t u, uint32_t v) {
+          if (get_edge_data_string(txn, src_label_id, u, dst_label_id, v,
+                                   edge_label_id, data)) {
+            match_edges.emplace_back(txn.GetVertexId(src_label_id, u),
+                                     txn.GetVertexId(dst_label_id, v), data);
+          }
+        };
+        auto scan_in_edges = [&]() {
+          for (uint32_t v = dst_range.from; v != dst_range.to; ++v) {
+            auto ieit = txn.GetInEdgeIterator(dst_label_id, v, src_label_id,
+                                              edge_label_id);
+            for (; ieit.IsValid(); ieit.Next()) {
+              if (src_range.contains(ieit.GetNeighbor())) {
+                add_match(ieit.GetNeighbor(), v);
+              }
             }
-            ieit.Next();
           }
-        }
-        if (match_edges.empty()) {
+        };
+        auto scan_out_edges = [&]() {
           for (uint32_t u = src_range.from; u != src_range.to; ++u) {
-            int64_t u_oid = txn.GetVertexId(src_label_id, u);
             auto oeit = txn.GetOutEdgeIterator(src_label_id, u, dst_label_id,
                                                edge_label_id);
-            while (oeit.IsValid()) {
-              uint32_t v = oeit.GetNeighbor();
-              if (dst_range.contains(v)) {
-                int64_t v_oid = txn.GetVertexId(dst_label_id, v);
-                // match_edges.emplace_back(u_oid, v_oid,
-                //                          oeit.GetData().to_string());
-                assert(false);
+            for (; oeit.IsValid(); oeit.Next()) {
+              if (dst_range.contains(oeit.GetNeighbor())) {
+                add_match(u, oeit.GetNeighbor());
               }
-              oeit.Next();
             }
           }
+        };
+        // 从顶点较少的一侧扫描，只给出一个端点时不会遍历整个label；没有
+        // 找到时再扫描另一侧，对应方向的邻接表可能没有保存
+        bool from_src =
+            src_range.to - src_range.from <= dst_range.to - dst_range.from;
+        if (from_src) {
+          scan_out_edges();
+        } else {
+          scan_in_edges();
+        }
+        if (match_edges.empty()) {
+          if (from_src) {
+            scan_in_edges();
+          } else {
+            scan_out_edges();
+          }
         }
         if (!match_edges.empty()) {
           total_matched_edges += match_edges.size();
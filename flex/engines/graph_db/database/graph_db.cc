@@ -14,6 +14,10 @@
  */
 
 #include "flex/engines/graph_db/database/graph_db.h"
+
+#include <algorithm>
+#include <limits>
+
 #include "flex/engines/graph_db/database/graph_db_session.h"
 
 #include "flex/engines/graph_db/app/server_app.h"
@@ -38,6 +42,8 @@ struct SessionLocalContext {
 
 GraphDB::GraphDB() = default;
 GraphDB::~GraphDB() {
+  stopCompactor();
+  wal_flusher_.stop();
   // Checkpoint();
   for (int i = 0; i < thread_num_; ++i) {
     contexts_[i].~SessionLocalContext();
@@ -61,6 +67,8 @@ void GraphDB::Init(const Schema& schema, const std::string& data_dir,
     LOG(FATAL) << "Schema file does not exist";
   }
   work_dir_ = data_dir;
+  stopCompactor();
+  wal_flusher_.stop();
   graph_.Open(data_dir);
 
   std::string wal_dir_path = wal_dir(data_dir);
@@ -82,19 +90,102 @@ void GraphDB::Init(const Schema& schema, const std::string& data_dir,
   }
   ingestWals(wal_files, data_dir, thread_num_);
 
+  // 记录锁的槽数随顶点数增长，减少不同顶点散列到同一个槽上的误报冲突
+  size_t vertex_num = 0;
+  for (label_t i = 0; i < graph_.schema().vertex_label_num(); ++i) {
+    vertex_num += graph_.vertex_num(i);
+  }
+  version_manager_.record_locks().init(vertex_num);
+
+  wal_flusher_.start(wal_sync_mode_, wal_group_delay_us_);
   for (int i = 0; i < thread_num_; ++i) {
-    contexts_[i].logger.open(wal_dir_path, i);
+    contexts_[i].logger.open(wal_dir_path, i, &wal_flusher_);
   }
 
   initApps(schema.GetPluginsList());
+  startCompactor();
+}
+
+void GraphDB::SetWalSyncMode(WalSyncMode mode, uint32_t group_delay_us) {
+  wal_sync_mode_ = mode;
+  wal_group_delay_us_ = group_delay_us;
 }
 
+void GraphDB::SetSortedWalReplay(bool sorted) { sorted_wal_replay_ = sorted; }
+
+void GraphDB::startCompactor() {
+  compactor_running_.store(true);
+  compactor_ = std::thread([this]() {
+    uint32_t frozen_ts = 0;
+    uint32_t reclaimed_ts = 0;
+    while (compactor_running_.load()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      freezeEdges(frozen_ts);
+      reclaimVersions(reclaimed_ts);
+      if (!graph_.NeedCompactEdges()) {
+        continue;
+      }
+      // 压缩与读、写事务并发；持有读时间戳以排除独占的dump和重启。read_ts
+      // 和min_ts在登记之前读取，min_ts不受自身的时间戳限制
+      uint32_t read_ts = version_manager_.read_timestamp();
+      uint32_t min_ts = version_manager_.min_active_read_timestamp();
+      version_manager_.acquire_read_timestamp();
+      double t = -grape::GetCurrentTime();
+      size_t compacted = graph_.CompactEdges(read_ts, min_ts);
+      t += grape::GetCurrentTime();
+      version_manager_.release_read_timestamp();
+      VLOG(10) << "Compacted " << compacted << " adjacency lists using " << t
+               << "s";
+    }
+  });
+}
+
+void GraphDB::freezeEdges(uint32_t& frozen_ts) {
+  // 持有读时间戳，排除独占的dump和重启；自身的时间戳也计入最小读时间戳
+  version_manager_.acquire_read_timestamp();
+  uint32_t ts = version_manager_.min_active_read_timestamp();
+  if (ts > frozen_ts) {
+    double t = -grape::GetCurrentTime();
+    size_t frozen = graph_.FreezeEdges(ts);
+    t += grape::GetCurrentTime();
+    frozen_ts = ts;
+    if (frozen != 0) {
+      VLOG(10) << "Froze " << frozen << " adjacency lists at " << ts
+               << " using " << t << "s";
+    }
+  }
+  version_manager_.release_read_timestamp();
+}
+
+void GraphDB::reclaimVersions(uint32_t& reclaimed_ts) {
+  // 与freezeEdges相同，持有读时间戳以排除dump和重启
+  version_manager_.acquire_read_timestamp();
+  uint32_t ts = version_manager_.min_active_read_timestamp();
+  if (ts > reclaimed_ts) {
+    size_t reclaimed = graph_.ReclaimVersions(ts);
+    reclaimed_ts = ts;
+    if (reclaimed != 0) {
+      VLOG(10) << "Reclaimed " << reclaimed << " old versions at " << ts;
+    }
+  }
+  version_manager_.release_read_timestamp();
+}
+
+void GraphDB::stopCompactor() {
+  compactor_running_.store(false);
+  if (compactor_.joinable()) {
+    compactor_.join();
+  }
+}
+
+#if OV
 void GraphDB::Checkpoint() {
-  uint32_t ts = version_manager_.acquire_update_timestamp();
+  std::lock_guard<std::mutex> guard(checkpoint_mutex_);
+  uint32_t ts = version_manager_.acquire_exclusive_timestamp();
 
   uint32_t read_version = ts - 1;
   if (read_version == 0 || read_version <= get_snapshot_version(work_dir_)) {
-    CHECK(version_manager_.revert_update_timestamp(ts));
+    CHECK(version_manager_.revert_exclusive_timestamp(ts));
     return;
   }
 
@@ -102,13 +193,66 @@ void GraphDB::Checkpoint() {
   graph_.Dump(work_dir_, read_version);
   t += grape::GetCurrentTime();
   LOG(INFO) << "Dump graph data using " << t << "s";
-  CHECK(version_manager_.revert_update_timestamp(ts));
+  CHECK(version_manager_.revert_exclusive_timestamp(ts));
 }
 
 void GraphDB::CheckpointAndRestart() {
   Checkpoint();
   Init(graph_.schema(), work_dir_, thread_num_);
 }
+#else
+/**
+ * @brief 增量checkpoint：只暂停写事务，读事务照常进行。各结构只写出上次
+ * checkpoint以来的脏页，写完之后切换快照版本并轮转WAL。
+ */
+void GraphDB::Checkpoint() {
+  std::lock_guard<std::mutex> guard(checkpoint_mutex_);
+  uint32_t version = version_manager_.acquire_checkpoint_timestamp();
+  if (version == 0 || version <= get_snapshot_version(work_dir_)) {
+    version_manager_.release_checkpoint_timestamp();
+    return;
+  }
+
+  double t = -grape::GetCurrentTime();
+  graph_.Checkpoint(work_dir_, version);
+  rotateWals();
+  t += grape::GetCurrentTime();
+  LOG(INFO) << "Checkpoint graph data of version " << version << " using "
+            << t << "s";
+  version_manager_.release_checkpoint_timestamp();
+}
+
+// 完整的dump会合并基础段和增量段，之后图不可用，需要重新打开
+void GraphDB::CheckpointAndRestart() {
+  std::lock_guard<std::mutex> guard(checkpoint_mutex_);
+  uint32_t ts = version_manager_.acquire_exclusive_timestamp();
+  uint32_t read_version = ts - 1;
+  if (read_version != 0 && read_version > get_snapshot_version(work_dir_)) {
+    double t = -grape::GetCurrentTime();
+    graph_.Dump(work_dir_, read_version);
+    t += grape::GetCurrentTime();
+    LOG(INFO) << "Dump graph data using " << t << "s";
+  }
+  CHECK(version_manager_.revert_exclusive_timestamp(ts));
+  Init(graph_.schema(), work_dir_, thread_num_);
+}
+
+void GraphDB::rotateWals() {
+  std::string wal_dir_path = wal_dir(work_dir_);
+  std::vector<std::string> old_wals;
+  for (const auto& entry : std::filesystem::directory_iterator(wal_dir_path)) {
+    old_wals.push_back(entry.path().string());
+  }
+  // 先打开新文件再删除旧文件，旧文件中的事务都已在快照中
+  for (int i = 0; i < thread_num_; ++i) {
+    contexts_[i].logger.close();
+    contexts_[i].logger.open(wal_dir_path, i, &wal_flusher_);
+  }
+  for (auto& path : old_wals) {
+    std::filesystem::remove(path);
+  }
+}
+#endif
 
 ReadTransaction GraphDB::GetReadTransaction() {
   uint32_t ts = version_manager_.acquire_read_timestamp();
@@ -139,6 +283,18 @@ GraphDBSession& GraphDB::GetSession(int thread_id) {
 
 int GraphDB::SessionNum() const { return thread_num_; }
 
+std::string GraphDB::DumpQueryStats() const {
+  std::vector<const QueryStats*> stats;
+  for (int i = 0; i < thread_num_; ++i) {
+    stats.push_back(&contexts_[i].session.query_stats());
+  }
+  return QueryStats::ToJson(stats);
+}
+
+void GraphDB::SetSlowQueryThreshold(uint64_t threshold_us) {
+  QueryStats::SetSlowQueryThreshold(threshold_us);
+}
+
 const MutablePropertyFragment& GraphDB::graph() const { return graph_; }
 MutablePropertyFragment& GraphDB::graph() { return graph_; }
 
@@ -213,24 +369,218 @@ static void IngestWalRange(SessionLocalContext* contexts,
   }
 }
 
+// 按(邻接表, 源点)排序后的一次插边，op为WalEdgeOp的下标
+struct WalAdjOp {
+  uint32_t csr;
+  vid_t v;
+  vid_t nbr;
+  timestamp_t ts;
+  uint32_t op;
+
+  bool operator<(const WalAdjOp& rhs) const {
+    if (csr != rhs.csr) {
+      return csr < rhs.csr;
+    }
+    if (v != rhs.v) {
+      return v < rhs.v;
+    }
+    if (ts != rhs.ts) {
+      return ts < rhs.ts;
+    }
+    return op < rhs.op;
+  }
+};
+
+static void ResolveWalEdgeEnds(const MutablePropertyFragment& graph,
+                               const std::vector<WalEdgeOp>& ops, size_t from,
+                               size_t to, std::vector<vid_t>& src_lids,
+                               std::vector<vid_t>& dst_lids) {
+#if !OV
+  // 按点标签分组后批量查询，减少索引页的随机访问
+  label_t vertex_label_num = graph.schema().vertex_label_num();
+  std::vector<std::vector<oid_t>> oids(vertex_label_num);
+  std::vector<std::vector<vid_t*>> slots(vertex_label_num);
+  for (size_t i = from; i < to; ++i) {
+    oids[ops[i].src_label].push_back(ops[i].src);
+    slots[ops[i].src_label].push_back(&src_lids[i]);
+    oids[ops[i].dst_label].push_back(ops[i].dst);
+    slots[ops[i].dst_label].push_back(&dst_lids[i]);
+  }
+  std::vector<vid_t> lids;
+  std::vector<bool> exists;
+  for (label_t label = 0; label < vertex_label_num; ++label) {
+    if (oids[label].empty()) {
+      continue;
+    }
+    lids.clear();
+    exists.clear();
+    graph.get_lid_batch(label, oids[label], lids, exists);
+    for (size_t i = 0; i < oids[label].size(); ++i) {
+      CHECK(exists[i]) << "get_vertex [" << oids[label][i] << "] failed";
+      *slots[label][i] = lids[i];
+    }
+  }
+#else
+  for (size_t i = from; i < to; ++i) {
+    CHECK(graph.get_lid(ops[i].src_label, ops[i].src, src_lids[i]));
+    CHECK(graph.get_lid(ops[i].dst_label, ops[i].dst, dst_lids[i]));
+  }
+#endif
+}
+
+/**
+ * @brief 按页的局部性重放[from, to)内的插入WAL：
+ * 1. 多线程解码WAL，点直接插入，边只记录下来；
+ * 2. 所有点插入之后，按点标签批量把边两端的oid解析为vid；
+ * 3. 把每条边的出边和入边按(邻接表, 源点, 时间戳)排序；
+ * 4. 按源点区间切分给各线程，依次写入邻接表。
+ * 每个邻接表内的边仍按时间戳顺序写入，并带着各自的时间戳，与逐条重放的结果一致。
+ */
+static void IngestWalRangeSorted(SessionLocalContext* contexts,
+                                 MutablePropertyFragment& graph,
+                                 const WalsParser& parser, uint32_t from,
+                                 uint32_t to, int thread_num) {
+  std::vector<std::vector<WalEdgeOp>> decoded(thread_num);
+  {
+    std::atomic<uint32_t> cur_ts(from);
+    std::vector<std::thread> threads(thread_num);
+    for (int i = 0; i < thread_num; ++i) {
+      threads[i] = std::thread(
+          [&](int tid) {
+            while (true) {
+              uint32_t got_ts = cur_ts.fetch_add(1);
+              if (got_ts >= to) {
+                break;
+              }
+              const auto& unit = parser.get_insert_wal(got_ts);
+              InsertTransaction::DecodeWal(graph, got_ts, unit.ptr, unit.size,
+                                           decoded[tid]);
+            }
+          },
+          i);
+    }
+    for (auto& thrd : threads) {
+      thrd.join();
+    }
+  }
+
+  std::vector<WalEdgeOp> ops;
+  for (auto& vec : decoded) {
+    ops.insert(ops.end(), std::make_move_iterator(vec.begin()),
+               std::make_move_iterator(vec.end()));
+    std::vector<WalEdgeOp>().swap(vec);
+  }
+  LOG(INFO) << "Decoded WALs [" << from << ", " << to << "), " << ops.size()
+            << " edges";
+  if (ops.empty()) {
+    return;
+  }
+  CHECK_LT(ops.size(), std::numeric_limits<uint32_t>::max());
+
+  std::vector<vid_t> src_lids(ops.size()), dst_lids(ops.size());
+  {
+    size_t chunk = (ops.size() + thread_num - 1) / thread_num;
+    std::vector<std::thread> threads;
+    for (size_t begin = 0; begin < ops.size(); begin += chunk) {
+      size_t end = std::min(ops.size(), begin + chunk);
+      threads.emplace_back([&, begin, end]() {
+        ResolveWalEdgeEnds(graph, ops, begin, end, src_lids, dst_lids);
+      });
+    }
+    for (auto& thrd : threads) {
+      thrd.join();
+    }
+  }
+
+  // 邻接表编号为 三元组编号 * 2 + 方向(0出边, 1入边)
+  size_t vertex_label_num = graph.schema().vertex_label_num();
+  size_t edge_label_num = graph.schema().edge_label_num();
+  std::vector<MutableCsrBase*> csrs(
+      vertex_label_num * vertex_label_num * edge_label_num * 2, nullptr);
+  std::vector<WalAdjOp> adj_ops;
+  adj_ops.reserve(ops.size() * 2);
+  for (size_t i = 0; i < ops.size(); ++i) {
+    const auto& op = ops[i];
+    uint32_t index = (op.src_label * vertex_label_num + op.dst_label) *
+                         edge_label_num +
+                     op.edge_label;
+    if (csrs[index * 2] == nullptr) {
+      csrs[index * 2] =
+          graph.get_oe_csr(op.src_label, op.dst_label, op.edge_label);
+      csrs[index * 2 + 1] =
+          graph.get_ie_csr(op.dst_label, op.src_label, op.edge_label);
+    }
+    adj_ops.push_back(WalAdjOp{index * 2, src_lids[i], dst_lids[i], op.ts,
+                               static_cast<uint32_t>(i)});
+    adj_ops.push_back(WalAdjOp{index * 2 + 1, dst_lids[i], src_lids[i], op.ts,
+                               static_cast<uint32_t>(i)});
+  }
+  std::vector<vid_t>().swap(src_lids);
+  std::vector<vid_t>().swap(dst_lids);
+  std::sort(adj_ops.begin(), adj_ops.end());
+
+  // 切分点对齐到(邻接表, 源点)的边界，同一个邻接表只由一个线程按时间戳顺序写入
+  std::vector<size_t> bounds(1, 0);
+  size_t chunk = (adj_ops.size() + thread_num - 1) / thread_num;
+  while (bounds.back() < adj_ops.size()) {
+    size_t pos = std::min(adj_ops.size(), bounds.back() + chunk);
+    while (pos < adj_ops.size() && adj_ops[pos].csr == adj_ops[pos - 1].csr &&
+           adj_ops[pos].v == adj_ops[pos - 1].v) {
+      ++pos;
+    }
+    bounds.push_back(pos);
+  }
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+    threads.emplace_back(
+        [&](size_t tid, size_t begin, size_t end) {
+          auto& alloc = contexts[tid].allocator;
+          for (size_t k = begin; k < end; ++k) {
+            const auto& adj_op = adj_ops[k];
+            csrs[adj_op.csr]->put_generic_edge(adj_op.v, adj_op.nbr,
+                                               ops[adj_op.op].data, adj_op.ts,
+                                               alloc);
+          }
+        },
+        i, bounds[i], bounds[i + 1]);
+  }
+  for (auto& thrd : threads) {
+    thrd.join();
+  }
+  LOG(INFO) << "Ingested WALs [" << from << ", " << to << ")";
+}
+
 void GraphDB::ingestWals(const std::vector<std::string>& wals,
                          const std::string& work_dir, int thread_num) {
   WalsParser parser(wals);
-  uint32_t from_ts = 1;
+  // 快照版本及之前的事务已包含在快照中
+  uint32_t snapshot_version = get_snapshot_version(work_dir);
+  uint32_t from_ts = snapshot_version + 1;
   for (auto& update_wal : parser.update_wals()) {
     uint32_t to_ts = update_wal.timestamp;
+    if (to_ts <= snapshot_version) {
+      continue;
+    }
     if (from_ts < to_ts) {
-      IngestWalRange(contexts_, graph_, parser, from_ts, to_ts, thread_num);
+      ingestWalRange(parser, from_ts, to_ts, thread_num);
     }
     UpdateTransaction::IngestWal(graph_, work_dir, to_ts, update_wal.ptr,
                                  update_wal.size, contexts_[0].allocator);
     from_ts = to_ts + 1;
   }
   if (from_ts <= parser.last_ts()) {
-    IngestWalRange(contexts_, graph_, parser, from_ts, parser.last_ts() + 1,
-                   thread_num);
+    ingestWalRange(parser, from_ts, parser.last_ts() + 1, thread_num);
+  }
+  version_manager_.init_ts(std::max(parser.last_ts(), snapshot_version));
+}
+
+void GraphDB::ingestWalRange(const WalsParser& parser, uint32_t from,
+                             uint32_t to, int thread_num) {
+  if (sorted_wal_replay_) {
+    IngestWalRangeSorted(contexts_, graph_, parser, from, to, thread_num);
+  } else {
+    IngestWalRange(contexts_, graph_, parser, from, to, thread_num);
   }
-  version_manager_.init_ts(parser.last_ts());
 }
 
 void GraphDB::initApps(const std::vector<std::string>& plugins) {
@@ -18,6 +18,7 @@
 
 #include <dlfcn.h>
 
+#include <atomic>
 #include <map>
 #include <mutex>
 #include <thread>
@@ -30,6 +31,7 @@
 #include "flex/engines/graph_db/database/single_vertex_insert_transaction.h"
 #include "flex/engines/graph_db/database/update_transaction.h"
 #include "flex/engines/graph_db/database/version_manager.h"
+#include "flex/engines/graph_db/database/wal.h"
 #include "flex/storages/rt_mutable_graph/loader/loader_factory.h"
 #include "flex/storages/rt_mutable_graph/mutable_property_fragment.h"
 
@@ -50,10 +52,33 @@ class GraphDB {
   void Init(const Schema& schema, const std::string& data_dir,
             int thread_num = 1);
 
+  /** @brief Persist a snapshot of all committed data. Only write transactions
+   * are paused while it runs; reads continue, and the graph stays usable
+   * afterwards. WAL files covered by the snapshot are removed.
+   *
+   * Inserts and updates block for the whole call: it writes the dirty pages
+   * of every structure and fdatasyncs every snapshot file before resuming
+   * them. Concurrent calls are serialized.
+   */
   void Checkpoint();
 
+  /** @brief Merge all edges into a compacted snapshot and reopen from it. */
   void CheckpointAndRestart();
 
+  /** @brief Set how committed transactions are persisted to WAL. Must be
+   * called before Init.
+   *
+   * @param mode kSync flushes in the committing thread, kGroup batches the
+   * fdatasync of concurrent commits, kAsync returns before the flush.
+   * @param group_delay_us Max time the flusher waits to gather a window.
+   */
+  void SetWalSyncMode(WalSyncMode mode, uint32_t group_delay_us = 0);
+
+  /** @brief Replay insert WALs sorted by adjacency list and source vertex
+   * instead of one WAL at a time. Must be called before Init.
+   */
+  void SetSortedWalReplay(bool sorted);
+
   /** @brief Create a transaction to read vertices and edges.
    *
    * @return graph_dir The directory of graph data.
@@ -105,14 +130,38 @@ class GraphDB {
 
   int SessionNum() const;
 
+  /** @brief Per app id query cost aggregated over all sessions, as JSON. */
+  std::string DumpQueryStats() const;
+
+  /** @brief Log queries slower than threshold_us with their input, 0 turns
+   * it off.
+   */
+  void SetSlowQueryThreshold(uint64_t threshold_us);
+
+  WalFlusher& wal_flusher() { return wal_flusher_; }
+
  private:
   void registerApp(const std::string& path, uint8_t index = 0);
 
   void ingestWals(const std::vector<std::string>& wals,
                   const std::string& work_dir, int thread_num);
 
+  void ingestWalRange(const WalsParser& parser, uint32_t from, uint32_t to,
+                      int thread_num);
+
   void initApps(const std::vector<std::string>& plugins);
 
+  // 关闭当前的WAL文件并从新文件开始写，删除已被快照覆盖的旧文件
+  void rotateWals();
+
+  // 后台线程定期合并邻接表的溢出块，与读、插入事务并发
+  void startCompactor();
+  void stopCompactor();
+  // 冻结所有读事务都能看到的边，由压缩线程周期性调用
+  void freezeEdges(uint32_t& frozen_ts);
+  // 回收所有读事务都不再需要的原地修改的旧版本，由压缩线程周期性调用
+  void reclaimVersions(uint32_t& reclaimed_ts);
+
   friend class GraphDBSession;
 
   std::string work_dir_;
@@ -122,6 +171,17 @@ class GraphDB {
   VersionManager version_manager_;
   std::array<std::string, 256> app_paths_;
   std::array<std::shared_ptr<AppFactoryBase>, 256> app_factories_;
+
+  WalSyncMode wal_sync_mode_ = WalSyncMode::kGroup;
+  uint32_t wal_group_delay_us_ = 0;
+  WalFlusher wal_flusher_;
+  bool sorted_wal_replay_ = true;
+
+  // Checkpoint和CheckpointAndRestart互斥，同时只有一个在写快照和轮转WAL
+  std::mutex checkpoint_mutex_;
+
+  std::thread compactor_;
+  std::atomic<bool> compactor_running_{false};
 };
 
 }  // namespace gs
@@ -19,6 +19,7 @@
 #include "flex/engines/graph_db/app/app_base.h"
 #include "flex/engines/graph_db/database/graph_db.h"
 #include "flex/utils/app_utils.h"
+#include "flex/utils/io_counters.h"
 #ifdef PROFILE_PAGE_FAULT
 #include "flex/graphscope_bufferpool/include/page_fault_monitor.h"
 #endif
@@ -50,9 +51,10 @@ SingleEdgeInsertTransaction GraphDBSession::GetSingleEdgeInsertTransaction() {
 }
 
 UpdateTransaction GraphDBSession::GetUpdateTransaction() {
-  uint32_t ts = db_.version_manager_.acquire_update_timestamp();
-  return UpdateTransaction(db_.graph_, alloc_, work_dir_, logger_,
-                           db_.version_manager_, ts);
+  uint32_t read_ts;
+  uint32_t ts = db_.version_manager_.acquire_update_timestamp(read_ts);
+  return UpdateTransaction(db_.graph_, alloc_, update_ws_, logger_,
+                           db_.version_manager_, ts, read_ts);
 }
 
 const MutablePropertyFragment& GraphDBSession::graph() const {
@@ -76,26 +78,38 @@ std::shared_ptr<RefColumnBase> GraphDBSession::get_vertex_id_column(
 
 // #define likely(x) __builtin_expect(!!(x), 1)
 
+static uint64_t thread_cpu_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
 std::vector<char> GraphDBSession::Eval(const std::string& input) {
+  std::vector<char> result_buffer;
+  Eval(input, result_buffer);
+  return result_buffer;
+}
+
+void GraphDBSession::Eval(const std::string& input,
+                          std::vector<char>& result_buffer) {
+  result_buffer.clear();
   // auto ts1 = gbp::GetSystemTime();
   uint8_t type = input.back();
   const char* str_data = input.data();
   size_t str_len = input.size() - 1;
 
-  std::vector<char> result_buffer;
-
   auto query_id_t = gbp::get_query_id().load();
 
   // assert((int) type == 31);
   // if (!((int) type == 7))
-  //   return result_buffer;
+  //   return;
   // if (gbp::get_query_id() != 38237)
-  //   return result_buffer;
+  //   return;
   // static size_t count = 0;
   // count++;
 
   // if (count > 3)
-  //   return result_buffer;
+  //   return;
   // // if ((int) type == 1)
   // //   assert(false);
   // LOG(INFO) << (int) type << " " << gbp::get_query_id().load() << " "
@@ -114,12 +128,38 @@ std::vector<char> GraphDBSession::Eval(const std::string& input) {
     if (app_wrappers_[type].app() == NULL) {
       LOG(ERROR) << "[Query-" + std::to_string((int) type)
                  << "] is not registered...";
-      return result_buffer;
+      return;
     } else {
       apps_[type] = app_wrappers_[type].app();
       app = apps_[type];
     }
   }
+  // 查询开始时的计数，在每个出口处与当前值求差后计入该app的统计
+  const IOCounters io_begin = io_counters_snapshot();
+  const uint64_t cpu_begin = thread_cpu_ns();
+  const uint64_t wall_begin = io_clock_ns();
+  uint32_t retries = 0;
+  auto record_query = [&](bool success) {
+    const IOCounters io = io_counters_snapshot() - io_begin;
+    QuerySample sample;
+    sample.requests = io.requests;
+    sample.misses = io.faults;
+    sample.bytes = io.bytes;
+    sample.cpu_ns = thread_cpu_ns() - cpu_begin;
+    sample.latency_ns = io_clock_ns() - wall_begin;
+    // 按查询计的等待时间：查询线程不在CPU上的时间，包括GetBlockSync和缺页
+    // 的阻塞以及等待预取结果，取页路径上不计时
+    sample.wait_ns = sample.latency_ns > sample.cpu_ns
+                         ? sample.latency_ns - sample.cpu_ns
+                         : 0;
+    sample.retries = retries;
+    sample.success = success;
+    query_stats_.Record(type, sample);
+    uint64_t threshold_us = QueryStats::SlowQueryThreshold();
+    if (threshold_us != 0 && sample.latency_ns >= threshold_us * 1000) {
+      QueryStats::LogSlowQuery(type, sample, input);
+    }
+  };
 #ifdef DEBUG_1
   gbp::get_counter(1) = 0;
   gbp::get_counter(2) = 0;
@@ -210,55 +250,87 @@ std::vector<char> GraphDBSession::Eval(const std::string& input) {
     // gbp::get_thread_logfile()
     //     << ts2 << " " << ts1 << " " << (int) type << std::endl;
 
-    return result_buffer;
+    record_query(true);
+    return;
   } else {
     LOG(INFO) << "query" << (int) type << " failed";
-    return result_buffer;
+    record_query(false);
+    return;
   }
 
   LOG(INFO) << "[Query-" << (int) type << "][Thread-" << thread_id_
             << "] retry - 1 / 3";
+  ++retries;
   std::this_thread::sleep_for(std::chrono::milliseconds(1));
 
   decoder.reset(str_data, str_len);
   result_buffer.clear();
 
   if (app->Query(decoder, encoder)) {
-    return result_buffer;
+    record_query(true);
+    return;
   }
 
   LOG(INFO) << "[Query-" << (int) type << "][Thread-" << thread_id_
             << "] retry - 2 / 3";
+  ++retries;
   std::this_thread::sleep_for(std::chrono::milliseconds(1));
 
   decoder.reset(str_data, str_len);
   result_buffer.clear();
 
   if (app->Query(decoder, encoder)) {
-    return result_buffer;
+    record_query(true);
+    return;
   }
 
   LOG(INFO) << "[Query-" << (int) type << "][Thread-" << thread_id_
             << "] retry - 3 / 3";
+  ++retries;
   std::this_thread::sleep_for(std::chrono::milliseconds(1));
 
   decoder.reset(str_data, str_len);
   result_buffer.clear();
 
   if (app->Query(decoder, encoder)) {
-    return result_buffer;
+    record_query(true);
+    return;
   }
   LOG(INFO) << "[Query-" << (int) type << "][Thread-" << thread_id_
             << "] failed after 3 retries";
 
   result_buffer.clear();
-  return result_buffer;
+  record_query(false);
 }  // namespace gs
 
 #undef likely
 
 void GraphDBSession::GetAppInfo(Encoder& result) { db_.GetAppInfo(result); }
 
+const QueryStats& GraphDBSession::query_stats() const { return query_stats_; }
+
+std::vector<char> GraphDBSession::AcquireResultBuffer() {
+  std::lock_guard<std::mutex> guard(result_buffers_lock_);
+  if (result_buffers_.empty()) {
+    return {};
+  }
+  std::vector<char> buf = std::move(result_buffers_.back());
+  result_buffers_.pop_back();
+  return buf;
+}
+
+void GraphDBSession::ReleaseResultBuffer(std::vector<char>&& buf) {
+  // 偶尔出现的超大结果不保留，避免长期占用内存
+  if (buf.capacity() > kMaxPooledResultBufferSize) {
+    return;
+  }
+  buf.clear();
+  std::lock_guard<std::mutex> guard(result_buffers_lock_);
+  if (result_buffers_.size() < kMaxPooledResultBufferNum) {
+    result_buffers_.emplace_back(std::move(buf));
+  }
+}
+
 int GraphDBSession::SessionId() const { return thread_id_; }
 
 }  // namespace gs
@@ -16,8 +16,12 @@
 #ifndef GRAPHSCOPE_DATABASE_GRAPH_DB_SESSION_H_
 #define GRAPHSCOPE_DATABASE_GRAPH_DB_SESSION_H_
 
+#include <mutex>
+#include <vector>
+
 #include "flex/engines/graph_db/app/app_base.h"
 #include "flex/engines/graph_db/database/insert_transaction.h"
+#include "flex/engines/graph_db/database/query_stats.h"
 #include "flex/engines/graph_db/database/read_transaction.h"
 #include "flex/engines/graph_db/database/single_edge_insert_transaction.h"
 #include "flex/engines/graph_db/database/single_vertex_insert_transaction.h"
@@ -82,8 +86,22 @@ class GraphDBSession {
 
   std::vector<char> Eval(const std::string& input);
 
+  // 结果编码到result中，result先被清空，已有的容量会被复用
+  void Eval(const std::string& input, std::vector<char>& result);
+
+  /**
+   * @brief 结果缓冲区池。服务端把Eval的结果直接交给网络层发送，发送完成后
+   * 归还，缓冲区的容量在之后的查询中复用，省去结果的复制和反复扩容。归还
+   * 可能发生在其他线程上。
+   */
+  std::vector<char> AcquireResultBuffer();
+  void ReleaseResultBuffer(std::vector<char>&& buf);
+
   void GetAppInfo(Encoder& result);
 
+  // 该会话上执行过的查询按app id汇总的开销
+  const QueryStats& query_stats() const;
+
   int SessionId() const;
 
  private:
@@ -92,9 +110,18 @@ class GraphDBSession {
   WalWriter& logger_;
   std::string work_dir_;
   int thread_id_;
+  // 该会话的更新事务依次复用
+  UpdateWorkspace update_ws_;
 
   std::array<AppWrapper, 256> app_wrappers_;
   std::array<AppBase*, 256> apps_;
+
+  static constexpr size_t kMaxPooledResultBufferNum = 32;
+  static constexpr size_t kMaxPooledResultBufferSize = 16 * 1024 * 1024;
+  std::mutex result_buffers_lock_;
+  std::vector<std::vector<char>> result_buffers_;
+
+  QueryStats query_stats_;
 };
 
 }  // namespace gs
@@ -62,15 +62,29 @@ bool InsertTransaction::AddVertex(label_t label, oid_t id,
     }
     serialize_field(arc_, prop);
   }
-  added_vertices_.emplace(label, id);
+  added_vertices_.emplace(std::make_pair(label, id),
+                          std::numeric_limits<vid_t>::max());
   return true;
 }
 
-bool InsertTransaction::AddEdge(label_t src_label, oid_t src, label_t dst_label,
-                                oid_t dst, label_t edge_label,
-                                const Any& prop) {
-  vid_t lid;
-  if (!graph_.get_lid(src_label, src, lid)) {
+bool InsertTransaction::resolve_vertex(label_t label, oid_t oid, vid_t& vid) {
+  auto key = std::make_pair(label, oid);
+  auto iter = resolved_vids_.find(key);
+  if (iter != resolved_vids_.end()) {
+    vid = iter->second;
+    return true;
+  }
+  if (!graph_.get_lid(label, oid, vid)) {
+    return false;
+  }
+  resolved_vids_.emplace(key, vid);
+  return true;
+}
+
+bool InsertTransaction::resolve_edge_ends(label_t src_label, oid_t src,
+                                          label_t dst_label, oid_t dst,
+                                          vid_t& src_vid, vid_t& dst_vid) {
+  if (!resolve_vertex(src_label, src, src_vid)) {
     if (added_vertices_.find(std::make_pair(src_label, src)) ==
         added_vertices_.end()) {
       std::string label_name = graph_.schema().get_vertex_label_name(src_label);
@@ -78,8 +92,9 @@ bool InsertTransaction::AddEdge(label_t src_label, oid_t src, label_t dst_label,
                  << "] not found...";
       return false;
     }
+    src_vid = std::numeric_limits<vid_t>::max();
   }
-  if (!graph_.get_lid(dst_label, dst, lid)) {
+  if (!resolve_vertex(dst_label, dst, dst_vid)) {
     if (added_vertices_.find(std::make_pair(dst_label, dst)) ==
         added_vertices_.end()) {
       std::string label_name = graph_.schema().get_vertex_label_name(dst_label);
@@ -87,6 +102,24 @@ bool InsertTransaction::AddEdge(label_t src_label, oid_t src, label_t dst_label,
                  << "] not found...";
       return false;
     }
+    dst_vid = std::numeric_limits<vid_t>::max();
+  }
+  return true;
+}
+
+bool InsertTransaction::AddEdge(label_t src_label, oid_t src, label_t dst_label,
+                                oid_t dst, label_t edge_label,
+                                const Any& prop) {
+  vid_t src_vid, dst_vid;
+  if (!resolve_edge_ends(src_label, src, dst_label, dst, src_vid, dst_vid)) {
+    return false;
+  }
+  if (graph_.schema()
+          .get_edge_properties(src_label, dst_label, edge_label)
+          .size() > 1) {
+    LOG(ERROR) << "Edge " << graph_.schema().get_edge_label_name(edge_label)
+               << " has multiple properties, a single value is not enough";
+    return false;
   }
   const PropertyType& type =
       graph_.schema().get_edge_property(src_label, dst_label, edge_label);
@@ -99,6 +132,41 @@ bool InsertTransaction::AddEdge(label_t src_label, oid_t src, label_t dst_label,
   arc_ << static_cast<uint8_t>(1) << src_label << src << dst_label << dst
        << edge_label;
   serialize_field(arc_, prop);
+  parsed_endpoints_.push_back(src_vid);
+  parsed_endpoints_.push_back(dst_vid);
+  return true;
+}
+
+bool InsertTransaction::AddEdge(label_t src_label, oid_t src, label_t dst_label,
+                                oid_t dst, label_t edge_label,
+                                const std::vector<Any>& props) {
+  vid_t src_vid, dst_vid;
+  if (!resolve_edge_ends(src_label, src, dst_label, dst, src_vid, dst_vid)) {
+    return false;
+  }
+  const std::vector<PropertyType>& types =
+      graph_.schema().get_edge_properties(src_label, dst_label, edge_label);
+  std::string label_name = graph_.schema().get_edge_label_name(edge_label);
+  if (types.size() != props.size()) {
+    LOG(ERROR) << "Edge " << label_name << " properties size not match, expected "
+               << types.size() << ", got " << props.size();
+    return false;
+  }
+  for (size_t i = 0; i < types.size(); ++i) {
+    if (props[i].type != types[i]) {
+      LOG(ERROR) << "Edge property " << label_name << "[" << i
+                 << "] type not match, expected " << types[i] << ", got "
+                 << props[i].type;
+      return false;
+    }
+  }
+  arc_ << static_cast<uint8_t>(1) << src_label << src << dst_label << dst
+       << edge_label;
+  for (auto& prop : props) {
+    serialize_field(arc_, prop);
+  }
+  parsed_endpoints_.push_back(src_vid);
+  parsed_endpoints_.push_back(dst_vid);
   return true;
 }
 
@@ -117,8 +185,7 @@ void InsertTransaction::Commit() {
   header->timestamp = timestamp_;
 
   logger_.append(arc_.GetBuffer(), arc_.GetSize());
-  IngestWal(graph_, timestamp_, arc_.GetBuffer() + sizeof(WalHeader),
-            header->length, alloc_);
+  ingestWal();
 
   vm_.release_insert_timestamp(timestamp_);
   clear();
@@ -167,10 +234,92 @@ void InsertTransaction::IngestWal(MutablePropertyFragment& graph,
   }
 }
 
+void InsertTransaction::DecodeWal(MutablePropertyFragment& graph,
+                                  uint32_t timestamp, char* data,
+                                  size_t length,
+                                  std::vector<WalEdgeOp>& edges) {
+  grape::OutArchive arc;
+  arc.SetSlice(data, length);
+  while (!arc.Empty()) {
+    uint8_t op_type;
+    arc >> op_type;
+    if (op_type == 0) {
+      label_t label;
+      oid_t id;
+
+      arc >> label >> id;
+      vid_t lid = graph.add_vertex(label, id);
+      graph.get_vertex_table(label).ingest(lid, arc);
+    } else if (op_type == 1) {
+      WalEdgeOp op;
+      arc >> op.src_label >> op.src >> op.dst_label >> op.dst >>
+          op.edge_label;
+      op.ts = timestamp;
+      auto* edge_table =
+          graph.get_edge_table(op.src_label, op.dst_label, op.edge_label);
+      if (edge_table != nullptr) {
+        // 边属性表中的属性按边id顺序写入，与邻接表的顺序无关，在解码时直接写入
+        edge_id_t eid = edge_table->allocate();
+        edge_table->ingest(eid, arc);
+        op.data = Any::From(eid);
+      } else {
+        const auto& props = graph.schema().get_edge_properties(
+            op.src_label, op.dst_label, op.edge_label);
+        op.data.type = props.empty() ? PropertyType::kEmpty : props[0];
+        deserialize_field(arc, op.data);
+      }
+      edges.emplace_back(op);
+    } else {
+      LOG(FATAL) << "Unexpected op-" << static_cast<int>(op_type);
+    }
+  }
+}
+
+void InsertTransaction::ingestWal() {
+  grape::OutArchive arc;
+  arc.SetSlice(arc_.GetBuffer() + sizeof(WalHeader),
+               arc_.GetSize() - sizeof(WalHeader));
+  const vid_t* vid_ptr = parsed_endpoints_.data();
+  while (!arc.Empty()) {
+    uint8_t op_type;
+    arc >> op_type;
+    if (op_type == 0) {
+      label_t label;
+      oid_t id;
+
+      arc >> label >> id;
+      vid_t lid = graph_.add_vertex(label, id);
+      graph_.get_vertex_table(label).ingest(lid, arc);
+      added_vertices_[std::make_pair(label, id)] = lid;
+    } else if (op_type == 1) {
+      label_t src_label, dst_label, edge_label;
+      oid_t src, dst;
+
+      arc >> src_label >> src >> dst_label >> dst >> edge_label;
+
+      vid_t src_vid = *(vid_ptr++);
+      if (src_vid == std::numeric_limits<vid_t>::max()) {
+        src_vid = added_vertices_.at(std::make_pair(src_label, src));
+      }
+      vid_t dst_vid = *(vid_ptr++);
+      if (dst_vid == std::numeric_limits<vid_t>::max()) {
+        dst_vid = added_vertices_.at(std::make_pair(dst_label, dst));
+      }
+
+      graph_.IngestEdge(src_label, src_vid, dst_label, dst_vid, edge_label,
+                        timestamp_, arc, alloc_);
+    } else {
+      LOG(FATAL) << "Unexpected op-" << static_cast<int>(op_type);
+    }
+  }
+}
+
 void InsertTransaction::clear() {
   arc_.Clear();
   arc_.Resize(sizeof(WalHeader));
   added_vertices_.clear();
+  resolved_vids_.clear();
+  parsed_endpoints_.clear();
 
   timestamp_ = std::numeric_limits<timestamp_t>::max();
 }
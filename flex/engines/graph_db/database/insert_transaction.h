@@ -17,6 +17,9 @@
 #define GRAPHSCOPE_DATABASE_INSERT_TRANSACTION_H_
 
 #include <limits>
+#include <map>
+#include <utility>
+#include <vector>
 
 #include "flex/storages/rt_mutable_graph/types.h"
 #include "flex/utils/property/types.h"
@@ -29,6 +32,17 @@ class WalWriter;
 class VersionManager;
 class MMapAllocator;
 
+// WAL重放时解码出的一条插入边，端点仍是oid，属性已经解码
+struct WalEdgeOp {
+  oid_t src;
+  oid_t dst;
+  Any data;
+  timestamp_t ts;
+  label_t src_label;
+  label_t dst_label;
+  label_t edge_label;
+};
+
 class InsertTransaction {
  public:
   InsertTransaction(MutablePropertyFragment& graph, MMapAllocator& alloc,
@@ -42,6 +56,10 @@ class InsertTransaction {
   bool AddEdge(label_t src_label, oid_t src, label_t dst_label, oid_t dst,
                label_t edge_label, const Any& prop);
 
+  // 多属性边，props按schema中边属性的顺序给出
+  bool AddEdge(label_t src_label, oid_t src, label_t dst_label, oid_t dst,
+               label_t edge_label, const std::vector<Any>& props);
+
   void Commit();
 
   void Abort();
@@ -51,15 +69,37 @@ class InsertTransaction {
   static void IngestWal(MutablePropertyFragment& graph, uint32_t timestamp,
                         char* data, size_t length, MMapAllocator& alloc);
 
+  /** @brief Decode an insert WAL for batched replay. Vertices are added to
+   * the graph right away, edges are only appended to edges so that the
+   * caller can resolve and apply them in adjacency-list order.
+   */
+  static void DecodeWal(MutablePropertyFragment& graph, uint32_t timestamp,
+                        char* data, size_t length,
+                        std::vector<WalEdgeOp>& edges);
+
  private:
   void clear();
 
+  // 校验边的两个端点存在，并把解析出的vid记录到parsed_endpoints_中
+  bool resolve_edge_ends(label_t src_label, oid_t src, label_t dst_label,
+                         oid_t dst, vid_t& src_vid, vid_t& dst_vid);
+
+  // 查询图中已有顶点的vid，同一事务中重复出现的端点只查一次索引
+  bool resolve_vertex(label_t label, oid_t oid, vid_t& vid);
+
+  // 提交时按arc_中的顺序写入图，边直接使用AddEdge时解析出的vid
+  void ingestWal();
+
   static bool get_vertex_with_retries(MutablePropertyFragment& graph,
                                       label_t label, oid_t oid, vid_t& lid);
 
   grape::InArchive arc_;
 
-  std::set<std::pair<label_t, oid_t>> added_vertices_;
+  // 事务中新增的顶点，提交时写入图后记录其vid
+  std::map<std::pair<label_t, oid_t>, vid_t> added_vertices_;
+  std::map<std::pair<label_t, oid_t>, vid_t> resolved_vids_;
+  // 每条边的(src, dst)，端点是本事务新增的顶点时为max()，提交时再映射
+  std::vector<vid_t> parsed_endpoints_;
 
   MutablePropertyFragment& graph_;
   MMapAllocator& alloc_;
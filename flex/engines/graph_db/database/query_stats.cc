@@ -0,0 +1,158 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flex/engines/graph_db/database/query_stats.h"
+
+#include "glog/logging.h"
+
+namespace gs {
+
+namespace {
+
+std::atomic<uint64_t> slow_query_threshold_us(0);
+
+size_t bucket_of(uint64_t ns) {
+  uint64_t us = ns / 1000;
+  if (us == 0) {
+    return 0;
+  }
+  size_t idx = 63 - __builtin_clzll(us);
+  return idx < QueryStats::kBucketNum ? idx : QueryStats::kBucketNum - 1;
+}
+
+inline void add(std::atomic<uint64_t>& counter, uint64_t value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+}
+
+std::string hist_to_json(const std::array<uint64_t, QueryStats::kBucketNum>&
+                             hist) {
+  // 去掉末尾的空桶
+  size_t len = hist.size();
+  while (len > 0 && hist[len - 1] == 0) {
+    --len;
+  }
+  std::string ret = "[";
+  for (size_t i = 0; i < len; ++i) {
+    if (i != 0) {
+      ret += ",";
+    }
+    ret += std::to_string(hist[i]);
+  }
+  ret += "]";
+  return ret;
+}
+
+}  // namespace
+
+void QueryStats::Record(uint8_t app, const QuerySample& sample) {
+  // 只有本会话的线程写入，不需要原子的读-改-写
+  auto& entry = entries_[app];
+  add(entry.count, 1);
+  if (!sample.success) {
+    add(entry.failures, 1);
+  }
+  add(entry.retries, sample.retries);
+  add(entry.requests, sample.requests);
+  add(entry.misses, sample.misses);
+  add(entry.bytes, sample.bytes);
+  add(entry.wait_ns, sample.wait_ns);
+  add(entry.cpu_ns, sample.cpu_ns);
+  add(entry.latency_ns, sample.latency_ns);
+  add(entry.latency_hist[bucket_of(sample.latency_ns)], 1);
+  add(entry.wait_hist[bucket_of(sample.wait_ns)], 1);
+}
+
+void QueryStats::SetSlowQueryThreshold(uint64_t threshold_us) {
+  slow_query_threshold_us.store(threshold_us, std::memory_order_relaxed);
+}
+
+uint64_t QueryStats::SlowQueryThreshold() {
+  return slow_query_threshold_us.load(std::memory_order_relaxed);
+}
+
+void QueryStats::LogSlowQuery(uint8_t app, const QuerySample& sample,
+                              const std::string& input) {
+  static const char digits[] = "0123456789abcdef";
+  std::string hex;
+  hex.reserve(input.size() * 2);
+  for (unsigned char c : input) {
+    hex.push_back(digits[c >> 4]);
+    hex.push_back(digits[c & 0xf]);
+  }
+  LOG(WARNING) << "[Query-" << (int) app << "] slow query: latency "
+               << sample.latency_ns / 1000 << "us, cpu "
+               << sample.cpu_ns / 1000 << "us, io wait "
+               << sample.wait_ns / 1000 << "us, " << sample.requests
+               << " requests, " << sample.misses << " misses, "
+               << sample.bytes << " bytes, " << sample.retries
+               << " retries, input: " << hex;
+}
+
+std::string QueryStats::ToJson(const std::vector<const QueryStats*>& stats) {
+  // 缓冲池不返回是否命中，也不在取页路径上计时；未命中数和等待时间的来源
+  // 写在结果中，缓冲池自己的I/O线程上的读取不计入bp_misses
+  std::string ret = "{\"slow_query_threshold_us\":" +
+                    std::to_string(SlowQueryThreshold()) +
+                    ",\"bp_misses_source\":\"major_page_faults\""
+                    ",\"io_wait_source\":\"off_cpu_time\",\"apps\":[";
+  bool first = true;
+  for (size_t app = 0; app < kAppNum; ++app) {
+    uint64_t count = 0, failures = 0, retries = 0, requests = 0, misses = 0,
+             bytes = 0, wait_ns = 0, cpu_ns = 0, latency_ns = 0;
+    std::array<uint64_t, kBucketNum> latency_hist{}, wait_hist{};
+    for (auto* s : stats) {
+      auto& entry = s->entries_[app];
+      count += entry.count.load(std::memory_order_relaxed);
+      failures += entry.failures.load(std::memory_order_relaxed);
+      retries += entry.retries.load(std::memory_order_relaxed);
+      requests += entry.requests.load(std::memory_order_relaxed);
+      misses += entry.misses.load(std::memory_order_relaxed);
+      bytes += entry.bytes.load(std::memory_order_relaxed);
+      wait_ns += entry.wait_ns.load(std::memory_order_relaxed);
+      cpu_ns += entry.cpu_ns.load(std::memory_order_relaxed);
+      latency_ns += entry.latency_ns.load(std::memory_order_relaxed);
+      for (size_t i = 0; i < kBucketNum; ++i) {
+        latency_hist[i] += entry.latency_hist[i].load(std::memory_order_relaxed);
+        wait_hist[i] += entry.wait_hist[i].load(std::memory_order_relaxed);
+      }
+    }
+    if (count == 0) {
+      continue;
+    }
+    if (!first) {
+      ret += ",";
+    }
+    first = false;
+    ret += "{\"app\":" + std::to_string(app) +
+           ",\"count\":" + std::to_string(count) +
+           ",\"failures\":" + std::to_string(failures) +
+           ",\"retries\":" + std::to_string(retries) +
+           ",\"bp_requests\":" + std::to_string(requests) +
+           ",\"bp_hits\":" +
+           std::to_string(requests > misses ? requests - misses : 0) +
+           ",\"bp_misses\":" + std::to_string(misses) +
+           ",\"bp_bytes\":" + std::to_string(bytes) +
+           ",\"io_wait_us\":" + std::to_string(wait_ns / 1000) +
+           ",\"cpu_us\":" + std::to_string(cpu_ns / 1000) +
+           ",\"latency_us\":" + std::to_string(latency_ns / 1000) +
+           ",\"latency_hist_us\":" + hist_to_json(latency_hist) +
+           ",\"io_wait_hist_us\":" + hist_to_json(wait_hist) + "}";
+  }
+  ret += "]}";
+  return ret;
+}
+
+}  // namespace gs
@@ -0,0 +1,82 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GRAPHSCOPE_DATABASE_QUERY_STATS_H_
+#define GRAPHSCOPE_DATABASE_QUERY_STATS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gs {
+
+// 单次查询的开销，requests、bytes和misses取自该线程的IOCounters在查询前后
+// 的差，misses为major page fault数；wait_ns为查询线程不在CPU上的时间
+struct QuerySample {
+  uint64_t requests = 0;
+  uint64_t misses = 0;
+  uint64_t bytes = 0;
+  uint64_t wait_ns = 0;
+  uint64_t cpu_ns = 0;
+  uint64_t latency_ns = 0;
+  uint32_t retries = 0;
+  bool success = true;
+};
+
+/**
+ * @brief 按app id汇总查询的开销，每个会话一份，只由该会话的线程写入，
+ * 统计接口在其他线程上读取并合并所有会话，因此计数都是relaxed的原子变量。
+ * 延迟和I/O等待时间各有一个以微秒为单位的log2直方图，第i个桶统计
+ * [2^i, 2^(i+1))微秒的查询，最后一个桶包含更大的值。
+ */
+class QueryStats {
+ public:
+  static constexpr size_t kAppNum = 256;
+  static constexpr size_t kBucketNum = 32;
+
+  void Record(uint8_t app, const QuerySample& sample);
+
+  // 超过阈值的查询连同输入一起写到日志中，0表示关闭
+  static void SetSlowQueryThreshold(uint64_t threshold_us);
+  static uint64_t SlowQueryThreshold();
+
+  static void LogSlowQuery(uint8_t app, const QuerySample& sample,
+                           const std::string& input);
+
+  static std::string ToJson(const std::vector<const QueryStats*>& stats);
+
+ private:
+  struct Entry {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> failures{0};
+    std::atomic<uint64_t> retries{0};
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> wait_ns{0};
+    std::atomic<uint64_t> cpu_ns{0};
+    std::atomic<uint64_t> latency_ns{0};
+    std::array<std::atomic<uint64_t>, kBucketNum> latency_hist{};
+    std::array<std::atomic<uint64_t>, kBucketNum> wait_hist{};
+  };
+
+  std::array<Entry, kAppNum> entries_;
+};
+
+}  // namespace gs
+
+#endif  // GRAPHSCOPE_DATABASE_QUERY_STATS_H_
@@ -34,8 +34,13 @@ void ReadTransaction::Commit() { release(); }
 void ReadTransaction::Abort() { release(); }
 
 ReadTransaction::vertex_iterator::vertex_iterator(
-    label_t label, vid_t cur, vid_t num, const MutablePropertyFragment& graph)
-    : label_(label), cur_(cur), num_(num), graph_(graph) {}
+    label_t label, vid_t cur, vid_t num, const MutablePropertyFragment& graph,
+    timestamp_t timestamp)
+    : label_(label),
+      cur_(cur),
+      num_(num),
+      graph_(graph),
+      timestamp_(timestamp) {}
 ReadTransaction::vertex_iterator::~vertex_iterator() = default;
 
 bool ReadTransaction::vertex_iterator::IsValid() const { return cur_ < num_; }
@@ -55,7 +60,9 @@ Any ReadTransaction::vertex_iterator::GetField(int col_id) const {
 }
 #else
 gbp::BufferBlock ReadTransaction::vertex_iterator::GetField(int col_id) const {
-  return graph_.get_vertex_table(label_).get_column_by_id(col_id)->get(cur_);
+  return get_versioned(
+      *graph_.get_vertex_table(label_).get_column_by_id(col_id), cur_,
+      timestamp_);
 }
 #endif
 
@@ -65,10 +72,14 @@ int ReadTransaction::vertex_iterator::FieldNum() const {
 
 ReadTransaction::edge_iterator::edge_iterator(
     label_t neighbor_label, label_t edge_label,
-    std::shared_ptr<MutableCsrConstEdgeIterBase> iter)
+    std::shared_ptr<MutableCsrConstEdgeIterBase> iter,
+    const CellVersions* versions, vid_t v, timestamp_t timestamp)
     : neighbor_label_(neighbor_label),
       edge_label_(edge_label),
-      iter_(std::move(iter)) {}
+      iter_(std::move(iter)),
+      versions_(versions),
+      v_(v),
+      timestamp_(timestamp) {}
 ReadTransaction::edge_iterator::~edge_iterator() = default;
 
 #if OV
@@ -77,7 +88,15 @@ Any ReadTransaction::edge_iterator::GetData() const {
 }
 #else
 const void* ReadTransaction::edge_iterator::GetData() const {
-  return iter_->get_data();
+  const void* data = iter_->get_data();
+  if (versions_ != nullptr) {
+    auto* old = versions_->find(edge_version_key(v_, iter_->get_neighbor()),
+                                timestamp_);
+    if (old != nullptr) {
+      return old->data();
+    }
+  }
+  return data;
 }
 #endif
 
@@ -101,16 +120,17 @@ label_t ReadTransaction::edge_iterator::GetEdgeLabel() const {
 
 ReadTransaction::vertex_iterator ReadTransaction::GetVertexIterator(
     label_t label) const {
-  return {label, 0, graph_.vertex_num(label), graph_};
+  return {label, 0, graph_.vertex_num(label), graph_, timestamp_};
 }
 
 ReadTransaction::vertex_iterator ReadTransaction::FindVertex(label_t label,
                                                              oid_t id) const {
   vid_t lid;
   if (graph_.get_lid(label, id, lid)) {
-    return {label, lid, graph_.vertex_num(label), graph_};
+    return {label, lid, graph_.vertex_num(label), graph_, timestamp_};
   } else {
-    return {label, graph_.vertex_num(label), graph_.vertex_num(label), graph_};
+    return {label, graph_.vertex_num(label), graph_.vertex_num(label), graph_,
+            timestamp_};
   }
 }
 
@@ -119,6 +139,18 @@ bool ReadTransaction::GetVertexIndex(label_t label, oid_t id,
   return graph_.get_lid(label, id, index);
 }
 
+bool ReadTransaction::FindEdge(label_t src_label, vid_t src, label_t dst_label,
+                               vid_t dst, label_t edge_label,
+                               Any& data) const {
+  // 不保存出边时oe是EmptyCsr，找不到再查dst的入边
+  auto oe = graph_.get_oe_csr(src_label, dst_label, edge_label);
+  if (oe != nullptr && oe->find_edge(src, dst, timestamp_, data)) {
+    return true;
+  }
+  auto ie = graph_.get_ie_csr(dst_label, src_label, edge_label);
+  return ie != nullptr && ie->find_edge(dst, src, timestamp_, data);
+}
+
 vid_t ReadTransaction::GetVertexNum(label_t label) const {
   return graph_.vertex_num(label);
 }
@@ -129,18 +161,33 @@ oid_t ReadTransaction::GetVertexId(label_t label, vid_t index) const {
 
 ReadTransaction::edge_iterator ReadTransaction::GetOutEdgeIterator(
     label_t label, vid_t u, label_t neighnor_label, label_t edge_label) const {
-  return {neighnor_label, edge_label,
-          graph_.get_outgoing_edges(label, u, neighnor_label, edge_label)};
+  auto csr = graph_.get_oe_csr(label, neighnor_label, edge_label);
+  return {neighnor_label,
+          edge_label,
+          graph_.get_outgoing_edges(label, u, neighnor_label, edge_label),
+          csr == nullptr ? nullptr : &csr->versions(),
+          u,
+          timestamp_};
 }
 
 ReadTransaction::edge_iterator ReadTransaction::GetInEdgeIterator(
     label_t label, vid_t u, label_t neighnor_label, label_t edge_label) const {
-  return {neighnor_label, edge_label,
-          graph_.get_incoming_edges(label, u, neighnor_label, edge_label)};
+  auto csr = graph_.get_ie_csr(label, neighnor_label, edge_label);
+  return {neighnor_label,
+          edge_label,
+          graph_.get_incoming_edges(label, u, neighnor_label, edge_label),
+          csr == nullptr ? nullptr : &csr->versions(),
+          u,
+          timestamp_};
 }
 
 const Schema& ReadTransaction::schema() const { return graph_.schema(); }
 
+const EdgePropertyTable* ReadTransaction::GetEdgeTable(
+    label_t src_label, label_t dst_label, label_t edge_label) const {
+  return graph_.get_edge_table(src_label, dst_label, edge_label);
+}
+
 void ReadTransaction::release() {
   if (timestamp_ != std::numeric_limits<timestamp_t>::max()) {
     vm_.release_read_timestamp();
@@ -162,6 +209,7 @@ std::vector<oid_t> ReadTransaction::BatchGetVertexIds(
     requests[i] = graph_.get_oid_batch(label, indices[i]);
   }
   buffer_pool_manager_->GetBlockBatch(requests, blocks);
+  record_block_batch(blocks);
   for (size_t i = 0; i < indices.size(); ++i) {
     oids[i] = gbp::BufferBlock::Ref<oid_t>(blocks[i]);
   }
@@ -169,18 +217,13 @@ std::vector<oid_t> ReadTransaction::BatchGetVertexIds(
   return std::move(oids);
 }
 
-// TODO: 该函数暂时不实现，其中包含查找过程，实现比较复杂
 std::pair<std::vector<vid_t>, std::vector<bool>>
 ReadTransaction::BatchGetVertexIndices(label_t label,
                                        const std::vector<oid_t>& oids) const {
-  assert(false);
-
-  std::vector<vid_t> indices(oids.size());
-  std::vector<bool> exists(oids.size());
-  for (size_t i = 0; i < oids.size(); ++i) {
-    exists[i] = graph_.get_lid(label, oids[i], indices[i]);
-  }
-  return {indices, exists};
+  std::vector<vid_t> indices;
+  std::vector<bool> exists;
+  graph_.get_lid_batch(label, oids, indices, exists);
+  return {std::move(indices), std::move(exists)};
 }
 
 std::vector<gbp::BufferBlock> ReadTransaction::BatchGetOutgoingSingleEdges(
@@ -191,11 +234,15 @@ std::vector<gbp::BufferBlock> ReadTransaction::BatchGetOutgoingSingleEdges(
 
   std::vector<gbp::batch_request_type> requests;
 
+  auto csr = graph_.get_oe_csr(v_label, neighbor_label, edge_label);
   for (auto v : vids) {
-    auto csr = graph_.get_oe_csr(v_label, neighbor_label, edge_label);
     requests.emplace_back(csr->get_edges_batch(v));
   }
   buffer_pool_manager_->GetBlockBatch(requests, blocks);
+  record_block_batch(blocks);
+  for (size_t i = 0; i < vids.size(); ++i) {
+    csr->resolve_version(vids[i], timestamp_, blocks[i]);
+  }
 
   return std::move(blocks);
 }
@@ -208,11 +255,15 @@ std::vector<gbp::BufferBlock> ReadTransaction::BatchGetIncomingSingleEdges(
 
   std::vector<gbp::batch_request_type> requests;
 
+  auto csr = graph_.get_ie_csr(v_label, neighbor_label, edge_label);
   for (auto v : vids) {
-    auto csr = graph_.get_ie_csr(v_label, neighbor_label, edge_label);
     requests.emplace_back(csr->get_edges_batch(v));
   }
   buffer_pool_manager_->GetBlockBatch(requests, blocks);
+  record_block_batch(blocks);
+  for (size_t i = 0; i < vids.size(); ++i) {
+    csr->resolve_version(vids[i], timestamp_, blocks[i]);
+  }
 
   return std::move(blocks);
 }
@@ -223,6 +274,7 @@ ReadTransaction::BatchGetVertexPropsFromVids(
     const std::vector<std::string>& prop_names) const {
   std::vector<gbp::batch_request_type> requests;
   std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> string_column_idxs;
+  std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> dict_column_idxs;
   auto& table = graph_.get_vertex_table(label_id);
 
   // 获取所有列
@@ -238,6 +290,14 @@ ReadTransaction::BatchGetVertexPropsFromVids(
     auto column = columns[column_idx];
     switch (column->type()) {
     case PropertyType::kString: {
+      auto dict_column = std::dynamic_pointer_cast<StringDictColumn>(column);
+      if (dict_column != nullptr) {
+        for (auto vid : vids) {
+          requests.emplace_back(dict_column->get_stringview_batch(vid));
+          dict_column_idxs.emplace_back(column_idx, vid, requests.size() - 1);
+        }
+        break;
+      }
       auto string_column = std::dynamic_pointer_cast<StringColumn>(column);
       CHECK(string_column != nullptr);
       for (auto vid : vids) {
@@ -281,6 +341,15 @@ ReadTransaction::BatchGetVertexPropsFromVids(
   std::vector<gbp::BufferBlock> blocks;
   blocks.reserve(requests.size());
   buffer_pool_manager_->GetBlockBatch(requests, blocks);
+  record_block_batch(blocks);
+
+  // 字典编码的列第一轮取回的是编码，直接在内存中的字典里解码
+  for (auto& idx : dict_column_idxs) {
+    auto& block = blocks[std::get<2>(idx)];
+    block = std::dynamic_pointer_cast<StringDictColumn>(
+                columns[std::get<0>(idx)])
+                ->decode(std::get<1>(idx), block);
+  }
 
   // 对string需要特别处理
   {
@@ -296,6 +365,7 @@ ReadTransaction::BatchGetVertexPropsFromVids(
     std::vector<gbp::BufferBlock> blocks_tmp;
     blocks_tmp.reserve(requests.size());
     buffer_pool_manager_->GetBlockBatch(requests, blocks_tmp);
+    record_block_batch(blocks_tmp);
     for (size_t i = 0; i < string_column_idxs.size(); i++) {
       blocks[std::get<2>(string_column_idxs[i])] = blocks_tmp[i];
     }
@@ -309,6 +379,19 @@ ReadTransaction::BatchGetVertexPropsFromVids(
     for (size_t vid_idx = 0; vid_idx < vids.size(); vid_idx++) {
       results_vec[column_idx][vid_idx] = blocks[result_idx++];
     }
+    // 读时间戳之后被原地修改过的属性换回旧值
+    auto& versions = columns[column_idx]->versions();
+    if (!versions.newer_than(timestamp_)) {
+      continue;
+    }
+    for (size_t vid_idx = 0; vid_idx < vids.size(); vid_idx++) {
+      auto* old = versions.find(vids[vid_idx], timestamp_);
+      if (old != nullptr) {
+        gbp::BufferBlock block(old->size());
+        ::memcpy(block.Data(), old->data(), old->size());
+        results_vec[column_idx][vid_idx] = block;
+      }
+    }
   }
 
   return std::move(results_vec);
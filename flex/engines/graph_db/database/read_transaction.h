@@ -16,12 +16,20 @@
 #ifndef GRAPHSCOPE_DATABASE_READ_TRANSACTION_H_
 #define GRAPHSCOPE_DATABASE_READ_TRANSACTION_H_
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <utility>
 
 #include "flex/storages/rt_mutable_graph/mutable_csr.h"
 #include "flex/storages/rt_mutable_graph/mutable_property_fragment.h"
 #include "flex/storages/rt_mutable_graph/types.h"
+#include "flex/utils/io_counters.h"
 
 namespace gs {
 
@@ -94,9 +102,13 @@ class AdjListView {
   using slice_t = MutableNbrSlice<EDATA_T>;
   using sliceiter_t = TypedMutableCsrConstEdgeIter<EDATA_T>;
 
+  // 增量段中所有的边都可见时不再逐条检查时间戳
   AdjListView(const slice_t& slice, timestamp_t timestamp)
-      : edges_(sliceiter_t(slice)), timestamp_(timestamp) {
-    while (edges_.is_valid() && edges_.get_timestamp() > timestamp_) {
+      : edges_(sliceiter_t(slice)),
+        timestamp_(timestamp),
+        check_ts_(slice.max_ts_ > timestamp) {
+    while (check_ts_ && edges_.is_valid() &&
+           edges_.get_timestamp() > timestamp_) {
       edges_.next();
     }
   }
@@ -108,30 +120,51 @@ class AdjListView {
     }
   }
 
+  AdjListView(const gbp::BufferBlock base_slice, int base_size,
+              size_t base_bytes, const gbp::BufferBlock slice, int size,
+              timestamp_t timestamp,
+              const MutableNbrChunks<EDATA_T>* chunks = nullptr,
+              u_int32_t chunk_head = MutableNbrChunks<EDATA_T>::kNullChunk,
+              size_t chunk_edge_num = 0)
+      : edges_(sliceiter_t(base_slice, base_size, base_bytes, slice, size,
+                           chunks, chunk_head, chunk_edge_num)),
+        timestamp_(timestamp) {
+    while (edges_.is_valid() && edges_.get_timestamp() > timestamp_) {
+      edges_.next();
+    }
+  }
+
   FORCE_INLINE vid_t get_neighbor() { return edges_.get_neighbor(); }
 
-  FORCE_INLINE const void* get_data() { return edges_.get_data(); }
+  // 之后被原地修改过的边返回timestamp_时的旧值
+  FORCE_INLINE const void* get_data() { return edges_.get_data(timestamp_); }
 
   FORCE_INLINE timestamp_t get_timestamp() { return edges_.get_timestamp(); }
 
   FORCE_INLINE void next() {
     edges_.next();
-    while (edges_.is_valid() && edges_.get_timestamp() > timestamp_) {
+    while (check_ts_ && edges_.is_valid() &&
+           edges_.get_timestamp() > timestamp_) {
       edges_.next();
     }
   }
 
   FORCE_INLINE bool is_valid() {
-    return edges_.is_valid() && edges_.get_timestamp() <= timestamp_;
+    return edges_.is_valid() &&
+           (!check_ts_ || edges_.get_timestamp() <= timestamp_);
   }
   FORCE_INLINE void recover() { edges_.recover(); }
   FORCE_INLINE void free() { edges_.free(); }
+  void set_versions(const CellVersions* versions, vid_t v) {
+    edges_.set_versions(versions, v);
+  }
   int estimated_degree() const { return edges_.size(); }
   timestamp_t timestamp() const { return timestamp_; }
 
  private:
   sliceiter_t edges_;
   timestamp_t timestamp_;
+  bool check_ts_ = true;
 };
 #endif
 template <typename EDATA_T>
@@ -143,6 +176,25 @@ class GraphView {
   AdjListView<EDATA_T> get_edges(vid_t v) const {
     return AdjListView<EDATA_T>(csr_.get_edges(v), timestamp_);
   }
+#if !OV
+  // 快照中的邻接表按schema的edge_sort_order排列时二分查找，只读取相关的页
+  bool contains(vid_t v, vid_t neighbor) const {
+    return csr_.contains(v, neighbor, timestamp_);
+  }
+
+  // neighbor位于[lo, hi)中的边
+  void get_edges_by_neighbor(
+      vid_t v, vid_t lo, vid_t hi,
+      std::vector<ImmutableNbr<EDATA_T>>& edges) const {
+    csr_.get_edges_by_neighbor(v, lo, hi, timestamp_, edges);
+  }
+
+  // 边数据位于[lo, hi)中的边
+  void get_edges_by_data(vid_t v, const EDATA_T& lo, const EDATA_T& hi,
+                         std::vector<ImmutableNbr<EDATA_T>>& edges) const {
+    csr_.get_edges_by_data(v, lo, hi, timestamp_, edges);
+  }
+#endif
   timestamp_t timestamp() const { return timestamp_; }
 
  private:
@@ -172,7 +224,7 @@ class SingleGraphView {
   }
 
   FORCE_INLINE const gbp::BufferBlock exist(vid_t v, bool& exist) const {
-    auto item = csr_.get_edge(v);
+    auto item = csr_.get_edge(v, timestamp_);
     exist = gbp::BufferBlock::Ref<nbr_t>(item).timestamp.load() <= timestamp_;
     return item;
   }
@@ -180,7 +232,7 @@ class SingleGraphView {
     return gbp::BufferBlock::Ref<nbr_t>(item).timestamp.load() <= timestamp_;
   }
   FORCE_INLINE const gbp::BufferBlock get_edge(vid_t v) const {
-    return csr_.get_edge(v);
+    return csr_.get_edge(v, timestamp_);
   }
 
   FORCE_INLINE timestamp_t timestamp() const { return timestamp_; }
@@ -190,6 +242,217 @@ class SingleGraphView {
   timestamp_t timestamp_;
 };
 
+#if !OV
+/**
+ * @brief 分两轮批量读取frontier的邻接表：先读所有点的邻接表头(.adj)和基础段
+ * 位置(.brg)，再读它们指向的基础段(.base)和增量段(.nbr)。空的范围不发给
+ * buffer pool，溢出到chunk中的增量边由返回的AdjListView按需读取。
+ */
+template <typename EDATA_T>
+std::vector<AdjListView<EDATA_T>> batch_get_adj_lists(
+    const TypedMutableCsrBase<EDATA_T>* csr, const std::vector<vid_t>& vids,
+    timestamp_t timestamp) {
+  auto* buffer_pool_manager = &gbp::BufferPoolManager::GetGlobalInstance();
+  std::vector<gbp::batch_request_type> requests;
+  requests.reserve(vids.size() * 2);
+
+  // 第一轮：获取所有邻接表头和基础段位置
+  std::vector<gbp::BufferBlock> adj_blocks;
+  adj_blocks.reserve(vids.size() * 2);
+  for (auto v : vids) {
+    requests.emplace_back(csr->get_edgelist_batch(v));
+  }
+  std::vector<size_t> range_idx;
+  gbp::batch_request_type range_request;
+  for (size_t i = 0; i < vids.size(); ++i) {
+    if (csr->get_base_range_batch(vids[i], range_request)) {
+      range_idx.push_back(i);
+      requests.emplace_back(range_request);
+    }
+  }
+  buffer_pool_manager->GetBlockBatch(requests, adj_blocks);
+  record_block_batch(adj_blocks);
+
+  std::vector<MutableBaseRange> base_ranges(vids.size());
+  for (size_t k = 0; k < range_idx.size(); ++k) {
+    base_ranges[range_idx[k]] = gbp::BufferBlock::Ref<MutableBaseRange>(
+        adj_blocks[vids.size() + k]);
+  }
+
+  // 第二轮：获取所有非空的边列表(基础段和增量段)
+  std::vector<size_t> base_sizes(vids.size());
+  std::vector<size_t> base_bytes(vids.size());
+  std::vector<size_t> sizes(vids.size());
+  std::vector<size_t> run_sizes(vids.size());
+  std::vector<u_int32_t> chunk_heads(vids.size());
+  std::vector<size_t> request_idx;
+  request_idx.reserve(vids.size() * 2);
+  requests.clear();
+  for (size_t i = 0; i < vids.size(); ++i) {
+    MutableDeltaRange delta;
+    gbp::BufferBlock::Ref<MutableAdjlist<EDATA_T>>(adj_blocks[i]).load(delta);
+    base_sizes[i] = base_ranges[i].size_;
+    base_bytes[i] = base_ranges[i].bytes_;
+    sizes[i] = delta.size_;
+    run_sizes[i] = delta.run_size();
+    chunk_heads[i] = delta.chunk_head_;
+    if (base_sizes[i] != 0) {
+      request_idx.push_back(i * 2);
+      requests.emplace_back(csr->get_base_edges_batch(
+          base_ranges[i].start_idx_, base_sizes[i], base_bytes[i]));
+    }
+    if (run_sizes[i] != 0) {
+      request_idx.push_back(i * 2 + 1);
+      requests.emplace_back(
+          csr->get_edges_batch(delta.start_idx_, run_sizes[i]));
+    }
+  }
+  adj_blocks.clear();
+  std::vector<gbp::BufferBlock> edge_blocks;
+  edge_blocks.reserve(requests.size());
+  buffer_pool_manager->GetBlockBatch(requests, edge_blocks);
+  record_block_batch(edge_blocks);
+
+  std::vector<gbp::BufferBlock> blocks(vids.size() * 2);
+  for (size_t i = 0; i < request_idx.size(); ++i) {
+    blocks[request_idx[i]] = edge_blocks[i];
+  }
+
+  auto* chunks = csr->get_chunks();
+  std::vector<AdjListView<EDATA_T>> results;
+  results.reserve(vids.size());
+  for (size_t i = 0; i < vids.size(); ++i) {
+    results.emplace_back(blocks[i * 2], base_sizes[i], base_bytes[i],
+                         blocks[i * 2 + 1], run_sizes[i], timestamp, chunks,
+                         chunk_heads[i], sizes[i] - run_sizes[i]);
+    results.back().set_versions(&csr->versions(), vids[i]);
+  }
+  return results;
+}
+
+namespace detail {
+
+// 预取共用的后台线程，第一次预取时启动，线程数固定，不再每次预取新建线程
+class PrefetchPool {
+ public:
+  static constexpr size_t kThreadNum = 4;
+
+  static PrefetchPool& get() {
+    static PrefetchPool pool;
+    return pool;
+  }
+
+  void submit(std::function<void()>&& task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.emplace_back(std::move(task));
+    }
+    cv_.notify_one();
+  }
+
+  ~PrefetchPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : threads_) {
+      t.join();
+    }
+  }
+
+ private:
+  PrefetchPool() {
+    for (size_t i = 0; i < kThreadNum; ++i) {
+      threads_.emplace_back([this]() { run(); });
+    }
+  }
+
+  void run() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return stopped_ || !tasks_.empty(); });
+        if (tasks_.empty()) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> tasks_;
+  std::vector<std::thread> threads_;
+  bool stopped_ = false;
+};
+
+}  // namespace detail
+
+/**
+ * @brief 在后台预取下一跳frontier的邻接表，使batch_get_adj_lists的两轮
+ * buffer pool请求与当前跳的计算重叠。预取在共用的PrefetchPool中执行，
+ * 其间的请求数、字节数和major fault在get()时计入调用线程的统计。
+ *
+ * 用法:
+ *   auto prefetcher = txn.PrefetchOutgoingEdges<EDATA_T>(..., next_frontier);
+ *   ... 处理当前frontier ...
+ *   auto edges = prefetcher->get();  // edges[i]对应next_frontier[i]
+ */
+template <typename EDATA_T>
+class AdjListPrefetcher {
+ public:
+  AdjListPrefetcher() = default;
+  AdjListPrefetcher(const TypedMutableCsrBase<EDATA_T>* csr,
+                    std::vector<vid_t>&& vids, timestamp_t timestamp)
+      : vids_(std::move(vids)) {
+    if (csr == nullptr || vids_.empty()) {
+      return;
+    }
+    auto promise = std::make_shared<std::promise<result_type>>();
+    result_ = promise->get_future();
+    detail::PrefetchPool::get().submit([this, csr, timestamp, promise]() {
+      // 在预取线程上发生的取页和缺页随结果一起返回
+      const IOCounters io_begin = io_counters_snapshot();
+      auto lists = batch_get_adj_lists<EDATA_T>(csr, vids_, timestamp);
+      promise->set_value(
+          {std::move(lists), io_counters_snapshot() - io_begin});
+    });
+  }
+  AdjListPrefetcher(AdjListPrefetcher&& rhs) = delete;
+  AdjListPrefetcher(const AdjListPrefetcher&) = delete;
+  AdjListPrefetcher& operator=(const AdjListPrefetcher&) = delete;
+  // 任务引用了vids_，析构前等待其完成
+  ~AdjListPrefetcher() {
+    if (result_.valid()) {
+      result_.wait();
+    }
+  }
+
+  const std::vector<vid_t>& vertices() const { return vids_; }
+
+  // 等待两轮请求完成，只能调用一次。预取的开销计入调用线程的IOCounters
+  std::vector<AdjListView<EDATA_T>> get() {
+    if (!result_.valid()) {
+      return {};
+    }
+    auto ret = result_.get();
+    merge_io_counters(ret.second);
+    return std::move(ret.first);
+  }
+
+ private:
+  using result_type = std::pair<std::vector<AdjListView<EDATA_T>>, IOCounters>;
+
+  std::vector<vid_t> vids_;
+  std::future<result_type> result_;
+};
+#endif
+
 class ReadTransaction {
  public:
   ReadTransaction(const MutablePropertyFragment& graph, VersionManager& vm,
@@ -205,7 +468,8 @@ class ReadTransaction {
   class vertex_iterator {
    public:
     vertex_iterator(label_t label, vid_t cur, vid_t num,
-                    const MutablePropertyFragment& graph);
+                    const MutablePropertyFragment& graph,
+                    timestamp_t timestamp);
     ~vertex_iterator();
 
     bool IsValid() const;
@@ -226,12 +490,16 @@ class ReadTransaction {
     vid_t cur_;
     vid_t num_;
     const MutablePropertyFragment& graph_;
+    timestamp_t timestamp_;
   };
 
   class edge_iterator {
    public:
+    // versions为所在csr中边数据的旧版本，v为邻接表所属的顶点
     edge_iterator(label_t neighbor_label, label_t edge_label,
-                  std::shared_ptr<MutableCsrConstEdgeIterBase> iter);
+                  std::shared_ptr<MutableCsrConstEdgeIterBase> iter,
+                  const CellVersions* versions, vid_t v,
+                  timestamp_t timestamp);
     ~edge_iterator();
 #if OV
     Any GetData() const;
@@ -253,6 +521,9 @@ class ReadTransaction {
     label_t edge_label_;
 
     std::shared_ptr<MutableCsrConstEdgeIterBase> iter_;
+    const CellVersions* versions_;
+    vid_t v_;
+    timestamp_t timestamp_;
   };
 
   vertex_iterator GetVertexIterator(label_t label) const;
@@ -269,6 +540,11 @@ class ReadTransaction {
                                    label_t neighnor_label,
                                    label_t edge_label) const;
 
+  // 查找src到dst的一条边，先查src的出边再查dst的入边，存在时把边数据写入data。
+  // 属性存放在边属性表中时data为边id，属性经由GetEdgeTable读出
+  bool FindEdge(label_t src_label, vid_t src, label_t dst_label, vid_t dst,
+                label_t edge_label, Any& data) const;
+
   edge_iterator GetInEdgeIterator(label_t label, vid_t u,
                                   label_t neighnor_label,
                                   label_t edge_label) const;
@@ -294,6 +570,11 @@ class ReadTransaction {
 
   const Schema& schema() const;
 
+  // 多属性/字符串属性边的属性表，通过邻接表中的边id(edge_id_t)读取属性；
+  // 其他边返回nullptr
+  const EdgePropertyTable* GetEdgeTable(label_t src_label, label_t dst_label,
+                                        label_t edge_label) const;
+
   template <typename EDATA_T>
   GraphView<EDATA_T> GetOutgoingGraphView(label_t v_label,
                                           label_t neighbor_label,
@@ -373,43 +654,9 @@ class ReadTransaction {
   std::vector<AdjListView<EDATA_T>> BatchGetOutgoingEdges(
       label_t v_label, label_t neighbor_label, label_t edge_label,
       const std::vector<vid_t>& vids) const {
-    std::vector<gbp::BufferBlock> adj_blocks;
-    adj_blocks.reserve(vids.size());
-    std::vector<gbp::BufferBlock> edge_blocks;
-    edge_blocks.reserve(vids.size());
-
-    std::vector<gbp::batch_request_type> requests;
-    std::vector<AdjListView<EDATA_T>> results;
-    // results.reserve(vids.size());
-    // 获取所有邻接列表
-    for (auto v : vids) {
-      auto csr = dynamic_cast<const TypedMutableCsrBase<EDATA_T>*>(
-          graph_.get_oe_csr(v_label, neighbor_label, edge_label));
-      requests.emplace_back(csr->get_edgelist_batch(v));
-    }
-    buffer_pool_manager_->GetBlockBatch(requests, adj_blocks);
-
-    // 获取所有边列表
-    requests.clear();
-    for (size_t i = 0; i < adj_blocks.size(); ++i) {
-      auto& adj_list =
-          gbp::BufferBlock::Ref<MutableAdjlist<EDATA_T>>(adj_blocks[i]);
-      auto csr = dynamic_cast<const TypedMutableCsrBase<EDATA_T>*>(
-          graph_.get_oe_csr(v_label, neighbor_label, edge_label));
-      requests.emplace_back(
-          csr->get_edges_batch(adj_list.start_idx_, adj_list.size_));
-    }
-    buffer_pool_manager_->GetBlockBatch(requests, edge_blocks);
-
-    // 生成最后结果
-    for (size_t i = 0; i < adj_blocks.size(); ++i) {
-      results.emplace_back(
-          edge_blocks[i],
-          gbp::BufferBlock::Ref<MutableAdjlist<EDATA_T>>(adj_blocks[i]).size_,
-          timestamp_);
-    }
-
-    return std::move(results);
+    auto csr = dynamic_cast<const TypedMutableCsrBase<EDATA_T>*>(
+        graph_.get_oe_csr(v_label, neighbor_label, edge_label));
+    return batch_get_adj_lists<EDATA_T>(csr, vids, timestamp_);
   }
 
   /** 批量获取入边
@@ -423,44 +670,43 @@ class ReadTransaction {
   std::vector<AdjListView<EDATA_T>> BatchGetIncomingEdges(
       label_t v_label, label_t neighbor_label, label_t edge_label,
       const std::vector<vid_t>& vids) const {
-    std::vector<gbp::BufferBlock> adj_blocks;
-    adj_blocks.reserve(vids.size());
-    std::vector<gbp::BufferBlock> edge_blocks;
-    edge_blocks.reserve(vids.size());
-
-    std::vector<gbp::batch_request_type> requests;
-    std::vector<AdjListView<EDATA_T>> results;
-    // results.reserve(vids.size());
-    // 获取所有邻接列表
-    for (auto v : vids) {
-      auto csr = dynamic_cast<const TypedMutableCsrBase<EDATA_T>*>(
-          graph_.get_ie_csr(v_label, neighbor_label, edge_label));
-      requests.emplace_back(csr->get_edgelist_batch(v));
-    }
-    buffer_pool_manager_->GetBlockBatch(requests, adj_blocks);
-    requests.clear();
-
-    // 获取所有边列表
-    for (size_t i = 0; i < adj_blocks.size(); ++i) {
-      auto& adj_list =
-          gbp::BufferBlock::Ref<MutableAdjlist<EDATA_T>>(adj_blocks[i]);
-      auto csr = dynamic_cast<const TypedMutableCsrBase<EDATA_T>*>(
-          graph_.get_ie_csr(v_label, neighbor_label, edge_label));
-      requests.emplace_back(
-          csr->get_edges_batch(adj_list.start_idx_, adj_list.size_));
-    }
-
-    buffer_pool_manager_->GetBlockBatch(requests, edge_blocks);
+    auto csr = dynamic_cast<const TypedMutableCsrBase<EDATA_T>*>(
+        graph_.get_ie_csr(v_label, neighbor_label, edge_label));
+    return batch_get_adj_lists<EDATA_T>(csr, vids, timestamp_);
+  }
 
-    // 生成最后结果
-    for (size_t i = 0; i < adj_blocks.size(); ++i) {
-      results.emplace_back(
-          edge_blocks[i],
-          gbp::BufferBlock::Ref<MutableAdjlist<EDATA_T>>(adj_blocks[i]).size_,
-          timestamp_);
-    }
+  /** 异步预取下一跳frontier的出边，与当前跳的计算重叠
+  @param v_label: 顶点标签
+  @param neighbor_label: 邻居标签
+  @param edge_label: 边标签
+  @param vids: 下一跳的顶点ID
+  @return: 预取器，调用get()获取出边列表
+  */
+  template <typename EDATA_T>
+  std::unique_ptr<AdjListPrefetcher<EDATA_T>> PrefetchOutgoingEdges(
+      label_t v_label, label_t neighbor_label, label_t edge_label,
+      std::vector<vid_t> vids) const {
+    auto csr = dynamic_cast<const TypedMutableCsrBase<EDATA_T>*>(
+        graph_.get_oe_csr(v_label, neighbor_label, edge_label));
+    return std::make_unique<AdjListPrefetcher<EDATA_T>>(csr, std::move(vids),
+                                                        timestamp_);
+  }
 
-    return std::move(results);
+  /** 异步预取下一跳frontier的入边，与当前跳的计算重叠
+  @param v_label: 顶点标签
+  @param neighbor_label: 邻居标签
+  @param edge_label: 边标签
+  @param vids: 下一跳的顶点ID
+  @return: 预取器，调用get()获取入边列表
+  */
+  template <typename EDATA_T>
+  std::unique_ptr<AdjListPrefetcher<EDATA_T>> PrefetchIncomingEdges(
+      label_t v_label, label_t neighbor_label, label_t edge_label,
+      std::vector<vid_t> vids) const {
+    auto csr = dynamic_cast<const TypedMutableCsrBase<EDATA_T>*>(
+        graph_.get_ie_csr(v_label, neighbor_label, edge_label));
+    return std::make_unique<AdjListPrefetcher<EDATA_T>>(csr, std::move(vids),
+                                                        timestamp_);
   }
 
   std::vector<gbp::BufferBlock> BatchGetOutgoingSingleEdges(
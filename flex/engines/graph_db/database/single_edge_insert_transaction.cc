@@ -52,6 +52,13 @@ bool SingleEdgeInsertTransaction::AddEdge(label_t src_label, oid_t src,
                << "] not found...";
     return false;
   }
+  if (graph_.schema()
+          .get_edge_properties(src_label, dst_label, edge_label)
+          .size() > 1) {
+    LOG(ERROR) << "Edge " << graph_.schema().get_edge_label_name(edge_label)
+               << " has multiple properties, a single value is not enough";
+    return false;
+  }
   const PropertyType& type =
       graph_.schema().get_edge_property(src_label, dst_label, edge_label);
   if (prop.type != type) {
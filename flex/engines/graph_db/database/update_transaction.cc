@@ -13,7 +13,7 @@
  * limitations under the License.
  */
 
-#include <filesystem>
+#include <cstring>
 
 #include "grape/serialization/in_archive.h"
 #include "grape/serialization/out_archive.h"
@@ -27,72 +27,267 @@
 
 namespace gs {
 
+namespace {
+
+// 事务内新增的顶点还没有边，返回空的迭代器
+class EmptyEdgeIter : public MutableCsrConstEdgeIterBase {
+ public:
+  vid_t get_neighbor() const override { return 0; }
+#if OV
+  Any get_data() const override { return Any(); }
+#else
+  const void* get_data() const override { return nullptr; }
+#endif
+  timestamp_t get_timestamp() const override { return 0; }
+  size_t size() const override { return 0; }
+
+  void next() override {}
+  bool is_valid() const override { return false; }
+};
+
+}  // namespace
+
+UpdateWorkspace::UpdateWorkspace() : vertex_label_num_(0), edge_label_num_(0) {}
+
+UpdateWorkspace::~UpdateWorkspace() = default;
+
+void UpdateWorkspace::begin(const MutablePropertyFragment& graph) {
+  size_t vertex_label_num = graph.schema().vertex_label_num();
+  size_t edge_label_num = graph.schema().edge_label_num();
+  if (vertex_label_num != vertex_label_num_ ||
+      edge_label_num != edge_label_num_) {
+    vertex_label_num_ = vertex_label_num;
+    edge_label_num_ = edge_label_num;
+    added_vertices_.resize(vertex_label_num_);
+    added_vertices_base_.resize(vertex_label_num_);
+    added_vertices_lid_.resize(vertex_label_num_);
+    vertex_nums_.resize(vertex_label_num_);
+    vertex_offsets_.resize(vertex_label_num_);
+    staged_rows_.resize(vertex_label_num_);
+    label_touched_.resize(vertex_label_num_, false);
+    // 只分配指针，具体的map在第一次写到该csr时才创建
+    size_t csr_num = 2 * vertex_label_num_ * vertex_label_num_ * edge_label_num_;
+    edge_updates_.resize(csr_num);
+    csr_touched_.resize(csr_num, false);
+  }
+  for (size_t i = 0; i < vertex_label_num_; ++i) {
+    added_vertices_base_[i] = vertex_nums_[i] = graph.vertex_num(i);
+  }
+}
+
+void UpdateWorkspace::reset() {
+  for (auto label : touched_labels_) {
+    added_vertices_[label].clear();
+    added_vertices_lid_[label].clear();
+    vertex_offsets_[label].clear();
+    label_touched_[label] = false;
+  }
+  touched_labels_.clear();
+  for (auto csr_index : touched_csrs_) {
+    edge_updates_[csr_index]->added_edges.clear();
+    edge_updates_[csr_index]->updated_edge_data.clear();
+    csr_touched_[csr_index] = false;
+  }
+  touched_csrs_.clear();
+  table_edges_.clear();
+  strings_.clear();
+  locked_slots_.clear();
+  arc_.Clear();
+}
+
+void UpdateWorkspace::touch_label(label_t label) {
+  if (!label_touched_[label]) {
+    label_touched_[label] = true;
+    touched_labels_.push_back(label);
+  }
+}
+
+std::vector<Any>& UpdateWorkspace::staged_row(label_t label, vid_t lid,
+                                              size_t col_num) {
+  touch_label(label);
+  auto& vertex_offset = vertex_offsets_[label];
+  auto& rows = staged_rows_[label];
+  auto iter = vertex_offset.find(lid);
+  if (iter != vertex_offset.end()) {
+    return rows[iter->second];
+  }
+  vid_t offset = vertex_offset.size();
+  vertex_offset.emplace(lid, offset);
+  // 复用之前事务留下的行
+  if (offset < rows.size()) {
+    rows[offset].assign(col_num, Any());
+  } else {
+    rows.emplace_back(col_num);
+  }
+  return rows[offset];
+}
+
+bool UpdateWorkspace::find_staged_row(label_t label, vid_t lid,
+                                      vid_t& offset) const {
+  auto& vertex_offset = vertex_offsets_[label];
+  auto iter = vertex_offset.find(lid);
+  if (iter == vertex_offset.end()) {
+    return false;
+  }
+  offset = iter->second;
+  return true;
+}
+
+UpdateWorkspace::EdgeUpdates& UpdateWorkspace::edge_updates(size_t csr_index) {
+  auto& updates = edge_updates_[csr_index];
+  if (updates == nullptr) {
+    updates = std::make_unique<EdgeUpdates>();
+  }
+  if (!csr_touched_[csr_index]) {
+    csr_touched_[csr_index] = true;
+    touched_csrs_.push_back(csr_index);
+  }
+  return *updates;
+}
+
+const UpdateWorkspace::EdgeUpdates* UpdateWorkspace::find_edge_updates(
+    size_t csr_index) const {
+  return csr_touched_[csr_index] ? edge_updates_[csr_index].get() : nullptr;
+}
+
+Any UpdateWorkspace::own(const Any& value) {
+  if (value.type != PropertyType::kString) {
+    return value;
+  }
+  // deque扩容时已有的元素不会移动
+  strings_.emplace_back(value.value.s);
+  Any ret;
+  ret.set_string(strings_.back());
+  return ret;
+}
+
+#if !OV
+// 格式与列的get相同：字符串为字符本身，其他类型为值的字节
+gbp::BufferBlock UpdateWorkspace::readback(const Any& value) {
+  const void* data;
+  size_t size;
+  switch (value.type) {
+  case PropertyType::kInt32:
+    data = &value.value.i;
+    size = sizeof(int);
+    break;
+  case PropertyType::kInt64:
+    data = &value.value.l;
+    size = sizeof(int64_t);
+    break;
+  case PropertyType::kDate:
+    data = &value.value.d;
+    size = sizeof(Date);
+    break;
+  case PropertyType::kDouble:
+    data = &value.value.db;
+    size = sizeof(double);
+    break;
+  case PropertyType::kString:
+    data = value.value.s.data();
+    size = value.value.s.size();
+    break;
+  default:
+    LOG(FATAL) << "Unexpected property type";
+    return gbp::BufferBlock();
+  }
+  gbp::BufferBlock ret(size);
+  ::memcpy(ret.Data(), data, size);
+  return ret;
+}
+#endif
+
 UpdateTransaction::UpdateTransaction(MutablePropertyFragment& graph,
-                                     MMapAllocator& alloc,
-                                     const std::string& work_dir,
+                                     MMapAllocator& alloc, UpdateWorkspace& ws,
                                      WalWriter& logger, VersionManager& vm,
-                                     timestamp_t timestamp)
+                                     timestamp_t timestamp,
+                                     timestamp_t read_ts)
     : graph_(graph),
       alloc_(alloc),
+      ws_(ws),
       logger_(logger),
       vm_(vm),
       timestamp_(timestamp),
+      read_ts_(read_ts),
+      conflict_(false),
       op_num_(0) {
-  arc_.Resize(sizeof(WalHeader));
-
-  vertex_label_num_ = graph_.schema().vertex_label_num();
-  edge_label_num_ = graph_.schema().edge_label_num();
-
-  added_vertices_.resize(vertex_label_num_);
-  added_vertices_base_.resize(vertex_label_num_);
-  vertex_nums_.resize(vertex_label_num_);
-  for (size_t i = 0; i < vertex_label_num_; ++i) {
-    added_vertices_base_[i] = vertex_nums_[i] = graph_.vertex_num(i);
-  }
-  vertex_offsets_.resize(vertex_label_num_);
-  extra_vertex_properties_.resize(vertex_label_num_);
-  std::string txn_work_dir = update_txn_dir(work_dir, timestamp_);
-  std::filesystem::create_directories(txn_work_dir);
-  for (size_t i = 0; i < vertex_label_num_; ++i) {
-    const Table& table = graph_.get_vertex_table(i);
-    std::string v_label = graph_.schema().get_vertex_label_name(i);
-    std::string table_prefix = vertex_table_prefix(v_label);
-    extra_vertex_properties_[i].init(
-        table_prefix, work_dir, table.column_names(), table.column_types(), {});
-    extra_vertex_properties_[i].resize(4096);
-  }
+  ws_.begin(graph_);
+  ws_.arc_.Resize(sizeof(WalHeader));
 
-  size_t csr_num = 2 * vertex_label_num_ * vertex_label_num_ * edge_label_num_;
-  added_edges_.resize(csr_num);
-  updated_edge_data_.resize(csr_num);
+  vertex_label_num_ = ws_.vertex_label_num_;
+  edge_label_num_ = ws_.edge_label_num_;
 }
 
 UpdateTransaction::~UpdateTransaction() { release(); }
 
 timestamp_t UpdateTransaction::timestamp() const { return timestamp_; }
 
-void UpdateTransaction::Commit() {
+bool UpdateTransaction::Commit() {
   if (timestamp_ == std::numeric_limits<timestamp_t>::max()) {
-    return;
+    return true;
   }
   if (op_num_ == 0) {
     release();
-    return;
+    return true;
+  }
+  if (conflict_ || !validate()) {
+    VLOG(10) << "Update transaction " << timestamp_ << " aborted by conflict";
+    release();
+    return false;
   }
 
-  auto* header = reinterpret_cast<WalHeader*>(arc_.GetBuffer());
-  header->length = arc_.GetSize() - sizeof(WalHeader);
+  auto& arc = ws_.arc_;
+  auto* header = reinterpret_cast<WalHeader*>(arc.GetBuffer());
+  header->length = arc.GetSize() - sizeof(WalHeader);
   header->type = 1;
   header->timestamp = timestamp_;
-  logger_.append(arc_.GetBuffer(), arc_.GetSize());
+  logger_.append(arc.GetBuffer(), arc.GetSize());
 
   applyVerticesUpdates();
   applyEdgesUpdates();
+  unlock_all(timestamp_);
   release();
+  return true;
 }
 
 void UpdateTransaction::Abort() { release(); }
 
+bool UpdateTransaction::lock_vertex(label_t label, oid_t oid) {
+  if (conflict_) {
+    return false;
+  }
+  size_t key = static_cast<size_t>(oid) * vertex_label_num_ + label;
+  size_t slot;
+  int ret = vm_.record_locks().lock(key, timestamp_, slot);
+  if (ret < 0) {
+    conflict_ = true;
+    return false;
+  }
+  if (ret > 0) {
+    ws_.locked_slots_.push_back(slot);
+  }
+  return true;
+}
+
+// 事务开始之后有其他事务提交过同一个槽，之前读到的值可能已经过期
+bool UpdateTransaction::validate() const {
+  auto& locks = vm_.record_locks();
+  for (auto slot : ws_.locked_slots_) {
+    if (locks.last_commit_ts(slot) > read_ts_) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void UpdateTransaction::unlock_all(timestamp_t commit_ts) {
+  auto& locks = vm_.record_locks();
+  for (auto slot : ws_.locked_slots_) {
+    locks.unlock(slot, commit_ts);
+  }
+  ws_.locked_slots_.clear();
+}
+
 bool UpdateTransaction::AddVertex(label_t label, oid_t oid,
                                   const std::vector<Any>& props) {
   vid_t id;
@@ -107,24 +302,25 @@ bool UpdateTransaction::AddVertex(label_t label, oid_t oid,
       return false;
     }
   }
+  if (!lock_vertex(label, oid)) {
+    return false;
+  }
   if (!oid_to_lid(label, oid, id)) {
-    added_vertices_[label]._add(oid);
-    id = vertex_nums_[label]++;
+    ws_.touch_label(label);
+    ws_.added_vertices_[label]._add(oid);
+    id = ws_.vertex_nums_[label]++;
   }
 
-  vid_t row_num = vertex_offsets_[label].size();
-  vertex_offsets_[label].emplace(id, row_num);
-  grape::InArchive arc;
-  for (auto& prop : props) {
-    serialize_field(arc, prop);
+  auto& row = ws_.staged_row(label, id, col_num);
+  for (int col_i = 0; col_i != col_num; ++col_i) {
+    row[col_i] = ws_.own(props[col_i]);
   }
-  grape::OutArchive oarc;
-  oarc.SetSlice(arc.GetBuffer(), arc.GetSize());
-  extra_vertex_properties_[label].ingest(row_num, oarc);
 
   op_num_ += 1;
-  arc_ << static_cast<uint8_t>(0) << label << oid;
-  arc_.AddBytes(arc.GetBuffer(), arc.GetSize());
+  ws_.arc_ << static_cast<uint8_t>(0) << label << oid;
+  for (auto& prop : props) {
+    serialize_field(ws_.arc_, prop);
+  }
   return true;
 }
 
@@ -143,22 +339,88 @@ bool UpdateTransaction::AddEdge(label_t src_label, oid_t src, label_t dst_label,
   if (type != value.type) {
     return false;
   }
-  size_t in_csr_index = get_in_csr_index(src_label, dst_label, edge_label);
-  size_t out_csr_index = get_out_csr_index(src_label, dst_label, edge_label);
-  added_edges_[in_csr_index][dst_lid].push_back(src_lid);
-  updated_edge_data_[in_csr_index][dst_lid].emplace(src_lid, value);
-
-  added_edges_[out_csr_index][src_lid].push_back(dst_lid);
-  updated_edge_data_[out_csr_index][src_lid].emplace(dst_lid, value);
+  if (graph_.get_edge_table(src_label, dst_label, edge_label) != nullptr) {
+    return AddEdge(src_label, src, dst_label, dst, edge_label,
+                   std::vector<Any>{value});
+  }
+  if (!lock_vertex(src_label, src) || !lock_vertex(dst_label, dst)) {
+    return false;
+  }
+  stage_edge(src_label, src_lid, dst_label, dst_lid, edge_label,
+             ws_.own(value));
 
   op_num_ += 1;
-  arc_ << static_cast<uint8_t>(1) << src_label << src << dst_label << dst
-       << edge_label;
-  serialize_field(arc_, value);
+  ws_.arc_ << static_cast<uint8_t>(1) << src_label << src << dst_label << dst
+           << edge_label;
+  serialize_field(ws_.arc_, value);
 
   return true;
 }
 
+bool UpdateTransaction::AddEdge(label_t src_label, oid_t src, label_t dst_label,
+                                oid_t dst, label_t edge_label,
+                                const std::vector<Any>& props) {
+  auto* edge_table = graph_.get_edge_table(src_label, dst_label, edge_label);
+  if (edge_table == nullptr) {
+    return props.size() == 1 &&
+           AddEdge(src_label, src, dst_label, dst, edge_label, props[0]);
+  }
+  vid_t src_lid, dst_lid;
+  if (!oid_to_lid(src_label, src, src_lid)) {
+    return false;
+  }
+  if (!oid_to_lid(dst_label, dst, dst_lid)) {
+    return false;
+  }
+  const std::vector<PropertyType>& types =
+      graph_.schema().get_edge_properties(src_label, dst_label, edge_label);
+  if (types.size() != props.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < types.size(); ++i) {
+    if (props[i].type != types[i]) {
+      return false;
+    }
+  }
+  if (!lock_vertex(src_label, src) || !lock_vertex(dst_label, dst)) {
+    return false;
+  }
+  edge_id_t staged_idx = ws_.table_edges_.size();
+  ws_.table_edges_.emplace_back();
+  auto& staged = ws_.table_edges_.back();
+  staged.table = edge_table;
+  staged.eid = -1;
+  staged.props.reserve(props.size());
+  for (auto& prop : props) {
+    staged.props.emplace_back(ws_.own(prop));
+  }
+  stage_edge(src_label, src_lid, dst_label, dst_lid, edge_label,
+             Any::From(staged_idx));
+
+  op_num_ += 1;
+  // 与InsertTransaction相同的格式，重放时由IngestEdge写入边属性表
+  ws_.arc_ << static_cast<uint8_t>(1) << src_label << src << dst_label << dst
+           << edge_label;
+  for (auto& prop : props) {
+    serialize_field(ws_.arc_, prop);
+  }
+  return true;
+}
+
+void UpdateTransaction::stage_edge(label_t src_label, vid_t src_lid,
+                                   label_t dst_label, vid_t dst_lid,
+                                   label_t edge_label, const Any& value) {
+  size_t in_csr_index = get_in_csr_index(src_label, dst_label, edge_label);
+  size_t out_csr_index = get_out_csr_index(src_label, dst_label, edge_label);
+  auto& in_updates = ws_.edge_updates(in_csr_index);
+  in_updates.added_edges[dst_lid].push_back(src_lid);
+  in_updates.updated_edge_data[dst_lid].emplace(src_lid, value);
+
+  auto& out_updates = ws_.edge_updates(out_csr_index);
+  out_updates.added_edges[src_lid].push_back(dst_lid);
+  out_updates.updated_edge_data[src_lid].emplace(dst_lid, value);
+}
+
 UpdateTransaction::vertex_iterator::vertex_iterator(label_t label, vid_t cur,
                                                     vid_t& num,
                                                     UpdateTransaction* txn)
@@ -204,9 +466,18 @@ UpdateTransaction::edge_iterator::edge_iterator(
       added_edges_cur_(aeb),
       added_edges_end_(aee),
       init_iter_(std::move(init_iter)),
-      txn_(txn) {}
+      txn_(txn) {
+  skip_invisible();
+}
 UpdateTransaction::edge_iterator::~edge_iterator() = default;
 
+void UpdateTransaction::edge_iterator::skip_invisible() {
+  while (init_iter_->is_valid() &&
+         init_iter_->get_timestamp() > txn_->read_ts_) {
+    init_iter_->next();
+  }
+}
+
 #if OV
 Any UpdateTransaction::edge_iterator::GetData() const {
   if (init_iter_->is_valid()) {
@@ -269,6 +540,7 @@ bool UpdateTransaction::edge_iterator::IsValid() const {
 void UpdateTransaction::edge_iterator::Next() {
   if (init_iter_->is_valid()) {
     init_iter_->next();
+    skip_invisible();
   } else {
     ++added_edges_cur_;
   }
@@ -292,7 +564,7 @@ label_t UpdateTransaction::edge_iterator::GetEdgeLabel() const {
 
 UpdateTransaction::vertex_iterator UpdateTransaction::GetVertexIterator(
     label_t label) {
-  return {label, 0, vertex_nums_[label], this};
+  return {label, 0, ws_.vertex_nums_[label], this};
 }
 
 UpdateTransaction::edge_iterator UpdateTransaction::GetOutEdgeIterator(
@@ -300,20 +572,22 @@ UpdateTransaction::edge_iterator UpdateTransaction::GetOutEdgeIterator(
   size_t csr_index = get_out_csr_index(label, neighnor_label, edge_label);
   const vid_t* begin = nullptr;
   const vid_t* end = nullptr;
-  auto iter = added_edges_[csr_index].find(u);
-  if (iter != added_edges_[csr_index].end()) {
-    begin = iter->second.data();
-    end = begin + iter->second.size();
-  }
-  return {true,
-          label,
-          u,
-          neighnor_label,
-          edge_label,
-          begin,
-          end,
-          graph_.get_outgoing_edges(label, u, neighnor_label, edge_label),
-          this};
+  auto* updates = ws_.find_edge_updates(csr_index);
+  if (updates != nullptr) {
+    auto iter = updates->added_edges.find(u);
+    if (iter != updates->added_edges.end()) {
+      begin = iter->second.data();
+      end = begin + iter->second.size();
+    }
+  }
+  std::shared_ptr<MutableCsrConstEdgeIterBase> init_iter;
+  if (u < ws_.added_vertices_base_[label]) {
+    init_iter = graph_.get_outgoing_edges(label, u, neighnor_label, edge_label);
+  } else {
+    init_iter = std::make_shared<EmptyEdgeIter>();
+  }
+  return {true,  label, u,   neighnor_label,       edge_label,
+          begin, end,   std::move(init_iter), this};
 }
 
 UpdateTransaction::edge_iterator UpdateTransaction::GetInEdgeIterator(
@@ -321,52 +595,53 @@ UpdateTransaction::edge_iterator UpdateTransaction::GetInEdgeIterator(
   size_t csr_index = get_in_csr_index(label, neighnor_label, edge_label);
   const vid_t* begin = nullptr;
   const vid_t* end = nullptr;
-  auto iter = added_edges_[csr_index].find(u);
-  if (iter != added_edges_[csr_index].end()) {
-    begin = iter->second.data();
-    end = begin + iter->second.size();
-  }
-  return {false,
-          label,
-          u,
-          neighnor_label,
-          edge_label,
-          begin,
-          end,
-          graph_.get_incoming_edges(label, u, neighnor_label, edge_label),
-          this};
+  auto* updates = ws_.find_edge_updates(csr_index);
+  if (updates != nullptr) {
+    auto iter = updates->added_edges.find(u);
+    if (iter != updates->added_edges.end()) {
+      begin = iter->second.data();
+      end = begin + iter->second.size();
+    }
+  }
+  std::shared_ptr<MutableCsrConstEdgeIterBase> init_iter;
+  if (u < ws_.added_vertices_base_[label]) {
+    init_iter = graph_.get_incoming_edges(label, u, neighnor_label, edge_label);
+  } else {
+    init_iter = std::make_shared<EmptyEdgeIter>();
+  }
+  return {false, label, u,   neighnor_label,       edge_label,
+          begin, end,   std::move(init_iter), this};
 }
 #if OV
 Any UpdateTransaction::GetVertexField(label_t label, vid_t lid,
                                       int col_id) const {
-  auto& vertex_offset = vertex_offsets_[label];
-  auto iter = vertex_offset.find(lid);
-  if (iter == vertex_offset.end()) {
-    return graph_.get_vertex_table(label).get_column_by_id(col_id)->get(lid);
-  } else {
-    return extra_vertex_properties_[label].get_column_by_id(col_id)->get(
-        iter->second);
+  vid_t offset;
+  if (ws_.find_staged_row(label, lid, offset)) {
+    const Any& value = ws_.staged_rows_[label][offset][col_id];
+    if (value.type != PropertyType::kEmpty) {
+      return value;
+    }
   }
+  return graph_.get_vertex_table(label).get_column_by_id(col_id)->get(lid);
 }
 #else
 gbp::BufferBlock UpdateTransaction::GetVertexField(label_t label, vid_t lid,
                                                    int col_id) const {
-  auto& vertex_offset = vertex_offsets_[label];
-  auto iter = vertex_offset.find(lid);
-  if (iter == vertex_offset.end()) {
-    return graph_.get_vertex_table(label).get_column_by_id(col_id)->get(lid);
-  } else {
-    return extra_vertex_properties_[label].get_column_by_id(col_id)->get(
-        iter->second);
+  vid_t offset;
+  if (ws_.find_staged_row(label, lid, offset)) {
+    const Any& value = ws_.staged_rows_[label][offset][col_id];
+    if (value.type != PropertyType::kEmpty) {
+      return UpdateWorkspace::readback(value);
+    }
   }
+  // 事务开始之后其他事务提交的修改不可见
+  return get_versioned(*graph_.get_vertex_table(label).get_column_by_id(col_id),
+                       lid, read_ts_);
 }
 #endif
 
 bool UpdateTransaction::SetVertexField(label_t label, vid_t lid, int col_id,
                                        const Any& value) {
-  auto& vertex_offset = vertex_offsets_[label];
-  auto iter = vertex_offset.find(lid);
-  auto& extra_table = extra_vertex_properties_[label];
   const std::vector<PropertyType>& types =
       graph_.schema().get_vertex_properties(label);
   if (static_cast<size_t>(col_id) >= types.size()) {
@@ -375,60 +650,50 @@ bool UpdateTransaction::SetVertexField(label_t label, vid_t lid, int col_id,
   if (types[col_id] != value.type) {
     return false;
   }
-  if (iter == vertex_offset.end()) {
-    auto& table = graph_.get_vertex_table(label);
-    if (table.col_num() <= static_cast<size_t>(col_id)) {
-      return false;
-    }
-    if (graph_.vertex_num(label) <= lid) {
-      return false;
-    }
-    vid_t new_offset = vertex_offset.size();
-    vertex_offset.emplace(lid, new_offset);
-    size_t col_num = table.col_num();
-    for (size_t i = 0; i < col_num; ++i) {
-#if OV
-      extra_table.get_column_by_id(i)->set_any(
-          new_offset, table.get_column_by_id(i)->get(lid));
-#else
-      extra_table.get_column_by_id(i)->set(new_offset,
-                                           table.get_column_by_id(i)->get(lid));
-#endif
-    }
-    extra_table.get_column_by_id(col_id)->set_any(new_offset, value);
-  } else {
-    if (extra_table.col_num() <= static_cast<size_t>(col_id)) {
-      return false;
-    }
-    extra_table.get_column_by_id(col_id)->set_any(iter->second, value);
+  if (lid >= ws_.vertex_nums_[label]) {
+    return false;
+  }
+  oid_t oid = lid_to_oid(label, lid);
+  if (!lock_vertex(label, oid)) {
+    return false;
   }
+  // 已有的顶点只暂存被修改的列，不复制整行
+  auto& row = ws_.staged_row(label, lid, types.size());
+  row[col_id] = ws_.own(value);
 
   op_num_ += 1;
-  arc_ << static_cast<uint8_t>(2) << label << lid_to_oid(label, lid) << col_id;
-  serialize_field(arc_, value);
+  ws_.arc_ << static_cast<uint8_t>(2) << label << oid << col_id;
+  serialize_field(ws_.arc_, value);
   return true;
 }
 
 void UpdateTransaction::SetEdgeData(bool dir, label_t label, vid_t v,
                                     label_t neighbor_label, vid_t nbr,
                                     label_t edge_label, const Any& value) {
+  label_t src_label = dir ? label : neighbor_label;
+  label_t dst_label = dir ? neighbor_label : label;
+  if (graph_.get_edge_table(src_label, dst_label, edge_label) != nullptr) {
+    // 邻接表中只有边id，不支持原地修改边属性表中的属性；Commit会回滚
+    LOG(ERROR) << "Edge " << graph_.schema().get_edge_label_name(edge_label)
+               << " stores properties in edge table, SetEdgeData unsupported";
+    conflict_ = true;
+    return;
+  }
+  oid_t v_oid = lid_to_oid(label, v);
+  oid_t nbr_oid = lid_to_oid(neighbor_label, nbr);
+  // 加锁失败时Commit会回滚
+  if (!lock_vertex(label, v_oid) || !lock_vertex(neighbor_label, nbr_oid)) {
+    return;
+  }
   size_t csr_index = dir ? get_out_csr_index(label, neighbor_label, edge_label)
                          : get_in_csr_index(label, neighbor_label, edge_label);
-  if (value.type == PropertyType::kString) {
-    size_t loc = sv_vec_.size();
-    sv_vec_.emplace_back(std::string(value.value.s));
-    Any dup_value;
-    dup_value.set_string(sv_vec_[loc]);
-    updated_edge_data_[csr_index][v].emplace(nbr, dup_value);
-  } else {
-    updated_edge_data_[csr_index][v].emplace(nbr, value);
-  }
+  ws_.edge_updates(csr_index).updated_edge_data[v].emplace(nbr,
+                                                          ws_.own(value));
 
   op_num_ += 1;
-  arc_ << static_cast<uint8_t>(3) << static_cast<uint8_t>(dir ? 1 : 0) << label
-       << lid_to_oid(label, v) << neighbor_label
-       << lid_to_oid(neighbor_label, nbr) << edge_label;
-  serialize_field(arc_, value);
+  ws_.arc_ << static_cast<uint8_t>(3) << static_cast<uint8_t>(dir ? 1 : 0)
+           << label << v_oid << neighbor_label << nbr_oid << edge_label;
+  serialize_field(ws_.arc_, value);
 }
 
 bool UpdateTransaction::GetUpdatedEdgeData(bool dir, label_t label, vid_t v,
@@ -436,8 +701,12 @@ bool UpdateTransaction::GetUpdatedEdgeData(bool dir, label_t label, vid_t v,
                                            label_t edge_label, Any& ret) const {
   size_t csr_index = dir ? get_out_csr_index(label, neighbor_label, edge_label)
                          : get_in_csr_index(label, neighbor_label, edge_label);
-  auto map_iter = updated_edge_data_[csr_index].find(v);
-  if (map_iter == updated_edge_data_[csr_index].end()) {
+  auto* updates = ws_.find_edge_updates(csr_index);
+  if (updates == nullptr) {
+    return false;
+  }
+  auto map_iter = updates->updated_edge_data.find(v);
+  if (map_iter == updates->updated_edge_data.end()) {
     return false;
   } else {
     auto& updates = map_iter->second;
@@ -455,42 +724,6 @@ void UpdateTransaction::IngestWal(MutablePropertyFragment& graph,
                                   const std::string& work_dir,
                                   uint32_t timestamp, char* data, size_t length,
                                   MMapAllocator& alloc) {
-  std::vector<IdIndexer<oid_t, vid_t>> added_vertices;
-  std::vector<vid_t> added_vertices_base;
-  std::vector<vid_t> vertex_nums;
-  std::vector<ska::flat_hash_map<vid_t, vid_t>> vertex_offsets;
-  std::vector<Table> extra_vertex_properties;
-
-  std::vector<ska::flat_hash_map<vid_t, std::vector<vid_t>>> added_edges;
-  std::vector<ska::flat_hash_map<vid_t, ska::flat_hash_map<vid_t, Any>>>
-      updated_edge_data;
-
-  size_t vertex_label_num = graph.schema().vertex_label_num();
-  size_t edge_label_num = graph.schema().edge_label_num();
-
-  added_vertices.resize(vertex_label_num);
-  added_vertices_base.resize(vertex_label_num);
-  vertex_nums.resize(vertex_label_num);
-  for (size_t i = 0; i < vertex_label_num; ++i) {
-    added_vertices_base[i] = vertex_nums[i] = graph.vertex_num(i);
-  }
-  vertex_offsets.resize(vertex_label_num);
-  extra_vertex_properties.resize(vertex_label_num);
-  std::string txn_work_dir = update_txn_dir(work_dir, timestamp);
-  std::filesystem::create_directories(txn_work_dir);
-  for (size_t i = 0; i < vertex_label_num; ++i) {
-    const Table& table = graph.get_vertex_table(i);
-    std::string v_label = graph.schema().get_vertex_label_name(i);
-    std::string table_prefix = vertex_table_prefix(v_label);
-    extra_vertex_properties[i].init(
-        table_prefix, work_dir, table.column_names(), table.column_types(), {});
-    extra_vertex_properties[i].resize(4096);
-  }
-
-  size_t csr_num = 2 * vertex_label_num * vertex_label_num * edge_label_num;
-  added_edges.resize(csr_num);
-  updated_edge_data.resize(csr_num);
-
   grape::OutArchive arc;
   arc.SetSlice(data, length);
   while (!arc.Empty()) {
@@ -575,12 +808,14 @@ size_t UpdateTransaction::get_out_csr_index(label_t src_label,
          vertex_label_num_ * vertex_label_num_ * edge_label_num_;
 }
 
+// 事务开始之后由其他事务新增的顶点不可见
 bool UpdateTransaction::oid_to_lid(label_t label, oid_t oid, vid_t& lid) const {
-  if (graph_.get_lid(label, oid, lid)) {
+  if (graph_.get_lid(label, oid, lid) &&
+      lid < ws_.added_vertices_base_[label]) {
     return true;
   } else {
-    if (added_vertices_[label].get_index(oid, lid)) {
-      lid += added_vertices_base_[label];
+    if (ws_.added_vertices_[label].get_index(oid, lid)) {
+      lid += ws_.added_vertices_base_[label];
       return true;
     }
   }
@@ -588,158 +823,145 @@ bool UpdateTransaction::oid_to_lid(label_t label, oid_t oid, vid_t& lid) const {
 }
 
 oid_t UpdateTransaction::lid_to_oid(label_t label, vid_t lid) const {
-  if (graph_.vertex_num(label) > lid) {
+  vid_t base = ws_.added_vertices_base_[label];
+  if (base > lid) {
     return graph_.get_oid(label, lid);
   } else {
     oid_t ret;
-    CHECK(
-        added_vertices_[label].get_key(lid - added_vertices_base_[label], ret));
+    CHECK(ws_.added_vertices_[label].get_key(lid - base, ret));
     return ret;
   }
 }
 
+vid_t UpdateTransaction::resolve_lid(label_t label, vid_t lid) const {
+  vid_t base = ws_.added_vertices_base_[label];
+  return lid < base ? lid : ws_.added_vertices_lid_[label][lid - base];
+}
+
 void UpdateTransaction::release() {
   if (timestamp_ != std::numeric_limits<timestamp_t>::max()) {
-    arc_.Clear();
+    unlock_all(0);
+    // 只重置用到过的部分，留给该会话的下一个更新事务
+    ws_.reset();
     vm_.release_update_timestamp(timestamp_);
     timestamp_ = std::numeric_limits<timestamp_t>::max();
 
     op_num_ = 0;
-
-    added_vertices_.clear();
-    added_vertices_base_.clear();
-    vertex_offsets_.clear();
-    extra_vertex_properties_.clear();
-    added_edges_.clear();
-    updated_edge_data_.clear();
+    conflict_ = false;
   }
 }
 
 void UpdateTransaction::applyVerticesUpdates() {
-  for (label_t label = 0; label < vertex_label_num_; ++label) {
-    std::vector<std::pair<vid_t, oid_t>> added_vertices;
-    vid_t added_vertices_num = added_vertices_[label].size();
+  for (auto label : ws_.touched_labels_) {
+    // 并发的事务也可能新增顶点，实际的lid在这里才确定；持有记录锁，同一个
+    // oid不会被其他更新事务同时新增
+    auto& added_vertices = ws_.added_vertices_[label];
+    vid_t added_vertices_num = added_vertices.size();
+    auto& added_lids = ws_.added_vertices_lid_[label];
+    added_lids.resize(added_vertices_num);
     for (vid_t v = 0; v < added_vertices_num; ++v) {
-      vid_t lid = v + added_vertices_base_[label];
       oid_t oid;
-      CHECK(added_vertices_[label].get_key(v, oid));
-      added_vertices.emplace_back(lid, oid);
-    }
-    std::sort(added_vertices.begin(), added_vertices.end(),
-              [](const std::pair<vid_t, oid_t>& lhs,
-                 const std::pair<vid_t, oid_t>& rhs) {
-                return lhs.first < rhs.first;
-              });
-
-    auto& table = extra_vertex_properties_[label];
-    auto& vertex_offset = vertex_offsets_[label];
-    for (auto& pair : added_vertices) {
-      vid_t offset = vertex_offset.at(pair.first);
-      vid_t lid = graph_.add_vertex(label, pair.second);
-      graph_.get_vertex_table(label).insert(lid, table.get_row(offset));
-      CHECK_EQ(lid, pair.first);
-      vertex_offset.erase(pair.first);
+      CHECK(added_vertices.get_key(v, oid));
+      vid_t lid;
+      if (!graph_.get_lid(label, oid, lid)) {
+        lid = graph_.add_vertex(label, oid);
+      }
+      added_lids[v] = lid;
     }
 
-    for (auto& pair : vertex_offset) {
-      vid_t lid = pair.first;
-      vid_t offset = pair.second;
-      graph_.get_vertex_table(label).insert(lid, table.get_row(offset));
+    // 只写回被设置过的列，新增顶点的所有列都已设置。已有顶点的属性先以
+    // 提交时间戳保存旧版本再覆盖，更早的读事务仍读到旧值
+    auto& table = graph_.get_vertex_table(label);
+    auto& rows = ws_.staged_rows_[label];
+    size_t col_num = table.col_num();
+    vid_t base = ws_.added_vertices_base_[label];
+    for (auto& pair : ws_.vertex_offsets_[label]) {
+      vid_t lid = resolve_lid(label, pair.first);
+      auto& row = rows[pair.second];
+      for (size_t i = 0; i < col_num; ++i) {
+        if (row[i].type != PropertyType::kEmpty) {
+          auto column = table.get_column_by_id(i);
+#if !OV
+          if (pair.first < base) {
+            save_version(*column, lid, timestamp_);
+          }
+#endif
+          column->set_any(lid, row[i]);
+        }
+      }
     }
-
-    CHECK_EQ(graph_.vertex_num(label), vertex_nums_[label]);
   }
-
-  added_vertices_.clear();
-  vertex_nums_.clear();
-  vertex_offsets_.clear();
-  extra_vertex_properties_.clear();
 }
 
 void UpdateTransaction::applyEdgesUpdates() {
-  for (label_t src_label = 0; src_label < vertex_label_num_; ++src_label) {
-    for (label_t dst_label = 0; dst_label < vertex_label_num_; ++dst_label) {
-      for (label_t edge_label = 0; edge_label < edge_label_num_; ++edge_label) {
-        size_t oe_csr_index =
-            get_out_csr_index(src_label, dst_label, edge_label);
-        for (auto& pair : updated_edge_data_[oe_csr_index]) {
-          auto& updates = pair.second;
-          if (updates.empty()) {
-            continue;
-          }
-          std::shared_ptr<MutableCsrEdgeIterBase> edge_iter =
-              graph_.get_outgoing_edges_mut(src_label, pair.first, dst_label,
-                                            edge_label);
-          while (edge_iter->is_valid()) {
-            auto iter = updates.find(edge_iter->get_neighbor());
-            if (iter != updates.end()) {
-              edge_iter->set_data(iter->second, timestamp_);
-            }
-            edge_iter->next();
-          }
-        }
-
-        MutableCsrBase* csr =
-            graph_.get_oe_csr(src_label, dst_label, edge_label);
-
-        for (auto& pair : added_edges_[oe_csr_index]) {
-          vid_t v = pair.first;
-          auto& add_list = pair.second;
-          if (add_list.empty()) {
-            continue;
-          }
-          auto& edge_data = updated_edge_data_[oe_csr_index].at(v);
-          for (auto u : add_list) {
-            auto value = edge_data.at(u);
-            csr->put_generic_edge(v, u, value, timestamp_, alloc_);
-          }
+  // 先为边属性表中的新增边分配边id并写入属性，两个方向的邻接表共享边id
+  for (auto& staged : ws_.table_edges_) {
+    staged.eid = staged.table->allocate();
+    staged.table->insert(staged.eid, staged.props);
+  }
+  size_t vve = vertex_label_num_ * vertex_label_num_ * edge_label_num_;
+  // 只遍历写过的csr，下标的编码见get_in_csr_index/get_out_csr_index
+  for (auto csr_index : ws_.touched_csrs_) {
+    bool dir = csr_index >= vve;
+    size_t index = csr_index % vve;
+    label_t src_label = index / (vertex_label_num_ * edge_label_num_);
+    label_t dst_label = (index / edge_label_num_) % vertex_label_num_;
+    label_t edge_label = index % edge_label_num_;
+    // 出边以src为端点，入边以dst为端点
+    label_t v_label = dir ? src_label : dst_label;
+    label_t nbr_label = dir ? dst_label : src_label;
+    auto& updates = *ws_.edge_updates_[csr_index];
+    // 边属性表中的边在邻接表中只有边id，暂存的数据都是新增边的下标
+    bool in_edge_table =
+        graph_.get_edge_table(src_label, dst_label, edge_label) != nullptr;
+
+    for (auto& pair : updates.updated_edge_data) {
+      auto& edge_data = pair.second;
+      if (edge_data.empty() || in_edge_table) {
+        continue;
+      }
+      if (pair.first >= ws_.added_vertices_base_[v_label]) {
+        continue;
+      }
+      std::shared_ptr<MutableCsrEdgeIterBase> edge_iter =
+          dir ? graph_.get_outgoing_edges_mut(v_label, pair.first, nbr_label,
+                                              edge_label)
+              : graph_.get_incoming_edges_mut(v_label, pair.first, nbr_label,
+                                              edge_label);
+      vid_t nbr_base = ws_.added_vertices_base_[nbr_label];
+      while (edge_iter->is_valid()) {
+        // 临时的lid可能与并发新增的顶点相同
+        vid_t nbr = edge_iter->get_neighbor();
+        auto iter = nbr < nbr_base ? edge_data.find(nbr) : edge_data.end();
+        // set_data先以提交时间戳保存旧值，更早的读事务仍读到它
+        if (iter != edge_data.end()) {
+          edge_iter->set_data(iter->second, timestamp_);
         }
+        edge_iter->next();
       }
     }
-  }
-
-  for (label_t src_label = 0; src_label < vertex_label_num_; ++src_label) {
-    for (label_t dst_label = 0; dst_label < vertex_label_num_; ++dst_label) {
-      for (label_t edge_label = 0; edge_label < edge_label_num_; ++edge_label) {
-        size_t ie_csr_index =
-            get_in_csr_index(src_label, dst_label, edge_label);
-        for (auto& pair : updated_edge_data_[ie_csr_index]) {
-          auto& updates = pair.second;
-          if (updates.empty()) {
-            continue;
-          }
-          std::shared_ptr<MutableCsrEdgeIterBase> edge_iter =
-              graph_.get_incoming_edges_mut(dst_label, pair.first, src_label,
-                                            edge_label);
-          while (edge_iter->is_valid()) {
-            auto iter = updates.find(edge_iter->get_neighbor());
-            if (iter != updates.end()) {
-              edge_iter->set_data(iter->second, timestamp_);
-            }
-            edge_iter->next();
-          }
-        }
-
-        MutableCsrBase* csr =
-            graph_.get_ie_csr(dst_label, src_label, edge_label);
 
-        for (auto& pair : added_edges_[ie_csr_index]) {
-          vid_t v = pair.first;
-          auto& add_list = pair.second;
-          if (add_list.empty()) {
-            continue;
-          }
-          auto& edge_data = updated_edge_data_[ie_csr_index].at(v);
-          for (auto u : add_list) {
-            auto value = edge_data.at(u);
-            csr->put_generic_edge(v, u, value, timestamp_, alloc_);
-          }
+    MutableCsrBase* csr =
+        dir ? graph_.get_oe_csr(src_label, dst_label, edge_label)
+            : graph_.get_ie_csr(dst_label, src_label, edge_label);
+    for (auto& pair : updates.added_edges) {
+      vid_t v = pair.first;
+      auto& add_list = pair.second;
+      if (add_list.empty()) {
+        continue;
+      }
+      auto& edge_data = updates.updated_edge_data.at(v);
+      vid_t v_lid = resolve_lid(v_label, v);
+      for (auto u : add_list) {
+        auto value = edge_data.at(u);
+        if (in_edge_table) {
+          value = Any::From(ws_.table_edges_[value.AsInt64()].eid);
         }
+        csr->put_generic_edge(v_lid, resolve_lid(nbr_label, u), value,
+                              timestamp_, alloc_);
       }
     }
   }
-  added_edges_.clear();
-  updated_edge_data_.clear();
 }
 
 }  // namespace gs
@@ -16,10 +16,13 @@
 #ifndef GRAPHSCOPE_DATABASE_UPDATE_TRANSACTION_H_
 #define GRAPHSCOPE_DATABASE_UPDATE_TRANSACTION_H_
 
+#include <deque>
 #include <limits>
+#include <memory>
 #include <utility>
 
 #include "flat_hash_map/flat_hash_map.hpp"
+#include "flex/storages/rt_mutable_graph/edge_property_table.h"
 #include "flex/storages/rt_mutable_graph/mutable_csr.h"
 #include "flex/storages/rt_mutable_graph/types.h"
 #include "flex/utils/id_indexer.h"
@@ -33,17 +36,104 @@ class MutablePropertyFragment;
 class WalWriter;
 class VersionManager;
 
+/**
+ * @brief 更新事务的工作区，由会话持有并在该会话的更新事务之间复用。各个label
+ * 和csr的结构在第一次用到时才分配，事务结束时只重置用到过的部分。修改的顶点
+ * 属性暂存在内存中，只记录被写过的列，读回时也直接从内存返回。同一个会话
+ * 同时只能有一个更新事务。
+ */
+class UpdateWorkspace {
+ public:
+  UpdateWorkspace();
+  ~UpdateWorkspace();
+
+ private:
+  friend class UpdateTransaction;
+
+  struct EdgeUpdates {
+    ska::flat_hash_map<vid_t, std::vector<vid_t>> added_edges;
+    ska::flat_hash_map<vid_t, ska::flat_hash_map<vid_t, Any>>
+        updated_edge_data;
+  };
+
+  // 属性存放在边属性表中的新增边。提交前邻接表的暂存数据是它在
+  // table_edges_中的下标，提交时分配边id并写入属性
+  struct TableEdge {
+    EdgePropertyTable* table;
+    std::vector<Any> props;
+    edge_id_t eid;
+  };
+
+  void begin(const MutablePropertyFragment& graph);
+
+  void reset();
+
+  void touch_label(label_t label);
+
+  // 返回lid对应的暂存行，不存在时新建一个所有列都未设置(kEmpty)的行
+  std::vector<Any>& staged_row(label_t label, vid_t lid, size_t col_num);
+
+  bool find_staged_row(label_t label, vid_t lid, vid_t& offset) const;
+
+  EdgeUpdates& edge_updates(size_t csr_index);
+
+  const EdgeUpdates* find_edge_updates(size_t csr_index) const;
+
+  // 字符串只保存string_view，复制一份到工作区中
+  Any own(const Any& value);
+
+#if !OV
+  // 读取暂存的列时需要BufferBlock，把暂存的值复制到自有内存的BufferBlock中
+  static gbp::BufferBlock readback(const Any& value);
+#endif
+
+  size_t vertex_label_num_;
+  size_t edge_label_num_;
+
+  std::vector<IdIndexer<oid_t, vid_t>> added_vertices_;
+  std::vector<vid_t> added_vertices_base_;
+  std::vector<std::vector<vid_t>> added_vertices_lid_;
+  std::vector<vid_t> vertex_nums_;
+  // lid -> 暂存行的下标
+  std::vector<ska::flat_hash_map<vid_t, vid_t>> vertex_offsets_;
+  std::vector<std::vector<std::vector<Any>>> staged_rows_;
+  std::vector<bool> label_touched_;
+  std::vector<label_t> touched_labels_;
+
+  std::vector<std::unique_ptr<EdgeUpdates>> edge_updates_;
+  std::vector<bool> csr_touched_;
+  std::vector<size_t> touched_csrs_;
+  std::vector<TableEdge> table_edges_;
+
+  std::deque<std::string> strings_;
+  std::vector<size_t> locked_slots_;
+  grape::InArchive arc_;
+};
+
+/**
+ * @brief 更新事务与读、插入事务以及其他更新事务并发执行。写入的顶点(边的
+ * 两个端点)在第一次写时加记录锁，直到提交或回滚；锁被其他事务持有时写操作
+ * 失败，事务只能回滚。提交时校验持有的锁在事务开始之后没有被其他事务提交过，
+ * 否则回滚。事务只读到开始时已提交的边。
+ *
+ * 新增的顶点和边带有时间戳，旧的读事务看不到，提交时与其他事务并发写入。
+ * 已有顶点的属性和已有边的数据在提交时原地覆盖，覆盖前的值以提交时间戳
+ * 记入所在列或csr的CellVersions，读时间戳更早的事务仍读到旧值，因此提交
+ * 不需要独占，也不等待读事务。
+ */
 class UpdateTransaction {
  public:
   UpdateTransaction(MutablePropertyFragment& graph, MMapAllocator& alloc,
-                    const std::string& work_dir, WalWriter& logger,
-                    VersionManager& vm, timestamp_t timestamp);
+                    UpdateWorkspace& ws, WalWriter& logger, VersionManager& vm,
+                    timestamp_t timestamp, timestamp_t read_ts);
 
   ~UpdateTransaction();
 
   timestamp_t timestamp() const;
 
-  void Commit();
+  // 发生写冲突或校验失败时回滚并返回false，调用方需要重新执行整个事务或者
+  // 向客户端报告失败
+  [[nodiscard]] bool Commit();
 
   void Abort();
 
@@ -52,6 +142,10 @@ class UpdateTransaction {
   bool AddEdge(label_t src_label, oid_t src, label_t dst_label, oid_t dst,
                label_t edge_label, const Any& value);
 
+  // 多属性或字符串属性的边，props按schema中边属性的顺序给出
+  bool AddEdge(label_t src_label, oid_t src, label_t dst_label, oid_t dst,
+               label_t edge_label, const std::vector<Any>& props);
+
   class vertex_iterator {
    public:
     vertex_iterator(label_t label, vid_t cur, vid_t& num,
@@ -104,6 +198,9 @@ class UpdateTransaction {
     label_t GetEdgeLabel() const;
 
    private:
+    // 跳过事务开始之后由其他事务提交的边
+    void skip_invisible();
+
     bool dir_;
 
     label_t label_;
@@ -156,6 +253,21 @@ class UpdateTransaction {
 
   oid_t lid_to_oid(label_t label, vid_t lid) const;
 
+  // 对(label, oid)加记录锁，失败时标记冲突
+  bool lock_vertex(label_t label, oid_t oid);
+
+  // 在两个方向的邻接表中暂存一条新增边
+  void stage_edge(label_t src_label, vid_t src_lid, label_t dst_label,
+                  vid_t dst_lid, label_t edge_label, const Any& value);
+
+  // 提交时校验持有的锁
+  bool validate() const;
+
+  void unlock_all(timestamp_t commit_ts);
+
+  // 事务内新增的顶点在提交前使用临时的lid，提交后映射为实际的lid
+  vid_t resolve_lid(label_t label, vid_t lid) const;
+
   void release();
 
   void applyVerticesUpdates();
@@ -164,27 +276,17 @@ class UpdateTransaction {
 
   MutablePropertyFragment& graph_;
   MMapAllocator& alloc_;
+  UpdateWorkspace& ws_;
   WalWriter& logger_;
   VersionManager& vm_;
   timestamp_t timestamp_;
+  timestamp_t read_ts_;  // 事务开始时已提交的最大时间戳
 
-  grape::InArchive arc_;
+  bool conflict_;
   int op_num_;
 
   size_t vertex_label_num_;
   size_t edge_label_num_;
-
-  std::vector<IdIndexer<oid_t, vid_t>> added_vertices_;
-  std::vector<vid_t> added_vertices_base_;
-  std::vector<vid_t> vertex_nums_;
-  std::vector<ska::flat_hash_map<vid_t, vid_t>> vertex_offsets_;
-  std::vector<Table> extra_vertex_properties_;
-
-  std::vector<ska::flat_hash_map<vid_t, std::vector<vid_t>>> added_edges_;
-  std::vector<ska::flat_hash_map<vid_t, ska::flat_hash_map<vid_t, Any>>>
-      updated_edge_data_;
-
-  std::vector<std::string> sv_vec_;
 };
 
 }  // namespace gs
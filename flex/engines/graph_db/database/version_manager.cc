@@ -15,6 +15,8 @@
 
 #include "flex/engines/graph_db/database/version_manager.h"
 
+#include <vector>
+
 #include "flex/engines/graph_db/app/app_base.h"
 
 // #define likely(x) __builtin_expect(!!(x), 1)
@@ -24,7 +26,72 @@ namespace gs {
 constexpr static uint32_t ring_buf_size = 1024 * 1024;
 constexpr static uint32_t ring_index_mask = ring_buf_size - 1;
 
-VersionManager::VersionManager() { buf_.init(ring_buf_size); }
+namespace {
+
+// 槽号在进程内所有VersionManager之间共用。线程第一次使用时取一个空闲的槽号，
+// 退出时归还，每个槽只属于一个线程；没有空闲的槽号时等待其他线程退出
+class SlotRegistry {
+ public:
+  // 线程退出时还要归还槽号，因此不随静态对象析构
+  static SlotRegistry& get() {
+    static SlotRegistry* registry = new SlotRegistry();
+    return *registry;
+  }
+
+  size_t acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (free_slots_.empty()) {
+      LOG(WARNING) << "All " << VersionManager::kActiveSlotNum
+                   << " active slots are in use, waiting for a thread to exit";
+    }
+    cv_.wait(lock, [this] { return !free_slots_.empty(); });
+    size_t slot = free_slots_.back();
+    free_slots_.pop_back();
+    return slot;
+  }
+
+  void release(size_t slot) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      free_slots_.push_back(slot);
+    }
+    cv_.notify_one();
+  }
+
+ private:
+  SlotRegistry() {
+    free_slots_.reserve(VersionManager::kActiveSlotNum);
+    for (size_t i = VersionManager::kActiveSlotNum; i > 0; --i) {
+      free_slots_.push_back(i - 1);
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<size_t> free_slots_;
+};
+
+struct ThreadSlot {
+  ThreadSlot() : slot(SlotRegistry::get().acquire()) {}
+  ~ThreadSlot() { SlotRegistry::get().release(slot); }
+
+  size_t slot;
+};
+
+size_t this_thread_slot() {
+  thread_local ThreadSlot slot;
+  return slot.slot;
+}
+
+}  // namespace
+
+VersionManager::VersionManager()
+    : active_(new ActiveSlot[kActiveSlotNum]),
+      committed_(new std::atomic<uint8_t>[ring_buf_size]) {
+  for (uint32_t i = 0; i < ring_buf_size; ++i) {
+    committed_[i].store(0);
+  }
+}
 
 VersionManager::~VersionManager() {}
 
@@ -33,79 +100,241 @@ void VersionManager::init_ts(uint32_t ts) {
   read_ts_.store(ts);
 }
 
+void VersionManager::enter_read(ActiveSlot& slot, uint32_t ts) {
+  uint64_t cur = slot.readers.load();
+  uint64_t next;
+  do {
+    uint32_t min_ts =
+        reader_num(cur) == 0 ? ts : std::min(reader_min_ts(cur), ts);
+    next = (static_cast<uint64_t>(reader_num(cur) + 1) << 32) | min_ts;
+  } while (!slot.readers.compare_exchange_weak(cur, next));
+}
+
+void VersionManager::exit_read(ActiveSlot& slot) {
+  uint64_t cur = slot.readers.load();
+  uint64_t next;
+  do {
+    uint32_t num = reader_num(cur) - 1;
+    next = num == 0 ? 0 : ((static_cast<uint64_t>(num) << 32) |
+                           reader_min_ts(cur));
+  } while (!slot.readers.compare_exchange_weak(cur, next));
+}
+
 uint32_t VersionManager::acquire_read_timestamp() {
-  auto pr = pending_reqs_.fetch_add(1);
-  if (likely(pr >= 0)) {
-    return read_ts_.load();
-  } else {
-    while (true) {
-      while (pending_reqs_.load() < 0) {
-        std::this_thread::sleep_for(std::chrono::microseconds(100));
-      }
-      pr = pending_reqs_.fetch_add(1);
-      if (pr >= 0) {
-        return read_ts_.load();
-      }
+  auto& slot = active_[this_thread_slot()];
+  while (true) {
+    // 先登记再检查，与acquire_exclusive_timestamp中先置位再等待配对。登记的
+    // 下界在登记之前读取，返回的时间戳在登记之后读取，不会小于下界，也不会
+    // 小于登记之前min_active_read_timestamp()看到的read_ts_
+    enter_read(slot, read_ts_.load());
+    if (likely(!exclusive_.load())) {
+      return read_ts_.load();
     }
+    exit_read(slot);
+    notify_drainer();
+    wait_unblocked(false);
   }
 }
 
-void VersionManager::release_read_timestamp() { pending_reqs_.fetch_sub(1); }
+void VersionManager::release_read_timestamp() {
+  exit_read(active_[this_thread_slot()]);
+  notify_drainer();
+}
 
-uint32_t VersionManager::acquire_insert_timestamp() {
-  auto pr = pending_reqs_.fetch_add(1);
-  if (likely(pr >= 0)) {
-    return write_ts_.fetch_add(1);
-  } else {
-    while (true) {
-      while (pending_reqs_.load() < 0) {
-        std::this_thread::sleep_for(std::chrono::microseconds(100));
-      }
-      pr = pending_reqs_.fetch_add(1);
-      if (pr >= 0) {
-        return write_ts_.fetch_add(1);
-      }
+uint32_t VersionManager::min_active_read_timestamp() const {
+  // 先读read_ts_再扫描：扫描时没有看到的读事务在之后登记，时间戳不小于它
+  uint32_t ret = read_ts_.load();
+  for (size_t i = 0; i < kActiveSlotNum; ++i) {
+    uint64_t readers = active_[i].readers.load();
+    if (reader_num(readers) != 0) {
+      ret = std::min(ret, reader_min_ts(readers));
     }
   }
+  return ret;
 }
-void VersionManager::release_insert_timestamp(uint32_t ts) {
-  lock_.lock();
-  if (ts == read_ts_.load() + 1) {
-    while (buf_.reset_bit_with_ret((ts + 1) & ring_index_mask)) {
-      ++ts;
+
+void VersionManager::enter_write() {
+  auto& slot = active_[this_thread_slot()];
+  while (true) {
+    slot.writers.fetch_add(1);
+    if (likely(!writes_frozen_.load() && !exclusive_.load())) {
+      return;
+    }
+    slot.writers.fetch_sub(1);
+    notify_drainer();
+    wait_unblocked(true);
+  }
+}
+
+void VersionManager::exit_write() {
+  active_[this_thread_slot()].writers.fetch_sub(1);
+  notify_drainer();
+}
+
+void VersionManager::wait_unblocked(bool write) {
+  std::unique_lock<std::mutex> lock(wait_mutex_);
+  wait_cv_.wait(lock, [&] {
+    return !exclusive_.load() && !(write && writes_frozen_.load());
+  });
+}
+
+// 修改阻塞标记的一方在锁内修改，之后唤醒所有等待者
+void VersionManager::notify_blocked() { wait_cv_.notify_all(); }
+
+bool VersionManager::drained(bool include_readers) const {
+  for (size_t i = 0; i < kActiveSlotNum; ++i) {
+    if (active_[i].writers.load() != 0 ||
+        (include_readers && reader_num(active_[i].readers.load()) != 0)) {
+      return false;
     }
-    read_ts_.store(ts);
-  } else {
-    buf_.set_bit(ts & ring_index_mask);
   }
-  lock_.unlock();
+  return true;
+}
 
-  pending_reqs_.fetch_sub(1);
+void VersionManager::wait_drained(bool include_readers) {
+  drain_waiters_.fetch_add(1);
+  {
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    wait_cv_.wait(lock, [&] { return drained(include_readers); });
+  }
+  drain_waiters_.fetch_sub(1);
 }
 
-uint32_t VersionManager::acquire_update_timestamp() {
-  int expected = 0;
-  while (!pending_reqs_.compare_exchange_strong(
-      expected, std::numeric_limits<int>::min())) {
-    expected = 0;
-    std::this_thread::sleep_for(std::chrono::microseconds(100));
+// 只有独占或checkpoint在等待时才需要唤醒，平时只多一次读
+void VersionManager::notify_drainer() {
+  if (unlikely(drain_waiters_.load() > 0)) {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    wait_cv_.notify_all();
   }
+}
+
+uint32_t VersionManager::acquire_shared_write_timestamp() {
+  enter_write();
   return write_ts_.fetch_add(1);
 }
+
+void VersionManager::release_shared_write_timestamp(uint32_t ts) {
+  // 先标记已提交，再尝试按顺序推进read_ts_；推进由看到连续标记的任意线程完成
+  committed_[ts & ring_index_mask].store(1);
+  uint32_t cur = read_ts_.load();
+  while (committed_[(cur + 1) & ring_index_mask].load()) {
+    if (read_ts_.compare_exchange_weak(cur, cur + 1)) {
+      ++cur;
+      committed_[cur & ring_index_mask].store(0);
+    }
+  }
+
+  exit_write();
+}
+
+uint32_t VersionManager::acquire_insert_timestamp() {
+  return acquire_shared_write_timestamp();
+}
+void VersionManager::release_insert_timestamp(uint32_t ts) {
+  release_shared_write_timestamp(ts);
+}
+
+// 更新事务与插入事务一样按时间戳顺序推进read_ts_，不再排空读事务
+uint32_t VersionManager::acquire_update_timestamp(uint32_t& read_ts) {
+  auto& slot = active_[this_thread_slot()];
+  while (true) {
+    enter_read(slot, read_ts_.load());
+    slot.writers.fetch_add(1);
+    if (likely(!writes_frozen_.load() && !exclusive_.load())) {
+      read_ts = read_ts_.load();
+      return write_ts_.fetch_add(1);
+    }
+    slot.writers.fetch_sub(1);
+    exit_read(slot);
+    notify_drainer();
+    wait_unblocked(true);
+  }
+}
+
 void VersionManager::release_update_timestamp(uint32_t ts) {
-  buf_.set_bit(ts & ring_index_mask);
-  pending_reqs_.store(0);
+  exit_read(active_[this_thread_slot()]);
+  release_shared_write_timestamp(ts);
 }
 
-bool VersionManager::revert_update_timestamp(uint32_t ts) {
+uint32_t VersionManager::acquire_exclusive_timestamp() {
+  {
+    // 同时只有一个独占者
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    wait_cv_.wait(lock, [&] { return !exclusive_.load(); });
+    exclusive_.store(true);
+  }
+  wait_drained(true);
+  return write_ts_.fetch_add(1);
+}
+
+bool VersionManager::revert_exclusive_timestamp(uint32_t ts) {
   uint32_t expected_ts = ts + 1;
   if (write_ts_.compare_exchange_strong(expected_ts, ts)) {
-    pending_reqs_.store(0);
+    {
+      std::lock_guard<std::mutex> lock(wait_mutex_);
+      exclusive_.store(false);
+    }
+    notify_blocked();
     return true;
   }
   return false;
 }
 
+uint32_t VersionManager::acquire_checkpoint_timestamp() {
+  {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    writes_frozen_.store(true);
+  }
+  wait_drained(false);
+  // 写事务都已结束，小于write_ts_的事务都已提交；持有读时间戳以排除独占的
+  // dump，并使压缩搬走的旧空间在checkpoint结束之前不被回收
+  acquire_read_timestamp();
+  return write_ts_.load() - 1;
+}
+
+void VersionManager::release_checkpoint_timestamp() {
+  release_read_timestamp();
+  {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    writes_frozen_.store(false);
+  }
+  notify_blocked();
+}
+
+RecordLockTable::RecordLockTable() { init(0); }
+
+void RecordLockTable::init(size_t record_num) {
+  size_t slot_num = kMinSlotNum;
+  while (slot_num < 2 * record_num && slot_num < kMaxSlotNum) {
+    slot_num <<= 1;
+  }
+  slot_mask_ = slot_num - 1;
+  owners_.reset(new std::atomic<uint32_t>[slot_num]);
+  last_commit_ts_.reset(new std::atomic<uint32_t>[slot_num]);
+  for (size_t i = 0; i < slot_num; ++i) {
+    owners_[i].store(0);
+    last_commit_ts_[i].store(0);
+  }
+}
+
+// 只尝试一次，被其他事务持有时不等待它释放
+int RecordLockTable::lock(size_t key, uint32_t owner, size_t& slot) {
+  key *= 0x9E3779B97F4A7C15ull;
+  slot = (key >> 32) & slot_mask_;
+  uint32_t expected = 0;
+  if (owners_[slot].compare_exchange_strong(expected, owner)) {
+    return 1;
+  }
+  return expected == owner ? 0 : -1;
+}
+
+void RecordLockTable::unlock(size_t slot, uint32_t commit_ts) {
+  if (commit_ts != 0) {
+    last_commit_ts_[slot].store(commit_ts);
+  }
+  owners_[slot].store(0);
+}
+
 }  // namespace gs
 
 #undef likely
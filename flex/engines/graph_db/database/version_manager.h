@@ -22,15 +22,61 @@
 
 #include <array>
 #include <atomic>
-#include <bitset>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <thread>
 
 #include "glog/logging.h"
-#include "grape/utils/bitset.h"
 #include "grape/utils/concurrent_queue.h"
 
 namespace gs {
 
+/**
+ * @brief 更新事务的记录锁，按key散列到槽上。锁由事务时间戳持有，直到提交或
+ * 回滚；获取失败时立即返回，不等待也不重试(no-wait)，由事务回滚，因此不会
+ * 死锁。每个槽还记录最近一次提交的时间戳，用于提交时的校验。
+ *
+ * 不同的记录可能散列到同一个槽上，造成误报的冲突。槽数S按打开时的顶点数V
+ * 取不小于2V的2的幂(在[kMinSlotNum, kMaxSlotNum]之间)。并发的更新事务共持有
+ * H个锁时，一次加锁误报冲突的概率约为H/S；例如32个事务各持有8个锁、
+ * S = 2^20时约为0.02%。提交时的校验同理，事务执行期间其他事务提交了C个
+ * 记录时，每个持有的槽被误判为已修改的概率约为C/S。
+ */
+class RecordLockTable {
+ public:
+  static constexpr size_t kMinSlotNum = 1 << 16;
+  static constexpr size_t kMaxSlotNum = 1 << 24;
+
+  RecordLockTable();
+
+  // 按记录数重新分配槽，只能在没有更新事务时调用
+  void init(size_t record_num);
+
+  // 返回1表示新获取，0表示已由owner持有，-1表示被其他事务持有
+  int lock(size_t key, uint32_t owner, size_t& slot);
+
+  // commit_ts为0表示回滚
+  void unlock(size_t slot, uint32_t commit_ts);
+
+  uint32_t last_commit_ts(size_t slot) const {
+    return last_commit_ts_[slot].load();
+  }
+
+  size_t slot_num() const { return slot_mask_ + 1; }
+
+ private:
+  size_t slot_mask_;
+  std::unique_ptr<std::atomic<uint32_t>[]> owners_;
+  std::unique_ptr<std::atomic<uint32_t>[]> last_commit_ts_;
+};
+
+/**
+ * @brief 时间戳管理。活跃的读、写事务登记在按线程分配的槽中，每个线程独占
+ * 一个槽，获取读时间戳只修改本线程的槽；独占和checkpoint时才汇总所有槽。
+ * 槽数不够时新线程等待其他线程退出。事务的获取和释放必须在同一个线程中
+ * 进行。写事务的提交顺序由无锁的环形标记推进read_ts_。
+ */
 class VersionManager {
  public:
   VersionManager();
@@ -45,18 +91,84 @@ class VersionManager {
   uint32_t acquire_insert_timestamp();
   void release_insert_timestamp(uint32_t ts);
 
-  uint32_t acquire_update_timestamp();
+  // 更新事务与读、插入事务并发执行，写冲突由record_locks()检测。更新事务
+  // 同时登记为读事务，read_ts为它能看到的最大时间戳；两者一起登记，避免在
+  // 两次登记之间被独占阻塞而死锁。释放时一起注销
+  uint32_t acquire_update_timestamp(uint32_t& read_ts);
   void release_update_timestamp(uint32_t ts);
-  bool revert_update_timestamp(uint32_t ts);
+
+  // 独占的时间戳，等待所有事务结束，期间没有其他事务开始。调用线程不能
+  // 持有其他时间戳
+  uint32_t acquire_exclusive_timestamp();
+  bool revert_exclusive_timestamp(uint32_t ts);
+
+  // 当前可见的最大时间戳，不超过它的事务都已提交
+  uint32_t read_timestamp() const { return read_ts_.load(); }
+
+  // 活跃的读事务中最小的读时间戳的下界，没有活跃的读事务时为read_ts_。
+  // 之后开始的读事务的时间戳都不小于返回值
+  uint32_t min_active_read_timestamp() const;
+
+  RecordLockTable& record_locks() { return record_locks_; }
+
+  static constexpr size_t kActiveSlotNum = 4096;
+
+  /**
+   * @brief 暂停新的插入和更新事务并等待已开始的提交，读事务不受影响。
+   * 返回的时间戳及之前的事务都已提交。
+   */
+  uint32_t acquire_checkpoint_timestamp();
+  void release_checkpoint_timestamp();
 
  private:
+  // 独占一个cache line，避免不同线程的槽互相干扰
+  // readers的高32位为本线程的读事务数，低32位为这些读事务时间戳的下界，两者
+  // 一起修改；读事务数回到0时下界才被重置。槽不与其他线程共用，下界只被本
+  // 线程嵌套的读事务拖住，本线程的读事务都结束后即可前移
+  struct alignas(64) ActiveSlot {
+    std::atomic<uint64_t> readers{0};
+    std::atomic<int> writers{0};
+  };
+
+  static uint32_t reader_num(uint64_t readers) { return readers >> 32; }
+  static uint32_t reader_min_ts(uint64_t readers) {
+    return static_cast<uint32_t>(readers);
+  }
+
+  void enter_read(ActiveSlot& slot, uint32_t ts);
+  void exit_read(ActiveSlot& slot);
+
+  // 插入和更新事务开始前登记，checkpoint时据此暂停写事务
+  void enter_write();
+  void exit_write();
+
+  uint32_t acquire_shared_write_timestamp();
+  void release_shared_write_timestamp(uint32_t ts);
+
+  // 被独占或checkpoint阻塞时在条件变量上等待，不再轮询
+  void wait_unblocked(bool write);
+  void notify_blocked();
+
+  // 等待所有槽中的写事务(以及读事务)结束
+  void wait_drained(bool include_readers);
+  void notify_drainer();
+  bool drained(bool include_readers) const;
+
   std::atomic<uint32_t> write_ts_{1};
   std::atomic<uint32_t> read_ts_{0};
 
-  std::atomic<int> pending_reqs_{0};
+  std::unique_ptr<ActiveSlot[]> active_;
+  // 已提交但read_ts_还没有推进到的时间戳
+  std::unique_ptr<std::atomic<uint8_t>[]> committed_;
+
+  std::atomic<bool> exclusive_{false};
+  std::atomic<bool> writes_frozen_{false};
+  std::atomic<int> drain_waiters_{0};
+
+  std::mutex wait_mutex_;
+  std::condition_variable wait_cv_;
 
-  grape::Bitset buf_;
-  grape::SpinLock lock_;
+  RecordLockTable record_locks_;
 };
 
 }  // namespace gs
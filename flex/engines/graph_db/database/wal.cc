@@ -15,12 +15,164 @@
 
 #include "flex/engines/graph_db/database/wal.h"
 
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
 
 namespace gs {
 
-void WalWriter::open(const std::string& prefix, int thread_id) {
+WalSyncMode StringToWalSyncMode(const std::string& str) {
+  if (str == "none") {
+    return WalSyncMode::kNone;
+  } else if (str == "sync") {
+    return WalSyncMode::kSync;
+  } else if (str == "group") {
+    return WalSyncMode::kGroup;
+  } else if (str == "async") {
+    return WalSyncMode::kAsync;
+  }
+  LOG(FATAL) << "Unknown wal sync mode: " << str;
+  return WalSyncMode::kGroup;
+}
+
+static void sync_wal_file(int fd) {
+#ifdef F_FULLFSYNC
+  if (fcntl(fd, F_FULLFSYNC) != 0) {
+    LOG(FATAL) << "Failed to fcntl sync wal file";
+  }
+#else
+  if (fdatasync(fd) != 0) {
+    LOG(FATAL) << "Failed to fsync wal file";
+  }
+#endif
+}
+
+namespace {
+thread_local WalFlusher::DeferredWait* deferred_wait = nullptr;
+}  // namespace
+
+WalFlusher::DeferredWait::DeferredWait() : prev_(deferred_wait) {
+  deferred_wait = this;
+}
+
+WalFlusher::DeferredWait::~DeferredWait() { deferred_wait = prev_; }
+
+void WalFlusher::start(WalSyncMode mode, uint32_t group_delay_us) {
+  stop();
+  mode_ = mode;
+  group_delay_us_ = group_delay_us;
+  if (mode_ != WalSyncMode::kGroup && mode_ != WalSyncMode::kAsync) {
+    return;
+  }
+  running_ = true;
+  thread_ = std::thread([this]() { run(); });
+}
+
+void WalFlusher::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  flush_cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void WalFlusher::commit(int fd) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!running_) {
+    lock.unlock();
+    sync_wal_file(fd);
+    return;
+  }
+  if (std::find(dirty_fds_.begin(), dirty_fds_.end(), fd) ==
+      dirty_fds_.end()) {
+    dirty_fds_.push_back(fd);
+  }
+  // 下一轮开始的刷盘一定包含这次登记
+  uint64_t target = epoch_ + 1;
+  flush_cv_.notify_one();
+  if (mode_ == WalSyncMode::kGroup) {
+    if (deferred_wait != nullptr) {
+      deferred_wait->epoch_ = std::max(deferred_wait->epoch_, target);
+      return;
+    }
+    done_cv_.wait(lock, [&]() { return flushed_epoch_ >= target; });
+  }
+}
+
+// kAsync模式下提交不等待，fd可能还在dirty_fds_中或者正在被同步
+void WalFlusher::drain(int fd) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  flush_cv_.notify_one();
+  done_cv_.wait(lock, [&]() {
+    return !flushing_ && std::find(dirty_fds_.begin(), dirty_fds_.end(),
+                                   fd) == dirty_fds_.end();
+  });
+}
+
+bool WalFlusher::on_flushed(uint64_t epoch, std::function<void()>&& callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (flushed_epoch_ >= epoch) {
+    return false;
+  }
+  callbacks_.emplace_back(epoch, std::move(callback));
+  return true;
+}
+
+void WalFlusher::run() {
+  std::vector<int> fds;
+  std::vector<std::function<void()>> ready;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    flush_cv_.wait(lock, [&]() { return !dirty_fds_.empty() || !running_; });
+    if (dirty_fds_.empty()) {
+      break;
+    }
+    if (running_ && group_delay_us_ != 0) {
+      // 等待同一窗口内的其他提交
+      flush_cv_.wait_for(lock, std::chrono::microseconds(group_delay_us_),
+                         [&]() { return !running_; });
+    }
+    fds.swap(dirty_fds_);
+    uint64_t epoch = ++epoch_;
+    flushing_ = true;
+    lock.unlock();
+    for (auto fd : fds) {
+      sync_wal_file(fd);
+    }
+    fds.clear();
+    lock.lock();
+    flushed_epoch_ = epoch;
+    flushing_ = false;
+    size_t kept = 0;
+    for (auto& item : callbacks_) {
+      if (item.first <= epoch) {
+        ready.emplace_back(std::move(item.second));
+      } else {
+        callbacks_[kept++] = std::move(item);
+      }
+    }
+    callbacks_.resize(kept);
+    done_cv_.notify_all();
+    if (!ready.empty()) {
+      lock.unlock();
+      for (auto& callback : ready) {
+        callback();
+      }
+      ready.clear();
+      lock.lock();
+    }
+  }
+}
+
+void WalWriter::open(const std::string& prefix, int thread_id,
+                     WalFlusher* flusher) {
+  flusher_ = flusher;
+  if (flusher_ != nullptr && flusher_->mode() == WalSyncMode::kNone) {
+    return;
+  }
   const int max_version = 65536;
   for (int version = 0; version != max_version; ++version) {
     std::string path = prefix + "/thread_" + std::to_string(thread_id) + "_" +
@@ -43,6 +195,9 @@ void WalWriter::open(const std::string& prefix, int thread_id) {
 
 void WalWriter::close() {
   if (fd_ != -1) {
+    if (flusher_ != nullptr) {
+      flusher_->drain(fd_);
+    }
     ::close(fd_);
     fd_ = -1;
     file_size_ = 0;
@@ -53,7 +208,6 @@ void WalWriter::close() {
 #define unlikely(x) __builtin_expect(!!(x), 0)
 
 void WalWriter::append(const char* data, size_t length) {
-  return;
   if (unlikely(fd_ == -1)) {
     return;
   }
@@ -72,18 +226,11 @@ void WalWriter::append(const char* data, size_t length) {
     LOG(FATAL) << "Failed to write wal file";
   }
 
-#if 1
-#ifdef F_FULLFSYNC
-  if (fcntl(fd_, F_FULLFSYNC) != 0) {
-    LOG(FATAL) << "Failed to fcntl sync wal file";
+  if (flusher_ == nullptr) {
+    sync_wal_file(fd_);
+  } else {
+    flusher_->commit(fd_);
   }
-#else
-  // if (fsync(fd_) != 0) {
-  if (fdatasync(fd_) != 0) {
-    LOG(FATAL) << "Failed to fsync wal file";
-  }
-#endif
-#endif
 }
 
 #undef unlikely
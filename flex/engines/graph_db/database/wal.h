@@ -21,10 +21,15 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <filesystem>
+#include <functional>
+#include <mutex>
 #include <queue>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "glog/logging.h"
 
@@ -47,14 +52,91 @@ struct UpdateWalUnit {
   size_t size{0};
 };
 
+// 事务提交时WAL的持久化方式
+enum class WalSyncMode {
+  kNone,   // 不写WAL
+  kSync,   // 每个事务在提交线程中write + fdatasync
+  kGroup,  // 组提交：提交线程write之后等待刷盘线程的下一次fdatasync
+  kAsync,  // 提交线程只write，刷盘线程周期性fdatasync，崩溃时可能丢失最近的事务
+};
+
+WalSyncMode StringToWalSyncMode(const std::string& str);
+
+/**
+ * @brief 组提交的刷盘线程。各会话仍然写自己的WAL文件(文件格式不变)，提交时
+ * 登记自己的fd并等待；刷盘线程每个窗口(最多等待group_delay_us)对所有登记过的
+ * fd各做一次fdatasync，然后一起唤醒这一窗口内的提交。
+ *
+ * seastar的shard上不能阻塞等待：在DeferredWait的作用域内提交时只登记，
+ * 需要等待的刷盘轮数记在scope中，调用方之后用on_flushed异步等待再返回响应。
+ * 这样的事务在刷盘之前已经对其他事务可见，但客户端在刷盘之后才收到结果。
+ */
+class WalFlusher {
+ public:
+  // 当前线程上的提交不等待刷盘，只记录需要等待的轮数
+  class DeferredWait {
+   public:
+    DeferredWait();
+    ~DeferredWait();
+    // 作用域内的提交需要等待的刷盘轮数，为0表示不需要等待
+    uint64_t epoch() const { return epoch_; }
+
+   private:
+    friend class WalFlusher;
+    uint64_t epoch_ = 0;
+    DeferredWait* prev_;
+  };
+
+  WalFlusher() = default;
+  ~WalFlusher() { stop(); }
+
+  void start(WalSyncMode mode, uint32_t group_delay_us);
+
+  // 刷完已登记的fd之后退出刷盘线程
+  void stop();
+
+  // fd上已经write的数据需要持久化；kGroup模式下等待刷盘完成，在DeferredWait
+  // 的作用域内只登记
+  void commit(int fd);
+
+  // 关闭fd之前调用：等待刷盘线程同步完fd上已登记的数据，之后刷盘线程不会
+  // 再访问这个fd
+  void drain(int fd);
+
+  // 第epoch轮刷盘完成之后在刷盘线程上调用callback；已经完成时返回false，
+  // 不调用callback
+  bool on_flushed(uint64_t epoch, std::function<void()>&& callback);
+
+  WalSyncMode mode() const { return mode_; }
+
+ private:
+  void run();
+
+  WalSyncMode mode_ = WalSyncMode::kSync;
+  uint32_t group_delay_us_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable flush_cv_;  // 唤醒刷盘线程
+  std::condition_variable done_cv_;   // 唤醒等待刷盘的提交
+  std::vector<int> dirty_fds_;
+  uint64_t epoch_ = 0;          // 已开始的刷盘轮数
+  uint64_t flushed_epoch_ = 0;  // 已完成的刷盘轮数
+  bool flushing_ = false;       // 刷盘线程正在锁外同步一轮fd
+  std::vector<std::pair<uint64_t, std::function<void()>>> callbacks_;
+  bool running_ = false;
+  std::thread thread_;
+};
+
 class WalWriter {
   static constexpr size_t TRUNC_SIZE = 1ul << 30;
 
  public:
-  WalWriter() : fd_(-1), file_size_(0), file_used_(0) {}
+  WalWriter() : fd_(-1), file_size_(0), file_used_(0), flusher_(nullptr) {}
   ~WalWriter() { close(); }
 
-  void open(const std::string& prefix, int thread_id);
+  // flusher为空时按kSync处理
+  void open(const std::string& prefix, int thread_id,
+            WalFlusher* flusher = nullptr);
 
   void close();
 
@@ -64,6 +146,7 @@ class WalWriter {
   int fd_;
   size_t file_size_;
   size_t file_used_;
+  WalFlusher* flusher_;
 };
 
 class WalsParser {
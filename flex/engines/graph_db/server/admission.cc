@@ -0,0 +1,149 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* 	http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "flex/engines/graph_db/server/admission.h"
+#include "flex/engines/graph_db/server/options.h"
+
+#include <glog/logging.h>
+#include <seastar/core/reactor.hh>
+
+#include <algorithm>
+#include <limits>
+
+namespace server {
+
+static constexpr uint32_t max_shard_num = 256;
+static shard_load shard_loads[max_shard_num];
+
+static const char* query_class_names[query_class_num] = {"IC", "IS", "IU"};
+
+query_class classify_query(const seastar::sstring& content) {
+  if (content.empty()) {
+    return query_class::kIS;
+  }
+  uint8_t app_id = static_cast<uint8_t>(content[content.size() - 1]);
+  if (app_id == 0) {
+    return query_class::kIS;
+  } else if (app_id < ic_app_id_end) {
+    return query_class::kIC;
+  } else if (app_id < is_app_id_end) {
+    return query_class::kIS;
+  }
+  return query_class::kIU;
+}
+
+void shard_load::record_latency(uint64_t us) {
+  // 只用于选择shard，并发更新时丢失个别样本没有影响
+  uint64_t old = latency_us.load(std::memory_order_relaxed);
+  latency_us.store(old == 0 ? us : old - old / 8 + us / 8,
+                   std::memory_order_relaxed);
+}
+
+shard_load& get_shard_load(uint32_t shard) {
+  return shard_loads[shard];
+}
+
+std::string dump_shard_loads() {
+  std::string ret = "[";
+  for (uint32_t shard = 0; shard < seastar::smp::count; ++shard) {
+    auto& load = shard_loads[shard];
+    if (shard != 0) {
+      ret += ",";
+    }
+    ret += "{\"shard\":" + std::to_string(shard) +
+           ",\"running\":" + std::to_string(load.running.load()) +
+           ",\"latency_us\":" + std::to_string(load.latency_us.load());
+    for (size_t cls = 0; cls < query_class_num; ++cls) {
+      ret += ",\"" + std::string(query_class_names[cls]) + "\":{" +
+             "\"queued\":" + std::to_string(load.queued[cls].load()) +
+             ",\"admitted\":" + std::to_string(load.admitted[cls].load()) +
+             ",\"shed\":" + std::to_string(load.shed[cls].load()) + "}";
+    }
+    ret += "}";
+  }
+  ret += "]";
+  return ret;
+}
+
+admission_controller::admission_controller()
+    : shard_(seastar::this_shard_id()), running_(0), queued_(0), vtime_(0) {
+  CHECK_LE(seastar::smp::count, max_shard_num);
+  for (size_t cls = 0; cls < query_class_num; ++cls) {
+    class_running_[cls] = 0;
+    pass_[cls] = 0;
+  }
+}
+
+bool admission_controller::runnable(size_t cls) const {
+  return !waiters_[cls].empty() &&
+         class_running_[cls] < query_class_concurrency[cls];
+}
+
+std::optional<seastar::future<>> admission_controller::acquire(query_class cls) {
+  size_t idx = static_cast<size_t>(cls);
+  auto& load = shard_loads[shard_];
+  if (waiters_[idx].empty() && running_ < shard_max_running &&
+      class_running_[idx] < query_class_concurrency[idx]) {
+    ++running_;
+    ++class_running_[idx];
+    load.admitted[idx].fetch_add(1, std::memory_order_relaxed);
+    return seastar::make_ready_future<>();
+  }
+  if (queued_ >= shard_max_queued) {
+    load.shed[idx].fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+  }
+  if (waiters_[idx].empty()) {
+    // 空闲过的类别不能积累额度
+    pass_[idx] = std::max(pass_[idx], vtime_);
+  }
+  waiters_[idx].emplace_back();
+  ++queued_;
+  load.queued[idx].fetch_add(1, std::memory_order_relaxed);
+  return waiters_[idx].back().get_future();
+}
+
+void admission_controller::release(query_class cls) {
+  --running_;
+  --class_running_[static_cast<size_t>(cls)];
+  dispatch();
+}
+
+void admission_controller::dispatch() {
+  auto& load = shard_loads[shard_];
+  while (running_ < shard_max_running) {
+    size_t next = query_class_num;
+    for (size_t cls = 0; cls < query_class_num; ++cls) {
+      if (runnable(cls) && (next == query_class_num || pass_[cls] < pass_[next])) {
+        next = cls;
+      }
+    }
+    if (next == query_class_num) {
+      break;
+    }
+    vtime_ = pass_[next];
+    pass_[next] += stride_base / std::max<uint32_t>(query_class_weight[next], 1);
+    auto pr = std::move(waiters_[next].front());
+    waiters_[next].pop_front();
+    --queued_;
+    ++running_;
+    ++class_running_[next];
+    load.queued[next].fetch_sub(1, std::memory_order_relaxed);
+    load.admitted[next].fetch_add(1, std::memory_order_relaxed);
+    pr.set_value();
+  }
+}
+
+}  // namespace server
@@ -0,0 +1,87 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* 	http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef SERVER_ADMISSION_H_
+#define SERVER_ADMISSION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+
+#include <seastar/core/future.hh>
+#include <seastar/core/sstring.hh>
+
+namespace server {
+
+enum class query_class : uint8_t {
+  kIC = 0,
+  kIS = 1,
+  kIU = 2,
+};
+
+constexpr size_t query_class_num = 3;
+
+/// 查询的最后一个字节是app id
+query_class classify_query(const seastar::sstring& content);
+
+/// 一个shard上的负载和计数器，其他shard在选择执行的shard和输出统计时读取
+struct alignas(64) shard_load {
+  std::atomic<uint32_t> running{0};  // 在该shard上执行中的查询
+  std::atomic<uint64_t> latency_us{0};  // 最近查询延迟的滑动平均
+  std::atomic<uint32_t> queued[query_class_num] = {};
+  std::atomic<uint64_t> admitted[query_class_num] = {};
+  std::atomic<uint64_t> shed[query_class_num] = {};
+
+  void record_latency(uint64_t us);
+};
+
+shard_load& get_shard_load(uint32_t shard);
+
+/// 输出所有shard的排队数、执行数、拒绝数和延迟
+std::string dump_shard_loads();
+
+/// 每个shard上的准入控制，在接收请求的shard上使用。每类查询一个队列，按权重
+/// 做stride调度，同时受每类和整个shard的并发上限约束；排队的查询过多时拒绝。
+class admission_controller {
+public:
+  admission_controller();
+
+  /// 申请执行名额，队列已满时返回空，否则返回的future在获得名额时就绪
+  std::optional<seastar::future<>> acquire(query_class cls);
+
+  /// 查询结束后归还名额
+  void release(query_class cls);
+
+private:
+  bool runnable(size_t cls) const;
+  void dispatch();
+
+private:
+  static constexpr uint64_t stride_base = 1 << 20;
+
+  uint32_t shard_;
+  uint32_t running_;
+  uint32_t queued_;
+  uint32_t class_running_[query_class_num];
+  uint64_t pass_[query_class_num];
+  uint64_t vtime_;
+  std::deque<seastar::promise<>> waiters_[query_class_num];
+};
+
+}  // namespace server
+
+#endif  // SERVER_ADMISSION_H_
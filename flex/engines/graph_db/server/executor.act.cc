@@ -17,6 +17,7 @@
 
 #include "flex/engines/graph_db/database/graph_db.h"
 #include "flex/engines/graph_db/database/graph_db_session.h"
+#include "flex/engines/graph_db/server/query_worker.h"
 
 #include <seastar/core/print.hh>
 
@@ -36,9 +37,24 @@ executor::executor(hiactor::actor_base* exec_ctx, const hiactor::byte_t* addr)
 }
 
 seastar::future<query_result> executor::run_query(query_param&& param) {
-  auto ret = gs::GraphDB::get().GetSession(hiactor::local_shard_id()).Eval(param.content);
-  seastar::sstring content(ret.data(), ret.size());
-  return seastar::make_ready_future<query_result>(std::move(content));
+  auto& workers = query_worker_pool::get();
+  if (workers.running()) {
+    // 交给工作线程执行，等待缓冲池缺页时shard不被阻塞
+    return workers.submit(hiactor::local_shard_id(),
+                          std::string(param.content.data(), param.content.size()));
+  }
+  auto shard = hiactor::local_shard_id();
+  auto& session = gs::GraphDB::get().GetSession(shard);
+  auto ret = session.AcquireResultBuffer();
+  // 组提交模式下不在shard上等待刷盘，刷盘之后再返回结果
+  gs::WalFlusher::DeferredWait wal_wait;
+  session.Eval(std::string(param.content.data(), param.content.size()), ret);
+  auto result = make_query_result(session, std::move(ret));
+  if (wal_wait.epoch() == 0) {
+    return seastar::make_ready_future<query_result>(std::move(result));
+  }
+  return wait_wal_flushed(shard, wal_wait.epoch())
+      .then([result = std::move(result)]() mutable { return std::move(result); });
 }
 
 }  // namespace server
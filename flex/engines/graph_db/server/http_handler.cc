@@ -13,6 +13,8 @@
 * limitations under the License.
 */
 
+#include "flex/engines/graph_db/database/graph_db.h"
+#include "flex/engines/graph_db/server/admission.h"
 #include "flex/engines/graph_db/server/executor_group.actg.h"
 #include "flex/engines/graph_db/server/service.h"
 #include "flex/engines/graph_db/server/options.h"
@@ -21,9 +23,14 @@
 #include "flex/engines/graph_db/server/types.h"
 #include "flex/engines/graph_db/server/generated/executor_ref.act.autogen.h"
 #include <seastar/core/alien.hh>
+#include <seastar/core/do_with.hh>
+#include <seastar/core/iostream.hh>
 #include <seastar/core/print.hh>
+#include <seastar/core/shared_ptr.hh>
 #include <seastar/http/handlers.hh>
 
+#include <chrono>
+
 
 
 namespace server {
@@ -31,15 +38,21 @@ namespace server {
 
 class ic_handler : public seastar::httpd::handler_base {
 public:
-  ic_handler(uint32_t group_id, uint32_t shard_concurrency)
-      : shard_concurrency_(shard_concurrency), executor_idx_(0) {
-    executor_refs_.reserve(shard_concurrency_);
-    hiactor::scope_builder builder;
-    builder.set_shard(hiactor::local_shard_id())
-      .enter_sub_scope(hiactor::scope<executor_group>(0))
-      .enter_sub_scope(hiactor::scope<hiactor::actor_group>(group_id));
-    for (unsigned i = 0; i < shard_concurrency_; ++i) {
-      executor_refs_.emplace_back(builder.build_ref<executor_ref>(i));
+  ic_handler(uint32_t group_id, uint32_t shard_concurrency,
+             seastar::lw_shared_ptr<admission_controller> admission)
+      : shard_concurrency_(shard_concurrency), executor_idx_(0),
+        admission_(std::move(admission)), rand_state_(hiactor::local_shard_id() + 1) {
+    // 每个shard上的executor都可以作为执行目标
+    executor_refs_.resize(seastar::smp::count);
+    for (unsigned shard = 0; shard < seastar::smp::count; ++shard) {
+      executor_refs_[shard].reserve(shard_concurrency_);
+      hiactor::scope_builder builder;
+      builder.set_shard(shard)
+        .enter_sub_scope(hiactor::scope<executor_group>(0))
+        .enter_sub_scope(hiactor::scope<hiactor::actor_group>(group_id));
+      for (unsigned i = 0; i < shard_concurrency_; ++i) {
+        executor_refs_[shard].emplace_back(builder.build_ref<executor_ref>(i));
+      }
     }
   }
   ~ic_handler() override = default;
@@ -48,25 +61,99 @@ public:
   handle(const seastar::sstring& path,
          std::unique_ptr<seastar::httpd::request> req,
          std::unique_ptr<seastar::httpd::reply> rep) override {
-    auto dst_executor = executor_idx_;
-    executor_idx_ = (executor_idx_ + 1) % shard_concurrency_;
-
-    return executor_refs_[dst_executor].run_query(query_param{std::move(req->content)}
-    ).then_wrapped([rep = std::move(rep)] (seastar::future<query_result>&& fut) mutable {
-      if (__builtin_expect(fut.failed(), false)) {
-        return seastar::make_exception_future<std::unique_ptr<seastar::httpd::reply>>(fut.get_exception());
-      }
-      auto result = fut.get0();
-      rep->write_body("bin", std::move(result.content));
+    auto cls = classify_query(req->content);
+    auto admitted = admission_->acquire(cls);
+    if (!admitted) {
+      rep->set_status(seastar::httpd::reply::status_type::service_unavailable);
+      rep->write_body("bin", seastar::sstring{"Too many queued queries"});
       rep->done();
       return seastar::make_ready_future<std::unique_ptr<seastar::httpd::reply>>(std::move(rep));
+    }
+
+    return admitted->then([this, cls, req = std::move(req), rep = std::move(rep)] () mutable {
+      auto shard = pick_shard();
+      auto dst_executor = executor_idx_;
+      executor_idx_ = (executor_idx_ + 1) % shard_concurrency_;
+      auto& load = get_shard_load(shard);
+      load.running.fetch_add(1, std::memory_order_relaxed);
+      auto start = std::chrono::steady_clock::now();
+
+      return executor_refs_[shard][dst_executor].run_query(query_param{std::move(req->content)}
+      ).then_wrapped([this, cls, &load, start, rep = std::move(rep)] (seastar::future<query_result>&& fut) mutable {
+        load.record_latency(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        load.running.fetch_sub(1, std::memory_order_relaxed);
+        admission_->release(cls);
+        if (__builtin_expect(fut.failed(), false)) {
+          return seastar::make_exception_future<std::unique_ptr<seastar::httpd::reply>>(fut.get_exception());
+        }
+        auto result = fut.get0();
+        // 结果缓冲区直接写入连接，不再复制成sstring
+        rep->write_body("bin", [buf = std::move(result.content)] (seastar::output_stream<char>&& out) mutable {
+          return seastar::do_with(std::move(out), std::move(buf), [] (auto& out, auto& buf) {
+            return out.write(std::move(buf)).then([&out] {
+              return out.close();
+            });
+          });
+        });
+        rep->done();
+        return seastar::make_ready_future<std::unique_ptr<seastar::httpd::reply>>(std::move(rep));
+      });
     });
   }
 
+private:
+  /// 在本地shard和随机选取的另一个shard中选择负载较低的一个，负载按执行中的
+  /// 查询数和最近的延迟估计
+  uint32_t pick_shard() {
+    uint32_t local = hiactor::local_shard_id();
+    uint32_t shard_num = seastar::smp::count;
+    if (shard_num == 1) {
+      return local;
+    }
+    rand_state_ ^= rand_state_ << 13;
+    rand_state_ ^= rand_state_ >> 7;
+    rand_state_ ^= rand_state_ << 17;
+    uint32_t other = (local + 1 + rand_state_ % (shard_num - 1)) % shard_num;
+    auto cost = [](uint32_t shard) {
+      auto& load = get_shard_load(shard);
+      return (load.running.load(std::memory_order_relaxed) + 1) *
+             std::max<uint64_t>(load.latency_us.load(std::memory_order_relaxed), 1);
+    };
+    // 本地执行省去跨shard的开销，只有明显更空闲时才转发
+    return cost(other) * 2 < cost(local) ? other : local;
+  }
+
 private:
   const uint32_t shard_concurrency_;
   uint32_t executor_idx_;
-  std::vector<executor_ref> executor_refs_;
+  std::vector<std::vector<executor_ref>> executor_refs_;
+  seastar::lw_shared_ptr<admission_controller> admission_;
+  uint64_t rand_state_;
+};
+
+class admission_stats_handler : public seastar::httpd::handler_base {
+public:
+  seastar::future<std::unique_ptr<seastar::httpd::reply>>
+  handle(const seastar::sstring& path,
+         std::unique_ptr<seastar::httpd::request> req,
+         std::unique_ptr<seastar::httpd::reply> rep) override {
+    rep->write_body("json", seastar::sstring{dump_shard_loads()});
+    rep->done();
+    return seastar::make_ready_future<std::unique_ptr<seastar::httpd::reply>>(std::move(rep));
+  }
+};
+
+class query_stats_handler : public seastar::httpd::handler_base {
+public:
+  seastar::future<std::unique_ptr<seastar::httpd::reply>>
+  handle(const seastar::sstring& path,
+         std::unique_ptr<seastar::httpd::request> req,
+         std::unique_ptr<seastar::httpd::reply> rep) override {
+    rep->write_body("json", seastar::sstring{gs::GraphDB::get().DumpQueryStats()});
+    rep->done();
+    return seastar::make_ready_future<std::unique_ptr<seastar::httpd::reply>>(std::move(rep));
+  }
 };
 
 class exit_handler : public seastar::httpd::handler_base {
@@ -107,15 +194,23 @@ void http_handler::stop() {
 
 seastar::future<> http_handler::set_routes() {
   return server_.set_routes([this] (seastar::httpd::routes& r) {
+    // 同一个shard上的各个路由共用一个准入控制
+    auto admission = seastar::make_lw_shared<admission_controller>();
     r.add(seastar::httpd::operation_type::POST,
           seastar::httpd::url("/interactive/query"),
-	  new ic_handler(ic_query_group_id, shard_query_concurrency));
+	  new ic_handler(ic_query_group_id, shard_query_concurrency, admission));
     r.add(seastar::httpd::operation_type::POST,
           seastar::httpd::url("/interactive/update"),
-          new ic_handler(ic_update_group_id, shard_update_concurrency));
+          new ic_handler(ic_update_group_id, shard_update_concurrency, admission));
     r.add(seastar::httpd::operation_type::POST,
           seastar::httpd::url("/interactive/app"),
-          new ic_handler(ic_update_group_id, shard_update_concurrency));
+          new ic_handler(ic_update_group_id, shard_update_concurrency, admission));
+    r.add(seastar::httpd::operation_type::GET,
+          seastar::httpd::url("/interactive/admission"),
+          new admission_stats_handler());
+    r.add(seastar::httpd::operation_type::GET,
+          seastar::httpd::url("/interactive/stats"),
+          new query_stats_handler());
     r.add(seastar::httpd::operation_type::POST,
           seastar::httpd::url("/interactive/exit"),
           new exit_handler());
@@ -19,5 +19,17 @@ namespace server {
 
 uint32_t shard_query_concurrency = 16;
 uint32_t shard_update_concurrency = 4;
+uint32_t shard_worker_num = 0;
+
+uint32_t ic_app_id_end = 15;
+uint32_t is_app_id_end = 22;
+
+uint32_t query_class_weight[3] = {1, 4, 4};
+uint32_t query_class_concurrency[3] = {8, 16, 4};
+
+uint32_t shard_max_running = 16;
+uint32_t shard_max_queued = 1024;
+
+uint64_t slow_query_threshold_us = 0;
 
 }  // namespace server
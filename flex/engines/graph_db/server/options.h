@@ -27,6 +27,26 @@ const uint32_t ic_update_group_id = 2;
 extern uint32_t shard_query_concurrency;
 extern uint32_t shard_update_concurrency;
 
+/// 每个shard上执行查询的工作线程数，为0时查询直接在shard上执行。大于0时
+/// GraphDB需要以num_shards * shard_worker_num个session初始化。
+extern uint32_t shard_worker_num;
+
+/// 按app id划分查询类别：[1, ic_app_id_end)为IC，[ic_app_id_end,
+/// is_app_id_end)为IS，其余为IU，0号ServerApp归入IS。
+extern uint32_t ic_app_id_end;
+extern uint32_t is_app_id_end;
+
+/// 各类查询(IC, IS, IU)的调度权重和每个shard上同时执行的上限
+extern uint32_t query_class_weight[3];
+extern uint32_t query_class_concurrency[3];
+
+/// 每个shard上同时执行的查询数上限和排队的查询数上限，队列满时返回503
+extern uint32_t shard_max_running;
+extern uint32_t shard_max_queued;
+
+/// 执行时间超过该值(微秒)的查询连同输入写到日志中，为0时不记录
+extern uint64_t slow_query_threshold_us;
+
 }  // namespace server
 
 #endif  // SERVER_OPTIONS_H_
@@ -0,0 +1,129 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* 	http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "flex/engines/graph_db/server/query_worker.h"
+
+#include "flex/engines/graph_db/database/graph_db.h"
+#include "flex/engines/graph_db/database/graph_db_session.h"
+
+#include <seastar/core/alien.hh>
+#include <seastar/core/deleter.hh>
+
+namespace server {
+
+query_result make_query_result(gs::GraphDBSession& session,
+                               std::vector<char>&& buf) {
+  char* data = buf.data();
+  size_t size = buf.size();
+  return query_result{seastar::temporary_buffer<char>(
+      data, size,
+      seastar::make_deleter([&session, buf = std::move(buf)]() mutable {
+        session.ReleaseResultBuffer(std::move(buf));
+      }))};
+}
+
+seastar::future<> wait_wal_flushed(uint32_t shard, uint64_t epoch) {
+  if (epoch == 0) {
+    return seastar::make_ready_future<>();
+  }
+  auto* pr = new seastar::promise<>();
+  auto fut = pr->get_future();
+  bool pending = gs::GraphDB::get().wal_flusher().on_flushed(epoch, [shard, pr]() {
+    seastar::alien::run_on(*seastar::alien::internal::default_instance, shard,
+                           [pr]() {
+                             pr->set_value();
+                             delete pr;
+                           });
+  });
+  if (!pending) {
+    pr->set_value();
+    delete pr;
+  }
+  return fut;
+}
+
+query_worker_pool::~query_worker_pool() {
+  stop();
+}
+
+void query_worker_pool::start(uint32_t num_shards, uint32_t workers_per_shard) {
+  CHECK(shards_.empty()) << "query workers have been started";
+  CHECK_LE(num_shards * workers_per_shard,
+           static_cast<uint32_t>(gs::GraphDB::get().SessionNum()))
+      << "GraphDB should be initialized with num_shards * workers_per_shard "
+         "sessions";
+  for (uint32_t i = 0; i < num_shards; ++i) {
+    shards_.emplace_back(std::make_unique<shard_queue>());
+  }
+  for (uint32_t i = 0; i < num_shards; ++i) {
+    for (uint32_t j = 0; j < workers_per_shard; ++j) {
+      threads_.emplace_back(&query_worker_pool::work, this, i,
+                            i * workers_per_shard + j);
+    }
+  }
+}
+
+void query_worker_pool::stop() {
+  for (auto& queue : shards_) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    queue->stopped = true;
+    queue->cv.notify_all();
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+  shards_.clear();
+}
+
+seastar::future<query_result> query_worker_pool::submit(uint32_t shard,
+                                                        std::string&& input) {
+  auto* pr = new seastar::promise<query_result>();
+  auto fut = pr->get_future();
+  auto& queue = *shards_[shard];
+  {
+    std::lock_guard<std::mutex> guard(queue.lock);
+    queue.jobs.push_back(job{std::move(input), pr});
+  }
+  queue.cv.notify_one();
+  return fut;
+}
+
+void query_worker_pool::work(uint32_t shard, uint32_t session_id) {
+  auto& queue = *shards_[shard];
+  auto& session = gs::GraphDB::get().GetSession(session_id);
+  while (true) {
+    job cur;
+    {
+      std::unique_lock<std::mutex> guard(queue.lock);
+      queue.cv.wait(guard, [&] { return queue.stopped || !queue.jobs.empty(); });
+      if (queue.jobs.empty()) {
+        break;
+      }
+      cur = std::move(queue.jobs.front());
+      queue.jobs.pop_front();
+    }
+    auto ret = session.AcquireResultBuffer();
+    session.Eval(cur.input, ret);
+    // promise只能在所属的shard上完成
+    seastar::alien::run_on(*seastar::alien::internal::default_instance, shard,
+                           [&session, pr = cur.pr, ret = std::move(ret)]() mutable {
+                             pr->set_value(make_query_result(session, std::move(ret)));
+                             delete pr;
+                           });
+  }
+}
+
+}  // namespace server
@@ -0,0 +1,91 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* 	http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef SERVER_QUERY_WORKER_H_
+#define SERVER_QUERY_WORKER_H_
+
+#include "flex/engines/graph_db/server/types.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <seastar/core/future.hh>
+
+namespace gs {
+class GraphDBSession;
+}
+
+namespace server {
+
+/// 把会话的结果缓冲区包装为query_result，不复制结果，释放时缓冲区归还给
+/// 会话。需要在shard上调用。
+query_result make_query_result(gs::GraphDBSession& session,
+                               std::vector<char>&& buf);
+
+/// 在shard上等待第epoch轮WAL刷盘完成，不阻塞shard；epoch为0时立即完成
+seastar::future<> wait_wal_flushed(uint32_t shard, uint64_t epoch);
+
+/// 每个shard上的查询工作线程。查询在工作线程上用各自的session执行，缓冲池
+/// 缺页只阻塞工作线程，shard可以继续接收和分发其他查询。一个查询从开始到
+/// 结束都在同一个工作线程上执行，事务的时间戳也在该线程上释放。
+class query_worker_pool {
+public:
+  static query_worker_pool& get() {
+    static query_worker_pool instance;
+    return instance;
+  }
+  ~query_worker_pool();
+
+  /// shard i的第j个工作线程使用GraphDB的第i * workers_per_shard + j个session
+  void start(uint32_t num_shards, uint32_t workers_per_shard);
+  /// 执行完已提交的查询后退出，需要在actor system结束之前调用
+  void stop();
+
+  bool running() const { return !shards_.empty(); }
+
+  /// 在shard上调用，结果在同一个shard上返回
+  seastar::future<query_result> submit(uint32_t shard, std::string&& input);
+
+private:
+  struct job {
+    std::string input;
+    seastar::promise<query_result>* pr;
+  };
+
+  struct shard_queue {
+    std::mutex lock;
+    std::condition_variable cv;
+    std::deque<job> jobs;
+    bool stopped = false;
+  };
+
+  query_worker_pool() = default;
+
+  void work(uint32_t shard, uint32_t session_id);
+
+private:
+  std::vector<std::unique_ptr<shard_queue>> shards_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace server
+
+#endif  // SERVER_QUERY_WORKER_H_
@@ -14,12 +14,18 @@
 */
 
 #include "flex/engines/graph_db/server/service.h"
+#include "flex/engines/graph_db/database/graph_db.h"
 #include "flex/engines/graph_db/server/options.h"
+#include "flex/engines/graph_db/server/query_worker.h"
 namespace server {
 
 void service::init(uint32_t num_shards, uint16_t http_port, bool dpdk_mode) {
   actor_sys_ = std::make_unique<actor_system>(num_shards, dpdk_mode);
   http_hdl_ = std::make_unique<http_handler>(http_port);
+  gs::GraphDB::get().SetSlowQueryThreshold(slow_query_threshold_us);
+  if (shard_worker_num > 0) {
+    query_worker_pool::get().start(num_shards, shard_worker_num);
+  }
 }
 
 void service::run_and_wait_for_exit() {
@@ -34,6 +40,8 @@ void service::run_and_wait_for_exit() {
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
   }
   http_hdl_->stop();
+  // 工作线程会向shard投递结果，需要先于actor system退出
+  query_worker_pool::get().stop();
   actor_sys_->terminate();
 }
 
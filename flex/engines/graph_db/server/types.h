@@ -50,7 +50,8 @@ struct payload {
 };
 
 using query_param = payload<seastar::sstring>;
-using query_result = payload<seastar::sstring>;
+/// 结果直接引用会话的结果缓冲区，释放时归还，见make_query_result
+using query_result = payload<seastar::temporary_buffer<char>>;
 
 }  // namespace server
 
@@ -20,6 +20,7 @@
 #include "flex/engines/http_server/codegen_proxy.h"
 #include "flex/engines/http_server/stored_procedure.h"
 
+#include <seastar/core/alien.hh>
 #include <seastar/core/print.hh>
 
 namespace server {
@@ -36,13 +37,38 @@ executor::executor(hiactor::actor_base* exec_ctx, const hiactor::byte_t* addr)
   // ...
 }
 
+// 组提交模式下不在shard上等待刷盘，刷盘线程完成第epoch轮之后回到shard上完成
+static seastar::future<> wait_wal_flushed(uint32_t shard, uint64_t epoch) {
+  if (epoch == 0) {
+    return seastar::make_ready_future<>();
+  }
+  auto* pr = new seastar::promise<>();
+  auto fut = pr->get_future();
+  bool pending =
+      gs::GraphDB::get().wal_flusher().on_flushed(epoch, [shard, pr]() {
+        seastar::alien::run_on(*seastar::alien::internal::default_instance,
+                               shard, [pr]() {
+                                 pr->set_value();
+                                 delete pr;
+                               });
+      });
+  if (!pending) {
+    pr->set_value();
+    delete pr;
+  }
+  return fut;
+}
+
 seastar::future<query_result> executor::run_graph_db_query(
     query_param&& param) {
-  auto ret = gs::GraphDB::get()
-                 .GetSession(hiactor::local_shard_id())
-                 .Eval(param.content);
+  auto shard = hiactor::local_shard_id();
+  gs::WalFlusher::DeferredWait wal_wait;
+  auto ret = gs::GraphDB::get().GetSession(shard).Eval(param.content);
   seastar::sstring content(ret.data(), ret.size());
-  return seastar::make_ready_future<query_result>(std::move(content));
+  return wait_wal_flushed(shard, wal_wait.epoch())
+      .then([content = std::move(content)]() mutable {
+        return seastar::make_ready_future<query_result>(std::move(content));
+      });
 }
 
 // // run_query_for stored_procedure
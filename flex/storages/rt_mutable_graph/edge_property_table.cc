@@ -0,0 +1,166 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flex/storages/rt_mutable_graph/edge_property_table.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <limits>
+
+#include "flex/storages/rt_mutable_graph/file_names.h"
+#include "glog/logging.h"
+
+namespace gs {
+
+static constexpr size_t kMinEdgeTableCapacity = 4096;
+
+EdgePropertyTable::EdgePropertyTable() : size_(0), capacity_(0) {}
+EdgePropertyTable::~EdgePropertyTable() {}
+
+static std::vector<StorageStrategy> edge_table_strategies(size_t col_num) {
+  return std::vector<StorageStrategy>(col_num, StorageStrategy::kMem);
+}
+
+void EdgePropertyTable::init(const std::string& name,
+                             const std::string& work_dir,
+                             const std::vector<std::string>& col_names,
+                             const std::vector<PropertyType>& types) {
+  table_.init(name, work_dir, col_names, types,
+              edge_table_strategies(types.size()));
+  size_.store(0);
+  capacity_ = 0;
+}
+
+#if !OV
+void EdgePropertyTable::checkpoint(const std::string& name,
+                                   const std::string& snapshot_dir) {
+  size_t edge_num = size();
+  {
+    std::shared_lock<std::shared_mutex> guard(resize_lock_);
+    table_.checkpoint(name, snapshot_dir, edge_num);
+  }
+  std::string meta_path = snapshot_dir + "/" + name + ".meta";
+  FILE* fout = open_snapshot_file(meta_path);
+  write_snapshot_file(fout, &edge_num, sizeof(size_t), 1, meta_path);
+  close_snapshot_file(fout, meta_path);
+}
+#endif
+
+void EdgePropertyTable::open(const std::string& name,
+                             const std::string& snapshot_dir,
+                             const std::string& work_dir,
+                             const std::vector<std::string>& col_names,
+                             const std::vector<PropertyType>& types) {
+  table_.open(name, snapshot_dir, work_dir, col_names, types,
+              edge_table_strategies(types.size()));
+  size_t edge_num = 0;
+  if (!snapshot_dir.empty()) {
+    std::string meta_path = snapshot_dir + "/" + name + ".meta";
+    FILE* fin = fopen(meta_path.c_str(), "rb");
+    if (fin != nullptr) {
+      CHECK_EQ(fread(&edge_num, sizeof(size_t), 1, fin), 1);
+      fclose(fin);
+    }
+  }
+  size_.store(edge_num);
+  capacity_ = table_.row_num();
+  CHECK_LE(edge_num, capacity_);
+  // 与顶点表一样预留余量，减少运行期间的扩容
+  std::unique_lock<std::shared_mutex> guard(resize_lock_);
+  reserve(std::max(kMinEdgeTableCapacity, edge_num + (edge_num >> 2)));
+}
+
+void EdgePropertyTable::dump(const std::string& name,
+                             const std::string& snapshot_dir) {
+  size_t edge_num = size();
+  std::unique_lock<std::shared_mutex> guard(resize_lock_);
+  table_.resize(edge_num);
+  std::string meta_path = snapshot_dir + "/" + name + ".meta";
+  FILE* fout = fopen(meta_path.c_str(), "wb");
+  CHECK(fout != nullptr) << "Failed to open " << meta_path;
+  CHECK_EQ(fwrite(&edge_num, sizeof(size_t), 1, fout), 1);
+  fflush(fout);
+  fclose(fout);
+  table_.dump(name, snapshot_dir);
+  // table_已经收缩到edge_num行，之后的扩容从这里开始，不能再缩小
+  capacity_ = edge_num;
+}
+
+void EdgePropertyTable::reserve(size_t capacity) {
+  if (capacity <= capacity_) {
+    return;
+  }
+  // Table::ingest以uint32_t作为行号
+  CHECK_LE(capacity, std::numeric_limits<uint32_t>::max());
+  table_.resize(capacity);
+  capacity_ = capacity;
+}
+
+edge_id_t EdgePropertyTable::allocate() {
+  std::lock_guard<std::mutex> lock(lock_);
+  size_t eid = size_.load(std::memory_order_relaxed);
+  if (eid >= capacity_) {
+    std::unique_lock<std::shared_mutex> guard(resize_lock_);
+    reserve(std::min<size_t>(
+        std::max({eid + 1, kMinEdgeTableCapacity,
+                  capacity_ + (capacity_ >> 1)}),
+        std::numeric_limits<uint32_t>::max()));
+  }
+  size_.store(eid + 1, std::memory_order_release);
+  return static_cast<edge_id_t>(eid);
+}
+
+void EdgePropertyTable::ingest(edge_id_t eid, grape::OutArchive& arc) {
+  assert(eid >= 0 && static_cast<size_t>(eid) < size());
+  std::shared_lock<std::shared_mutex> guard(resize_lock_);
+  table_.ingest(static_cast<uint32_t>(eid), arc);
+}
+
+void EdgePropertyTable::insert(edge_id_t eid, const std::vector<Any>& values) {
+  assert(eid >= 0 && static_cast<size_t>(eid) < size());
+  std::shared_lock<std::shared_mutex> guard(resize_lock_);
+  CHECK_EQ(values.size(), table_.col_num());
+  for (size_t i = 0; i < values.size(); ++i) {
+    table_.get_column_by_id(i)->set_any(eid, values[i]);
+  }
+}
+
+#if OV
+Any EdgePropertyTable::at(edge_id_t eid, size_t col_id) const {
+  std::shared_lock<std::shared_mutex> guard(resize_lock_);
+  return table_.at(eid, col_id);
+}
+#else
+gbp::BufferBlock EdgePropertyTable::at(edge_id_t eid, size_t col_id) const {
+  std::shared_lock<std::shared_mutex> guard(resize_lock_);
+  return table_.at(eid, col_id);
+}
+
+std::vector<gbp::BufferBlock> EdgePropertyTable::get_row(edge_id_t eid) const {
+  std::shared_lock<std::shared_mutex> guard(resize_lock_);
+  return table_.get_row(eid);
+}
+#endif
+
+void EdgePropertyTable::resize(size_t edge_num) {
+  std::lock_guard<std::mutex> lock(lock_);
+  if (edge_num > capacity_) {
+    std::unique_lock<std::shared_mutex> guard(resize_lock_);
+    reserve(std::max(edge_num, capacity_ + (capacity_ >> 1)));
+  }
+  size_.store(edge_num, std::memory_order_release);
+}
+
+}  // namespace gs
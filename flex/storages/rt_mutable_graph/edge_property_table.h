@@ -0,0 +1,117 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GRAPHSCOPE_STORAGES_RT_MUTABLE_GRAPH_EDGE_PROPERTY_TABLE_H_
+#define GRAPHSCOPE_STORAGES_RT_MUTABLE_GRAPH_EDGE_PROPERTY_TABLE_H_
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "flex/utils/property/table.h"
+#include "flex/utils/property/types.h"
+#include "grape/serialization/out_archive.h"
+
+namespace gs {
+
+// 边id，两个方向的MutableCsr中都以它作为EDATA
+using edge_id_t = int64_t;
+
+// 多个属性或单个字符串属性的边不能直接放进MutableCsr的nbr中，
+// 这类边的属性按边id存放在EdgePropertyTable里
+inline bool use_edge_property_table(const std::vector<PropertyType>& types) {
+  if (types.size() > 1) {
+    return true;
+  }
+  return types.size() == 1 && types[0] == PropertyType::kString;
+}
+
+/**
+ * @brief 一个(src, dst, edge)三元组的边属性表
+ * 每条边在插入时分配一个边id，ie_和oe_中存放同一个边id，属性按列存放在
+ * table_的第边id行。遍历时不读取属性的查询仍然只访问紧凑的邻接表。
+ * table_扩容时会修改各列的元数据，扩容持有resize_lock_的写锁，读写属性的
+ * at/get_row/ingest/insert持有读锁；open时预留1/4的余量，运行期间很少扩容。
+ */
+class EdgePropertyTable {
+ public:
+  EdgePropertyTable();
+  ~EdgePropertyTable();
+
+  void init(const std::string& name, const std::string& work_dir,
+            const std::vector<std::string>& col_names,
+            const std::vector<PropertyType>& types);
+
+  void open(const std::string& name, const std::string& snapshot_dir,
+            const std::string& work_dir,
+            const std::vector<std::string>& col_names,
+            const std::vector<PropertyType>& types);
+
+  void dump(const std::string& name, const std::string& snapshot_dir);
+
+#if !OV
+  void checkpoint(const std::string& name, const std::string& snapshot_dir);
+#endif
+
+  // 分配一个新的边id，空间不足时按1.5倍扩容
+  edge_id_t allocate();
+
+  // 从archive中按列反序列化一条边的全部属性
+  void ingest(edge_id_t eid, grape::OutArchive& arc);
+
+  // 按列写入一条边的全部属性，values按schema中边属性的顺序给出
+  void insert(edge_id_t eid, const std::vector<Any>& values);
+
+#if OV
+  Any at(edge_id_t eid, size_t col_id) const;
+#else
+  gbp::BufferBlock at(edge_id_t eid, size_t col_id) const;
+  std::vector<gbp::BufferBlock> get_row(edge_id_t eid) const;
+#endif
+
+  // 批量导入时直接设置边数，必要时按1.5倍扩容
+  void resize(size_t edge_num);
+
+  size_t size() const { return size_.load(std::memory_order_acquire); }
+
+  size_t get_size_in_byte() const { return table_.get_size_in_byte(); }
+
+  // 以下直接访问table_，只用于批量导入等没有并发扩容的场景
+  Table& table() { return table_; }
+  const Table& table() const { return table_; }
+
+  std::shared_ptr<ColumnBase> get_column(const std::string& name) {
+    return table_.get_column(name);
+  }
+  const std::shared_ptr<ColumnBase> get_column(const std::string& name) const {
+    return table_.get_column(name);
+  }
+
+ private:
+  // 调用方持有resize_lock_的写锁
+  void reserve(size_t capacity);
+
+  Table table_;
+  std::atomic<size_t> size_;
+  size_t capacity_;
+  std::mutex lock_;
+  mutable std::shared_mutex resize_lock_;
+};
+
+}  // namespace gs
+
+#endif  // GRAPHSCOPE_STORAGES_RT_MUTABLE_GRAPH_EDGE_PROPERTY_TABLE_H_
@@ -1,8 +1,15 @@
 #ifndef GRAPHSCOPE_STORAGES_RT_MUTABLE_GRAPH_FILE_NAMES_H_
 #define GRAPHSCOPE_STORAGES_RT_MUTABLE_GRAPH_FILE_NAMES_H_
 
+#include <unistd.h>
+
+#include <cstdio>
+#include <filesystem>
 #include <string>
 
+#include "flex/storages/rt_mutable_graph/types.h"
+#include "glog/logging.h"
+
 namespace gs {
 
 /*
@@ -18,16 +25,16 @@ namespace gs {
    vertex_map_PERSON.indices │       ├── vertex_map_PERSON.keys │       ├──
    vertex_table_PERSON.col_0 │       ├── vertex_table_PERSON.col_1.data │   └──
    vertex_table_PERSON.col_1.items ├── snapshots // snapshots dir │   ├── 0 │  
-   │   ├── ie_PERSON_KNOWS_PERSON.deg │   │   ├── ie_PERSON_KNOWS_PERSON.nbr │  
-   │   ├── oe_PERSON_KNOWS_PERSON.deg │   │   ├── oe_PERSON_KNOWS_PERSON.nbr │  
+   │   ├── ie_PERSON_KNOWS_PERSON.deg │   │   ├── ie_PERSON_KNOWS_PERSON.base │  
+   │   ├── oe_PERSON_KNOWS_PERSON.deg │   │   ├── oe_PERSON_KNOWS_PERSON.base │  
    │   ├── vertex_map_PERSON.indices │   │   ├── vertex_map_PERSON.keys │   │  
    ├── vertex_map_PERSON.meta │   │   ├── vertex_table_PERSON.col_0 │   │   ├──
    vertex_table_PERSON.col_1.data │   │   └── vertex_table_PERSON.col_1.items
     │   ├── 1234567
     │   │   ├── ie_PERSON_KNOWS_PERSON.deg
-    │   │   ├── ie_PERSON_KNOWS_PERSON.nbr
+    │   │   ├── ie_PERSON_KNOWS_PERSON.base
     │   │   ├── oe_PERSON_KNOWS_PERSON.deg
-    │   │   ├── oe_PERSON_KNOWS_PERSON.nbr
+    │   │   ├── oe_PERSON_KNOWS_PERSON.base
     │   │   ├── vertex_map_PERSON.indices
     │   │   ├── vertex_map_PERSON.keys
     │   │   ├── vertex_map_PERSON.meta
@@ -46,6 +53,26 @@ inline std::string schema_path(const std::string& work_dir) {
   return work_dir + "/schema";
 }
 
+// 快照文件的写入：任何一步失败都直接退出；关闭前fdatasync，切换快照版本时
+// 快照中的文件都已落盘
+inline FILE* open_snapshot_file(const std::string& path) {
+  FILE* fout = fopen(path.c_str(), "wb");
+  CHECK(fout != nullptr) << "Failed to open " << path;
+  return fout;
+}
+
+inline void write_snapshot_file(FILE* fout, const void* data, size_t size,
+                                size_t num, const std::string& path) {
+  CHECK_EQ(::fwrite(data, size, num, fout), num)
+      << "Failed to write " << path;
+}
+
+inline void close_snapshot_file(FILE* fout, const std::string& path) {
+  CHECK_EQ(::fflush(fout), 0) << "Failed to flush " << path;
+  CHECK_EQ(::fdatasync(fileno(fout)), 0) << "Failed to sync " << path;
+  CHECK_EQ(::fclose(fout), 0) << "Failed to close " << path;
+}
+
 inline std::string snapshots_dir(const std::string& work_dir) {
   return work_dir + "/snapshots/";
 }
@@ -66,16 +93,71 @@ inline uint32_t get_snapshot_version(const std::string& work_dir) {
 inline void set_snapshot_version(const std::string& work_dir,
                                  uint32_t version) {
   std::string version_path = snapshot_version_path(work_dir);
-  FILE* version_file = fopen(version_path.c_str(), "wb");
-  auto ret = ::fwrite(&version, sizeof(uint32_t), 1, version_file);
-  ::fflush(version_file);
-  ::fclose(version_file);
+  FILE* version_file = open_snapshot_file(version_path);
+  write_snapshot_file(version_file, &version, sizeof(uint32_t), 1,
+                      version_path);
+  close_snapshot_file(version_file, version_path);
 }
 
 inline std::string snapshot_dir(const std::string& work_dir, uint32_t version) {
   return snapshots_dir(work_dir) + std::to_string(version) + "/";
 }
 
+// 快照中邻接表(MutableCsr)的存储格式，记录在<prefix>.fmt中；
+// 增量checkpoint写出的快照另有<prefix>.dlt，存放基础段之外的边
+enum class CsrFormatVersion : uint32_t {
+  kLegacyNbr = 0,   // <prefix>.nbr，带时间戳的MutableNbr
+  kBase = 1,        // <prefix>.base，不带时间戳的ImmutableNbr
+  kPackedBase = 2,  // <prefix>.base + <prefix>.boff，排序后差值位压缩
+};
+
+inline std::string csr_format_path(const std::string& snapshot_dir,
+                                   const std::string& prefix) {
+  return snapshot_dir + "/" + prefix + ".fmt";
+}
+
+// 没有.fmt的旧快照根据文件推断格式
+inline CsrFormatVersion get_csr_format_version(const std::string& snapshot_dir,
+                                               const std::string& prefix) {
+  std::string format_path = csr_format_path(snapshot_dir, prefix);
+  if (!std::filesystem::exists(format_path)) {
+    return std::filesystem::exists(snapshot_dir + "/" + prefix + ".base")
+               ? CsrFormatVersion::kBase
+               : CsrFormatVersion::kLegacyNbr;
+  }
+  FILE* format_file = fopen(format_path.c_str(), "rb");
+  uint32_t version = 0;
+  auto ret = ::fread(&version, sizeof(uint32_t), 1, format_file);
+  ::fclose(format_file);
+  return static_cast<CsrFormatVersion>(version);
+}
+
+// .fmt中格式之后记录基础段的排列顺序，没有记录时为EdgeSortOrder::kNone
+inline EdgeSortOrder get_csr_sort_order(const std::string& snapshot_dir,
+                                        const std::string& prefix) {
+  std::string format_path = csr_format_path(snapshot_dir, prefix);
+  if (!std::filesystem::exists(format_path)) {
+    return EdgeSortOrder::kNone;
+  }
+  FILE* format_file = fopen(format_path.c_str(), "rb");
+  uint32_t values[2] = {0, 0};
+  size_t num = ::fread(values, sizeof(uint32_t), 2, format_file);
+  ::fclose(format_file);
+  return num == 2 ? static_cast<EdgeSortOrder>(values[1])
+                  : EdgeSortOrder::kNone;
+}
+
+inline void set_csr_format_version(
+    const std::string& snapshot_dir, const std::string& prefix,
+    CsrFormatVersion version, EdgeSortOrder order = EdgeSortOrder::kNone) {
+  std::string format_path = csr_format_path(snapshot_dir, prefix);
+  uint32_t values[2] = {static_cast<uint32_t>(version),
+                        static_cast<uint32_t>(order)};
+  FILE* format_file = open_snapshot_file(format_path);
+  write_snapshot_file(format_file, values, sizeof(uint32_t), 2, format_path);
+  close_snapshot_file(format_file, format_path);
+}
+
 inline std::string wal_dir(const std::string& work_dir) {
   return work_dir + "/wal/";
 }
@@ -113,6 +195,13 @@ inline std::string oe_prefix(const std::string& src_label,
   return "oe_" + src_label + "_" + edge_label + "_" + dst_label;
 }
 
+// 多属性或字符串属性边的属性表(EdgePropertyTable)，按边id存放
+inline std::string edge_table_prefix(const std::string& src_label,
+                                     const std::string& dst_label,
+                                     const std::string edge_label) {
+  return "edge_table_" + src_label + "_" + edge_label + "_" + dst_label;
+}
+
 inline std::string vertex_table_prefix(const std::string& label) {
   return "vertex_table_" + label;
 }
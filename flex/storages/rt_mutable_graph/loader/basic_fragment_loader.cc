@@ -28,6 +28,8 @@ BasicFragmentLoader::BasicFragmentLoader(const Schema& schema,
   vertex_data_.resize(vertex_label_num_);
   ie_.resize(vertex_label_num_ * vertex_label_num_ * edge_label_num_, NULL);
   oe_.resize(vertex_label_num_ * vertex_label_num_ * edge_label_num_, NULL);
+  edge_data_.resize(vertex_label_num_ * vertex_label_num_ * edge_label_num_,
+                    NULL);
   lf_indexers_.resize(vertex_label_num_);
 
   std::filesystem::create_directories(runtime_dir(prefix));
@@ -87,6 +89,14 @@ void BasicFragmentLoader::LoadFragment() {
                 oe_prefix(src_label_name, dst_label_name, edge_label_name),
                 snapshot_dir(work_dir_, 0));
           }
+          if (edge_data_[index] != NULL) {
+            edge_data_[index]->dump(
+                edge_table_prefix(src_label_name, dst_label_name,
+                                  edge_label_name),
+                snapshot_dir(work_dir_, 0));
+            delete edge_data_[index];
+            edge_data_[index] = NULL;
+          }
         }
       }
     }
@@ -147,6 +157,27 @@ void BasicFragmentLoader::FinishAddingVertex(
   build_lf_indexer(indexer, prefix, lf_indexers_[v_label]);
 }
 
+EdgePropertyTable& BasicFragmentLoader::InitEdgeTable(label_t src_label_id,
+                                                      label_t dst_label_id,
+                                                      label_t edge_label_id) {
+  size_t index = src_label_id * vertex_label_num_ * edge_label_num_ +
+                 dst_label_id * edge_label_num_ + edge_label_id;
+  CHECK(edge_data_[index] == NULL);
+  auto src_label_name = schema_.get_vertex_label_name(src_label_id);
+  auto dst_label_name = schema_.get_vertex_label_name(dst_label_id);
+  auto edge_label_name = schema_.get_edge_label_name(edge_label_id);
+  auto table = new EdgePropertyTable();
+  table->init(
+      edge_table_prefix(src_label_name, dst_label_name, edge_label_name),
+      tmp_dir(work_dir_),
+      schema_.get_edge_property_names(src_label_name, dst_label_name,
+                                      edge_label_name),
+      schema_.get_edge_properties(src_label_name, dst_label_name,
+                                  edge_label_name));
+  edge_data_[index] = table;
+  return *table;
+}
+
 const LFIndexer<vid_t>& BasicFragmentLoader::GetLFIndexer(
     label_t v_label) const {
   CHECK(v_label < vertex_label_num_);
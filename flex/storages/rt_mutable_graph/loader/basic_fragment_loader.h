@@ -88,6 +88,10 @@ class BasicFragmentLoader {
         src_label_name, dst_label_name, edge_label_name);
     ie_[index] = create_typed_csr<EDATA_T>(ie_strategy);
     oe_[index] = create_typed_csr<EDATA_T>(oe_strategy);
+    EdgeSortOrder sort_order = schema_.get_edge_sort_order(
+        src_label_name, dst_label_name, edge_label_name);
+    ie_[index]->set_sort_order(sort_order);
+    oe_[index]->set_sort_order(sort_order);
     ie_[index]->batch_init(
         ie_prefix(src_label_name, dst_label_name, edge_label_name),
         tmp_dir(work_dir_), {});
@@ -117,6 +121,11 @@ class BasicFragmentLoader {
         src_label_name, dst_label_name, edge_label_name);
     auto ie_csr = create_typed_csr<EDATA_T>(ie_strategy);
     auto oe_csr = create_typed_csr<EDATA_T>(oe_strategy);
+    // 排序在LoadFragment的dump中进行
+    EdgeSortOrder sort_order = schema_.get_edge_sort_order(
+        src_label_name, dst_label_name, edge_label_name);
+    ie_csr->set_sort_order(sort_order);
+    oe_csr->set_sort_order(sort_order);
     CHECK(ie_degree.size() == dst_indexer.size());
     CHECK(oe_degree.size() == src_indexer.size());
 
@@ -138,6 +147,10 @@ class BasicFragmentLoader {
     VLOG(10) << "Finish adding edge batch of size: " << edges.size();
   }
 
+  // 为多属性/字符串属性的边创建边属性表，表随LoadFragment一起dump
+  EdgePropertyTable& InitEdgeTable(label_t src_label_id, label_t dst_label_id,
+                                   label_t edge_label_id);
+
   Table& GetVertexTable(size_t ind) {
     CHECK(ind < vertex_data_.size());
     return vertex_data_[ind];
@@ -153,6 +166,7 @@ class BasicFragmentLoader {
   size_t vertex_label_num_, edge_label_num_;
   std::vector<LFIndexer<vid_t>> lf_indexers_;
   std::vector<MutableCsrBase*> ie_, oe_;
+  std::vector<EdgePropertyTable*> edge_data_;
   std::vector<Table> vertex_data_;
 };
 }  // namespace gs
@@ -25,21 +25,22 @@ static void check_edge_invariant(
         column_mappings,
     size_t src_col_ind, size_t dst_col_ind, label_t src_label_i,
     label_t dst_label_i, label_t edge_label_i) {
-  // TODO(zhanglei): Check column mappings after multiple property on edge is
-  // supported
-  if (column_mappings.size() > 1) {
-    LOG(FATAL) << "Edge column mapping must be less than 1";
+  auto src_label_name = schema.get_vertex_label_name(src_label_i);
+  auto dst_label_name = schema.get_vertex_label_name(dst_label_i);
+  auto edge_label_name = schema.get_edge_label_name(edge_label_i);
+  size_t prop_num =
+      schema.get_edge_properties(src_label_name, dst_label_name, edge_label_name)
+          .size();
+  if (column_mappings.size() > prop_num) {
+    LOG(FATAL) << "Edge column mappings (" << column_mappings.size()
+               << ") more than edge properties (" << prop_num << ")";
   }
-  if (column_mappings.size() > 0) {
-    auto& mapping = column_mappings[0];
+  for (auto& mapping : column_mappings) {
     if (std::get<0>(mapping) == src_col_ind ||
         std::get<0>(mapping) == dst_col_ind) {
       LOG(FATAL) << "Edge column mappings must not contain src_col_ind or "
                     "dst_col_ind";
     }
-    auto src_label_name = schema.get_vertex_label_name(src_label_i);
-    auto dst_label_name = schema.get_vertex_label_name(dst_label_i);
-    auto edge_label_name = schema.get_edge_label_name(edge_label_i);
     // check property exists in schema
     if (!schema.edge_has_property(src_label_name, dst_label_name,
                                   edge_label_name, std::get<2>(mapping))) {
@@ -50,9 +51,10 @@ static void check_edge_invariant(
   }
 }
 #if OV
+template <typename INDEX_T>
 static void set_vertex_properties(gs::ColumnBase* col,
                                   std::shared_ptr<arrow::ChunkedArray> array,
-                                  const std::vector<vid_t>& vids) {
+                                  const std::vector<INDEX_T>& vids) {
   auto type = array->type();
   auto col_type = col->type();
   size_t cur_ind = 0;
@@ -158,9 +160,10 @@ static void set_vertex_properties(gs::ColumnBase* col,
   }
 }
 #else
+template <typename INDEX_T>
 static void set_vertex_properties(gs::ColumnBase* col,
                                   std::shared_ptr<arrow::ChunkedArray> array,
-                                  const std::vector<vid_t>& vids) {
+                                  const std::vector<INDEX_T>& vids) {
   auto type = array->type();
   auto col_type = col->type();
   size_t cur_ind = 0;
@@ -267,12 +270,12 @@ static void set_vertex_properties(gs::ColumnBase* col,
   }
 }
 #endif
+// 解析一批边的src/dst并统计度数，返回这批边在parsed_edges中的起始位置
 template <typename EDATA_T>
-static void append_edges(
+static size_t append_edge_ends(
     std::shared_ptr<arrow::Int64Array> src_col,
     std::shared_ptr<arrow::Int64Array> dst_col,
     const LFIndexer<vid_t>& src_indexer, const LFIndexer<vid_t>& dst_indexer,
-    std::vector<std::shared_ptr<arrow::Array>>& edata_cols,
     std::vector<std::tuple<vid_t, vid_t, EDATA_T>>& parsed_edges,
     std::vector<int32_t>& ie_degree, std::vector<int32_t>& oe_degree) {
   CHECK(src_col->length() == dst_col->length());
@@ -300,6 +303,19 @@ static void append_edges(
   });
   src_col_thread.join();
   dst_col_thread.join();
+  return old_size;
+}
+
+template <typename EDATA_T>
+static void append_edges(
+    std::shared_ptr<arrow::Int64Array> src_col,
+    std::shared_ptr<arrow::Int64Array> dst_col,
+    const LFIndexer<vid_t>& src_indexer, const LFIndexer<vid_t>& dst_indexer,
+    std::vector<std::shared_ptr<arrow::Array>>& edata_cols,
+    std::vector<std::tuple<vid_t, vid_t, EDATA_T>>& parsed_edges,
+    std::vector<int32_t>& ie_degree, std::vector<int32_t>& oe_degree) {
+  auto old_size = append_edge_ends(src_col, dst_col, src_indexer, dst_indexer,
+                                   parsed_edges, ie_degree, oe_degree);
 
   // if EDATA_T is grape::EmptyType, no need to read columns
   if constexpr (!std::is_same<EDATA_T, grape::EmptyType>::value) {
@@ -343,10 +359,44 @@ static void append_edges(
   }
 }
 
+// 多属性/字符串属性的边：按到达顺序分配边id，属性按列写入边属性表，
+// 邻接表中只存放边id
+static void append_table_edges(
+    std::shared_ptr<arrow::Int64Array> src_col,
+    std::shared_ptr<arrow::Int64Array> dst_col,
+    const LFIndexer<vid_t>& src_indexer, const LFIndexer<vid_t>& dst_indexer,
+    std::vector<std::shared_ptr<arrow::Array>>& edata_cols,
+    EdgePropertyTable& edge_table,
+    std::vector<std::tuple<vid_t, vid_t, edge_id_t>>& parsed_edges,
+    std::vector<int32_t>& ie_degree, std::vector<int32_t>& oe_degree) {
+  auto old_size = append_edge_ends(src_col, dst_col, src_indexer, dst_indexer,
+                                   parsed_edges, ie_degree, oe_degree);
+  auto& columns = edge_table.table().column_ptrs();
+  CHECK_EQ(edata_cols.size(), columns.size());
+  size_t new_size = parsed_edges.size();
+  CHECK_EQ(old_size, edge_table.size());
+  edge_table.resize(new_size);
+
+  std::vector<size_t> eids(new_size - old_size);
+  for (size_t i = 0; i < eids.size(); ++i) {
+    eids[i] = old_size + i;
+    std::get<2>(parsed_edges[old_size + i]) = static_cast<edge_id_t>(eids[i]);
+  }
+  for (size_t j = 0; j < edata_cols.size(); ++j) {
+    CHECK_EQ(edata_cols[j]->length(), src_col->length());
+    set_vertex_properties(columns[j],
+                          std::make_shared<arrow::ChunkedArray>(edata_cols[j]),
+                          eids);
+  }
+  VLOG(10) << "Finish inserting:  " << src_col->length()
+           << " edges with property table";
+}
+
 void CSVFragmentLoader::addVertexBatch(
     label_t v_label_id, IdIndexer<oid_t, vid_t>& indexer,
     std::shared_ptr<arrow::Array>& primary_key_col,
-    const std::vector<std::shared_ptr<arrow::Array>>& property_cols) {
+    const std::vector<std::shared_ptr<arrow::Array>>& property_cols,
+    bool preassigned) {
   size_t row_num = primary_key_col->length();
   CHECK_EQ(primary_key_col->type()->id(), arrow::Type::INT64);
   auto col_num = property_cols.size();
@@ -362,7 +412,12 @@ void CSVFragmentLoader::addVertexBatch(
   vids.reserve(row_num);
 
   for (auto i = 0; i < row_num; ++i) {
-    if (!indexer.add(casted_array->Value(i), vid)) {
+    if (preassigned) {
+      CHECK(indexer.get_index(casted_array->Value(i), vid))
+          << "Vertex id " << casted_array->Value(i)
+          << " not found in pre-scan for "
+          << schema_.get_vertex_label_name(v_label_id);
+    } else if (!indexer.add(casted_array->Value(i), vid)) {
       LOG(FATAL) << "Duplicate vertex id: " << casted_array->Value(i) << " for "
                  << schema_.get_vertex_label_name(v_label_id);
     }
@@ -383,7 +438,8 @@ void CSVFragmentLoader::addVertexBatch(
 void CSVFragmentLoader::addVerticesImpl(label_t v_label_id,
                                         const std::string& v_label_name,
                                         const std::vector<std::string> v_files,
-                                        IdIndexer<oid_t, vid_t>& indexer) {
+                                        IdIndexer<oid_t, vid_t>& indexer,
+                                        bool preassigned) {
   VLOG(10) << "Parsing vertex file:" << v_files.size() << " for label "
            << v_label_name;
 
@@ -410,7 +466,7 @@ void CSVFragmentLoader::addVerticesImpl(label_t v_label_id,
       other_columns_array.erase(other_columns_array.begin() + primary_key_ind);
       VLOG(10) << "Reading record batch of size: " << record_batch->num_rows();
       addVertexBatch(v_label_id, indexer, primary_key_column,
-                     other_columns_array);
+                     other_columns_array, preassigned);
     }
   }
 
@@ -434,8 +490,14 @@ void CSVFragmentLoader::addVertices(label_t v_label_id,
            << v_files.size() << " files.";
 
   IdIndexer<oid_t, vid_t> indexer;
+  bool preassigned = false;
+  if (v_label_id < ordered_indexers_.size() &&
+      !ordered_indexers_[v_label_id].empty()) {
+    indexer.swap(ordered_indexers_[v_label_id]);
+    preassigned = true;
+  }
 
-  addVerticesImpl(v_label_id, v_label_name, v_files, indexer);
+  addVerticesImpl(v_label_id, v_label_name, v_files, indexer, preassigned);
 
   if (indexer.bucket_count() == 0) {
     indexer._rehash(schema_.get_max_vnum(v_label_name));
@@ -449,7 +511,8 @@ void CSVFragmentLoader::addVertices(label_t v_label_id,
 template <typename EDATA_T>
 void CSVFragmentLoader::addEdgesImpl(label_t src_label_id, label_t dst_label_id,
                                      label_t e_label_id,
-                                     const std::vector<std::string>& e_files) {
+                                     const std::vector<std::string>& e_files,
+                                     EdgePropertyTable* edge_table) {
   auto edge_column_mappings = loading_config_.GetEdgeColumnMappings(
       src_label_id, dst_label_id, e_label_id);
   auto src_dst_col_pair =
@@ -504,8 +567,8 @@ void CSVFragmentLoader::addEdgesImpl(label_t src_label_id, label_t dst_label_id,
       for (auto i = 2; i < columns.size(); ++i) {
         property_cols.emplace_back(columns[i]);
       }
-      CHECK(property_cols.size() <= 1)
-          << "Currently only support at most one property on edge";
+      CHECK(edge_table != nullptr || property_cols.size() <= 1)
+          << "Multiple properties on edge require an edge property table";
       {
         // add edges to vector
         CHECK(src_col->length() == dst_col->length());
@@ -515,6 +578,14 @@ void CSVFragmentLoader::addEdgesImpl(label_t src_label_id, label_t dst_label_id,
             std::static_pointer_cast<arrow::Int64Array>(src_col);
         auto dst_casted_array =
             std::static_pointer_cast<arrow::Int64Array>(dst_col);
+        if constexpr (std::is_same<EDATA_T, edge_id_t>::value) {
+          if (edge_table != nullptr) {
+            append_table_edges(src_casted_array, dst_casted_array, src_indexer,
+                               dst_indexer, property_cols, *edge_table,
+                               parsed_edges, ie_degree, oe_degree);
+            continue;
+          }
+        }
         append_edges(src_casted_array, dst_casted_array, src_indexer,
                      dst_indexer, property_cols, parsed_edges, ie_degree,
                      oe_degree);
@@ -550,9 +621,18 @@ void CSVFragmentLoader::addEdges(label_t src_label_i, label_t dst_label_i,
   auto& property_types = schema_.get_edge_properties(
       src_label_name, dst_label_name, edge_label_name);
   size_t col_num = property_types.size();
-  CHECK_LE(col_num, 1) << "Only single or no property is supported for edge.";
 
-  if (col_num == 0) {
+  if (use_edge_property_table(property_types)) {
+    auto& edge_table = basic_fragment_loader_.InitEdgeTable(
+        src_label_i, dst_label_i, edge_label_i);
+    if (filenames.empty()) {
+      basic_fragment_loader_.AddNoPropEdgeBatch<edge_id_t>(
+          src_label_i, dst_label_i, edge_label_i);
+    } else {
+      addEdgesImpl<edge_id_t>(src_label_i, dst_label_i, edge_label_i,
+                              filenames, &edge_table);
+    }
+  } else if (col_num == 0) {
     if (filenames.empty()) {
       basic_fragment_loader_.AddNoPropEdgeBatch<grape::EmptyType>(
           src_label_i, dst_label_i, edge_label_i);
@@ -581,13 +661,6 @@ void CSVFragmentLoader::addEdges(label_t src_label_i, label_t dst_label_i,
     } else {
       addEdgesImpl<int64_t>(src_label_i, dst_label_i, edge_label_i, filenames);
     }
-  } else if (property_types[0] == PropertyType::kString) {
-    if (filenames.empty()) {
-      basic_fragment_loader_.AddNoPropEdgeBatch<std::string>(
-          src_label_i, dst_label_i, edge_label_i);
-    } else {
-      LOG(FATAL) << "Unsupported edge property type.";
-    }
   } else if (property_types[0] == PropertyType::kDouble) {
     if (filenames.empty()) {
       basic_fragment_loader_.AddNoPropEdgeBatch<double>(
@@ -600,6 +673,203 @@ void CSVFragmentLoader::addEdges(label_t src_label_i, label_t dst_label_i,
   }
 }
 
+static void parallel_run(size_t task_num, int thread_num,
+                         const std::function<void(size_t)>& func) {
+  std::atomic<size_t> task_ind(0);
+  std::vector<std::thread> threads(
+      std::max<size_t>(1, std::min<size_t>(thread_num, task_num)));
+  for (auto& thread : threads) {
+    thread = std::thread([&]() {
+      while (true) {
+        size_t cur = task_ind.fetch_add(1);
+        if (cur >= task_num) {
+          break;
+        }
+        func(cur);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+void CSVFragmentLoader::scanVertexKeys(label_t v_label_id,
+                                       const std::vector<std::string>& v_files,
+                                       IdIndexer<oid_t, vid_t>& indexer) {
+  size_t primary_key_ind =
+      std::get<2>(schema_.get_vertex_primary_key(v_label_id)[0]);
+  for (auto& v_file : v_files) {
+    bool is_stream = !loading_config_.GetIsBatchReader();
+    auto reader = create_vertex_reader(schema_, loading_config_, v_label_id,
+                                       v_file, is_stream);
+    while (true) {
+      std::shared_ptr<arrow::RecordBatch> record_batch = reader->Read();
+      if (record_batch == nullptr) {
+        break;
+      }
+      auto primary_key_column = record_batch->column(primary_key_ind);
+      CHECK_EQ(primary_key_column->type()->id(), arrow::Type::INT64);
+      auto casted_array =
+          std::static_pointer_cast<arrow::Int64Array>(primary_key_column);
+      vid_t vid;
+      for (auto i = 0; i < casted_array->length(); ++i) {
+        if (!indexer.add(casted_array->Value(i), vid)) {
+          LOG(FATAL) << "Duplicate vertex id: " << casted_array->Value(i)
+                     << " for " << schema_.get_vertex_label_name(v_label_id);
+        }
+      }
+    }
+  }
+}
+
+void CSVFragmentLoader::scanEdges(
+    label_t src_label_id, label_t dst_label_id, label_t e_label_id,
+    const std::vector<std::string>& e_files, bool is_group_edge,
+    const std::vector<IdIndexer<oid_t, vid_t>>& indexers,
+    VertexOrderingBuilder& builder) {
+  const auto& src_indexer = indexers[src_label_id];
+  const auto& dst_indexer = indexers[dst_label_id];
+  std::vector<vid_t> srcs, dsts;
+  for (auto& filename : e_files) {
+    bool is_stream = !loading_config_.GetIsBatchReader();
+    auto reader =
+        create_edge_reader(schema_, loading_config_, src_label_id, dst_label_id,
+                           e_label_id, filename, is_stream);
+    size_t missing = 0;
+    while (true) {
+      std::shared_ptr<arrow::RecordBatch> record_batch = reader->Read();
+      if (record_batch == nullptr) {
+        break;
+      }
+      CHECK(record_batch->num_columns() >= 2);
+      auto src_col = record_batch->column(0);
+      auto dst_col = record_batch->column(1);
+      CHECK(src_col->type() == arrow::int64());
+      CHECK(dst_col->type() == arrow::int64());
+      auto src_casted_array =
+          std::static_pointer_cast<arrow::Int64Array>(src_col);
+      auto dst_casted_array =
+          std::static_pointer_cast<arrow::Int64Array>(dst_col);
+      srcs.clear();
+      dsts.clear();
+      vid_t src_vid, dst_vid;
+      for (auto i = 0; i < src_casted_array->length(); ++i) {
+        if (src_indexer.get_index(src_casted_array->Value(i), src_vid) &&
+            dst_indexer.get_index(dst_casted_array->Value(i), dst_vid)) {
+          srcs.push_back(src_vid);
+          dsts.push_back(dst_vid);
+        } else {
+          ++missing;
+        }
+      }
+      builder.AddEdges(src_label_id, dst_label_id, is_group_edge, srcs, dsts);
+    }
+    if (missing > 0) {
+      LOG(WARNING) << missing << " edges in " << filename
+                   << " refer to unknown vertices, ignored by ordering";
+    }
+  }
+}
+
+void CSVFragmentLoader::computeVertexOrdering() {
+  std::vector<VertexOrderingType> types(vertex_label_num_);
+  bool enabled = false;
+  for (label_t i = 0; i < vertex_label_num_; ++i) {
+    types[i] = parse_vertex_ordering(loading_config_.GetVertexOrdering(i));
+    enabled |= (types[i] != VertexOrderingType::kNone);
+  }
+  if (!enabled) {
+    return;
+  }
+  double t0 = -grape::GetCurrentTime();
+
+  // 1. 按文件顺序为每个label分配临时vid
+  auto& vertex_sources = loading_config_.GetVertexLoadingMeta();
+  std::vector<std::pair<label_t, std::vector<std::string>>> vertex_files(
+      vertex_sources.begin(), vertex_sources.end());
+  std::vector<IdIndexer<oid_t, vid_t>> indexers(vertex_label_num_);
+  parallel_run(vertex_files.size(), thread_num_, [&](size_t i) {
+    auto v_label_id = vertex_files[i].first;
+    scanVertexKeys(v_label_id, vertex_files[i].second, indexers[v_label_id]);
+  });
+  std::vector<size_t> vertex_nums(vertex_label_num_);
+  for (label_t i = 0; i < vertex_label_num_; ++i) {
+    vertex_nums[i] = indexers[i].size();
+  }
+
+  // 2. group_by_creator按分组边(src -> creator)排序
+  auto& edge_sources = loading_config_.GetEdgeLoadingMeta();
+  const auto& group_edge_name = loading_config_.GetGroupByEdgeLabel();
+  std::vector<label_t> group_labels(vertex_label_num_);
+  for (label_t i = 0; i < vertex_label_num_; ++i) {
+    group_labels[i] = i;
+    if (types[i] != VertexOrderingType::kGroupByCreator) {
+      continue;
+    }
+    bool found = false;
+    for (auto& pair : edge_sources) {
+      if (std::get<0>(pair.first) == i &&
+          schema_.get_edge_label_name(std::get<2>(pair.first)) ==
+              group_edge_name) {
+        group_labels[i] = std::get<1>(pair.first);
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      LOG(WARNING) << "No " << group_edge_name << " edge found for "
+                   << schema_.get_vertex_label_name(i)
+                   << ", keep file order";
+      types[i] = VertexOrderingType::kNone;
+    }
+  }
+
+  // 3. 扫描边文件，收集度数、同label子图和分组
+  VertexOrderingBuilder builder(vertex_nums, types, group_labels);
+  std::vector<std::pair<typename LoadingConfig::edge_triplet_type,
+                        std::vector<std::string>>>
+      edge_files;
+  for (auto& pair : edge_sources) {
+    if (builder.NeedEdges(std::get<0>(pair.first), std::get<1>(pair.first))) {
+      edge_files.emplace_back(pair.first, pair.second);
+    }
+  }
+  parallel_run(edge_files.size(), thread_num_, [&](size_t i) {
+    auto src_label_id = std::get<0>(edge_files[i].first);
+    auto dst_label_id = std::get<1>(edge_files[i].first);
+    auto e_label_id = std::get<2>(edge_files[i].first);
+    bool is_group_edge =
+        types[src_label_id] == VertexOrderingType::kGroupByCreator &&
+        group_labels[src_label_id] == dst_label_id &&
+        schema_.get_edge_label_name(e_label_id) == group_edge_name;
+    scanEdges(src_label_id, dst_label_id, e_label_id, edge_files[i].second,
+              is_group_edge, indexers, builder);
+  });
+
+  // 4. 计算新顺序，并按新顺序重建indexer，之后点表、LFIndexer和邻接表都
+  // 使用新的vid
+  auto orders = builder.Build(thread_num_);
+  ordered_indexers_.resize(vertex_label_num_);
+  parallel_run(vertex_label_num_, thread_num_, [&](size_t i) {
+    if (types[i] == VertexOrderingType::kNone) {
+      return;
+    }
+    auto& order = orders[i];
+    CHECK_EQ(order.size(), indexers[i].size());
+    auto& ordered = ordered_indexers_[i];
+    oid_t oid;
+    vid_t vid;
+    for (auto old_vid : order) {
+      indexers[i].get_key(old_vid, oid);
+      ordered.add(oid, vid);
+    }
+  });
+
+  t0 += grape::GetCurrentTime();
+  LOG(INFO) << "Finished computing vertex ordering, elapsed " << t0 << " s";
+}
+
 void CSVFragmentLoader::loadVertices() {
   auto vertex_sources = loading_config_.GetVertexLoadingMeta();
   if (vertex_sources.empty()) {
@@ -700,6 +970,7 @@ void CSVFragmentLoader::loadEdges() {
 }
 
 void CSVFragmentLoader::LoadFragment() {
+  computeVertexOrdering();
   loadVertices();
   loadEdges();
 
@@ -19,6 +19,7 @@
 
 #include "flex/storages/rt_mutable_graph/loader/basic_fragment_loader.h"
 #include "flex/storages/rt_mutable_graph/loader/i_fragment_loader.h"
+#include "flex/storages/rt_mutable_graph/loader/vertex_ordering.h"
 #include "flex/storages/rt_mutable_graph/loading_config.h"
 #include "flex/storages/rt_mutable_graph/mutable_property_fragment.h"
 
@@ -53,6 +54,19 @@ class CSVFragmentLoader : public IFragmentLoader {
   void LoadFragment() override;
 
  private:
+  // 预扫描点和边文件，按LoadingConfig中的vertex ordering预先分配vid
+  void computeVertexOrdering();
+
+  void scanVertexKeys(label_t v_label_id,
+                      const std::vector<std::string>& v_files,
+                      IdIndexer<oid_t, vid_t>& indexer);
+
+  void scanEdges(label_t src_label_id, label_t dst_label_id,
+                 label_t e_label_id, const std::vector<std::string>& e_files,
+                 bool is_group_edge,
+                 const std::vector<IdIndexer<oid_t, vid_t>>& indexers,
+                 VertexOrderingBuilder& builder);
+
   void loadVertices();
 
   void loadEdges();
@@ -61,12 +75,14 @@ class CSVFragmentLoader : public IFragmentLoader {
 
   void addVerticesImpl(label_t v_label_id, const std::string& v_label_name,
                        const std::vector<std::string> v_file,
-                       IdIndexer<oid_t, vid_t>& indexer);
+                       IdIndexer<oid_t, vid_t>& indexer, bool preassigned);
 
+  // preassigned为true时indexer中已按vertex ordering分配好所有vid
   void addVertexBatch(
       label_t v_label_id, IdIndexer<oid_t, vid_t>& indexer,
       std::shared_ptr<arrow::Array>& primary_key_col,
-      const std::vector<std::shared_ptr<arrow::Array>>& property_cols);
+      const std::vector<std::shared_ptr<arrow::Array>>& property_cols,
+      bool preassigned);
 
   void addEdges(label_t src_label_id, label_t dst_label_id, label_t e_label_id,
                 const std::vector<std::string>& e_files);
@@ -74,13 +90,17 @@ class CSVFragmentLoader : public IFragmentLoader {
   template <typename EDATA_T>
   void addEdgesImpl(label_t src_label_id, label_t dst_label_id,
                     label_t e_label_id,
-                    const std::vector<std::string>& e_files);
+                    const std::vector<std::string>& e_files,
+                    EdgePropertyTable* edge_table = nullptr);
 
   const LoadingConfig& loading_config_;
   const Schema& schema_;
   size_t vertex_label_num_, edge_label_num_;
   int32_t thread_num_;
 
+  // 按vertex ordering预先分配好vid的indexer，为空表示该label按文件顺序分配
+  std::vector<IdIndexer<oid_t, vid_t>> ordered_indexers_;
+
   mutable BasicFragmentLoader basic_fragment_loader_;
 };
 
@@ -0,0 +1,325 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flex/storages/rt_mutable_graph/loader/vertex_ordering.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <numeric>
+#include <thread>
+
+#include <glog/logging.h>
+
+namespace gs {
+
+VertexOrderingType parse_vertex_ordering(const std::string& name) {
+  if (name.empty() || name == "none") {
+    return VertexOrderingType::kNone;
+  } else if (name == "degree") {
+    return VertexOrderingType::kDegree;
+  } else if (name == "rcm" || name == "bfs") {
+    return VertexOrderingType::kRCM;
+  } else if (name == "group_by_creator") {
+    return VertexOrderingType::kGroupByCreator;
+  } else if (name == "hub_cluster") {
+    return VertexOrderingType::kHubCluster;
+  }
+  LOG(FATAL) << "Unknown vertex ordering: " << name
+             << ", expect one of none/degree/rcm/group_by_creator/hub_cluster";
+  return VertexOrderingType::kNone;
+}
+
+std::string vertex_ordering_to_string(VertexOrderingType type) {
+  switch (type) {
+  case VertexOrderingType::kNone:
+    return "none";
+  case VertexOrderingType::kDegree:
+    return "degree";
+  case VertexOrderingType::kRCM:
+    return "rcm";
+  case VertexOrderingType::kGroupByCreator:
+    return "group_by_creator";
+  case VertexOrderingType::kHubCluster:
+    return "hub_cluster";
+  }
+  return "unknown";
+}
+
+std::vector<vid_t> degree_order(const std::vector<int32_t>& degree) {
+  std::vector<vid_t> order(degree.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](vid_t a, vid_t b) {
+    return degree[a] > degree[b];
+  });
+  return order;
+}
+
+std::vector<vid_t> hub_cluster_order(const std::vector<int32_t>& degree) {
+  std::vector<vid_t> order;
+  order.reserve(degree.size());
+  if (degree.empty()) {
+    return order;
+  }
+  size_t total = 0;
+  for (auto d : degree) {
+    total += d;
+  }
+  double avg = static_cast<double>(total) / degree.size();
+  for (vid_t v = 0; v < degree.size(); ++v) {
+    if (degree[v] > avg) {
+      order.push_back(v);
+    }
+  }
+  for (vid_t v = 0; v < degree.size(); ++v) {
+    if (degree[v] <= avg) {
+      order.push_back(v);
+    }
+  }
+  return order;
+}
+
+std::vector<vid_t> rcm_order(const std::vector<size_t>& offsets,
+                             const std::vector<vid_t>& nbrs) {
+  size_t vnum = offsets.size() - 1;
+  auto degree = [&](vid_t v) { return offsets[v + 1] - offsets[v]; };
+
+  // 从度数最小的点开始BFS，邻居按度数升序入队
+  std::vector<vid_t> starts;
+  std::vector<vid_t> isolated;
+  for (vid_t v = 0; v < vnum; ++v) {
+    if (degree(v) == 0) {
+      isolated.push_back(v);
+    } else {
+      starts.push_back(v);
+    }
+  }
+  std::stable_sort(starts.begin(), starts.end(),
+                   [&](vid_t a, vid_t b) { return degree(a) < degree(b); });
+
+  std::vector<bool> visited(vnum, false);
+  std::vector<vid_t> order;
+  order.reserve(vnum);
+  std::vector<vid_t> buffer;
+  for (auto start : starts) {
+    if (visited[start]) {
+      continue;
+    }
+    size_t head = order.size();
+    visited[start] = true;
+    order.push_back(start);
+    while (head < order.size()) {
+      vid_t u = order[head++];
+      buffer.clear();
+      for (size_t k = offsets[u]; k < offsets[u + 1]; ++k) {
+        vid_t w = nbrs[k];
+        if (!visited[w]) {
+          visited[w] = true;
+          buffer.push_back(w);
+        }
+      }
+      std::sort(buffer.begin(), buffer.end(), [&](vid_t a, vid_t b) {
+        return degree(a) != degree(b) ? degree(a) < degree(b) : a < b;
+      });
+      order.insert(order.end(), buffer.begin(), buffer.end());
+    }
+  }
+  std::reverse(order.begin(), order.end());
+  // 没有同label边的点保持原序放在最后
+  order.insert(order.end(), isolated.begin(), isolated.end());
+  return order;
+}
+
+std::vector<vid_t> group_order(const std::vector<vid_t>& group_key) {
+  std::vector<vid_t> order(group_key.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](vid_t a, vid_t b) {
+    return group_key[a] < group_key[b];
+  });
+  return order;
+}
+
+VertexOrderingBuilder::VertexOrderingBuilder(
+    const std::vector<size_t>& vertex_nums,
+    const std::vector<VertexOrderingType>& types,
+    const std::vector<label_t>& group_labels)
+    : vertex_nums_(vertex_nums),
+      types_(types),
+      group_labels_(group_labels),
+      degrees_(vertex_nums.size()),
+      self_edges_(vertex_nums.size()),
+      group_keys_(vertex_nums.size()),
+      locks_(vertex_nums.size()) {
+  CHECK_EQ(types_.size(), vertex_nums_.size());
+  CHECK_EQ(group_labels_.size(), vertex_nums_.size());
+  for (size_t i = 0; i < vertex_nums_.size(); ++i) {
+    if (types_[i] == VertexOrderingType::kDegree ||
+        types_[i] == VertexOrderingType::kHubCluster ||
+        types_[i] == VertexOrderingType::kRCM) {
+      degrees_[i].resize(vertex_nums_[i], 0);
+    } else if (types_[i] == VertexOrderingType::kGroupByCreator) {
+      group_keys_[i].resize(vertex_nums_[i],
+                            std::numeric_limits<vid_t>::max());
+    }
+  }
+}
+
+bool VertexOrderingBuilder::NeedEdges(label_t src_label,
+                                      label_t dst_label) const {
+  return types_[src_label] != VertexOrderingType::kNone ||
+         types_[dst_label] != VertexOrderingType::kNone;
+}
+
+void VertexOrderingBuilder::AddEdges(label_t src_label, label_t dst_label,
+                                     bool is_group_edge,
+                                     const std::vector<vid_t>& srcs,
+                                     const std::vector<vid_t>& dsts) {
+  CHECK_EQ(srcs.size(), dsts.size());
+  if (!degrees_[src_label].empty()) {
+    std::lock_guard<std::mutex> lock(locks_[src_label]);
+    for (auto v : srcs) {
+      ++degrees_[src_label][v];
+    }
+  }
+  if (!degrees_[dst_label].empty()) {
+    std::lock_guard<std::mutex> lock(locks_[dst_label]);
+    for (auto v : dsts) {
+      ++degrees_[dst_label][v];
+    }
+  }
+  if (src_label == dst_label && types_[src_label] == VertexOrderingType::kRCM) {
+    std::lock_guard<std::mutex> lock(locks_[src_label]);
+    auto& edges = self_edges_[src_label];
+    for (size_t i = 0; i < srcs.size(); ++i) {
+      edges.emplace_back(srcs[i], dsts[i]);
+    }
+  }
+  if (is_group_edge) {
+    CHECK(types_[src_label] == VertexOrderingType::kGroupByCreator);
+    CHECK_EQ(group_labels_[src_label], dst_label);
+    std::lock_guard<std::mutex> lock(locks_[src_label]);
+    auto& keys = group_keys_[src_label];
+    for (size_t i = 0; i < srcs.size(); ++i) {
+      keys[srcs[i]] = dsts[i];
+    }
+  }
+}
+
+std::vector<vid_t> VertexOrderingBuilder::build_label(
+    label_t label, const std::vector<std::vector<vid_t>>& orders) {
+  size_t vnum = vertex_nums_[label];
+  switch (types_[label]) {
+  case VertexOrderingType::kDegree:
+    return degree_order(degrees_[label]);
+  case VertexOrderingType::kHubCluster:
+    return hub_cluster_order(degrees_[label]);
+  case VertexOrderingType::kRCM: {
+    auto& edges = self_edges_[label];
+    std::vector<size_t> offsets(vnum + 1, 0);
+    for (auto& e : edges) {
+      ++offsets[e.first + 1];
+      ++offsets[e.second + 1];
+    }
+    for (size_t v = 0; v < vnum; ++v) {
+      offsets[v + 1] += offsets[v];
+    }
+    std::vector<vid_t> nbrs(offsets[vnum]);
+    std::vector<size_t> pos(offsets.begin(), offsets.end() - 1);
+    for (auto& e : edges) {
+      nbrs[pos[e.first]++] = e.second;
+      nbrs[pos[e.second]++] = e.first;
+    }
+    std::vector<std::pair<vid_t, vid_t>>().swap(edges);
+    if (offsets[vnum] == 0) {
+      LOG(WARNING) << "No edges within label " << static_cast<int>(label)
+                   << ", fall back to degree ordering";
+      return degree_order(degrees_[label]);
+    }
+    return rcm_order(offsets, nbrs);
+  }
+  case VertexOrderingType::kGroupByCreator: {
+    // 分组键换成目标label的新vid，使同一creator的消息按creator的顺序排列
+    auto& keys = group_keys_[label];
+    // 若目标label本身也按分组排序，则按其文件顺序分组
+    label_t group_label = group_labels_[label];
+    if (types_[group_label] == VertexOrderingType::kGroupByCreator) {
+      LOG(WARNING) << "Group label of " << static_cast<int>(label)
+                   << " is also grouped, using its file order";
+    } else {
+      const auto& group_order_vec = orders[group_label];
+      std::vector<vid_t> rank(group_order_vec.size());
+      for (vid_t i = 0; i < group_order_vec.size(); ++i) {
+        rank[group_order_vec[i]] = i;
+      }
+      for (auto& key : keys) {
+        if (key != std::numeric_limits<vid_t>::max()) {
+          key = rank[key];
+        }
+      }
+    }
+    return group_order(keys);
+  }
+  default:
+    break;
+  }
+  std::vector<vid_t> order(vnum);
+  std::iota(order.begin(), order.end(), 0);
+  return order;
+}
+
+std::vector<std::vector<vid_t>> VertexOrderingBuilder::Build(int thread_num) {
+  size_t label_num = vertex_nums_.size();
+  std::vector<std::vector<vid_t>> orders(label_num);
+
+  auto run = [&](const std::vector<label_t>& labels) {
+    std::atomic<size_t> idx(0);
+    std::vector<std::thread> threads(
+        std::max(1, std::min<int>(thread_num, labels.size())));
+    for (auto& thread : threads) {
+      thread = std::thread([&]() {
+        while (true) {
+          size_t cur = idx.fetch_add(1);
+          if (cur >= labels.size()) {
+            break;
+          }
+          label_t label = labels[cur];
+          orders[label] = build_label(label, orders);
+          LOG(INFO) << "Finish computing " << vertex_ordering_to_string(
+                                                  types_[label])
+                    << " ordering for label " << static_cast<int>(label)
+                    << ", vertex num: " << vertex_nums_[label];
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  };
+
+  std::vector<label_t> independent, grouped;
+  for (label_t i = 0; i < label_num; ++i) {
+    if (types_[i] == VertexOrderingType::kGroupByCreator) {
+      grouped.push_back(i);
+    } else {
+      independent.push_back(i);
+    }
+  }
+  // 按分组排序的label依赖分组目标label的最终顺序
+  run(independent);
+  run(grouped);
+  return orders;
+}
+
+}  // namespace gs
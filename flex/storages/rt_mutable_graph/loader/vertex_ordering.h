@@ -0,0 +1,91 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STORAGES_RT_MUTABLE_GRAPH_LOADER_VERTEX_ORDERING_H_
+#define STORAGES_RT_MUTABLE_GRAPH_LOADER_VERTEX_ORDERING_H_
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "flex/storages/rt_mutable_graph/types.h"
+
+namespace gs {
+
+// 导入时vid的分配顺序。所有顺序都只决定vid，LFIndexer、点表和两个方向的
+// 邻接表都按同一个vid构建，因此天然一致。
+enum class VertexOrderingType {
+  kNone,            // 按文件中出现的顺序
+  kDegree,          // 按度数降序
+  kRCM,             // 同label子图上的Reverse Cuthill-McKee
+  kGroupByCreator,  // 按出边(如HASCREATOR)指向的点聚簇，用于消息
+  kHubCluster,      // 度数高于平均值的hub点聚集在最前，其余保持原序
+};
+
+VertexOrderingType parse_vertex_ordering(const std::string& name);
+
+std::string vertex_ordering_to_string(VertexOrderingType type);
+
+// 以下函数返回order，order[new_vid] = old_vid
+
+std::vector<vid_t> degree_order(const std::vector<int32_t>& degree);
+
+std::vector<vid_t> hub_cluster_order(const std::vector<int32_t>& degree);
+
+// offsets/nbrs是同label无向子图的CSR
+std::vector<vid_t> rcm_order(const std::vector<size_t>& offsets,
+                             const std::vector<vid_t>& nbrs);
+
+// group_key[v]为v所属分组在目标label中的新vid，没有分组的点为
+// std::numeric_limits<vid_t>::max()，排在最后
+std::vector<vid_t> group_order(const std::vector<vid_t>& group_key);
+
+/**
+ * @brief 预扫描边文件时收集排序所需的拓扑。这里的vid是按文件顺序分配的临时
+ * vid；不同边三元组的AddEdges可以并发调用。
+ */
+class VertexOrderingBuilder {
+ public:
+  VertexOrderingBuilder(const std::vector<size_t>& vertex_nums,
+                        const std::vector<VertexOrderingType>& types,
+                        const std::vector<label_t>& group_labels);
+
+  bool NeedEdges(label_t src_label, label_t dst_label) const;
+
+  // is_group_edge表示这组边是src_label的分组边(src -> group)
+  void AddEdges(label_t src_label, label_t dst_label, bool is_group_edge,
+                const std::vector<vid_t>& srcs,
+                const std::vector<vid_t>& dsts);
+
+  // 先计算不依赖其他label的顺序，再计算按分组排序的label
+  std::vector<std::vector<vid_t>> Build(int thread_num);
+
+ private:
+  std::vector<vid_t> build_label(label_t label,
+                                 const std::vector<std::vector<vid_t>>& orders);
+
+  std::vector<size_t> vertex_nums_;
+  std::vector<VertexOrderingType> types_;
+  std::vector<label_t> group_labels_;
+
+  std::vector<std::vector<int32_t>> degrees_;
+  std::vector<std::vector<std::pair<vid_t, vid_t>>> self_edges_;
+  std::vector<std::vector<vid_t>> group_keys_;
+  std::vector<std::mutex> locks_;
+};
+
+}  // namespace gs
+
+#endif  // STORAGES_RT_MUTABLE_GRAPH_LOADER_VERTEX_ORDERING_H_
@@ -462,6 +462,29 @@ static bool parse_bulk_load_config_file(const std::string& config_file,
         return false;
       }
     }
+    auto ordering_node = loading_config_node["vertex_ordering"];
+    if (ordering_node) {
+      get_scalar(ordering_node, "default",
+                 load_config.default_vertex_ordering_);
+      get_scalar(ordering_node, "group_by_edge",
+                 load_config.group_by_edge_label_);
+      auto labels_node = ordering_node["labels"];
+      if (labels_node) {
+        if (!labels_node.IsMap()) {
+          LOG(ERROR) << "vertex_ordering labels should be a map";
+          return false;
+        }
+        for (auto it = labels_node.begin(); it != labels_node.end(); ++it) {
+          if (!load_config.SetVertexOrdering(it->first.as<std::string>(),
+                                             it->second.as<std::string>())) {
+            return false;
+          }
+        }
+      }
+      LOG(INFO) << "default vertex ordering: "
+                << load_config.default_vertex_ordering_
+                << ", group by edge: " << load_config.group_by_edge_label_;
+    }
   }
   if (load_config.method_ != "init") {
     LOG(ERROR) << "Only support init method now";
@@ -561,6 +584,18 @@ void LoadingConfig::SetDelimiter(const char& delimiter) {
   metadata_[reader_options::DELIMITER] = std::string(1, delimiter);
 }
 void LoadingConfig::SetMethod(const std::string& method) { method_ = method; }
+void LoadingConfig::SetVertexOrdering(const std::string& ordering) {
+  default_vertex_ordering_ = ordering;
+}
+bool LoadingConfig::SetVertexOrdering(const std::string& label,
+                                      const std::string& ordering) {
+  if (!schema_.has_vertex_label(label)) {
+    LOG(ERROR) << "Vertex label " << label << " not found in schema";
+    return false;
+  }
+  vertex_orderings_[schema_.get_vertex_label_id(label)] = ordering;
+  return true;
+}
 
 // getters
 const std::string& LoadingConfig::GetScheme() const { return scheme_; }
@@ -614,6 +649,18 @@ bool LoadingConfig::GetIsBatchReader() const {
   return str == "true" || str == "True" || str == "TRUE";
 }
 
+const std::string& LoadingConfig::GetVertexOrdering(label_t label_id) const {
+  auto iter = vertex_orderings_.find(label_id);
+  if (iter != vertex_orderings_.end()) {
+    return iter->second;
+  }
+  return default_vertex_ordering_;
+}
+
+const std::string& LoadingConfig::GetGroupByEdgeLabel() const {
+  return group_by_edge_label_;
+}
+
 const std::unordered_map<LoadingConfig::schema_label_type,
                          std::vector<std::string>>&
 LoadingConfig::GetVertexLoadingMeta() const {
@@ -97,6 +97,11 @@ class LoadingConfig {
   void SetScheme(const std::string& data_source);
   void SetDelimiter(const char& delimiter);
   void SetMethod(const std::string& method);
+  // Set the ordering used to assign vids when bulk loading, see
+  // loader/vertex_ordering.h. Labels without their own ordering use the
+  // default one.
+  void SetVertexOrdering(const std::string& ordering);
+  bool SetVertexOrdering(const std::string& label, const std::string& ordering);
 
   // getters
   const std::string& GetScheme() const;
@@ -111,6 +116,9 @@ class LoadingConfig {
   bool GetIsDoubleQuoting() const;
   int32_t GetBatchSize() const;
   bool GetIsBatchReader() const;
+  const std::string& GetVertexOrdering(label_t label_id) const;
+  // Edge label used by group_by_creator ordering, e.g. HASCREATOR.
+  const std::string& GetGroupByEdgeLabel() const;
   const std::unordered_map<schema_label_type, std::vector<std::string>>&
   GetVertexLoadingMeta() const;
   const std::unordered_map<edge_triplet_type, std::vector<std::string>,
@@ -168,6 +176,11 @@ class LoadingConfig {
                      boost::hash<edge_triplet_type>>
       edge_src_dst_col_;  // Which two columns are src_id and dst_id
 
+  std::string default_vertex_ordering_ = "none";
+  std::unordered_map<schema_label_type, std::string>
+      vertex_orderings_;  // <vertex_label_id, ordering>
+  std::string group_by_edge_label_ = "HASCREATOR";
+
   friend bool config_parsing::parse_bulk_load_config_file(
       const std::string& config_file, const Schema& schema,
       LoadingConfig& load_config);
@@ -17,13 +17,20 @@
 #define GRAPHSCOPE_GRAPH_MUTABLE_CSR_H_
 
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <cstring>
 #include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <type_traits>
 #include <vector>
 
+#include "flex/storages/rt_mutable_graph/file_names.h"
 #include "flex/storages/rt_mutable_graph/types.h"
 #include "flex/utils/allocators.h"
+#include "flex/utils/cell_versions.h"
 #include "flex/utils/mmap_array.h"
 #include "flex/utils/property/types.h"
 #include "grape/serialization/in_archive.h"
@@ -60,6 +67,339 @@ struct MutableNbr<grape::EmptyType> {
   };
 };
 
+/**
+ * @brief Edge of the frozen base segment of a MutableCsr. Every edge in a
+ * snapshot is visible to all transactions once the snapshot is opened, so no
+ * timestamp is stored (the timestamp of a base edge is always 0).
+ */
+template <typename EDATA_T>
+struct ImmutableNbr {
+  vid_t neighbor;
+  EDATA_T data;
+};
+
+template <>
+struct ImmutableNbr<grape::EmptyType> {
+  vid_t neighbor;
+  inline static grape::EmptyType data;
+};
+static_assert(sizeof(ImmutableNbr<grape::EmptyType>) == sizeof(vid_t));
+
+// 为true时MutableCsr::dump以压缩格式(CsrFormatVersion::kPackedBase)写基础段
+inline bool& compress_nbr_list_on_dump() {
+  static bool enabled = false;
+  return enabled;
+}
+
+struct PackedNbrHeader {
+  vid_t first;
+  uint8_t bit_width;
+  uint8_t reserved[3];
+};
+static_assert(sizeof(PackedNbrHeader) == 8);
+
+/**
+ * @brief 基础段的压缩格式。每个邻接表按neighbor升序排列后编码为
+ *   | PackedNbrHeader | neighbor差值，按bit_width位压缩(uint64_t) | EDATA_T[] |
+ * 各部分均按8字节对齐。不超过一页的邻接表在文件中不跨页，读取时直接在页内解码。
+ */
+template <typename EDATA_T>
+struct PackedNbrCodec {
+  using base_nbr_t = ImmutableNbr<EDATA_T>;
+  static constexpr bool kHasData =
+      !std::is_same<EDATA_T, grape::EmptyType>::value;
+  // 边数据原样存放，要求单个数据不跨页，这样可以原地更新
+  static constexpr bool kPackable =
+      !kHasData || (sizeof(EDATA_T) <= 8 && 8 % sizeof(EDATA_T) == 0);
+
+  static size_t data_offset(size_t num, uint8_t bit_width) {
+    size_t delta_words = num <= 1 ? 0 : ((num - 1) * bit_width + 63) / 64;
+    return sizeof(PackedNbrHeader) + delta_words * sizeof(uint64_t);
+  }
+
+  static size_t encoded_bytes(size_t num, uint8_t bit_width) {
+    size_t bytes = data_offset(num, bit_width);
+    if constexpr (kHasData) {
+      bytes += (num * sizeof(EDATA_T) + 7) / 8 * 8;
+    }
+    return bytes;
+  }
+
+  // nbrs需已按neighbor升序排列
+  static void encode(const base_nbr_t* nbrs, size_t num,
+                     std::vector<char>& out) {
+    vid_t max_delta = 0;
+    for (size_t i = 1; i < num; ++i) {
+      max_delta = std::max(max_delta, nbrs[i].neighbor - nbrs[i - 1].neighbor);
+    }
+    uint8_t bit_width = max_delta == 0 ? 0 : 32 - __builtin_clz(max_delta);
+    out.assign(encoded_bytes(num, bit_width), 0);
+
+    PackedNbrHeader header{};
+    header.first = nbrs[0].neighbor;
+    header.bit_width = bit_width;
+    memcpy(out.data(), &header, sizeof(PackedNbrHeader));
+
+    if (bit_width != 0) {
+      char* words = out.data() + sizeof(PackedNbrHeader);
+      for (size_t i = 1; i < num; ++i) {
+        uint64_t delta = nbrs[i].neighbor - nbrs[i - 1].neighbor;
+        size_t bit = (i - 1) * bit_width;
+        size_t word_id = bit >> 6, word_off = bit & 63;
+        uint64_t word;
+        memcpy(&word, words + word_id * 8, 8);
+        word |= delta << word_off;
+        memcpy(words + word_id * 8, &word, 8);
+        if (word_off + bit_width > 64) {
+          memcpy(&word, words + (word_id + 1) * 8, 8);
+          word |= delta >> (64 - word_off);
+          memcpy(words + (word_id + 1) * 8, &word, 8);
+        }
+      }
+    }
+    if constexpr (kHasData) {
+      char* data = out.data() + data_offset(num, bit_width);
+      for (size_t i = 0; i < num; ++i) {
+        memcpy(data + i * sizeof(EDATA_T), &nbrs[i].data, sizeof(EDATA_T));
+      }
+    }
+  }
+
+  // 第i(i >= 1)条边与第i-1条边的neighbor之差
+  static vid_t delta_at(const char* words, uint8_t bit_width, size_t i) {
+    const uint64_t mask = ~0ULL >> (64 - bit_width);
+    size_t bit = (i - 1) * bit_width;
+    size_t word_id = bit >> 6, word_off = bit & 63;
+    uint64_t word;
+    memcpy(&word, words + word_id * 8, 8);
+    uint64_t delta = word >> word_off;
+    if (word_off + bit_width > 64) {
+      memcpy(&word, words + (word_id + 1) * 8, 8);
+      delta |= word << (64 - word_off);
+    }
+    return static_cast<vid_t>(delta & mask);
+  }
+
+  // 返回EDATA_T[]相对于buf的偏移
+  static size_t decode(const char* buf, size_t num, base_nbr_t* out) {
+    PackedNbrHeader header;
+    memcpy(&header, buf, sizeof(PackedNbrHeader));
+    const uint8_t bit_width = header.bit_width;
+    const char* words = buf + sizeof(PackedNbrHeader);
+
+    vid_t prev = header.first;
+    out[0].neighbor = prev;
+    for (size_t i = 1; i < num; ++i) {
+      if (bit_width != 0) {
+        prev += delta_at(words, bit_width, i);
+      }
+      out[i].neighbor = prev;
+    }
+
+    size_t offset = data_offset(num, bit_width);
+    if constexpr (kHasData) {
+      for (size_t i = 0; i < num; ++i) {
+        memcpy(&out[i].data, buf + offset + i * sizeof(EDATA_T),
+               sizeof(EDATA_T));
+      }
+    }
+    return offset;
+  }
+
+  /**
+   * @brief 按顺序逐条解码，不分配内存，迭代器只解码实际访问到的边。
+   * buf需在Cursor的使用期间有效。
+   */
+  struct Cursor {
+    void init(const char* buf, size_t num) {
+      PackedNbrHeader header;
+      memcpy(&header, buf, sizeof(PackedNbrHeader));
+      buf_ = buf;
+      num_ = num;
+      first_ = header.first;
+      bit_width_ = header.bit_width;
+      data_offset_ = PackedNbrCodec::data_offset(num, bit_width_);
+      restart();
+    }
+
+    void next() {
+      if (++idx_ >= num_) {
+        return;
+      }
+      if (bit_width_ != 0) {
+        cur_.neighbor +=
+            delta_at(buf_ + sizeof(PackedNbrHeader), bit_width_, idx_);
+      }
+      load_data();
+    }
+
+    // 向后移动时从头重新解码
+    void seek(size_t idx) {
+      if (idx < idx_) {
+        restart();
+      }
+      while (idx_ < idx && idx_ < num_) {
+        next();
+      }
+    }
+
+    const base_nbr_t& cur() const { return cur_; }
+    // 当前边的数据被原地修改时同步
+    void set_data(const EDATA_T& data) { cur_.data = data; }
+    size_t idx() const { return idx_; }
+    size_t data_offset() const { return data_offset_; }
+
+   private:
+    void restart() {
+      idx_ = 0;
+      cur_.neighbor = first_;
+      load_data();
+    }
+
+    void load_data() {
+      if constexpr (kHasData) {
+        memcpy(&cur_.data, buf_ + data_offset_ + idx_ * sizeof(EDATA_T),
+               sizeof(EDATA_T));
+      }
+    }
+
+    const char* buf_ = nullptr;
+    size_t num_ = 0;
+    size_t idx_ = 0;
+    size_t data_offset_ = 0;
+    vid_t first_ = 0;
+    uint8_t bit_width_ = 0;
+    base_nbr_t cur_;
+  };
+
+#if !OV
+  /**
+   * @brief 压缩邻接表的连续字节。bytes不超过一页时块一定是连续的，直接返回
+   * 页内的地址；否则复制到holder中。
+   */
+  static const char* contiguous(const gbp::BufferBlock& block, size_t bytes,
+                                std::shared_ptr<std::vector<char>>& holder) {
+    if (bytes <= gbp::PAGE_SIZE_FILE) {
+      return &block.Obj<char>();
+    }
+    holder = std::make_shared<std::vector<char>>(bytes);
+    block.Copy(holder->data(), bytes);
+    return holder->data();
+  }
+
+  // 从缓冲池的块中解码到out，跨页的邻接表借用线程局部的缓冲区
+  static size_t decode(const gbp::BufferBlock& block, size_t bytes, size_t num,
+                       base_nbr_t* out) {
+    if (bytes <= gbp::PAGE_SIZE_FILE) {
+      return decode(&block.Obj<char>(), num, out);
+    }
+    thread_local std::vector<char> buf;
+    buf.resize(bytes);
+    block.Copy(buf.data(), bytes);
+    return decode(buf.data(), num, out);
+  }
+#endif
+};
+
+#if !OV
+/**
+ * @brief 增量段的溢出块。每个块固定容纳kChunkSize条边且不跨页，同一个邻接表
+ * 的块通过next_串成链表。邻接表的连续区间写满之后，新插入的边写入链表尾部的
+ * 块中，不再搬迁整个邻接表。块只在compact中回收：搬迁之后先退休，等看到
+ * 旧位置的读事务都结束之后才释放，释放的块可以直接复用。
+ *
+ * 块和链表指针存放在segmented_mmap_array中，块数增长时打开新的段，已有的
+ * 文件不再resize，读者读取块时不需要与分配互斥。
+ */
+template <typename EDATA_T>
+class MutableNbrChunks {
+ public:
+  using nbr_t = MutableNbr<EDATA_T>;
+  static constexpr u_int32_t kNullChunk =
+      std::numeric_limits<u_int32_t>::max();
+  static constexpr size_t kChunkSize =
+      std::min<size_t>(32, mmap_array<nbr_t>::OBJ_NUM_PERPAGE);
+  static constexpr size_t kChunksPerPage =
+      mmap_array<nbr_t>::OBJ_NUM_PERPAGE / kChunkSize;
+
+  // 第一个段容纳的块数，之后的段依次翻倍
+  static constexpr size_t kBaseChunkNum = kChunksPerPage * 64;
+
+  MutableNbrChunks() : size_(0) {}
+  ~MutableNbrChunks() = default;
+
+  // 溢出块只在运行期间使用，dump时并入基础段，因此每次open都从空开始
+  void open(const std::string& prefix) {
+    list_.open(prefix + ".chunk",
+               kBaseChunkNum / kChunksPerPage *
+                   mmap_array<nbr_t>::OBJ_NUM_PERPAGE);
+    next_.open(prefix + ".chunk_next", kBaseChunkNum);
+    size_ = 0;
+    free_chunks_.clear();
+  }
+
+  static size_t chunk_start(u_int32_t id) {
+    return (id / kChunksPerPage) * mmap_array<nbr_t>::OBJ_NUM_PERPAGE +
+           (id % kChunksPerPage) * kChunkSize;
+  }
+
+  u_int32_t allocate() {
+    std::lock_guard<std::mutex> lock(lock_);
+    u_int32_t id;
+    if (!free_chunks_.empty()) {
+      id = free_chunks_.back();
+      free_chunks_.pop_back();
+    } else {
+      CHECK_LT(size_, kNullChunk);
+      id = size_++;
+      // 段的边界与页对齐，块不跨页因此也不跨段
+      list_.ensure(chunk_start(id));
+      next_.ensure(id);
+    }
+    u_int32_t null_chunk = kNullChunk;
+    next_.set(id, &null_chunk);
+    return id;
+  }
+
+  // 调用方需保证没有读者还能看到这个块
+  void release(u_int32_t id) {
+    std::lock_guard<std::mutex> lock(lock_);
+    free_chunks_.push_back(id);
+  }
+
+  void link(u_int32_t prev, u_int32_t id) { next_.set(prev, &id); }
+
+  u_int32_t next(u_int32_t id) const {
+    auto item = next_.get(id);
+    return gbp::BufferBlock::Ref<u_int32_t>(item);
+  }
+
+  const gbp::BufferBlock get(u_int32_t id, size_t len = kChunkSize) const {
+    return list_.get(chunk_start(id), len);
+  }
+
+  gbp::BufferBlock get_mut(u_int32_t id, size_t len = kChunkSize) {
+    return list_.get(chunk_start(id), len);
+  }
+
+  // 块中的第offset条边
+  const gbp::BufferBlock get_nbr(u_int32_t id, size_t offset) const {
+    return list_.get(chunk_start(id) + offset);
+  }
+
+  size_t get_size_in_byte() const {
+    return list_.get_size_in_byte() + next_.get_size_in_byte();
+  }
+
+ private:
+  segmented_mmap_array<nbr_t> list_;
+  segmented_mmap_array<u_int32_t> next_;
+  size_t size_;  // 已分配过的块数
+  std::vector<u_int32_t> free_chunks_;
+  std::mutex lock_;
+};
+#endif
+
 #if OV
 template <typename EDATA_T>
 class MutableNbrSlice {
@@ -115,30 +455,60 @@ class MutableNbrSliceMut {
   int size_;
 };
 #else
+// 邻接表由两段组成：冻结的基础段(base_*, 无时间戳)和带时间戳的增量段
 template <typename EDATA_T>
 struct MutableNbrSlice {
   using nbr_t = MutableNbr<EDATA_T>;
+  using base_nbr_t = ImmutableNbr<EDATA_T>;
   MutableNbrSlice() = default;
   ~MutableNbrSlice() = default;
 
-  static MutableNbrSlice empty() { return {nullptr, 0, 0}; }
-
-  const mmap_array<nbr_t>* mmap_array_;
-  size_t start_idx_;
-  size_t size_;
+  static MutableNbrSlice empty() { return MutableNbrSlice(); }
+  size_t size() const { return base_size_ + size_; }
+
+  const mmap_array<nbr_t>* mmap_array_ = nullptr;
+  size_t start_idx_ = 0;
+  size_t size_ = 0;  // 增量段的边数，其中前run_size_条位于mmap_array_中
+  size_t run_size_ = 0;
+  const MutableNbrChunks<EDATA_T>* chunks_ = nullptr;
+  u_int32_t chunk_head_ = MutableNbrChunks<EDATA_T>::kNullChunk;
+  const mmap_array<base_nbr_t>* base_array_ = nullptr;
+  size_t base_start_idx_ = 0;
+  size_t base_size_ = 0;
+  // 基础段压缩存放时非空，此时base_start_idx_为字节偏移
+  const mmap_array<char>* packed_array_ = nullptr;
+  size_t base_bytes_ = 0;
+  // 增量段中边的最大时间戳，不超过读时间戳时读者无需逐条检查
+  timestamp_t max_ts_ = 0;
+  // 所在csr中边数据的旧版本，v_为邻接表所属的顶点
+  const CellVersions* versions_ = nullptr;
+  vid_t v_ = 0;
 };
 
 template <typename EDATA_T>
 struct MutableNbrSliceMut {
   using nbr_t = MutableNbr<EDATA_T>;
+  using base_nbr_t = ImmutableNbr<EDATA_T>;
   MutableNbrSliceMut() = default;
   ~MutableNbrSliceMut() = default;
 
-  static MutableNbrSliceMut empty() { return {nullptr, 0, 0}; }
-
-  mmap_array<nbr_t>* mmap_array_;
-  size_t start_idx_;
-  size_t size_;
+  static MutableNbrSliceMut empty() { return MutableNbrSliceMut(); }
+  size_t size() const { return base_size_ + size_; }
+
+  mmap_array<nbr_t>* mmap_array_ = nullptr;
+  size_t start_idx_ = 0;
+  size_t size_ = 0;
+  size_t run_size_ = 0;
+  MutableNbrChunks<EDATA_T>* chunks_ = nullptr;
+  u_int32_t chunk_head_ = MutableNbrChunks<EDATA_T>::kNullChunk;
+  mmap_array<base_nbr_t>* base_array_ = nullptr;
+  size_t base_start_idx_ = 0;
+  size_t base_size_ = 0;
+  mmap_array<char>* packed_array_ = nullptr;
+  size_t base_bytes_ = 0;
+  // 修改边数据之前把旧值记入versions_
+  CellVersions* versions_ = nullptr;
+  vid_t v_ = 0;
 };
 #endif
 template <typename T>
@@ -323,16 +693,96 @@ class MutableAdjlist {
 //   size_t start_idx_;
 // };
 
+/**
+ * @brief 快照中基础段的位置，open之后不再改变，与MutableAdjlist分开存放，
+ * 使邻接表头保持较小。压缩存放时start_idx_为字节偏移，bytes_为字节数。
+ */
+struct MutableBaseRange {
+  size_t start_idx_ = 0;
+  u_int32_t size_ = 0;
+  u_int32_t bytes_ = 0;
+};
+
+// 增量段位置的一致副本，由MutableAdjlist::load读出
+struct MutableDeltaRange {
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+  size_t start_idx_ = 0;
+  u_int32_t chunk_head_ = std::numeric_limits<u_int32_t>::max();
+  timestamp_t max_ts_ = 0;
+
+  size_t run_size() const { return std::min(size_, capacity_); }
+};
+
 template <typename EDATA_T>
 struct MutableAdjlist {
  public:
-  MutableAdjlist() : start_idx_(0), size_(0), capacity_(0) {}
+  MutableAdjlist()
+      : size_(0),
+        capacity_(0),
+        start_idx_(0),
+        chunk_head_(MutableNbrChunks<EDATA_T>::kNullChunk),
+        chunk_tail_(MutableNbrChunks<EDATA_T>::kNullChunk),
+        max_ts_(0),
+        version_(0) {}
   ~MutableAdjlist() {}
 
   void init(size_t start_idx, size_t cap, size_t size) {
     size_ = size;
     capacity_ = cap;
     start_idx_ = start_idx;
+    chunk_head_ = MutableNbrChunks<EDATA_T>::kNullChunk;
+    chunk_tail_ = MutableNbrChunks<EDATA_T>::kNullChunk;
+    max_ts_ = 0;
+    version_ = 0;
+  }
+
+  /**
+   * @brief 读出一致的增量段位置。compact搬迁增量段时同时修改start_idx_、
+   * capacity_和chunk_*，用version_实现seqlock：写者修改前后各加一，读者看到
+   * 奇数或前后不一致时重读。插入只追加，先写边和溢出块再release写size_，
+   * 不需要修改version_。
+   */
+  void load(MutableDeltaRange& out) const {
+    while (true) {
+      u_int32_t version = version_.load(std::memory_order_acquire);
+      if (version & 1) {
+        continue;
+      }
+      out.size_ = size_.load(std::memory_order_acquire);
+      out.capacity_ = capacity_;
+      out.start_idx_ = start_idx_;
+      out.chunk_head_ = chunk_head_;
+      out.max_ts_ = max_ts_.load();
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (version_.load(std::memory_order_relaxed) == version) {
+        return;
+      }
+    }
+  }
+
+  // 搬迁之后发布新的增量段位置，调用方持有该邻接表的锁
+  void publish(size_t start_idx, size_t capacity) {
+    version_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    start_idx_ = start_idx;
+    capacity_ = capacity;
+    chunk_head_ = MutableNbrChunks<EDATA_T>::kNullChunk;
+    chunk_tail_ = MutableNbrChunks<EDATA_T>::kNullChunk;
+    version_.fetch_add(1, std::memory_order_release);
+  }
+
+  // 增量段的前size条边中位于连续区间的边数，其余的边位于溢出块中
+  size_t run_size(size_t size) const {
+    return std::min<size_t>(size, capacity_);
+  }
+
+  // 增量段的前size条边占用的溢出块数
+  size_t chunk_num(size_t size) const {
+    using chunks_t = MutableNbrChunks<EDATA_T>;
+    return size <= capacity_ ? 0
+                             : (size - capacity_ + chunks_t::kChunkSize - 1) /
+                                   chunks_t::kChunkSize;
   }
 
   // bool is_buffer() const { return is_buffer_; }
@@ -406,9 +856,18 @@ struct MutableAdjlist {
   // mmap_array<nbr_t>* get_mmap_array() { return mmap_array_; }
 
   //  private:
+  // 增量段：open之后插入的边。前capacity_条位于nbr_list_的连续区间
+  // [start_idx_, start_idx_ + capacity_)中，其余的边按插入顺序位于从
+  // chunk_head_开始的溢出块链中，由compact并回连续区间
+  // 基础段(快照中的边)的位置记录在MutableCsr::base_ranges_中
   std::atomic<u_int32_t> size_;
   u_int32_t capacity_;
   size_t start_idx_;
+  u_int32_t chunk_head_;
+  u_int32_t chunk_tail_;
+  // 增量段中边的最大时间戳，冻结之后为0。在size_之前写入
+  std::atomic<timestamp_t> max_ts_;
+  std::atomic<u_int32_t> version_;  // 见load
 };
 #endif
 
@@ -485,6 +944,14 @@ class MutableCsrBase {
   virtual void dump(const std::string& name,
                     const std::string& new_spanshot_dir) = 0;
 
+#if !OV
+  // 不改变邻接表本身，把ts及之前提交的边写到新快照中，调用方需保证此时没有
+  // 并发的插入
+  virtual void checkpoint(const std::string& name,
+                          const std::string& new_snapshot_dir,
+                          timestamp_t ts) = 0;
+#endif
+
   virtual void resize(vid_t vnum) = 0;
   virtual size_t size() const = 0;
 
@@ -506,15 +973,69 @@ class MutableCsrBase {
   virtual size_t get_index_size_in_byte() const = 0;
 
   virtual size_t get_data_size_in_byte() const = 0;
-  virtual void copy_before_insert(vid_t v) { assert(false); }
+
+  // 将溢出块较多的邻接表并回连续区间，可以与读、插入事务并发，同一时间只能
+  // 有一个线程调用。read_ts为当前的读时间戳，min_ts为活跃读事务的最小读
+  // 时间戳，用于回收之前搬迁废弃的空间。返回处理的邻接表数
+  virtual size_t compact(timestamp_t read_ts, timestamp_t min_ts) { return 0; }
+  virtual bool need_compact() const { return false; }
+
+  // 把ts及之前插入的边的时间戳改为0，ts不能超过活跃读事务的最小读时间戳；
+  // 可以与读写事务并发。返回处理的邻接表数
+  virtual size_t freeze(timestamp_t ts) { return 0; }
+
+  // 之后dump出的快照中基础段的排列顺序，由schema中的edge_sort_order决定
+  virtual void set_sort_order(EdgeSortOrder order) {}
+
+  // 原地修改的边数据的旧版本，key为edge_version_key(v, neighbor)
+  CellVersions& versions() { return versions_; }
+  const CellVersions& versions() const { return versions_; }
+
+  // 查找src在ts时到dst的边，存在时把边数据写入data
+#if OV
+  virtual bool find_edge(vid_t src, vid_t dst, timestamp_t ts,
+                         Any& data) const {
+    if (src >= size()) {
+      return false;
+    }
+    for (auto it = edge_iter(src); it->is_valid(); it->next()) {
+      if (it->get_neighbor() == dst && it->get_timestamp() <= ts) {
+        data = it->get_data();
+        return true;
+      }
+    }
+    return false;
+  }
+#else
+  virtual bool find_edge(vid_t src, vid_t dst, timestamp_t ts,
+                         Any& data) const {
+    return false;
+  }
+#endif
 
 // ========================== batching 接口 ==========================
 #if !OV
   virtual const gbp::batch_request_type get_edgelist_batch(vid_t i) const = 0;
   virtual const gbp::batch_request_type get_edges_batch(
       size_t start_idx, size_t size = 1) const = 0;
+  // 顶点没有基础段时返回false
+  virtual bool get_base_range_batch(vid_t i,
+                                    gbp::batch_request_type& req) const {
+    return false;
+  }
+  virtual const gbp::batch_request_type get_base_edges_batch(
+      size_t start_idx, size_t size, size_t bytes) const {
+    assert(false);
+    return gbp::batch_request_type();
+  }
+  // 由get_edges_batch读出的单条边在ts之后被原地修改过时，换成带旧数据的副本
+  virtual void resolve_version(vid_t v, timestamp_t ts,
+                               gbp::BufferBlock& item) const {}
 #endif
   // ========================== batching 接口 ==========================
+
+ private:
+  CellVersions versions_;
 };
 
 #if OV
@@ -553,9 +1074,9 @@ class TypedMutableCsrEdgeIter : public MutableCsrEdgeIterBase {
   Any get_data() const { return AnyConverter<EDATA_T>::to_any(cur_->data); }
   timestamp_t get_timestamp() const { return cur_->timestamp.load(); }
 
+  // 不改变边的时间戳，并发的读事务仍能看到这条边
   void set_data(const Any& value, timestamp_t ts) {
     ConvertAny<EDATA_T>::to(value, cur_->data);
-    cur_->timestamp.store(ts);
   }
 
   void next() { ++cur_; }
@@ -569,21 +1090,49 @@ class TypedMutableCsrEdgeIter : public MutableCsrEdgeIterBase {
 template <typename EDATA_T>
 class TypedMutableCsrConstEdgeIter : public MutableCsrConstEdgeIterBase {
   using nbr_t = MutableNbr<EDATA_T>;
+  using base_nbr_t = ImmutableNbr<EDATA_T>;
+  using chunks_t = MutableNbrChunks<EDATA_T>;
 
  public:
-  TypedMutableCsrConstEdgeIter() : objs_(), cur_idx_(0), size_(0) {}
+  TypedMutableCsrConstEdgeIter()
+      : objs_(),
+        base_objs_(),
+        cur_idx_(0),
+        base_size_(0),
+        run_end_(0),
+        size_(0) {}
   explicit TypedMutableCsrConstEdgeIter(const MutableNbrSlice<EDATA_T>& slice)
-      : cur_idx_(0), size_(slice.size_) {
+      : cur_idx_(0),
+        base_size_(slice.base_size_),
+        run_end_(slice.base_size_ + slice.run_size_),
+        size_(slice.size()),
+        chunks_(slice.chunks_),
+        chunk_head_(slice.chunk_head_),
+        versions_(slice.versions_),
+        v_(slice.v_) {
+    if (base_size_ != 0) {
+      if (slice.packed_array_ != nullptr) {
+        init_packed(slice.packed_array_->get(slice.base_start_idx_,
+                                             slice.base_bytes_),
+                    slice.base_bytes_);
+      } else {
+        base_objs_ =
+            slice.base_array_->get(slice.base_start_idx_, base_size_);
+      }
+    }
+    if (slice.run_size_ != 0) {
 #ifdef USING_EDGE_ITER
-    auto tmp = slice.get_mmap_array()->get(slice.get_start_idx(), slice.size());
-    objs_ = gbp::BufferBlockIter<nbr_t>(tmp);
+      auto tmp = slice.mmap_array_->get(slice.start_idx_, slice.run_size_);
+      objs_ = gbp::BufferBlockIter<nbr_t>(tmp);
 #else
-    objs_ = slice.mmap_array_->get(slice.start_idx_, size_);
+      objs_ = slice.mmap_array_->get(slice.start_idx_, slice.run_size_);
 #endif
+    }
+    seek_chunk();
   }
   explicit TypedMutableCsrConstEdgeIter(const mmap_array<nbr_t>* ma,
                                         size_t start_idx, size_t size)
-      : cur_idx_(0), size_(size) {
+      : cur_idx_(0), base_size_(0), run_end_(size), size_(size) {
 #ifdef USING_EDGE_ITER
     auto tmp = ma->get(start_idx, size);
     objs_ = gbp::BufferBlockIter<nbr_t>(tmp);
@@ -594,24 +1143,50 @@ class TypedMutableCsrConstEdgeIter : public MutableCsrConstEdgeIterBase {
 
   explicit TypedMutableCsrConstEdgeIter(const gbp::BufferBlock objs,
                                         size_t size)
-      : cur_idx_(0), size_(size) {
+      : cur_idx_(0), base_size_(0), run_end_(size), size_(size) {
 #ifdef USING_EDGE_ITER
     objs_ = gbp::BufferBlockIter<nbr_t>(objs);
 #else
     objs_ = objs;
 #endif
   }
+
+  // base_objs为基础段(ImmutableNbr，base_bytes不为0时为压缩格式)，
+  // objs为增量段中连续区间的size条边，其后的chunk_edge_num条边位于从
+  // chunk_head开始的溢出块中，在遍历到时才读取
+  explicit TypedMutableCsrConstEdgeIter(
+      const gbp::BufferBlock base_objs, size_t base_size, size_t base_bytes,
+      const gbp::BufferBlock objs, size_t size,
+      const chunks_t* chunks = nullptr,
+      u_int32_t chunk_head = chunks_t::kNullChunk, size_t chunk_edge_num = 0)
+      : cur_idx_(0),
+        base_size_(base_size),
+        run_end_(base_size + size),
+        size_(base_size + size + chunk_edge_num),
+        chunks_(chunks),
+        chunk_head_(chunk_head) {
+    if (base_bytes != 0) {
+      init_packed(base_objs, base_bytes);
+    } else {
+      base_objs_ = base_objs;
+    }
+#ifdef USING_EDGE_ITER
+    objs_ = gbp::BufferBlockIter<nbr_t>(objs);
+#else
+    objs_ = objs;
+#endif
+    seek_chunk();
+  }
   ~TypedMutableCsrConstEdgeIter() = default;
 
   FORCE_INLINE vid_t get_neighbor() const {
 #if ASSERT_ENABLE
     assert(is_valid());
 #endif
-#ifdef USING_EDGE_ITER
-    return objs_.current()->neighbor;
-#else
-    return gbp::BufferBlock::Ref<nbr_t>(objs_, cur_idx_).neighbor;
-#endif
+    if (cur_idx_ < base_size_) {
+      return base_nbr().neighbor;
+    }
+    return delta_nbr().neighbor;
   }
 
   FORCE_INLINE const void* get_data() const {
@@ -625,37 +1200,67 @@ class TypedMutableCsrConstEdgeIter : public MutableCsrConstEdgeIterBase {
 // cur_idx_).data),
 //          sizeof(EDATA_T));
 // return ret;
-#ifdef USING_EDGE_ITER
-    return &(objs_.current()->data);
-#else
-    return &(gbp::BufferBlock::Ref<nbr_t>(objs_, cur_idx_).data);
-#endif
+    if (cur_idx_ < base_size_) {
+      return &(base_nbr().data);
+    }
+    return &(delta_nbr().data);
   }
 
   FORCE_INLINE timestamp_t get_timestamp() const {
 #if ASSERT_ENABLE
     assert(is_valid());
 #endif
-#ifdef USING_EDGE_ITER
-    return objs_.current()->timestamp.load();
-#else
-    return gbp::BufferBlock::Ref<nbr_t>(objs_, cur_idx_).timestamp.load();
-#endif
+    if (cur_idx_ < base_size_) {
+      return 0;
+    }
+    return delta_nbr().timestamp.load();
+  }
+
+  // 读时间戳为ts时的边数据，之后被原地修改过时返回修改之前的值
+  FORCE_INLINE const void* get_data(timestamp_t ts) const {
+    const void* data = get_data();
+    if (versions_ != nullptr) {
+      auto* old = versions_->find(edge_version_key(v_, get_neighbor()), ts);
+      if (old != nullptr) {
+        return old->data();
+      }
+    }
+    return data;
+  }
+
+  // 批量读取的邻接表不经过切片，由调用方给出所在csr的旧版本
+  void set_versions(const CellVersions* versions, vid_t v) {
+    versions_ = versions;
+    v_ = v;
   }
 
   FORCE_INLINE void next() {
 #ifdef USING_EDGE_ITER
-    objs_.next();
-    ++cur_idx_;
-#else
-    ++cur_idx_;
+    if (cur_idx_ >= base_size_ && cur_idx_ < run_end_) {
+      objs_.next();
+    }
 #endif
+    ++cur_idx_;
+    if (packed_ && cur_idx_ < base_size_) {
+      cursor_.next();
+    }
+    if (cur_idx_ >= run_end_ && cur_idx_ < size_ &&
+        (cur_idx_ - run_end_) % chunks_t::kChunkSize == 0) {
+      load_chunk(cur_idx_ == run_end_ ? chunk_head_
+                                      : chunks_->next(cur_chunk_));
+    }
   }
   FORCE_INLINE void set_cur(size_t idx) {
     CHECK_LT(idx, size_);
     cur_idx_ = idx;
+    seek_base();
+    seek_chunk();
+  }
+  FORCE_INLINE void recover() {
+    cur_idx_ = 0;
+    seek_base();
+    seek_chunk();
   }
-  FORCE_INLINE void recover() { cur_idx_ = 0; }
   FORCE_INLINE bool is_valid() const {
 #ifdef USING_EDGE_ITER
     return cur_idx_ < size_;
@@ -667,33 +1272,143 @@ class TypedMutableCsrConstEdgeIter : public MutableCsrConstEdgeIterBase {
   FORCE_INLINE size_t size() const { return size_; }
   FORCE_INLINE void free() {
     objs_.free();
+    base_objs_.free();
+    chunk_objs_.free();
+    packed_copy_.reset();
+    packed_ = false;
     cur_idx_ = 0;
+    base_size_ = 0;
+    run_end_ = 0;
     size_ = 0;
   }
 
  private:
+  // 压缩的基础段在遍历时逐条解码，base_objs_持有所在的页
+  void init_packed(const gbp::BufferBlock& packed, size_t bytes) {
+    base_objs_ = packed;
+    packed_ = true;
+    cursor_.init(PackedNbrCodec<EDATA_T>::contiguous(packed, bytes,
+                                                     packed_copy_),
+                 base_size_);
+  }
+
+  void seek_base() {
+    if (packed_ && cur_idx_ < base_size_) {
+      cursor_.seek(cur_idx_);
+    }
+  }
+
+  // 从链表头走到cur_idx_所在的溢出块
+  void seek_chunk() {
+    if (cur_idx_ < run_end_ || cur_idx_ >= size_) {
+      return;
+    }
+    u_int32_t chunk = chunk_head_;
+    for (size_t k = (cur_idx_ - run_end_) / chunks_t::kChunkSize; k != 0;
+         --k) {
+      chunk = chunks_->next(chunk);
+    }
+    load_chunk(chunk);
+  }
+
+  void load_chunk(u_int32_t chunk) {
+    size_t begin = cur_idx_ - (cur_idx_ - run_end_) % chunks_t::kChunkSize;
+    cur_chunk_ = chunk;
+    chunk_objs_ =
+        chunks_->get(chunk, std::min(chunks_t::kChunkSize, size_ - begin));
+  }
+
+  FORCE_INLINE const base_nbr_t& base_nbr() const {
+    return packed_ ? cursor_.cur()
+                   : gbp::BufferBlock::Ref<base_nbr_t>(base_objs_, cur_idx_);
+  }
+
+  FORCE_INLINE const nbr_t& delta_nbr() const {
+    if (cur_idx_ < run_end_) {
+#ifdef USING_EDGE_ITER
+      return *objs_.current();
+#else
+      return gbp::BufferBlock::Ref<nbr_t>(objs_, cur_idx_ - base_size_);
+#endif
+    }
+    return gbp::BufferBlock::Ref<nbr_t>(
+        chunk_objs_, (cur_idx_ - run_end_) % chunks_t::kChunkSize);
+  }
+
 #ifdef USING_EDGE_ITER
   gbp::BufferBlockIter<nbr_t> objs_;
 #else
   gbp::BufferBlock objs_;
 #endif
+  gbp::BufferBlock base_objs_;
+  gbp::BufferBlock chunk_objs_;  // 当前所在的溢出块
+  // 压缩的基础段：跨页时复制到packed_copy_中，cursor_指向cur_idx_
+  bool packed_ = false;
+  std::shared_ptr<std::vector<char>> packed_copy_;
+  typename PackedNbrCodec<EDATA_T>::Cursor cursor_;
   size_t cur_idx_;
+  size_t base_size_;
+  size_t run_end_;  // 增量段连续区间的结束位置
   size_t size_;
+  const chunks_t* chunks_ = nullptr;
+  u_int32_t chunk_head_ = chunks_t::kNullChunk;
+  u_int32_t cur_chunk_ = chunks_t::kNullChunk;
+  const CellVersions* versions_ = nullptr;
+  vid_t v_ = 0;
 };
 
 template <typename EDATA_T>
 class TypedMutableCsrEdgeIter : public MutableCsrEdgeIterBase {
   using nbr_t = MutableNbr<EDATA_T>;
+  using base_nbr_t = ImmutableNbr<EDATA_T>;
+  using chunks_t = MutableNbrChunks<EDATA_T>;
 
  public:
-  TypedMutableCsrEdgeIter() : objs_(), cur_idx_(0), size_(0) {}
+  TypedMutableCsrEdgeIter()
+      : cur_idx_(0),
+        objs_(),
+        base_objs_(),
+        base_size_(0),
+        run_end_(0),
+        size_(0) {}
   explicit TypedMutableCsrEdgeIter(MutableNbrSliceMut<EDATA_T> slice)
-      : cur_idx_(0), size_(slice.size_) {
-    objs_ = slice.mmap_array_->get(slice.start_idx_, size_);
+      : cur_idx_(0),
+        base_size_(slice.base_size_),
+        run_end_(slice.base_size_ + slice.run_size_),
+        size_(slice.size()),
+        chunks_(slice.chunks_),
+        chunk_head_(slice.chunk_head_),
+        versions_(slice.versions_),
+        v_(slice.v_) {
+    if (base_size_ != 0) {
+      if (slice.packed_array_ != nullptr) {
+        packed_array_ = slice.packed_array_;
+        base_objs_ =
+            packed_array_->get(slice.base_start_idx_, slice.base_bytes_);
+        cursor_.init(PackedNbrCodec<EDATA_T>::contiguous(
+                         base_objs_, slice.base_bytes_, packed_copy_),
+                     base_size_);
+        packed_data_idx_ = slice.base_start_idx_ + cursor_.data_offset();
+      } else {
+        base_objs_ =
+            slice.base_array_->get(slice.base_start_idx_, base_size_);
+      }
+    }
+    if (slice.run_size_ != 0) {
+      objs_ = slice.mmap_array_->get(slice.start_idx_, slice.run_size_);
+    }
+    seek_chunk();
   }
   explicit TypedMutableCsrEdgeIter(mmap_array<nbr_t>* ma, size_t start_idx,
-                                   size_t size)
-      : cur_idx_(0), size_(size) {
+                                   size_t size,
+                                   CellVersions* versions = nullptr,
+                                   vid_t v = 0)
+      : cur_idx_(0),
+        base_size_(0),
+        run_end_(size),
+        size_(size),
+        versions_(versions),
+        v_(v) {
     objs_ = ma->get(start_idx, size_);
   }
   ~TypedMutableCsrEdgeIter() = default;
@@ -702,8 +1417,10 @@ class TypedMutableCsrEdgeIter : public MutableCsrEdgeIterBase {
 #if ASSERT_ENABLE
     assert(is_valid());
 #endif
-
-    return gbp::BufferBlock::Ref<nbr_t>(objs_, cur_idx_).neighbor;
+    if (cur_idx_ < base_size_) {
+      return base_nbr().neighbor;
+    }
+    return delta_nbr().neighbor;
   }
 
   FORCE_INLINE const void* get_data() const {
@@ -719,41 +1436,146 @@ class TypedMutableCsrEdgeIter : public MutableCsrEdgeIterBase {
     // cur_idx_).data),
     //          sizeof(EDATA_T));
     // return ret;
-    return &(gbp::BufferBlock::Ref<nbr_t>(objs_, cur_idx_).data);
+    if (cur_idx_ < base_size_) {
+      return &(base_nbr().data);
+    }
+    return &(delta_nbr().data);
   }
 
   FORCE_INLINE timestamp_t get_timestamp() const {
 #if ASSERT_ENABLE
     assert(is_valid());
 #endif
-    return gbp::BufferBlock::Ref<nbr_t>(objs_, cur_idx_).timestamp.load();
+    if (cur_idx_ < base_size_) {
+      return 0;
+    }
+    return delta_nbr().timestamp.load();
   }
 
   FORCE_INLINE void set_data(const Any& value, timestamp_t ts) {
 #if ASSERT_ENABLE
     assert(is_valid());
 #endif
-
-    gbp::BufferBlock::UpdateContent<nbr_t>(
-        [&](nbr_t& item) {
-          ConvertAny<EDATA_T>::to(value, item.data);
-          item.timestamp.store(ts);
-        },
-        objs_, cur_idx_);
+    // 先记下旧值，时间戳早于ts的读者仍读到它
+    if constexpr (PackedNbrCodec<EDATA_T>::kHasData) {
+      if (versions_ != nullptr) {
+        versions_->push(edge_version_key(v_, get_neighbor()), ts, get_data(),
+                        sizeof(EDATA_T));
+      }
+    }
+    if (cur_idx_ < base_size_) {
+      // 基础段的边没有时间戳，原地修改数据
+      if (packed_array_ != nullptr) {
+        if constexpr (PackedNbrCodec<EDATA_T>::kHasData) {
+          EDATA_T data_new;
+          ConvertAny<EDATA_T>::to(value, data_new);
+          size_t offset = cur_idx_ * sizeof(EDATA_T);
+          auto data_item = packed_array_->get(packed_data_idx_ + offset,
+                                              sizeof(EDATA_T));
+          gbp::BufferBlock::UpdateContent<EDATA_T>(
+              [&](EDATA_T& data) { data = data_new; }, data_item);
+          // 跨页的邻接表读的是副本，同步修改
+          if (packed_copy_ != nullptr) {
+            memcpy(packed_copy_->data() + cursor_.data_offset() + offset,
+                   &data_new, sizeof(EDATA_T));
+          }
+          cursor_.set_data(data_new);
+        }
+      } else {
+        gbp::BufferBlock::UpdateContent<base_nbr_t>(
+            [&](base_nbr_t& item) {
+              ConvertAny<EDATA_T>::to(value, item.data);
+            },
+            base_objs_, cur_idx_);
+      }
+      return;
+    }
+    // 与基础段相同，只修改数据而不改变时间戳，否则并发的读事务会暂时看不到
+    // 这条边；旧的读事务从versions_中读到旧值
+    auto update = [&](nbr_t& item) {
+      ConvertAny<EDATA_T>::to(value, item.data);
+    };
+    if (cur_idx_ < run_end_) {
+      gbp::BufferBlock::UpdateContent<nbr_t>(update, objs_,
+                                             cur_idx_ - base_size_);
+    } else {
+      gbp::BufferBlock::UpdateContent<nbr_t>(
+          update, chunk_objs_, (cur_idx_ - run_end_) % chunks_t::kChunkSize);
+    }
   }
 
-  FORCE_INLINE void next() { ++cur_idx_; }
+  FORCE_INLINE void next() {
+    ++cur_idx_;
+    if (packed_array_ != nullptr && cur_idx_ < base_size_) {
+      cursor_.next();
+    }
+    if (cur_idx_ >= run_end_ && cur_idx_ < size_ &&
+        (cur_idx_ - run_end_) % chunks_t::kChunkSize == 0) {
+      load_chunk(cur_idx_ == run_end_ ? chunk_head_
+                                      : chunks_->next(cur_chunk_));
+    }
+  }
   FORCE_INLINE void set_cur(size_t idx) {
     CHECK_LT(idx, size_);
     cur_idx_ = idx;
+    if (packed_array_ != nullptr && cur_idx_ < base_size_) {
+      cursor_.seek(cur_idx_);
+    }
+    seek_chunk();
   }
   FORCE_INLINE bool is_valid() const { return cur_idx_ < size_; }
   FORCE_INLINE size_t size() const { return size_; }
 
  private:
+  void seek_chunk() {
+    if (cur_idx_ < run_end_ || cur_idx_ >= size_) {
+      return;
+    }
+    u_int32_t chunk = chunk_head_;
+    for (size_t k = (cur_idx_ - run_end_) / chunks_t::kChunkSize; k != 0;
+         --k) {
+      chunk = chunks_->next(chunk);
+    }
+    load_chunk(chunk);
+  }
+
+  void load_chunk(u_int32_t chunk) {
+    size_t begin = cur_idx_ - (cur_idx_ - run_end_) % chunks_t::kChunkSize;
+    cur_chunk_ = chunk;
+    chunk_objs_ =
+        chunks_->get_mut(chunk, std::min(chunks_t::kChunkSize, size_ - begin));
+  }
+
+  FORCE_INLINE const base_nbr_t& base_nbr() const {
+    return packed_array_ != nullptr
+               ? cursor_.cur()
+               : gbp::BufferBlock::Ref<base_nbr_t>(base_objs_, cur_idx_);
+  }
+
+  FORCE_INLINE const nbr_t& delta_nbr() const {
+    if (cur_idx_ < run_end_) {
+      return gbp::BufferBlock::Ref<nbr_t>(objs_, cur_idx_ - base_size_);
+    }
+    return gbp::BufferBlock::Ref<nbr_t>(
+        chunk_objs_, (cur_idx_ - run_end_) % chunks_t::kChunkSize);
+  }
+
   size_t cur_idx_;
   gbp::BufferBlock objs_;
+  gbp::BufferBlock base_objs_;
+  gbp::BufferBlock chunk_objs_;
+  std::shared_ptr<std::vector<char>> packed_copy_;
+  typename PackedNbrCodec<EDATA_T>::Cursor cursor_;
+  mmap_array<char>* packed_array_ = nullptr;
+  size_t packed_data_idx_ = 0;  // 压缩的基础段中EDATA_T[]的字节偏移
+  size_t base_size_;
+  size_t run_end_;
   size_t size_;
+  chunks_t* chunks_ = nullptr;
+  u_int32_t chunk_head_ = chunks_t::kNullChunk;
+  u_int32_t cur_chunk_ = chunks_t::kNullChunk;
+  CellVersions* versions_ = nullptr;
+  vid_t v_ = 0;
 };
 #endif
 
@@ -765,6 +1587,11 @@ class TypedMutableCsrBase : public MutableCsrBase {
                               timestamp_t ts = 0) = 0;
 
   virtual const slice_t get_edges(vid_t i) const = 0;
+#if !OV
+  virtual const MutableNbrChunks<EDATA_T>* get_chunks() const {
+    return nullptr;
+  }
+#endif
 };
 
 // FIXME: 目前是不支持EDATA_T是string的
@@ -772,9 +1599,31 @@ template <typename EDATA_T>
 class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
  public:
   using nbr_t = MutableNbr<EDATA_T>;
+  using base_nbr_t = ImmutableNbr<EDATA_T>;
   using adjlist_t = MutableAdjlist<EDATA_T>;
   using slice_t = MutableNbrSlice<EDATA_T>;
   using mut_slice_t = MutableNbrSliceMut<EDATA_T>;
+#if !OV
+  using chunks_t = MutableNbrChunks<EDATA_T>;
+  using base_range_t = MutableBaseRange;
+  using delta_range_t = MutableDeltaRange;
+  static constexpr u_int32_t kCompactChunkNum = 4;
+  static constexpr size_t kSizeClassNum = 64;
+  static constexpr size_t kMinRegionSize = 8;
+  // nbr_list_第一个段的边数，之后的段依次翻倍
+  static constexpr size_t kNbrSegmentSize = 1 << 16;
+  static constexpr timestamp_t kUnsealedTs =
+      std::numeric_limits<timestamp_t>::max();
+
+  // 搬迁后等待回收的连续区间和溢出块链，ts_为退休时间戳
+  struct retired_delta_t {
+    size_t start_idx_;
+    size_t capacity_;
+    u_int32_t chunk_head_;
+    size_t chunk_num_;
+    timestamp_t ts_;
+  };
+#endif
 
   MutableCsr() : locks_(nullptr) {}
   ~MutableCsr() {
@@ -795,9 +1644,9 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
     for (auto d : degree) {
       edge_num += d;
     }
+#if OV
     nbr_list_.open(work_dir + "/" + name + ".nbr", false);
     nbr_list_.resize(edge_num);
-#if OV
     nbr_t* ptr = nbr_list_.data();
     for (vid_t i = 0; i < vnum; ++i) {
       int deg = degree[i];
@@ -805,6 +1654,15 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
       ptr += deg;
     }
 #else
+    // 所有邻接表都放在第一个段中
+    nbr_list_.open(work_dir + "/" + name + ".nbr",
+                   std::max(edge_num, kNbrSegmentSize));
+    nbr_list_.ensure(0);
+    size_ = edge_num;
+    base_order_ = EdgeSortOrder::kNone;
+    base_vnum_ = 0;
+    clear_free_regions();
+    chunks_.open(work_dir + "/" + name);
     // FIXME: 此处的实现未经验证，需要检查其实现正确性
     gbp::BufferBlock items_tmp;
     size_t offset = 0;
@@ -842,21 +1700,50 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
     }
   }
 #else
+  /**
+   * @brief 快照中的边(.base)作为冻结的基础段打开，不带时间戳；open之后插入的
+   * 边写入带时间戳的增量段(.nbr)。快照格式由.fmt决定，旧格式的快照只有.nbr，
+   * 在open时转换。
+   */
   void open(const std::string& name, const std::string& snapshot_dir,
             const std::string& work_dir) override {
     mmap_array<int> degree_list;
     degree_list.open(snapshot_dir + "/" + name + ".deg", true);
 
-    nbr_list_.open(snapshot_dir + "/" + name + ".nbr", true);
-    size_ = nbr_list_.size();
-    nbr_list_.touch(work_dir + "/" + name + ".nbr");
-    nbr_list_.resize(nbr_list_.size() * 5.5);  // 原子操作
-    // nbr_list_.resize(nbr_list_.size() * 1);
-    capacity_ = nbr_list_.size();
+    mmap_array<size_t> base_offsets;
+    auto format = get_csr_format_version(snapshot_dir, name);
+    packed_ = false;
+    switch (format) {
+    case CsrFormatVersion::kLegacyNbr:
+      freeze_nbr_list(snapshot_dir + "/" + name + ".nbr",
+                      work_dir + "/" + name + ".base");
+      break;
+    case CsrFormatVersion::kBase:
+      base_list_.open(snapshot_dir + "/" + name + ".base", true);
+      base_list_.touch(work_dir + "/" + name + ".base");
+      break;
+    case CsrFormatVersion::kPackedBase:
+      packed_ = true;
+      packed_list_.open(snapshot_dir + "/" + name + ".base", true);
+      packed_list_.touch(work_dir + "/" + name + ".base");
+      base_offsets_file_ = snapshot_dir + "/" + name + ".boff";
+      base_offsets.open(base_offsets_file_, true);
+      CHECK_EQ(base_offsets.size(), degree_list.size() + 1);
+      break;
+    default:
+      LOG(FATAL) << "Unsupported csr format "
+                 << static_cast<uint32_t>(format) << " of " << name;
+    }
+    // 压缩格式总是按neighbor排列
+    base_order_ = packed_ ? EdgeSortOrder::kByNeighbor
+                          : get_csr_sort_order(snapshot_dir, name);
+    base_vnum_ = degree_list.size();
 
     adj_lists_.open(work_dir + "/" + name + ".adj", false);
+    base_ranges_.open(work_dir + "/" + name + ".brg", false);
 
     adj_lists_.resize(degree_list.size());
+    base_ranges_.resize(degree_list.size());
     locks_ = new grape::SpinLock[degree_list.size()];
 
     size_t step_size = 1024;
@@ -867,52 +1754,347 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
           std::min(step_size, degree_list.size() - step_id * step_size);
       auto degree_list_batch = degree_list.get(step_id * step_size, block_size);
       auto items_tmp = adj_lists_.get(step_id * step_size, block_size);
+      auto ranges_tmp = base_ranges_.get(step_id * step_size, block_size);
+      gbp::BufferBlock offsets_batch;
+      if (packed_) {
+        offsets_batch = base_offsets.get(step_id * step_size, block_size + 1);
+      }
       for (size_t i = 0; i < block_size; i++) {
         int degree = gbp::BufferBlock::Ref<int>(degree_list_batch, i);
         gbp::BufferBlock::UpdateContent<adjlist_t>(
-            [&](adjlist_t& item) { item.init(offset, degree, degree); },
-            items_tmp, i);
+            [&](adjlist_t& item) { item.init(0, 0, 0); }, items_tmp, i);
+        gbp::BufferBlock::UpdateContent<base_range_t>(
+            [&](base_range_t& item) {
+              item.size_ = degree;
+              if (packed_) {
+                size_t begin = gbp::BufferBlock::Ref<size_t>(offsets_batch, i);
+                size_t end =
+                    gbp::BufferBlock::Ref<size_t>(offsets_batch, i + 1);
+                item.start_idx_ = begin;
+                item.bytes_ = degree == 0 ? 0 : end - begin;
+              } else {
+                item.start_idx_ = offset;
+                item.bytes_ = 0;
+              }
+            },
+            ranges_tmp, i);
         offset += degree;
       }
     }
+    if (!packed_) {
+      CHECK_LE(offset, base_list_.size());
+    }
+
+    // 增量段不再预留空间：新插入的边写入溢出块，nbr_list_只在compact时按需
+    // 打开新的段
+    nbr_list_.open(work_dir + "/" + name + ".nbr", kNbrSegmentSize);
+    size_ = 0;
+    clear_free_regions();
+    chunks_.open(work_dir + "/" + name);
+
+    // checkpoint写出的快照中，基础段之外的边记录在.dlt中
+    std::string delta_path = snapshot_dir + "/" + name + ".dlt";
+    if (std::filesystem::exists(delta_path)) {
+      load_delta_edges(delta_path);
+    }
   }
 
-  void copy_before_insert(vid_t v) override {
-    CHECK_LT(v, adj_lists_.size());
-    locks_[v].lock();
-    auto adj_list_item = adj_lists_.get(v);
-    auto& adj_list = gbp::BufferBlock::Ref<adjlist_t>(adj_list_item);
+  /**
+   * @brief .dlt的格式为顶点数、边数，之后是按邻接表顺序排列的
+   * (src, neighbor, timestamp, data)。
+   */
+  struct delta_edge_t {
+    vid_t src;
+    vid_t neighbor;
+    timestamp_t timestamp;
+    EDATA_T data;
+  };
+  // 读写.dlt时每次处理的边数
+  static constexpr size_t kDeltaChunkSize = 4096;
+
+  void load_delta_edges(const std::string& delta_path) {
+    FILE* fin = fopen(delta_path.c_str(), "rb");
+    CHECK(fin != nullptr) << "Failed to open " << delta_path;
+    size_t header[2];
+    CHECK_EQ(fread(header, sizeof(size_t), 2, fin), 2);
+    resize(header[0]);
+    std::vector<delta_edge_t> edges(kDeltaChunkSize);
+    for (size_t left = header[1]; left != 0;) {
+      size_t num = std::min(left, edges.size());
+      CHECK_EQ(fread(edges.data(), sizeof(delta_edge_t), num, fin), num);
+      for (size_t k = 0; k < num; ++k) {
+        put_edge(edges[k].src, edges[k].neighbor, edges[k].data,
+                 edges[k].timestamp);
+      }
+      left -= num;
+    }
+    fclose(fin);
+  }
+
+  // 将旧格式快照中带时间戳的边转换为基础段
+  void freeze_nbr_list(const std::string& nbr_path,
+                       const std::string& base_path) {
+    mmap_array<nbr_t> nbr_list_old;
+    nbr_list_old.open(nbr_path, true);
+    base_list_.open(base_path, false);
+    base_list_.resize(nbr_list_old.size());
+
+    size_t step_size = nbr_list_old.OBJ_NUM_PERPAGE;
+    for (size_t idx = 0; idx < nbr_list_old.size(); idx += step_size) {
+      size_t block_size = std::min(step_size, nbr_list_old.size() - idx);
+      auto nbrs_old = nbr_list_old.get(idx, block_size);
+      auto nbrs_new = base_list_.get(idx, block_size);
+      for (size_t i = 0; i < block_size; i++) {
+        gbp::BufferBlock::UpdateContent<base_nbr_t>(
+            [&](base_nbr_t& item) {
+              auto& item_old = gbp::BufferBlock::Ref<nbr_t>(nbrs_old, i);
+              item.neighbor = item_old.neighbor;
+              item.data = item_old.data;
+            },
+            nbrs_new, i);
+      }
+    }
+  }
+
+  /**
+   * @brief 将溢出块数达到kCompactChunkNum的邻接表复制到新的连续区间。新区间
+   * 预留一半的空间，之后插入的边先写入预留的空间，因此每条边被复制的次数是
+   * 均摊O(1)的。
+   *
+   * 复制和发布在locks_[v]下进行，与同一个邻接表上的插入和freeze互斥；新位置
+   * 通过MutableAdjlist::publish发布，并发的读者用load读出旧的或新的位置，
+   * 两者都包含读者能看到的全部边。原地修改边数据经由edge_iter_mut，同样持有
+   * locks_[v]。
+   *
+   * 旧区间和溢出块在下一次调用时标记为read_ts退休，等所有活跃读事务的时间戳
+   * 都大于退休时间戳(min_ts > ts)之后才回收：看到旧位置的读者在发布之前开始，
+   * 时间戳不超过发布时的read_ts。没有新的写事务推进read_ts时，已退休的空间
+   * 暂不回收。
+   */
+  size_t compact(timestamp_t read_ts, timestamp_t min_ts) override {
+    reclaim_retired(read_ts, min_ts);
+    std::vector<vid_t> vids;
+    {
+      std::lock_guard<grape::SpinLock> lock(compact_lock_);
+      vids.swap(compact_candidates_);
+    }
+    std::sort(vids.begin(), vids.end());
+    vids.erase(std::unique(vids.begin(), vids.end()), vids.end());
+
+    size_t compacted = 0;
+    for (auto v : vids) {
+      locks_[v].lock();
+      auto adj_list_item = adj_lists_.get(v);
+      auto& adj_list = gbp::BufferBlock::Ref<adjlist_t>(adj_list_item);
+      delta_range_t delta;
+      adj_list.load(delta);
+      size_t chunk_num = adj_list.chunk_num(delta.size_);
+      if (chunk_num == 0) {
+        locks_[v].unlock();
+        continue;
+      }
+      size_t capacity_new = delta.size_ + (delta.size_ >> 1);
+      size_t start_idx_new = allocate_nbrs(capacity_new, capacity_new);
+      auto nbr_slice_new = nbr_list_.get(start_idx_new, delta.size_);
+      size_t k = 0;
+      foreach_delta_edge(delta, [&](const nbr_t& item_old) {
+        gbp::BufferBlock::UpdateContent<nbr_t>(
+            [&](nbr_t& item) {
+              item.neighbor = item_old.neighbor;
+              item.data = item_old.data;
+              item.timestamp.store(item_old.timestamp.load());
+            },
+            nbr_slice_new, k++);
+      });
+      gbp::BufferBlock::UpdateContent<adjlist_t>(
+          [&](adjlist_t& item) { item.publish(start_idx_new, capacity_new); },
+          adj_list_item);
+      locks_[v].unlock();
 
-    auto capacity_new = adj_list.capacity_;
-    size_t start_idx_new;
-    capacity_new += ((capacity_new) >> 1);
-    capacity_new = capacity_new > 8 ? capacity_new : 8;
+      retire_delta(delta.start_idx_, delta.capacity_, delta.chunk_head_,
+                   chunk_num);
+      ++compacted;
+    }
+    return compacted;
+  }
 
-    bool success = false;
-    std::tie<bool, size_t>(success, start_idx_new) =
-        gbp::atomic_add<size_t>(size_, capacity_new, nbr_list_.size());
-    assert(success);
+  // 有待搬迁的邻接表或者还没有回收的退休空间
+  bool need_compact() const override {
+    {
+      std::lock_guard<grape::SpinLock> lock(compact_lock_);
+      if (!compact_candidates_.empty()) {
+        return true;
+      }
+    }
+    std::lock_guard<std::mutex> lock(nbr_list_lock_);
+    return !retired_.empty();
+  }
+
+  /**
+   * @brief 增量段中所有边的时间戳都不超过ts的邻接表，把这些边的时间戳改为0
+   * 并清零max_ts_。ts不能超过活跃读事务的最小读时间戳，这样任何读者都能看到
+   * 这些边，改写时间戳不改变可见性，可以与读事务并发；与同一个邻接表上的插入
+   * 由locks_互斥。
+   */
+  size_t freeze(timestamp_t ts) override {
+    std::vector<vid_t> vids;
+    {
+      std::lock_guard<grape::SpinLock> lock(freeze_lock_);
+      vids.swap(freeze_candidates_);
+    }
+    std::sort(vids.begin(), vids.end());
+    vids.erase(std::unique(vids.begin(), vids.end()), vids.end());
+
+    std::vector<vid_t> pending;
+    size_t frozen = 0;
+    for (auto v : vids) {
+      if (v >= adj_lists_.size()) {
+        continue;
+      }
+      locks_[v].lock();
+      auto adj_list_item = adj_lists_.get(v);
+      auto& adj_list = gbp::BufferBlock::Ref<adjlist_t>(adj_list_item);
+      timestamp_t max_ts = adj_list.max_ts_.load();
+      if (max_ts == 0) {
+        locks_[v].unlock();
+        continue;
+      }
+      if (max_ts > ts) {
+        locks_[v].unlock();
+        pending.push_back(v);
+        continue;
+      }
+      size_t size = adj_list.size_.load();
+      size_t run_size = adj_list.run_size(size);
+      if (run_size != 0) {
+        auto nbrs = nbr_list_.get(adj_list.start_idx_, run_size);
+        for (size_t k = 0; k < run_size; ++k) {
+          gbp::BufferBlock::UpdateContent<nbr_t>(
+              [&](nbr_t& item) { item.timestamp.store(0); }, nbrs, k);
+        }
+      }
+      u_int32_t chunk = adj_list.chunk_head_;
+      for (size_t begin = run_size; begin < size;
+           begin += chunks_t::kChunkSize) {
+        size_t len = std::min(chunks_t::kChunkSize, size - begin);
+        auto nbrs = chunks_.get_mut(chunk, len);
+        for (size_t k = 0; k < len; ++k) {
+          gbp::BufferBlock::UpdateContent<nbr_t>(
+              [&](nbr_t& item) { item.timestamp.store(0); }, nbrs, k);
+        }
+        chunk = chunks_.next(chunk);
+      }
+      gbp::BufferBlock::UpdateContent<adjlist_t>(
+          [&](adjlist_t& item) { item.max_ts_.store(0); }, adj_list_item);
+      locks_[v].unlock();
+      ++frozen;
+    }
 
-    // 复制数据到新的位置
-    auto nbr_slice_old = nbr_list_.get(adj_list.start_idx_, adj_list.size_);
-    auto nbr_slice_new = nbr_list_.get(start_idx_new, adj_list.size_);
-    for (size_t i = 0; i < adj_list.size_; i++)
-      gbp::BufferBlock::UpdateContent<nbr_t>(
-          [&](nbr_t& item) {
-            auto& item_old = gbp::BufferBlock::Ref<nbr_t>(nbr_slice_old, i);
-            item.data = item_old.data;
-            item.neighbor = item_old.neighbor;
-            item.timestamp = item_old.timestamp.load();
-          },
-          nbr_slice_new, i);
+    if (!pending.empty()) {
+      std::lock_guard<grape::SpinLock> lock(freeze_lock_);
+      freeze_candidates_.insert(freeze_candidates_.end(), pending.begin(),
+                                pending.end());
+    }
+    return frozen;
+  }
+
+  /**
+   * @brief 分配至少num条边的连续空间，capacity返回实际的容量。优先复用
+   * 空闲区间：从能容纳num的最小级别中取一个区间，剩余部分足够大时拆分放回；
+   * 没有合适的空闲区间时在nbr_list_尾部分配。区间不跨段，当前段的剩余部分
+   * 放不下时放回空闲区间，从能放下的下一个段开始分配。
+   */
+  size_t allocate_nbrs(size_t num, size_t& capacity) {
+    std::lock_guard<std::mutex> lock(nbr_list_lock_);
+    for (size_t k = ceil_size_class(num); k < kSizeClassNum; ++k) {
+      auto& regions = free_regions_[k];
+      if (regions.empty()) {
+        continue;
+      }
+      auto region = regions.back();
+      regions.pop_back();
+      if (region.second - num >= std::max(num, kMinRegionSize)) {
+        push_free_region(region.first + num, region.second - num);
+        region.second = num;
+      }
+      capacity = region.second;
+      return region.first;
+    }
+    size_t tail = size_.load();
+    size_t start_idx = nbr_list_.fit(tail, num);
+    if (start_idx != tail && nbr_list_.contains(tail)) {
+      push_free_region(tail, nbr_list_.segment_end(tail) - tail);
+    }
+    nbr_list_.ensure(start_idx);
+    size_.store(start_idx + num);
+    capacity = num;
+    return start_idx;
+  }
 
-    gbp::BufferBlock::UpdateContent<adjlist_t>(
-        [&](adjlist_t& item) {
-          item.capacity_ = capacity_new;
-          item.start_idx_ = start_idx_new;
-        },
-        adj_list_item);
-    locks_[v].unlock();
+  // 搬迁后废弃的增量段，并发的读者可能还在读，先挂起
+  void retire_delta(size_t start_idx, size_t capacity, u_int32_t chunk_head,
+                    size_t chunk_num) {
+    if (capacity == 0 && chunk_num == 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(nbr_list_lock_);
+    retired_.push_back(
+        {start_idx, capacity, chunk_head, chunk_num, kUnsealedTs});
+  }
+
+  /**
+   * @brief 给上一次compact以来退休的空间标记退休时间戳read_ts，回收退休
+   * 时间戳小于min_ts的空间。溢出块在释放之前链表不变，可以在锁外遍历。
+   */
+  void reclaim_retired(timestamp_t read_ts, timestamp_t min_ts) {
+    std::vector<retired_delta_t> reclaimed;
+    {
+      std::lock_guard<std::mutex> lock(nbr_list_lock_);
+      size_t kept = 0;
+      for (auto& item : retired_) {
+        if (item.ts_ == kUnsealedTs) {
+          item.ts_ = read_ts;
+        }
+        if (item.ts_ < min_ts) {
+          if (item.capacity_ != 0) {
+            push_free_region(item.start_idx_, item.capacity_);
+          }
+          reclaimed.push_back(item);
+        } else {
+          retired_[kept++] = item;
+        }
+      }
+      retired_.resize(kept);
+    }
+    for (auto& item : reclaimed) {
+      u_int32_t chunk = item.chunk_head_;
+      for (size_t i = 0; i < item.chunk_num_; ++i) {
+        u_int32_t next = chunks_.next(chunk);
+        chunks_.release(chunk);
+        chunk = next;
+      }
+    }
+  }
+
+  // 容量在[2^k, 2^(k+1))之间的区间属于第k级
+  static size_t floor_size_class(size_t capacity) {
+    return 63 - __builtin_clzll(capacity);
+  }
+  // 第k级及以上的区间都能容纳num条边
+  static size_t ceil_size_class(size_t num) {
+    return num <= 1 ? 0 : floor_size_class(num - 1) + 1;
+  }
+
+  void clear_free_regions() {
+    for (auto& regions : free_regions_) {
+      regions.clear();
+    }
+    retired_.clear();
+  }
+
+  void push_free_region(size_t start_idx, size_t capacity) {
+    free_regions_[floor_size_class(capacity)].emplace_back(start_idx,
+                                                           capacity);
   }
 #endif
 
@@ -955,62 +2137,517 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
   }
 
 #else
+  /**
+   * @brief 基础段和增量段合并写入新快照的.base，丢弃时间戳：dump
+   * 持有独占的时间戳，此时所有已提交的边对之后的事务都可见。
+   * compress_nbr_list_on_dump()为true时以压缩格式写出，压缩格式要求按
+   * neighbor排列，因此按数据排序的邻接表不压缩。
+   */
   void dump(const std::string& name,
             const std::string& new_spanshot_dir) override {
     size_t vnum = adj_lists_.size();
-    bool reuse_nbr_list = true;
-    mmap_array<int> degree_list;
-    degree_list.open(new_spanshot_dir + "/" + name + ".deg", false);
-    degree_list.resize(vnum);
+    EdgeSortOrder order = effective_sort_order();
+    bool packed = PackedNbrCodec<EDATA_T>::kPackable &&
+                  compress_nbr_list_on_dump() &&
+                  order != EdgeSortOrder::kByData;
+    bool reuse_base_list = (packed == packed_) &&
+                           (order == EdgeSortOrder::kNone ||
+                            order == base_order_);
+    // .deg和.base都是新文件，直接按页布局顺序写出，不经过缓冲池
+    paged_file_writer<int> degree_list(new_spanshot_dir + "/" + name +
+                                       ".deg");
 
     size_t offset = 0;
     int size_tmp;
     gbp::BufferBlock adjlists_tmp = adj_lists_.get(0, adj_lists_.size());
+    gbp::BufferBlock ranges_tmp;
+    if (base_vnum_ != 0) {
+      ranges_tmp = base_ranges_.get(0, base_vnum_);
+    }
     for (size_t i = 0; i < vnum; ++i) {
       auto& item_tmp = gbp::BufferBlock::Ref<adjlist_t>(adjlists_tmp, i);
+      auto base = base_range_at(ranges_tmp, i);
 
       if (item_tmp.size_ != 0) {
-        if (!(item_tmp.start_idx_ == offset && offset < nbr_list_.size())) {
-          reuse_nbr_list = false;
-        }
+        reuse_base_list = false;
+      }
+      if (!packed_ && base.size_ != 0 && base.start_idx_ != offset) {
+        reuse_base_list = false;
       }
-      size_tmp = item_tmp.size_.load();
-      degree_list.set(i, &size_tmp);
-      offset += item_tmp.size_;
+      size_tmp = base.size_ + item_tmp.size_.load();
+      degree_list.append(size_tmp);
+      offset += size_tmp;
+    }
+    degree_list.close();
+    // 压缩格式的.boff按顶点数存放
+    if (packed_ && vnum != base_vnum_) {
+      reuse_base_list = false;
     }
 
-    if (reuse_nbr_list && !nbr_list_.filename().empty() &&
-        std::filesystem::exists(nbr_list_.filename())) {
-      std::filesystem::create_hard_link(nbr_list_.filename(),
-                                        new_spanshot_dir + "/" + name + ".nbr");
+    const std::string& base_file =
+        packed_ ? packed_list_.filename() : base_list_.filename();
+    if (reuse_base_list && !base_file.empty() &&
+        std::filesystem::exists(base_file)) {
+      std::filesystem::create_hard_link(
+          base_file, new_spanshot_dir + "/" + name + ".base");
+      if (packed_) {
+        std::filesystem::create_hard_link(
+            base_offsets_file_, new_spanshot_dir + "/" + name + ".boff");
+      }
+      order = base_order_;
+    } else if (packed) {
+      dump_packed(name, new_spanshot_dir, adjlists_tmp, ranges_tmp, vnum);
+      order = EdgeSortOrder::kByNeighbor;
     } else {
-      // FILE* fout =
-      //     fopen((new_spanshot_dir + "/" + name + ".nbr").c_str(), "wb");
-      mmap_array<nbr_t> fout;
-      fout.open(new_spanshot_dir + "/" + name + ".nbr", false);
-      offset = 0;
-      size_t size_old = 0;
+      paged_file_writer<base_nbr_t> fout(new_spanshot_dir + "/" + name +
+                                         ".base");
+      std::vector<base_nbr_t> nbrs;
       for (size_t i = 0; i < vnum; ++i) {
-        auto& item_tmp = gbp::BufferBlock::Ref<adjlist_t>(adjlists_tmp, i);
+        collect_edges(base_range_at(ranges_tmp, i),
+                      gbp::BufferBlock::Ref<adjlist_t>(adjlists_tmp, i), nbrs);
+        if (nbrs.empty()) {
+          continue;
+        }
+        sort_nbrs(nbrs, order);
+        fout.append(nbrs.data(), nbrs.size());
+      }
+      CHECK_EQ(fout.size(), offset);
+      fout.close();
+    }
+    set_csr_format_version(new_spanshot_dir, name,
+                           packed ? CsrFormatVersion::kPackedBase
+                                  : CsrFormatVersion::kBase,
+                           order);
+  }
+
+  /**
+   * @brief 增量checkpoint：基础段的布局不变，只写出上次checkpoint以来被
+   * 修改的页，.deg/.boff记录基础段；增量段分块写入.dlt，open时重新插入。
+   * 每个文件都在关闭前fdatasync。完整的合并仍由dump完成。
+   */
+  void checkpoint(const std::string& name, const std::string& new_snapshot_dir,
+                  timestamp_t ts) override {
+    std::string prefix = new_snapshot_dir + "/" + name;
+    if (packed_) {
+      packed_list_.checkpoint(prefix + ".base");
+    } else {
+      base_list_.checkpoint(prefix + ".base");
+    }
 
-        auto nbrs_old = nbr_list_.get(item_tmp.start_idx_, item_tmp.size_);
-        auto nbrs_new = fout.get(offset, item_tmp.size_);
+    // .dlt边扫描边分块写出，不在内存中收集全部增量边；边数在最后回填
+    std::string delta_path = prefix + ".dlt";
+    FILE* delta_out = open_snapshot_file(delta_path);
+    size_t vnum = adj_lists_.size();
+    size_t header[2] = {vnum, 0};
+    write_snapshot_file(delta_out, header, sizeof(size_t), 2, delta_path);
+    std::vector<delta_edge_t> edges;
+    edges.reserve(kDeltaChunkSize);
+    auto flush_edges = [&]() {
+      write_snapshot_file(delta_out, edges.data(), sizeof(delta_edge_t),
+                          edges.size(), delta_path);
+      header[1] += edges.size();
+      edges.clear();
+    };
+
+    std::vector<int> degrees(vnum, 0);
+    size_t step_size = adj_lists_.OBJ_NUM_PERPAGE;
+    for (size_t begin = 0; begin < vnum; begin += step_size) {
+      size_t block_size = std::min(step_size, vnum - begin);
+      auto adjlists_tmp = adj_lists_.get(begin, block_size);
+      gbp::BufferBlock ranges_tmp;
+      if (begin < base_vnum_) {
+        ranges_tmp = base_ranges_.get(
+            begin, std::min(block_size, base_vnum_ - begin));
+      }
+      for (size_t i = 0; i < block_size; ++i) {
+        delta_range_t delta;
+        gbp::BufferBlock::Ref<adjlist_t>(adjlists_tmp, i).load(delta);
+        if (begin + i < base_vnum_) {
+          degrees[begin + i] =
+              gbp::BufferBlock::Ref<base_range_t>(ranges_tmp, i).size_;
+        }
+        vid_t src = begin + i;
+        foreach_delta_edge(delta, [&](const nbr_t& nbr) {
+          timestamp_t nbr_ts = nbr.timestamp.load();
+          if (nbr_ts <= ts) {
+            edges.push_back({src, nbr.neighbor, nbr_ts, nbr.data});
+            if (edges.size() == kDeltaChunkSize) {
+              flush_edges();
+            }
+          }
+        });
+      }
+    }
+    flush_edges();
+    CHECK_EQ(::fseek(delta_out, 0, SEEK_SET), 0)
+        << "Failed to seek " << delta_path;
+    write_snapshot_file(delta_out, header, sizeof(size_t), 2, delta_path);
+    close_snapshot_file(delta_out, delta_path);
+
+    std::string deg_path = prefix + ".deg";
+    FILE* fout = open_snapshot_file(deg_path);
+    write_snapshot_file(fout, degrees.data(), sizeof(int), vnum, deg_path);
+    close_snapshot_file(fout, deg_path);
+
+    if (packed_) {
+      // 新增的顶点没有基础段，沿用最后一个偏移
+      mmap_array<size_t> base_offsets;
+      base_offsets.open(base_offsets_file_, true);
+      std::vector<size_t> offsets(vnum + 1);
+      base_offsets.get(0, base_vnum_ + 1)
+          .Copy(offsets.data(), (base_vnum_ + 1) * sizeof(size_t));
+      std::fill(offsets.begin() + base_vnum_ + 1, offsets.end(),
+                offsets[base_vnum_]);
+      std::string boff_path = prefix + ".boff";
+      fout = open_snapshot_file(boff_path);
+      write_snapshot_file(fout, offsets.data(), sizeof(size_t),
+                          offsets.size(), boff_path);
+      close_snapshot_file(fout, boff_path);
+      base_offsets_file_ = boff_path;
+    }
 
-        size_old = item_tmp.size_.load();
-        for (size_t i = 0; i < size_old; i++)
-          gbp::BufferBlock::UpdateContent<nbr_t>(
-              [&](nbr_t& item) {
-                auto& item_old = gbp::BufferBlock::Ref<nbr_t>(nbrs_old, i);
-                item.neighbor = item_old.neighbor;
-                item.data = item_old.data;
-                item.timestamp = item_old.timestamp.load();
-              },
-              nbrs_new, i);
-        offset += item_tmp.size_;
+    set_csr_format_version(new_snapshot_dir, name,
+                           packed_ ? CsrFormatVersion::kPackedBase
+                                   : CsrFormatVersion::kBase,
+                           base_order_);
+  }
+
+  void set_sort_order(EdgeSortOrder order) override { sort_order_ = order; }
+
+  // 没有边数据时按数据排序没有意义
+  EdgeSortOrder effective_sort_order() const {
+    if (sort_order_ == EdgeSortOrder::kByData &&
+        std::is_same<EDATA_T, grape::EmptyType>::value) {
+      return EdgeSortOrder::kNone;
+    }
+    return sort_order_;
+  }
+
+  static bool neighbor_less(const base_nbr_t& lhs, const base_nbr_t& rhs) {
+    return lhs.neighbor < rhs.neighbor;
+  }
+
+  static bool data_less(const base_nbr_t& lhs, const base_nbr_t& rhs) {
+    if constexpr (std::is_same<EDATA_T, grape::EmptyType>::value) {
+      return lhs.neighbor < rhs.neighbor;
+    } else {
+      if (lhs.data < rhs.data) {
+        return true;
       }
-      fout.close();
+      if (rhs.data < lhs.data) {
+        return false;
+      }
+      return lhs.neighbor < rhs.neighbor;
     }
   }
+
+  static void sort_nbrs(std::vector<base_nbr_t>& nbrs, EdgeSortOrder order) {
+    if (order == EdgeSortOrder::kByNeighbor) {
+      std::sort(nbrs.begin(), nbrs.end(), neighbor_less);
+    } else if (order == EdgeSortOrder::kByData) {
+      std::sort(nbrs.begin(), nbrs.end(), data_less);
+    }
+  }
+
+  /**
+   * @brief 判断src在ts时是否有到dst的边。基础段按neighbor有序时二分查找，
+   * 只访问查找路径上的页；增量段无序，逐条检查。
+   */
+  bool contains(vid_t src, vid_t dst, timestamp_t ts) const {
+    std::vector<base_nbr_t> nbrs;
+    get_edges_in_range(
+        src, EdgeSortOrder::kByNeighbor,
+        [&](const base_nbr_t& nbr) { return nbr.neighbor < dst; },
+        [&](const base_nbr_t& nbr) { return nbr.neighbor <= dst; },
+        [&](vid_t neighbor, const EDATA_T& data) { return neighbor == dst; },
+        ts, nbrs);
+    return !nbrs.empty();
+  }
+
+  // 按neighbor有序时只访问二分查找路径上的页
+  bool find_edge(vid_t src, vid_t dst, timestamp_t ts,
+                 Any& data) const override {
+    if (src >= adj_lists_.size() || dst == std::numeric_limits<vid_t>::max()) {
+      return false;
+    }
+    std::vector<base_nbr_t> nbrs;
+    get_edges_by_neighbor(src, dst, dst + 1, ts, nbrs);
+    if (nbrs.empty()) {
+      return false;
+    }
+    data = Any::From(nbrs[0].data);
+    return true;
+  }
+
+  /**
+   * @brief 读出v在ts时neighbor位于[lo, hi)中的边。基础段按neighbor有序时
+   * 只读取区间内的页。
+   */
+  void get_edges_by_neighbor(vid_t v, vid_t lo, vid_t hi, timestamp_t ts,
+                             std::vector<base_nbr_t>& out) const {
+    get_edges_in_range(
+        v, EdgeSortOrder::kByNeighbor,
+        [&](const base_nbr_t& nbr) { return nbr.neighbor < lo; },
+        [&](const base_nbr_t& nbr) { return nbr.neighbor < hi; },
+        [&](vid_t neighbor, const EDATA_T& data) {
+          return lo <= neighbor && neighbor < hi;
+        },
+        ts, out);
+  }
+
+  /**
+   * @brief 读出v在ts时边数据位于[lo, hi)中的边，例如creationDate的时间窗口。
+   * 基础段按数据有序时只读取区间内的页。
+   */
+  void get_edges_by_data(vid_t v, const EDATA_T& lo, const EDATA_T& hi,
+                         timestamp_t ts, std::vector<base_nbr_t>& out) const {
+    if constexpr (std::is_same<EDATA_T, grape::EmptyType>::value) {
+      get_edges_by_neighbor(v, 0, std::numeric_limits<vid_t>::max(), ts, out);
+    } else {
+      get_edges_in_range(
+          v, EdgeSortOrder::kByData,
+          [&](const base_nbr_t& nbr) { return nbr.data < lo; },
+          [&](const base_nbr_t& nbr) { return nbr.data < hi; },
+          [&](vid_t neighbor, const EDATA_T& data) {
+            return !(data < lo) && data < hi;
+          },
+          ts, out);
+    }
+  }
+
+  EdgeSortOrder base_sort_order() const { return base_order_; }
+
+ private:
+  // 非压缩基础段中第一个不满足less的位置，less需与基础段的顺序一致。
+  // 二分查找只访问查找路径上的页
+  template <typename LESS_T>
+  size_t base_lower_bound(const base_range_t& base, const LESS_T& less) const {
+    size_t lo = 0, hi = base.size_;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (less(get_base_nbr(base, mid))) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+  // 非压缩基础段中的一条边
+  base_nbr_t get_base_nbr(const base_range_t& base, size_t idx) const {
+    auto item = base_list_.get(base.start_idx_ + idx);
+    return gbp::BufferBlock::Ref<base_nbr_t>(item);
+  }
+
+  void read_base_edges(const base_range_t& base,
+                       std::vector<base_nbr_t>& nbrs) const {
+    size_t base_size = base.size_;
+    nbrs.resize(base_size);
+    if (base_size == 0) {
+      return;
+    }
+    if (packed_) {
+      PackedNbrCodec<EDATA_T>::decode(
+          packed_list_.get(base.start_idx_, base.bytes_), base.bytes_,
+          base_size, nbrs.data());
+    } else {
+      auto nbrs_old = base_list_.get(base.start_idx_, base_size);
+      for (size_t k = 0; k < base_size; k++) {
+        nbrs[k] = gbp::BufferBlock::Ref<base_nbr_t>(nbrs_old, k);
+      }
+    }
+  }
+
+  // 整体读取基础段时复用的缓冲区，避免每次查询分配
+  static std::vector<base_nbr_t>& base_scratch() {
+    thread_local std::vector<base_nbr_t> nbrs;
+    return nbrs;
+  }
+
+  // 遍历非压缩基础段中[begin, end)的边
+  template <typename FUNC_T>
+  void foreach_base_edge(const base_range_t& base, size_t begin, size_t end,
+                         const FUNC_T& func) const {
+    if (begin >= end) {
+      return;
+    }
+    auto nbrs = base_list_.get(base.start_idx_ + begin, end - begin);
+    for (size_t k = 0; k < end - begin; k++) {
+      func(gbp::BufferBlock::Ref<base_nbr_t>(nbrs, k));
+    }
+  }
+
+  // ts之后被原地修改过的边，把数据换回ts时的旧值
+  void resolve_data(vid_t v, timestamp_t ts, base_nbr_t& nbr) const {
+    if constexpr (PackedNbrCodec<EDATA_T>::kHasData) {
+      auto* old =
+          this->versions().find(edge_version_key(v, nbr.neighbor), ts);
+      if (old != nullptr) {
+        ::memcpy(&nbr.data, old->data(), sizeof(EDATA_T));
+      }
+    }
+  }
+
+  // 基础段按order有序时用lower/upper二分出区间，否则整体过滤；增量段逐条过滤。
+  // 压缩的基础段和不超过一页的有序基础段只读取、解码一次。ts之后有原地
+  // 修改时按ts时的数据输出，此时存储中的数据不再按ts时的值有序，按数据的
+  // 查找改为整体过滤
+  template <typename LOWER_T, typename UPPER_T, typename FILTER_T>
+  void get_edges_in_range(vid_t v, EdgeSortOrder order, const LOWER_T& lower,
+                          const UPPER_T& upper, const FILTER_T& filter,
+                          timestamp_t ts, std::vector<base_nbr_t>& out) const {
+    out.clear();
+    auto delta = get_delta_range(v);
+    auto base = get_base_range(v);
+    bool versioned = this->versions().newer_than(ts);
+    bool sorted = base_order_ == order &&
+                  !(versioned && order == EdgeSortOrder::kByData);
+    bool whole = packed_ || base.size_ <= base_list_.OBJ_NUM_PERPAGE;
+    auto emit = [&](base_nbr_t nbr, bool check) {
+      if (versioned) {
+        resolve_data(v, ts, nbr);
+      }
+      if (!check || filter(nbr.neighbor, nbr.data)) {
+        out.push_back(nbr);
+      }
+    };
+    if (base.size_ != 0 && whole) {
+      auto& nbrs = base_scratch();
+      read_base_edges(base, nbrs);
+      auto begin = nbrs.begin(), end = nbrs.end();
+      if (sorted) {
+        begin = std::partition_point(nbrs.begin(), nbrs.end(), lower);
+        end = std::partition_point(begin, nbrs.end(), upper);
+      }
+      for (auto it = begin; it != end; ++it) {
+        emit(*it, !sorted);
+      }
+    } else if (base.size_ != 0 && sorted) {
+      size_t begin = base_lower_bound(base, lower);
+      size_t end = base_lower_bound(base, upper);
+      foreach_base_edge(base, begin, end,
+                        [&](const base_nbr_t& nbr) { emit(nbr, false); });
+    } else if (base.size_ != 0) {
+      foreach_base_edge(base, 0, base.size_,
+                        [&](const base_nbr_t& nbr) { emit(nbr, true); });
+    }
+    foreach_delta_edge(delta, [&](const nbr_t& nbr) {
+      if (nbr.timestamp.load() <= ts) {
+        base_nbr_t edge;
+        edge.neighbor = nbr.neighbor;
+        edge.data = nbr.data;
+        emit(edge, true);
+      }
+    });
+  }
+
+ public:
+  // 快照之后新增的顶点没有基础段
+  base_range_t get_base_range(vid_t v) const {
+    if (v >= base_vnum_) {
+      return base_range_t();
+    }
+    auto item = base_ranges_.get(v);
+    return gbp::BufferBlock::Ref<base_range_t>(item);
+  }
+
+  // ranges为base_ranges_从0开始的一段
+  base_range_t base_range_at(const gbp::BufferBlock& ranges, size_t v) const {
+    return v < base_vnum_ ? gbp::BufferBlock::Ref<base_range_t>(ranges, v)
+                          : base_range_t();
+  }
+
+  // 读出一致的增量段位置，见MutableAdjlist::load
+  delta_range_t get_delta_range(vid_t v) const {
+    delta_range_t ret;
+    auto item = adj_lists_.get(v);
+    gbp::BufferBlock::Ref<adjlist_t>(item).load(ret);
+    return ret;
+  }
+
+  // 按(基础段, 增量段)的顺序读出一个邻接表的所有边
+  void collect_edges(const base_range_t& base, const adjlist_t& adj_list,
+                     std::vector<base_nbr_t>& nbrs) const {
+    delta_range_t delta;
+    adj_list.load(delta);
+    read_base_edges(base, nbrs);
+    size_t k = base.size_;
+    nbrs.resize(k + delta.size_);
+    foreach_delta_edge(delta, [&](const nbr_t& item_old) {
+      nbrs[k].neighbor = item_old.neighbor;
+      nbrs[k].data = item_old.data;
+      ++k;
+    });
+  }
+
+  // 按插入顺序遍历增量段的边：先是连续区间，再是溢出块链
+  template <typename FUNC_T>
+  void foreach_delta_edge(const delta_range_t& delta,
+                          const FUNC_T& func) const {
+    size_t size = delta.size_;
+    size_t run_size = delta.run_size();
+    if (run_size != 0) {
+      auto nbrs = nbr_list_.get(delta.start_idx_, run_size);
+      for (size_t k = 0; k < run_size; k++) {
+        func(gbp::BufferBlock::Ref<nbr_t>(nbrs, k));
+      }
+    }
+    u_int32_t chunk = delta.chunk_head_;
+    for (size_t begin = run_size; begin < size; begin += chunks_t::kChunkSize) {
+      size_t len = std::min(chunks_t::kChunkSize, size - begin);
+      auto nbrs = chunks_.get(chunk, len);
+      for (size_t k = 0; k < len; k++) {
+        func(gbp::BufferBlock::Ref<nbr_t>(nbrs, k));
+      }
+      chunk = chunks_.next(chunk);
+    }
+  }
+
+  // 写出压缩格式的.base和每个顶点的字节偏移.boff，两者都在切换VERSION之前
+  // 落盘
+  void dump_packed(const std::string& name, const std::string& new_spanshot_dir,
+                   const gbp::BufferBlock& adjlists_tmp,
+                   const gbp::BufferBlock& ranges_tmp, size_t vnum) const {
+    std::string base_path = new_spanshot_dir + "/" + name + ".base";
+    FILE* fout = open_snapshot_file(base_path);
+    std::vector<size_t> offsets(vnum + 1, 0);
+    std::vector<base_nbr_t> nbrs;
+    std::vector<char> buf;
+    std::vector<char> padding(gbp::PAGE_SIZE_FILE, 0);
+    size_t offset = 0;
+    for (size_t i = 0; i < vnum; ++i) {
+      collect_edges(base_range_at(ranges_tmp, i),
+                    gbp::BufferBlock::Ref<adjlist_t>(adjlists_tmp, i), nbrs);
+      if (!nbrs.empty()) {
+        sort_nbrs(nbrs, EdgeSortOrder::kByNeighbor);
+        PackedNbrCodec<EDATA_T>::encode(nbrs.data(), nbrs.size(), buf);
+        // 不超过一页的邻接表不跨页
+        if (buf.size() <= gbp::PAGE_SIZE_FILE &&
+            offset / gbp::PAGE_SIZE_FILE !=
+                (offset + buf.size() - 1) / gbp::PAGE_SIZE_FILE) {
+          size_t padding_size =
+              gbp::PAGE_SIZE_FILE - offset % gbp::PAGE_SIZE_FILE;
+          write_snapshot_file(fout, padding.data(), 1, padding_size,
+                              base_path);
+          offset += padding_size;
+        }
+      }
+      offsets[i] = offset;
+      if (!nbrs.empty()) {
+        write_snapshot_file(fout, buf.data(), 1, buf.size(), base_path);
+        offset += buf.size();
+      }
+    }
+    offsets[vnum] = offset;
+    close_snapshot_file(fout, base_path);
+
+    std::string offsets_path = new_spanshot_dir + "/" + name + ".boff";
+    fout = open_snapshot_file(offsets_path);
+    write_snapshot_file(fout, offsets.data(), sizeof(size_t), offsets.size(),
+                        offsets_path);
+    close_snapshot_file(fout, offsets_path);
+  }
 #endif
 
   void resize(vid_t vnum) override {
@@ -1083,49 +2720,43 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
     put_edge(src, dst, data, ts);
   }
 
+  /**
+   * @brief 连续区间写满之后，边追加到溢出块链的尾部，链尾的块写满时再分配
+   * 一个新块，不搬迁已有的边。边写入之后才增加size_，读者不会看到未写完的边。
+   */
   void put_edge(vid_t src, vid_t dst, const EDATA_T& data, timestamp_t ts) {
     CHECK_LT(src, adj_lists_.size());
     locks_[src].lock();
     auto adj_list_item = adj_lists_.get(src);
     auto& adj_list = gbp::BufferBlock::Ref<adjlist_t>(adj_list_item);
 
-    auto capacity_new = adj_list.capacity_;
-    size_t start_idx_new;
-    if (adj_list.size_ == adj_list.capacity_) {
-      capacity_new += ((capacity_new) >> 1);
-      capacity_new = capacity_new > 8 ? capacity_new : 8;
-
-      bool success = false;
-      std::tie<bool, size_t>(success, start_idx_new) =
-          gbp::atomic_add<size_t>(size_, capacity_new, nbr_list_.size());
-      assert(success);
-
-      // 复制数据到新的位置
-      auto nbr_slice_old = nbr_list_.get(adj_list.start_idx_, adj_list.size_);
-      auto nbr_slice_new = nbr_list_.get(start_idx_new, adj_list.size_);
-      for (size_t i = 0; i < adj_list.size_; i++)
-        gbp::BufferBlock::UpdateContent<nbr_t>(
-            [&](nbr_t& item) {
-              auto& item_old = gbp::BufferBlock::Ref<nbr_t>(nbr_slice_old, i);
-              item.data = item_old.data;
-              item.neighbor = item_old.neighbor;
-              item.timestamp = item_old.timestamp.load();
+    size_t pos = adj_list.size_.load();
+    gbp::BufferBlock nbr_item_new;
+    if (pos < adj_list.capacity_) {
+      nbr_item_new = nbr_list_.get(adj_list.start_idx_ + pos);
+    } else {
+      size_t chunk_offset = (pos - adj_list.capacity_) % chunks_t::kChunkSize;
+      if (chunk_offset == 0) {
+        u_int32_t chunk = chunks_.allocate();
+        bool first_chunk = pos == adj_list.capacity_;
+        if (!first_chunk) {
+          chunks_.link(adj_list.chunk_tail_, chunk);
+        }
+        gbp::BufferBlock::UpdateContent<adjlist_t>(
+            [&](adjlist_t& item) {
+              if (first_chunk) {
+                item.chunk_head_ = chunk;
+              }
+              item.chunk_tail_ = chunk;
             },
-            nbr_slice_new, i);
-
-      gbp::BufferBlock::UpdateContent<adjlist_t>(
-          [&](adjlist_t& item) {
-            item.capacity_ = capacity_new;
-            item.start_idx_ = start_idx_new;
-          },
-          adj_list_item);
+            adj_list_item);
+        if (adj_list.chunk_num(pos + 1) == kCompactChunkNum) {
+          std::lock_guard<grape::SpinLock> lock(compact_lock_);
+          compact_candidates_.push_back(src);
+        }
+      }
+      nbr_item_new = chunks_.get_nbr(adj_list.chunk_tail_, chunk_offset);
     }
-    size_t idx_new = 0;
-    gbp::BufferBlock::UpdateContent<adjlist_t>(
-        [&](adjlist_t& item) { idx_new = item.size_.fetch_add(1); },
-        adj_list_item);
-    idx_new += adj_list.start_idx_;
-    auto nbr_item_new = nbr_list_.get(idx_new);
     gbp::BufferBlock::UpdateContent<nbr_t>(
         [&](nbr_t& item) {
           item.neighbor = dst;
@@ -1133,6 +2764,19 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
           item.timestamp.store(ts);
         },
         nbr_item_new);
+    bool unfrozen = adj_list.max_ts_.load() == 0 && ts != 0;
+    gbp::BufferBlock::UpdateContent<adjlist_t>(
+        [&](adjlist_t& item) {
+          if (ts > item.max_ts_.load()) {
+            item.max_ts_.store(ts);
+          }
+          item.size_.store(pos + 1, std::memory_order_release);
+        },
+        adj_list_item);
+    if (unfrozen) {
+      std::lock_guard<grape::SpinLock> lock(freeze_lock_);
+      freeze_candidates_.push_back(src);
+    }
     // auto& aa = gbp::BufferBlock::Ref<nbr_t>(nbr_item_new);
     // assert(aa.neighbor == dst);
     // if (nbr_list_.filename().find("ie_POST_HASCREATOR_PERSON.nbr") != -1)
@@ -1151,51 +2795,119 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
 #else
   int degree(vid_t i) const {
     auto adj_list = adj_lists_.get(i);
-    return gbp::BufferBlock::Ref<adjlist_t>(adj_list).size_;
+    return get_base_range(i).size_ +
+           gbp::BufferBlock::Ref<adjlist_t>(adj_list).size_.load();
   }
 
+  // i为增量段中的下标
   gbp::BufferBlock get_edge(vid_t src, vid_t i) const {
-    auto item = adj_lists_.get(src);
-    auto& adj_list = gbp::BufferBlock::Ref<adjlist_t>(item);
+    auto delta = get_delta_range(src);
 
-    return nbr_list_.get(adj_list.start_idx_ + i);
+    if (i < delta.capacity_) {
+      return nbr_list_.get(delta.start_idx_ + i);
+    }
+    size_t offset = i - delta.capacity_;
+    u_int32_t chunk = delta.chunk_head_;
+    for (size_t k = offset / chunks_t::kChunkSize; k != 0; --k) {
+      chunk = chunks_.next(chunk);
+    }
+    return chunks_.get_nbr(chunk, offset % chunks_t::kChunkSize);
   }
 
   const slice_t get_edges(vid_t i) const override {
     slice_t ret;
-    auto item = adj_lists_.get(i);
-    auto& adj_list = gbp::BufferBlock::Ref<adjlist_t>(item);
-
-    ret.mmap_array_ = &nbr_list_;
-    ret.start_idx_ = adj_list.start_idx_;
-    ret.size_ = adj_list.size_.load(std::memory_order_acquire);
+    auto delta = get_delta_range(i);
+    auto base = get_base_range(i);
+
+    ret.size_ = delta.size_;
+    ret.max_ts_ = delta.max_ts_;
+    ret.run_size_ = delta.run_size();
+    // 连续区间不跨段，切片直接指向所在的段
+    if (ret.run_size_ != 0) {
+      ret.mmap_array_ = nbr_list_.segment(delta.start_idx_, ret.start_idx_);
+    }
+    ret.chunks_ = &chunks_;
+    ret.chunk_head_ = delta.chunk_head_;
+    ret.base_array_ = &base_list_;
+    ret.base_start_idx_ = base.start_idx_;
+    ret.base_size_ = base.size_;
+    if (packed_) {
+      ret.packed_array_ = &packed_list_;
+      ret.base_bytes_ = base.bytes_;
+    }
+    ret.versions_ = &this->versions();
+    ret.v_ = i;
     return ret;
   }
   const gbp::batch_request_type get_edgelist_batch(vid_t i) const override {
     return adj_lists_.get_batch(i);
   }
+  bool get_base_range_batch(vid_t i,
+                            gbp::batch_request_type& req) const override {
+    if (i >= base_vnum_) {
+      return false;
+    }
+    req = base_ranges_.get_batch(i);
+    return true;
+  }
   const gbp::batch_request_type get_edges_batch(size_t start_idx,
                                                 size_t size) const override {
     return nbr_list_.get_batch(start_idx, size);
   }
+  const gbp::batch_request_type get_base_edges_batch(
+      size_t start_idx, size_t size, size_t bytes) const override {
+    return packed_ ? packed_list_.get_batch(start_idx, bytes)
+                   : base_list_.get_batch(start_idx, size);
+  }
+  const chunks_t* get_chunks() const override { return &chunks_; }
 
   mut_slice_t get_edges_mut(vid_t i) {
-    auto item = adj_lists_.get(i);
-    auto& adj_list = gbp::BufferBlock::Ref<adjlist_t>(item);
+    auto delta = get_delta_range(i);
+    auto base = get_base_range(i);
+    // 基础段可能被原地修改，下一次checkpoint需要写出这些页
+    if (base.size_ != 0) {
+      if (packed_) {
+        packed_list_.mark_dirty(base.start_idx_, base.bytes_);
+      } else {
+        base_list_.mark_dirty(base.start_idx_, base.size_);
+      }
+    }
 
     mut_slice_t ret;
-    ret.mmap_array_ = &nbr_list_;
-    ret.start_idx_ = adj_list.start_idx_;
-    ret.size_ = adj_list.size_.load();
+    ret.size_ = delta.size_;
+    ret.run_size_ = delta.run_size();
+    if (ret.run_size_ != 0) {
+      ret.mmap_array_ = nbr_list_.segment(delta.start_idx_, ret.start_idx_);
+    }
+    ret.chunks_ = &chunks_;
+    ret.chunk_head_ = delta.chunk_head_;
+    ret.base_array_ = &base_list_;
+    ret.base_start_idx_ = base.start_idx_;
+    ret.base_size_ = base.size_;
+    if (packed_) {
+      ret.packed_array_ = &packed_list_;
+      ret.base_bytes_ = base.bytes_;
+    }
+    ret.versions_ = &this->versions();
+    ret.v_ = i;
     return ret;
   }
 
 #endif
   size_t get_index_size_in_byte() const override {
+#if OV
     return adj_lists_.get_size_in_byte();
+#else
+    return adj_lists_.get_size_in_byte() + base_ranges_.get_size_in_byte();
+#endif
   }
   size_t get_data_size_in_byte() const override {
+#if OV
     return nbr_list_.get_size_in_byte();
+#else
+    return base_list_.get_size_in_byte() + packed_list_.get_size_in_byte() +
+           nbr_list_.get_size_in_byte() + chunks_.get_size_in_byte();
+#endif
   }
 
   void ingest_edge(vid_t src, vid_t dst, grape::OutArchive& arc, timestamp_t ts,
@@ -1221,8 +2933,16 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
   MutableCsrConstEdgeIterBase* edge_iter_raw(vid_t v) const override {
     return new TypedMutableCsrConstEdgeIter<EDATA_T>(get_edges(v));
   }
+  // 迭代器存活期间持有locks_[v]，修改边数据与compact的复制互斥，否则复制
+  // 之后写入旧位置的修改会丢失
   std::shared_ptr<MutableCsrEdgeIterBase> edge_iter_mut(vid_t v) override {
-    return std::make_shared<TypedMutableCsrEdgeIter<EDATA_T>>(get_edges_mut(v));
+    locks_[v].lock();
+    return std::shared_ptr<MutableCsrEdgeIterBase>(
+        new TypedMutableCsrEdgeIter<EDATA_T>(get_edges_mut(v)),
+        [this, v](MutableCsrEdgeIterBase* iter) {
+          delete iter;
+          locks_[v].unlock();
+        });
   }
 
  private:
@@ -1233,9 +2953,28 @@ class MutableCsr : public TypedMutableCsrBase<EDATA_T> {
 #else
   grape::SpinLock* locks_;
   mmap_array<adjlist_t> adj_lists_;
-  mmap_array<nbr_t> nbr_list_;
-  std::atomic<size_t> size_;
-  size_t capacity_;
+  mmap_array<base_range_t> base_ranges_;  // 前base_vnum_个顶点的基础段位置
+  mmap_array<base_nbr_t> base_list_;      // 基础段，快照中的边
+  mmap_array<char> packed_list_;      // 压缩存放的基础段
+  bool packed_ = false;
+  std::string base_offsets_file_;  // 压缩格式中每个顶点的字节偏移(.boff)
+  size_t base_vnum_ = 0;
+  segmented_mmap_array<nbr_t> nbr_list_;  // 增量段的连续区间
+  std::atomic<size_t> size_;  // nbr_list_中下一个尾部分配的位置
+  mutable std::mutex nbr_list_lock_;
+  // 按容量分级的空闲区间(start_idx, capacity)，以及等待回收的增量段
+  std::array<std::vector<std::pair<size_t, size_t>>, kSizeClassNum>
+      free_regions_;
+  std::vector<retired_delta_t> retired_;
+  chunks_t chunks_;  // 增量段的溢出块
+  // 溢出块数达到kCompactChunkNum的顶点，等待compact
+  std::vector<vid_t> compact_candidates_;
+  mutable grape::SpinLock compact_lock_;
+  // 增量段中有未冻结的边的顶点，等待freeze
+  std::vector<vid_t> freeze_candidates_;
+  grape::SpinLock freeze_lock_;
+  EdgeSortOrder sort_order_ = EdgeSortOrder::kNone;  // dump时的排列顺序
+  EdgeSortOrder base_order_ = EdgeSortOrder::kNone;  // 当前基础段的排列顺序
 #endif
 };
 
@@ -1286,6 +3025,13 @@ class SingleMutableCsr : public TypedMutableCsrBase<EDATA_T> {
                                       new_snapshot_dir + "/" + name + ".nbr");
   }
 
+#if !OV
+  void checkpoint(const std::string& name, const std::string& new_snapshot_dir,
+                  timestamp_t ts) override {
+    nbr_list_.checkpoint(new_snapshot_dir + "/" + name + ".nbr");
+  }
+#endif
+
   void resize(vid_t vnum) override {
     if (vnum > nbr_list_.size()) {
       size_t old_size = nbr_list_.size();
@@ -1340,6 +3086,7 @@ class SingleMutableCsr : public TypedMutableCsrBase<EDATA_T> {
           item.timestamp.store(ts);
         },
         item_out);
+    nbr_list_.mark_dirty(src);
   }
 #endif
 
@@ -1372,6 +3119,7 @@ class SingleMutableCsr : public TypedMutableCsrBase<EDATA_T> {
           item.timestamp.store(ts);
         },
         item_out);
+    nbr_list_.mark_dirty(src);
   }
 #endif
 
@@ -1413,6 +3161,8 @@ class SingleMutableCsr : public TypedMutableCsrBase<EDATA_T> {
       ret.start_idx_ = i;
       ret.size_ = 1;
     }
+    ret.versions_ = &this->versions();
+    ret.v_ = i;
     return ret;
   }
 
@@ -1428,6 +3178,7 @@ class SingleMutableCsr : public TypedMutableCsrBase<EDATA_T> {
 
   mut_slice_t get_edges_mut(vid_t i) {
     mut_slice_t ret;
+    nbr_list_.mark_dirty(i);
     auto item = nbr_list_.get(i);
     ret.size_ = gbp::BufferBlock::Ref<nbr_t>(item).timestamp.load() ==
                         std::numeric_limits<timestamp_t>::max()
@@ -1438,9 +3189,49 @@ class SingleMutableCsr : public TypedMutableCsrBase<EDATA_T> {
       ret.start_idx_ = i;
       ret.size_ = 1;
     }
+    ret.versions_ = &this->versions();
+    ret.v_ = i;
     return ret;
   }
   gbp::BufferBlock get_edge(vid_t i) const { return nbr_list_.get(i); }
+
+  // 读时间戳为ts时i的边；之后边数据被原地修改过时返回带旧数据的副本
+  gbp::BufferBlock get_edge(vid_t i, timestamp_t ts) const {
+    auto item = nbr_list_.get(i);
+    resolve_version(i, ts, item);
+    return item;
+  }
+
+  void resolve_version(vid_t i, timestamp_t ts,
+                       gbp::BufferBlock& item) const override {
+    if constexpr (PackedNbrCodec<EDATA_T>::kHasData) {
+      auto& nbr = gbp::BufferBlock::Ref<nbr_t>(item);
+      auto* old =
+          this->versions().find(edge_version_key(i, nbr.neighbor), ts);
+      if (old != nullptr) {
+        gbp::BufferBlock copy(sizeof(nbr_t));
+        auto& ret = gbp::BufferBlock::Ref<nbr_t>(copy);
+        ret.neighbor = nbr.neighbor;
+        ret.timestamp.store(nbr.timestamp.load());
+        ::memcpy(&ret.data, old->data(), sizeof(EDATA_T));
+        item = copy;
+      }
+    }
+  }
+
+  bool find_edge(vid_t src, vid_t dst, timestamp_t ts,
+                 Any& data) const override {
+    if (src >= nbr_list_.size()) {
+      return false;
+    }
+    auto item = get_edge(src, ts);
+    auto& nbr = gbp::BufferBlock::Ref<nbr_t>(item);
+    if (nbr.neighbor != dst || nbr.timestamp.load() > ts) {
+      return false;
+    }
+    data = Any::From(nbr.data);
+    return true;
+  }
 #endif
   size_t get_index_size_in_byte() const override { return 0; }
   size_t get_data_size_in_byte() const override {
@@ -1498,6 +3289,11 @@ class EmptyCsr : public TypedMutableCsrBase<EDATA_T> {
   void dump(const std::string& name,
             const std::string& new_spanshot_dir) override {}
 
+#if !OV
+  void checkpoint(const std::string& name, const std::string& new_snapshot_dir,
+                  timestamp_t ts) override {}
+#endif
+
   void resize(vid_t vnum) override {}
 
   size_t size() const override { return 0; }
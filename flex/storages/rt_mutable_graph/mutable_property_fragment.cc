@@ -15,6 +15,10 @@
 
 #include "grape/util.h"
 
+#include <atomic>
+#include <functional>
+#include <thread>
+
 #include "flex/storages/rt_mutable_graph/mutable_property_fragment.h"
 
 #include "flex/engines/hqps_db/core/utils/hqps_utils.h"
@@ -45,6 +49,9 @@ MutablePropertyFragment::~MutablePropertyFragment() {
           oe_[index]->resize(degree_list[src_label]);
           delete oe_[index];
         }
+        if (edge_data_[index] != NULL) {
+          delete edge_data_[index];
+        }
       }
     }
   }
@@ -67,7 +74,16 @@ void MutablePropertyFragment::DumpSchema(const std::string& schema_path) {
 
 inline MutableCsrBase* create_csr(EdgeStrategy es,
                                   const std::vector<PropertyType>& properties) {
-  if (properties.empty()) {
+  if (use_edge_property_table(properties)) {
+    // 属性存放在EdgePropertyTable中，邻接表中只存放边id
+    if (es == EdgeStrategy::kSingle) {
+      return new SingleMutableCsr<edge_id_t>();
+    } else if (es == EdgeStrategy::kMultiple) {
+      return new MutableCsr<edge_id_t>();
+    } else if (es == EdgeStrategy::kNone) {
+      return new EmptyCsr<edge_id_t>();
+    }
+  } else if (properties.empty()) {
     if (es == EdgeStrategy::kSingle) {
       return new SingleMutableCsr<grape::EmptyType>();
     } else if (es == EdgeStrategy::kMultiple) {
@@ -166,6 +182,8 @@ void MutablePropertyFragment::Open(const std::string& work_dir) {
 
   ie_.resize(vertex_label_num_ * vertex_label_num_ * edge_label_num_, NULL);
   oe_.resize(vertex_label_num_ * vertex_label_num_ * edge_label_num_, NULL);
+  edge_data_.resize(vertex_label_num_ * vertex_label_num_ * edge_label_num_,
+                    NULL);
 
   t0 = -grape::GetCurrentTime();
   size_t size_in_byte_edge_index = 0;
@@ -194,6 +212,10 @@ void MutablePropertyFragment::Open(const std::string& work_dir) {
             src_label, dst_label, edge_label);
         ie_[index] = create_csr(ie_strategy, properties);
         oe_[index] = create_csr(oe_strategy, properties);
+        EdgeSortOrder sort_order =
+            schema_.get_edge_sort_order(src_label, dst_label, edge_label);
+        ie_[index]->set_sort_order(sort_order);
+        oe_[index]->set_sort_order(sort_order);
         ie_[index]->open(ie_prefix(src_label, dst_label, edge_label),
                          snapshot_dir, tmp_dir_path);
         ie_[index]->resize(vertex_capacities[dst_label_i]);
@@ -201,6 +223,16 @@ void MutablePropertyFragment::Open(const std::string& work_dir) {
                          snapshot_dir, tmp_dir_path);
 
         oe_[index]->resize(vertex_capacities[src_label_i]);
+        if (use_edge_property_table(properties)) {
+          edge_data_[index] = new EdgePropertyTable();
+          edge_data_[index]->open(
+              edge_table_prefix(src_label, dst_label, edge_label),
+              snapshot_dir, tmp_dir_path,
+              schema_.get_edge_property_names(src_label, dst_label,
+                                              edge_label),
+              properties);
+          size_in_byte_edge_data += edge_data_[index]->get_size_in_byte();
+        }
         size_in_byte_edge_index += ie_[index]->get_index_size_in_byte();
         size_in_byte_edge_index += oe_[index]->get_index_size_in_byte();
         size_in_byte_edge_data += ie_[index]->get_data_size_in_byte();
@@ -215,6 +247,27 @@ void MutablePropertyFragment::Open(const std::string& work_dir) {
             << size_in_byte_edge_data / MB_in_byte;
 }
 
+static void parallel_run(size_t task_num, int thread_num,
+                         const std::function<void(size_t)>& func) {
+  std::atomic<size_t> task_ind(0);
+  std::vector<std::thread> threads(
+      std::max<size_t>(1, std::min<size_t>(thread_num, task_num)));
+  for (auto& thread : threads) {
+    thread = std::thread([&]() {
+      while (true) {
+        size_t cur = task_ind.fetch_add(1);
+        if (cur >= task_num) {
+          break;
+        }
+        func(cur);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
 void MutablePropertyFragment::Dump(const std::string& work_dir,
                                    uint32_t version) {
   std::string snapshot_dir_path = snapshot_dir(work_dir, version);
@@ -222,11 +275,78 @@ void MutablePropertyFragment::Dump(const std::string& work_dir,
   std::vector<size_t> vertex_num(vertex_label_num_, 0);
   for (size_t i = 0; i < vertex_label_num_; ++i) {
     vertex_num[i] = lf_indexers_[i].size();
-    lf_indexers_[i].dump(vertex_map_prefix(schema_.get_vertex_label_name(i)),
-                         snapshot_dir_path);
-    vertex_data_[i].resize(vertex_num[i]);
-    vertex_data_[i].dump(vertex_table_prefix(schema_.get_vertex_label_name(i)),
-                         snapshot_dir_path);
+  }
+
+  // 各个索引、顶点表和csr写入不同的文件，互不依赖，拆成任务并行dump
+  std::vector<std::function<void()>> tasks;
+  for (size_t i = 0; i < vertex_label_num_; ++i) {
+    std::string label = schema_.get_vertex_label_name(i);
+    tasks.emplace_back([this, i, label, &snapshot_dir_path]() {
+      lf_indexers_[i].dump(vertex_map_prefix(label), snapshot_dir_path);
+    });
+    tasks.emplace_back([this, i, label, &vertex_num, &snapshot_dir_path]() {
+      vertex_data_[i].resize(vertex_num[i]);
+      vertex_data_[i].dump(vertex_table_prefix(label), snapshot_dir_path);
+    });
+  }
+
+  for (size_t src_label_i = 0; src_label_i != vertex_label_num_;
+       ++src_label_i) {
+    std::string src_label =
+        schema_.get_vertex_label_name(static_cast<label_t>(src_label_i));
+    for (size_t dst_label_i = 0; dst_label_i != vertex_label_num_;
+         ++dst_label_i) {
+      std::string dst_label =
+          schema_.get_vertex_label_name(static_cast<label_t>(dst_label_i));
+      for (size_t e_label_i = 0; e_label_i != edge_label_num_; ++e_label_i) {
+        std::string edge_label =
+            schema_.get_edge_label_name(static_cast<label_t>(e_label_i));
+        if (!schema_.exist(src_label, dst_label, edge_label)) {
+          continue;
+        }
+        size_t index = src_label_i * vertex_label_num_ * edge_label_num_ +
+                       dst_label_i * edge_label_num_ + e_label_i;
+        if (ie_[index] != NULL) {
+          std::string prefix = ie_prefix(src_label, dst_label, edge_label);
+          size_t vnum = vertex_num[dst_label_i];
+          tasks.emplace_back([this, index, prefix, vnum, &snapshot_dir_path]() {
+            ie_[index]->resize(vnum);
+            ie_[index]->dump(prefix, snapshot_dir_path);
+          });
+        }
+        if (oe_[index] != NULL) {
+          std::string prefix = oe_prefix(src_label, dst_label, edge_label);
+          size_t vnum = vertex_num[src_label_i];
+          tasks.emplace_back([this, index, prefix, vnum, &snapshot_dir_path]() {
+            oe_[index]->resize(vnum);
+            oe_[index]->dump(prefix, snapshot_dir_path);
+          });
+        }
+        if (edge_data_[index] != NULL) {
+          std::string prefix =
+              edge_table_prefix(src_label, dst_label, edge_label);
+          tasks.emplace_back([this, index, prefix, &snapshot_dir_path]() {
+            edge_data_[index]->dump(prefix, snapshot_dir_path);
+          });
+        }
+      }
+    }
+  }
+  parallel_run(tasks.size(), std::thread::hardware_concurrency(),
+               [&](size_t i) { tasks[i](); });
+  set_snapshot_version(work_dir, version);
+}
+
+#if !OV
+void MutablePropertyFragment::Checkpoint(const std::string& work_dir,
+                                         uint32_t version) {
+  std::string snapshot_dir_path = snapshot_dir(work_dir, version);
+  std::filesystem::create_directories(snapshot_dir_path);
+  for (size_t i = 0; i < vertex_label_num_; ++i) {
+    std::string label = schema_.get_vertex_label_name(i);
+    lf_indexers_[i].checkpoint(vertex_map_prefix(label), snapshot_dir_path);
+    vertex_data_[i].checkpoint(vertex_table_prefix(label), snapshot_dir_path,
+                               lf_indexers_[i].size());
   }
 
   for (size_t src_label_i = 0; src_label_i != vertex_label_num_;
@@ -246,20 +366,90 @@ void MutablePropertyFragment::Dump(const std::string& work_dir,
         size_t index = src_label_i * vertex_label_num_ * edge_label_num_ +
                        dst_label_i * edge_label_num_ + e_label_i;
         if (ie_[index] != NULL) {
-          ie_[index]->resize(vertex_num[dst_label_i]);
-          ie_[index]->dump(ie_prefix(src_label, dst_label, edge_label),
-                           snapshot_dir_path);
+          ie_[index]->checkpoint(ie_prefix(src_label, dst_label, edge_label),
+                                 snapshot_dir_path, version);
         }
         if (oe_[index] != NULL) {
-          oe_[index]->resize(vertex_num[src_label_i]);
-          oe_[index]->dump(oe_prefix(src_label, dst_label, edge_label),
-                           snapshot_dir_path);
+          oe_[index]->checkpoint(oe_prefix(src_label, dst_label, edge_label),
+                                 snapshot_dir_path, version);
+        }
+        if (edge_data_[index] != NULL) {
+          edge_data_[index]->checkpoint(
+              edge_table_prefix(src_label, dst_label, edge_label),
+              snapshot_dir_path);
         }
       }
     }
   }
+  // 所有文件写完之后才切换VERSION，中途崩溃时仍从上一个快照恢复
   set_snapshot_version(work_dir, version);
 }
+#endif
+
+size_t MutablePropertyFragment::CompactEdges(timestamp_t read_ts,
+                                             timestamp_t min_ts) {
+  size_t compacted = 0;
+  for (auto csr : ie_) {
+    if (csr != NULL) {
+      compacted += csr->compact(read_ts, min_ts);
+    }
+  }
+  for (auto csr : oe_) {
+    if (csr != NULL) {
+      compacted += csr->compact(read_ts, min_ts);
+    }
+  }
+  return compacted;
+}
+
+size_t MutablePropertyFragment::FreezeEdges(timestamp_t ts) {
+  size_t frozen = 0;
+  for (auto csr : ie_) {
+    if (csr != NULL) {
+      frozen += csr->freeze(ts);
+    }
+  }
+  for (auto csr : oe_) {
+    if (csr != NULL) {
+      frozen += csr->freeze(ts);
+    }
+  }
+  return frozen;
+}
+
+size_t MutablePropertyFragment::ReclaimVersions(timestamp_t min_ts) {
+  size_t reclaimed = 0;
+  for (auto& table : vertex_data_) {
+    for (auto& column : table.columns()) {
+      reclaimed += column->versions().reclaim(min_ts);
+    }
+  }
+  for (auto csr : ie_) {
+    if (csr != NULL) {
+      reclaimed += csr->versions().reclaim(min_ts);
+    }
+  }
+  for (auto csr : oe_) {
+    if (csr != NULL) {
+      reclaimed += csr->versions().reclaim(min_ts);
+    }
+  }
+  return reclaimed;
+}
+
+bool MutablePropertyFragment::NeedCompactEdges() const {
+  for (auto csr : ie_) {
+    if (csr != NULL && csr->need_compact()) {
+      return true;
+    }
+  }
+  for (auto csr : oe_) {
+    if (csr != NULL && csr->need_compact()) {
+      return true;
+    }
+  }
+  return false;
+}
 
 void MutablePropertyFragment::IngestEdge(label_t src_label, vid_t src_lid,
                                          label_t dst_label, vid_t dst_lid,
@@ -268,6 +458,15 @@ void MutablePropertyFragment::IngestEdge(label_t src_label, vid_t src_lid,
                                          MMapAllocator& alloc) {
   size_t index = src_label * vertex_label_num_ * edge_label_num_ +
                  dst_label * edge_label_num_ + edge_label;
+  if (edge_data_[index] != NULL) {
+    // 先将属性写入边属性表，两个方向的邻接表共享同一个边id
+    edge_id_t eid = edge_data_[index]->allocate();
+    edge_data_[index]->ingest(eid, arc);
+    Any eid_any = Any::From(eid);
+    ie_[index]->put_generic_edge(dst_lid, src_lid, eid_any, ts, alloc);
+    oe_[index]->put_generic_edge(src_lid, dst_lid, eid_any, ts, alloc);
+    return;
+  }
   ie_[index]->peek_ingest_edge(dst_lid, src_lid, arc, ts, alloc);
   oe_[index]->ingest_edge(src_lid, dst_lid, arc, ts, alloc);
 }
@@ -293,10 +492,11 @@ bool MutablePropertyFragment::get_lid(label_t label, oid_t oid,
 }
 
 #if !OV
-gbp::batch_request_type MutablePropertyFragment::get_lid_batch(
-    label_t label, oid_t oid, bool& success) const {
-  assert(false);
-  return gbp::batch_request_type();
+void MutablePropertyFragment::get_lid_batch(label_t label,
+                                            const std::vector<oid_t>& oids,
+                                            std::vector<vid_t>& lids,
+                                            std::vector<bool>& exists) const {
+  lf_indexers_[label].get_index_batch(oids, lids, exists);
 }
 #endif
 
@@ -387,6 +587,21 @@ MutableCsrBase* MutablePropertyFragment::get_ie_csr(label_t label,
   return ie_[index];
 }
 
+EdgePropertyTable* MutablePropertyFragment::get_edge_table(label_t src_label,
+                                                           label_t dst_label,
+                                                           label_t edge_label) {
+  size_t index = src_label * vertex_label_num_ * edge_label_num_ +
+                 dst_label * edge_label_num_ + edge_label;
+  return edge_data_[index];
+}
+
+const EdgePropertyTable* MutablePropertyFragment::get_edge_table(
+    label_t src_label, label_t dst_label, label_t edge_label) const {
+  size_t index = src_label * vertex_label_num_ * edge_label_num_ +
+                 dst_label * edge_label_num_ + edge_label;
+  return edge_data_[index];
+}
+
 const MutableCsrBase* MutablePropertyFragment::get_ie_csr(
     label_t label, label_t neighbor_label, label_t edge_label) const {
   size_t index = neighbor_label * vertex_label_num_ * edge_label_num_ +
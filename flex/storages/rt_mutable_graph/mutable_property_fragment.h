@@ -20,6 +20,7 @@
 #include <tuple>
 #include <vector>
 
+#include "flex/storages/rt_mutable_graph/edge_property_table.h"
 #include "flex/storages/rt_mutable_graph/schema.h"
 
 #include "flex/storages/rt_mutable_graph/mutable_csr.h"
@@ -45,8 +46,25 @@ class MutablePropertyFragment {
 
   void Open(const std::string& work_dir);
   void Dump(const std::string& work_dir, uint32_t version);
+#if !OV
+  // 与Dump不同，写出快照之后图仍可继续读写；调用方需保证此时没有并发的插入
+  void Checkpoint(const std::string& work_dir, uint32_t version);
+#endif
   void DumpSchema(const std::string& filename);
 
+  // 将插入较多的邻接表的溢出块并回连续区间，可以与读、插入事务并发；同一时间
+  // 只能有一个线程调用。旧空间在min_ts超过其退休时间戳之后回收，见
+  // MutableCsr::compact
+  size_t CompactEdges(timestamp_t read_ts, timestamp_t min_ts);
+  bool NeedCompactEdges() const;
+
+  // 将ts及之前插入的边的时间戳改为0，ts不能超过活跃读事务的最小读时间戳
+  size_t FreezeEdges(timestamp_t ts);
+
+  // 回收时间戳不超过min_ts的原地修改的旧版本，min_ts为活跃读事务的最小读
+  // 时间戳，见CellVersions。返回回收的版本数
+  size_t ReclaimVersions(timestamp_t min_ts);
+
   const Schema& schema() const;
 
   Table& get_vertex_table(label_t vertex_label);
@@ -57,8 +75,8 @@ class MutablePropertyFragment {
 
   bool get_lid(label_t label, oid_t oid, vid_t& lid) const;
 
-  gbp::batch_request_type get_lid_batch(label_t label, oid_t oid,
-                                        bool& success) const;
+  void get_lid_batch(label_t label, const std::vector<oid_t>& oids,
+                     std::vector<vid_t>& lids, std::vector<bool>& exists) const;
 
   oid_t get_oid(label_t label, vid_t lid) const;
 
@@ -97,11 +115,19 @@ class MutablePropertyFragment {
   const MutableCsrBase* get_ie_csr(label_t label, label_t neighbor_label,
                                    label_t edge_label) const;
 
+  // 多属性/字符串属性边的属性表，其他边返回nullptr
+  EdgePropertyTable* get_edge_table(label_t src_label, label_t dst_label,
+                                    label_t edge_label);
+
+  const EdgePropertyTable* get_edge_table(label_t src_label, label_t dst_label,
+                                          label_t edge_label) const;
+
   void loadSchema(const std::string& filename);
 
   Schema schema_;
   std::vector<LFIndexer<vid_t>> lf_indexers_;
   std::vector<MutableCsrBase*> ie_, oe_;
+  std::vector<EdgePropertyTable*> edge_data_;
   std::vector<Table> vertex_data_;
 
   size_t vertex_label_num_, edge_label_num_;
@@ -43,7 +43,8 @@ void Schema::add_edge_label(const std::string& src_label,
                             const std::string& edge_label,
                             const std::vector<PropertyType>& properties,
                             const std::vector<std::string>& prop_names,
-                            EdgeStrategy oe, EdgeStrategy ie) {
+                            EdgeStrategy oe, EdgeStrategy ie,
+                            EdgeSortOrder sort_order) {
   label_t src_label_id = vertex_label_to_index(src_label);
   label_t dst_label_id = vertex_label_to_index(dst_label);
   label_t edge_label_id = edge_label_to_index(edge_label);
@@ -53,6 +54,7 @@ void Schema::add_edge_label(const std::string& src_label,
   eproperties_[label_id] = properties;
   oe_strategy_[label_id] = oe;
   ie_strategy_[label_id] = ie;
+  sort_order_[label_id] = sort_order;
   eprop_names_[label_id] = prop_names;
 }
 
@@ -213,6 +215,18 @@ EdgeStrategy Schema::get_incoming_edge_strategy(
   return ie_strategy_.at(index);
 }
 
+EdgeSortOrder Schema::get_edge_sort_order(const std::string& src_label,
+                                          const std::string& dst_label,
+                                          const std::string& label) const {
+  label_t src, dst, edge;
+  CHECK(vlabel_indexer_.get_index(src_label, src));
+  CHECK(vlabel_indexer_.get_index(dst_label, dst));
+  CHECK(elabel_indexer_.get_index(label, edge));
+  uint32_t index = generate_edge_label(src, dst, edge);
+  auto iter = sort_order_.find(index);
+  return iter == sort_order_.end() ? EdgeSortOrder::kNone : iter->second;
+}
+
 label_t Schema::get_edge_label_id(const std::string& label) const {
   label_t ret;
   CHECK(elabel_indexer_.get_index(label, ret));
@@ -248,7 +262,7 @@ void Schema::Serialize(std::unique_ptr<grape::LocalIOAdaptor>& writer) const {
   grape::InArchive arc;
   arc << vproperties_ << vprop_names_ << v_primary_keys_ << vprop_storage_
       << eproperties_ << eprop_names_ << ie_strategy_ << oe_strategy_
-      << max_vnum_ << plugin_list_;
+      << max_vnum_ << plugin_list_ << sort_order_;
   CHECK(writer->WriteArchive(arc));
 }
 
@@ -260,6 +274,11 @@ void Schema::Deserialize(std::unique_ptr<grape::LocalIOAdaptor>& reader) {
   arc >> vproperties_ >> vprop_names_ >> v_primary_keys_ >> vprop_storage_ >>
       eproperties_ >> eprop_names_ >> ie_strategy_ >> oe_strategy_ >>
       max_vnum_ >> plugin_list_;
+  // 旧版本的schema文件中没有sort_order_
+  sort_order_.clear();
+  if (!arc.Empty()) {
+    arc >> sort_order_;
+  }
 }
 
 label_t Schema::vertex_label_to_index(const std::string& label) {
@@ -359,6 +378,15 @@ bool Schema::Equals(const Schema& other) const {
               return false;
             }
           }
+          {
+            auto lhs = get_edge_sort_order(src_label_name, dst_label_name,
+                                           edge_label_name);
+            auto rhs = other.get_edge_sort_order(
+                src_label_name, dst_label_name, edge_label_name);
+            if (lhs != rhs) {
+              return false;
+            }
+          }
         }
       }
     }
@@ -398,11 +426,23 @@ EdgeStrategy StringToEdgeStrategy(const std::string& str) {
   }
 }
 
+EdgeSortOrder StringToEdgeSortOrder(const std::string& str) {
+  if (str == "Neighbor") {
+    return EdgeSortOrder::kByNeighbor;
+  } else if (str == "Data") {
+    return EdgeSortOrder::kByData;
+  } else {
+    return EdgeSortOrder::kNone;
+  }
+}
+
 StorageStrategy StringToStorageStrategy(const std::string& str) {
   if (str == "None") {
     return StorageStrategy::kNone;
   } else if (str == "Mem") {
     return StorageStrategy::kMem;
+  } else if (str == "Dict") {
+    return StorageStrategy::kDict;
   } else {
     return StorageStrategy::kMem;
   }
@@ -653,8 +693,12 @@ static bool parse_edge_schema(YAML::Node node, Schema& schema) {
     }
     EdgeStrategy ie = EdgeStrategy::kMultiple;
     EdgeStrategy oe = EdgeStrategy::kMultiple;
+    EdgeSortOrder sort_order = EdgeSortOrder::kNone;
     {
-      std::string ie_str, oe_str;
+      std::string ie_str, oe_str, sort_str;
+      if (get_scalar(cur_node, "edge_sort_order", sort_str)) {
+        sort_order = StringToEdgeSortOrder(sort_str);
+      }
       if (get_scalar(cur_node, "outgoing_edge_strategy", oe_str)) {
         oe = StringToEdgeStrategy(oe_str);
       }
@@ -666,7 +710,7 @@ static bool parse_edge_schema(YAML::Node node, Schema& schema) {
              << " to " << dst_label_name << " with " << property_types.size()
              << " properties";
     schema.add_edge_label(src_label_name, dst_label_name, edge_label_name,
-                          property_types, prop_names, oe, ie);
+                          property_types, prop_names, oe, ie, sort_order);
   }
 
   // check the type_id equals to storage's label_id
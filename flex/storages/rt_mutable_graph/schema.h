@@ -43,7 +43,8 @@ class Schema {
                       const std::vector<PropertyType>& properties,
                       const std::vector<std::string>& prop_names,
                       EdgeStrategy oe = EdgeStrategy::kMultiple,
-                      EdgeStrategy ie = EdgeStrategy::kMultiple);
+                      EdgeStrategy ie = EdgeStrategy::kMultiple,
+                      EdgeSortOrder sort_order = EdgeSortOrder::kNone);
 
   label_t vertex_label_num() const;
 
@@ -123,6 +124,11 @@ class Schema {
                                           const std::string& dst_label,
                                           const std::string& label) const;
 
+  // 快照中两个方向的邻接表均按此顺序排列
+  EdgeSortOrder get_edge_sort_order(const std::string& src_label,
+                                    const std::string& dst_label,
+                                    const std::string& label) const;
+
   bool contains_edge_label(const std::string& label) const;
 
   label_t get_edge_label_id(const std::string& label) const;
@@ -167,6 +173,7 @@ class Schema {
   std::map<uint32_t, std::vector<std::string>> eprop_names_;
   std::map<uint32_t, EdgeStrategy> oe_strategy_;
   std::map<uint32_t, EdgeStrategy> ie_strategy_;
+  std::map<uint32_t, EdgeSortOrder> sort_order_;
   std::vector<size_t> max_vnum_;
   std::vector<std::string> plugin_list_;
 };
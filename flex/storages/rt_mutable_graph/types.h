@@ -26,6 +26,13 @@ enum class EdgeStrategy {
   kMultiple,
 };
 
+// 快照中邻接表基础段的排列顺序
+enum class EdgeSortOrder : uint32_t {
+  kNone = 0,        // 插入顺序
+  kByNeighbor = 1,  // 按neighbor升序
+  kByData = 2,      // 按EDATA升序，EDATA相同时按neighbor升序
+};
+
 using timestamp_t = uint32_t;
 using vid_t = uint32_t;
 using oid_t = int64_t;
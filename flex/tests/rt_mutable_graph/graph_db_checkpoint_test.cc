@@ -0,0 +1,99 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+
+#include "flex/tests/rt_mutable_graph/graph_db_test_utils.h"
+
+#include "glog/logging.h"
+
+namespace gs {
+
+/**
+ * 插入、修改之后做增量checkpoint，重新打开后的图与关闭前相同。checkpoint
+ * 轮转了WAL，重新打开时只能从快照中读到这些数据。
+ */
+void test_checkpoint_reopen(const Schema& schema, const std::string& dir) {
+  load_graph(schema, dir);
+  graph_state_t expected;
+  {
+    GraphDB db;
+    db.Init(schema, dir, 1);
+    insert_graph(db);
+    update_graph(db, 2);
+    db.Checkpoint();
+    expected = collect(db);
+  }
+  CHECK_EQ(expected.ages.size(), kVertexNum + kAddedVertexNum);
+  CHECK_EQ(expected.out_edges.size(), (kVertexNum + kAddedVertexNum) * 3);
+  {
+    GraphDB db;
+    db.Init(schema, dir, 1);
+    check_same(collect(db), expected);
+  }
+  LOG(INFO) << "Finish test_checkpoint_reopen";
+}
+
+/**
+ * checkpoint之后继续修改，重新打开时由快照和之后的WAL恢复；再checkpoint
+ * 一次，以上一个快照为底的增量快照同样与关闭前相同。
+ */
+void test_checkpoint_after_reopen(const Schema& schema,
+                                  const std::string& dir) {
+  load_graph(schema, dir);
+  graph_state_t expected;
+  {
+    GraphDB db;
+    db.Init(schema, dir, 1);
+    insert_graph(db);
+    db.Checkpoint();
+    update_graph(db, 3);
+    expected = collect(db);
+  }
+  {
+    GraphDB db;
+    db.Init(schema, dir, 1);
+    check_same(collect(db), expected);
+    update_graph(db, 5);
+    db.Checkpoint();
+    expected = collect(db);
+  }
+  {
+    GraphDB db;
+    db.Init(schema, dir, 1);
+    check_same(collect(db), expected);
+  }
+  LOG(INFO) << "Finish test_checkpoint_after_reopen";
+}
+
+}  // namespace gs
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  gbp::BufferPoolManager::GetGlobalInstance().init(
+      1, CEIL(64ul * 1024 * 1024, gbp::PAGE_SIZE_MEMORY), 1);
+
+  std::string dir = (std::filesystem::temp_directory_path() /
+                     ("graph_db_checkpoint_test_" + std::to_string(getpid())))
+                        .string();
+  gs::Schema schema = gs::make_schema();
+  std::filesystem::remove_all(dir);
+  gs::test_checkpoint_reopen(schema, dir + "/reopen");
+  gs::test_checkpoint_after_reopen(schema, dir + "/after_reopen");
+  std::filesystem::remove_all(dir);
+  return 0;
+}
@@ -0,0 +1,148 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRAPHSCOPE_TESTS_RT_MUTABLE_GRAPH_GRAPH_DB_TEST_UTILS_H_
+#define GRAPHSCOPE_TESTS_RT_MUTABLE_GRAPH_GRAPH_DB_TEST_UTILS_H_
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "flex/engines/graph_db/database/graph_db.h"
+#include "flex/storages/rt_mutable_graph/loader/basic_fragment_loader.h"
+
+#include "glog/logging.h"
+
+namespace gs {
+
+constexpr label_t kPerson = 0;
+constexpr label_t kKnows = 0;
+// 导入的顶点数；打开之后顶点表的容量为其1.25倍，新增顶点不能超过四分之一
+constexpr oid_t kVertexNum = 64;
+constexpr oid_t kAddedVertexNum = 8;
+
+inline Schema make_schema() {
+  Schema schema;
+  schema.add_vertex_label("person", {PropertyType::kInt64}, {"age"},
+                          {std::make_tuple(PropertyType::kInt64, "id", 0)},
+                          {}, 1024);
+  schema.add_edge_label("person", "person", "knows", {PropertyType::kInt64},
+                        {"weight"});
+  return schema;
+}
+
+// 导入kVertexNum个没有边的顶点，age为oid
+inline void load_graph(const Schema& schema, const std::string& dir) {
+  BasicFragmentLoader loader(schema, dir);
+  IdIndexer<oid_t, vid_t> indexer;
+  for (oid_t oid = 0; oid < kVertexNum; ++oid) {
+    vid_t vid;
+    CHECK(indexer.add(oid, vid));
+    loader.GetVertexTable(kPerson).column_ptrs()[0]->set_any(
+        vid, Any::From<int64_t>(oid));
+  }
+  loader.FinishAddingVertex(kPerson, indexer);
+  loader.AddNoPropEdgeBatch<int64_t>(kPerson, kPerson, kKnows);
+  loader.LoadFragment();
+}
+
+using edge_list_t = std::vector<std::tuple<oid_t, oid_t, int64_t>>;
+
+struct graph_state_t {
+  std::map<oid_t, int64_t> ages;
+  edge_list_t out_edges;
+  edge_list_t in_edges;
+};
+
+inline graph_state_t collect(GraphDB& db) {
+  graph_state_t state;
+  auto txn = db.GetReadTransaction();
+  for (auto vit = txn.GetVertexIterator(kPerson); vit.IsValid(); vit.Next()) {
+    oid_t oid = vit.GetId();
+    state.ages[oid] = gbp::BufferBlock::Ref<int64_t>(vit.GetField(0));
+    for (auto eit =
+             txn.GetOutEdgeIterator(kPerson, vit.GetIndex(), kPerson, kKnows);
+         eit.IsValid(); eit.Next()) {
+      state.out_edges.emplace_back(
+          oid, txn.GetVertexId(kPerson, eit.GetNeighbor()),
+          *static_cast<const int64_t*>(eit.GetData()));
+    }
+    for (auto eit =
+             txn.GetInEdgeIterator(kPerson, vit.GetIndex(), kPerson, kKnows);
+         eit.IsValid(); eit.Next()) {
+      state.in_edges.emplace_back(
+          oid, txn.GetVertexId(kPerson, eit.GetNeighbor()),
+          *static_cast<const int64_t*>(eit.GetData()));
+    }
+  }
+  txn.Commit();
+  // 同一邻接表中边的顺序与写入路径有关，只比较集合
+  std::sort(state.out_edges.begin(), state.out_edges.end());
+  std::sort(state.in_edges.begin(), state.in_edges.end());
+  return state;
+}
+
+inline void check_same(const graph_state_t& lhs, const graph_state_t& rhs) {
+  CHECK(lhs.ages == rhs.ages);
+  CHECK(lhs.out_edges == rhs.out_edges);
+  CHECK(lhs.in_edges == rhs.in_edges);
+}
+
+inline void insert_graph(GraphDB& db) {
+  {
+    auto txn = db.GetInsertTransaction();
+    for (oid_t oid = kVertexNum; oid < kVertexNum + kAddedVertexNum; ++oid) {
+      CHECK(txn.AddVertex(kPerson, oid, {Any::From<int64_t>(oid)}));
+    }
+    txn.Commit();
+  }
+  // 每个事务写入一部分边，边分散在多个事务中
+  for (oid_t src = 0; src < kVertexNum + kAddedVertexNum; ++src) {
+    auto txn = db.GetInsertTransaction();
+    for (oid_t step = 1; step <= 3; ++step) {
+      oid_t dst = (src * 7 + step) % (kVertexNum + kAddedVertexNum);
+      CHECK(txn.AddEdge(kPerson, src, kPerson, dst, kKnows,
+                        Any::From<int64_t>(src * 100 + dst)));
+    }
+    txn.Commit();
+  }
+}
+
+// 修改已有顶点的属性和已有边的数据，两个方向的邻接表都修改
+inline void update_graph(GraphDB& db, int64_t factor) {
+  auto txn = db.GetUpdateTransaction();
+  auto& graph = db.graph();
+  for (oid_t oid = 0; oid < kVertexNum + kAddedVertexNum; oid += 3) {
+    vid_t lid;
+    CHECK(graph.get_lid(kPerson, oid, lid));
+    CHECK(txn.SetVertexField(kPerson, lid, 0,
+                             Any::From<int64_t>(oid * factor)));
+  }
+  for (oid_t src = 0; src < kVertexNum + kAddedVertexNum; src += 5) {
+    oid_t dst = (src * 7 + 1) % (kVertexNum + kAddedVertexNum);
+    vid_t src_lid, dst_lid;
+    CHECK(graph.get_lid(kPerson, src, src_lid));
+    CHECK(graph.get_lid(kPerson, dst, dst_lid));
+    Any value = Any::From<int64_t>(-(src * 100 + dst) * factor);
+    txn.SetEdgeData(true, kPerson, src_lid, kPerson, dst_lid, kKnows, value);
+    txn.SetEdgeData(false, kPerson, dst_lid, kPerson, src_lid, kKnows, value);
+  }
+  CHECK(txn.Commit());
+}
+
+}  // namespace gs
+
+#endif  // GRAPHSCOPE_TESTS_RT_MUTABLE_GRAPH_GRAPH_DB_TEST_UTILS_H_
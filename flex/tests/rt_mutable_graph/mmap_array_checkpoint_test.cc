@@ -0,0 +1,97 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+
+#include "flex/utils/mmap_array.h"
+
+#include "glog/logging.h"
+
+namespace gs {
+
+// 跨越多页，使脏页和image都不止一页
+constexpr size_t kElemNum = mmap_array<int64_t>::OBJ_NUM_PERPAGE * 4 + 7;
+
+void fill(mmap_array<int64_t>& array, int64_t factor) {
+  for (size_t i = 0; i < kElemNum; ++i) {
+    int64_t value = static_cast<int64_t>(i) * factor;
+    array.set(i, &value);
+  }
+}
+
+void check_file(const std::string& filename, int64_t factor) {
+  mmap_array<int64_t> array;
+  array.open(filename, true);
+  CHECK_EQ(array.size(), kElemNum) << filename;
+  for (size_t i = 0; i < kElemNum; ++i) {
+    CHECK_EQ(gbp::BufferBlock::Ref<int64_t>(array.get(i)),
+             static_cast<int64_t>(i) * factor)
+        << filename << " at " << i;
+  }
+}
+
+/**
+ * 数组checkpoint之后又写了几页，随后重新打开另一个文件。重新打开后的
+ * checkpoint不能以之前的image为底，也不能只写之前留下的脏页。
+ */
+void test_reopen_checkpoint(const std::string& dir) {
+  mmap_array<int64_t> array;
+  array.open(dir + "/a", false);
+  array.resize(kElemNum);
+  fill(array, 1);
+  array.checkpoint(dir + "/a.ckp");
+  check_file(dir + "/a.ckp", 1);
+
+  // 在a上留下脏页
+  int64_t value = -1;
+  array.set(0, &value);
+  array.set(kElemNum - 1, &value);
+
+  {
+    mmap_array<int64_t> other;
+    other.open(dir + "/b", false);
+    other.resize(kElemNum);
+    fill(other, 2);
+  }
+
+  array.open(dir + "/b", false);
+  array.checkpoint(dir + "/b.ckp");
+  check_file(dir + "/b.ckp", 2);
+
+  // 重新打开同一个文件后再做一次增量checkpoint，以b.ckp为底
+  value = 2 * 3;
+  array.set(3, &value);
+  array.checkpoint(dir + "/b2.ckp");
+  check_file(dir + "/b2.ckp", 2);
+  LOG(INFO) << "Finish test_reopen_checkpoint";
+}
+
+}  // namespace gs
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  gbp::BufferPoolManager::GetGlobalInstance().init(
+      1, CEIL(64ul * 1024 * 1024, gbp::PAGE_SIZE_MEMORY), 1);
+
+  std::string dir = (std::filesystem::temp_directory_path() /
+                     ("mmap_array_checkpoint_test_" + std::to_string(getpid())))
+                        .string();
+  std::filesystem::create_directories(dir);
+  gs::test_reopen_checkpoint(dir);
+  std::filesystem::remove_all(dir);
+  return 0;
+}
@@ -0,0 +1,116 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+
+#include "flex/tests/rt_mutable_graph/graph_db_test_utils.h"
+
+#include "glog/logging.h"
+
+namespace gs {
+
+constexpr int kThreadNum = 2;
+
+/**
+ * checkpoint之后的写入，只留在WAL中：两个会话交替提交，源顶点逆序，使WAL
+ * 中的边既不按会话也不按源顶点排列；中间的修改事务把回放分成两段。
+ */
+void write_tail(GraphDB& db) {
+  constexpr oid_t kTailVertexNum = 4;
+  constexpr oid_t kOldNum = kVertexNum + kAddedVertexNum;
+  {
+    auto txn = db.GetInsertTransaction(1);
+    for (oid_t oid = kOldNum; oid < kOldNum + kTailVertexNum; ++oid) {
+      CHECK(txn.AddVertex(kPerson, oid, {Any::From<int64_t>(oid)}));
+    }
+    txn.Commit();
+  }
+  for (oid_t src = kOldNum + kTailVertexNum - 1; src >= 0; src -= 2) {
+    auto txn = db.GetInsertTransaction(src % kThreadNum);
+    oid_t dst = (src * 11 + 5) % (kOldNum + kTailVertexNum);
+    CHECK(txn.AddEdge(kPerson, src, kPerson, dst, kKnows,
+                      Any::From<int64_t>(src * 1000 + dst)));
+    CHECK(txn.AddEdge(kPerson, dst, kPerson, src, kKnows,
+                      Any::From<int64_t>(dst * 1000 + src)));
+    txn.Commit();
+  }
+  update_graph(db, 7);
+  for (oid_t src = 0; src < kOldNum + kTailVertexNum; src += 3) {
+    auto txn = db.GetInsertTransaction(src % kThreadNum);
+    oid_t dst = (src + 1) % (kOldNum + kTailVertexNum);
+    CHECK(txn.AddEdge(kPerson, src, kPerson, dst, kKnows,
+                      Any::From<int64_t>(-src)));
+    txn.Commit();
+  }
+}
+
+graph_state_t replay(const Schema& schema, const std::string& dir,
+                     bool sorted) {
+  GraphDB db;
+  db.SetSortedWalReplay(sorted);
+  db.Init(schema, dir, kThreadNum);
+  return collect(db);
+}
+
+/**
+ * 同一段WAL尾部分别按WAL顺序和按邻接表排序回放，两者得到的图相同，且与
+ * 关闭前的图相同。
+ */
+void test_sorted_replay(const Schema& schema, const std::string& dir) {
+  std::string base = dir + "/base";
+  load_graph(schema, base);
+  graph_state_t expected;
+  {
+    GraphDB db;
+    db.Init(schema, base, kThreadNum);
+    insert_graph(db);
+    db.Checkpoint();
+    write_tail(db);
+    expected = collect(db);
+  }
+
+  // 回放会修改目录中的数据，两种回放各用一份副本
+  std::string unsorted_dir = dir + "/unsorted";
+  std::string sorted_dir = dir + "/sorted";
+  std::filesystem::copy(base, unsorted_dir,
+                        std::filesystem::copy_options::recursive);
+  std::filesystem::copy(base, sorted_dir,
+                        std::filesystem::copy_options::recursive);
+
+  graph_state_t unsorted = replay(schema, unsorted_dir, false);
+  graph_state_t sorted = replay(schema, sorted_dir, true);
+  check_same(unsorted, sorted);
+  check_same(sorted, expected);
+  LOG(INFO) << "Finish test_sorted_replay";
+}
+
+}  // namespace gs
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  gbp::BufferPoolManager::GetGlobalInstance().init(
+      1, CEIL(64ul * 1024 * 1024, gbp::PAGE_SIZE_MEMORY), 1);
+
+  std::string dir = (std::filesystem::temp_directory_path() /
+                     ("wal_replay_test_" + std::to_string(getpid())))
+                        .string();
+  gs::Schema schema = gs::make_schema();
+  std::filesystem::remove_all(dir);
+  gs::test_sorted_replay(schema, dir);
+  std::filesystem::remove_all(dir);
+  return 0;
+}
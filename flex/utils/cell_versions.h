@@ -0,0 +1,139 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GRAPHSCOPE_UTILS_CELL_VERSIONS_H_
+#define GRAPHSCOPE_UTILS_CELL_VERSIONS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace gs {
+
+/**
+ * @brief 原地修改的单元格(顶点属性、边数据)的旧版本。以时间戳ts覆盖一个
+ * 单元格之前，先把覆盖前的值以ts记录在这里，存储中始终是最新提交的值。读
+ * 时间戳小于ts的读者读完存储之后再查这里，取回它应当看到的值，因此原地修改
+ * 与读事务并发，不需要独占。活跃读事务的读时间戳都不小于ts之后，旧版本由
+ * reclaim回收。
+ */
+class CellVersions {
+ public:
+  CellVersions() = default;
+  CellVersions(const CellVersions&) = delete;
+  CellVersions& operator=(const CellVersions&) = delete;
+
+  // 同一个时间戳多次覆盖同一个单元格时只保留第一次覆盖前的值
+  void push(uint64_t key, uint32_t ts, std::string value) {
+    {
+      std::unique_lock<std::shared_mutex> lock(mutex_);
+      auto& versions = versions_[key];
+      if (versions.empty() || versions.back().ts != ts) {
+        versions.push_back({ts, std::move(value)});
+        num_.fetch_add(1);
+      }
+      if (ts > max_ts_.load()) {
+        max_ts_.store(ts);
+      }
+    }
+    // 旧版本先于存储中的新值可见
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  void push(uint64_t key, uint32_t ts, const void* data, size_t size) {
+    push(key, ts, std::string(static_cast<const char*>(data), size));
+  }
+
+  /**
+   * @brief 读时间戳为read_ts的读者看到的key的值，nullptr表示存储中的值即
+   * 可见。须在读完存储之后调用；返回的值在读者释放读时间戳之前有效。
+   */
+  const std::string* find(uint64_t key, uint32_t read_ts) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (max_ts_.load() <= read_ts) {
+      return nullptr;
+    }
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto iter = versions_.find(key);
+    if (iter == versions_.end()) {
+      return nullptr;
+    }
+    // 按时间戳递增排列，第一个晚于read_ts的覆盖之前的值即为所求
+    for (auto& version : iter->second) {
+      if (version.ts > read_ts) {
+        return &version.value;
+      }
+    }
+    return nullptr;
+  }
+
+  // 有晚于read_ts的覆盖时，读者需要逐个单元格查找
+  bool newer_than(uint32_t read_ts) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return max_ts_.load() > read_ts;
+  }
+
+  // 回收时间戳不超过min_ts的旧版本，min_ts为活跃读事务的最小读时间戳。
+  // 返回回收的版本数
+  size_t reclaim(uint32_t min_ts) {
+    if (num_.load() == 0) {
+      return 0;
+    }
+    size_t reclaimed = 0;
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (auto iter = versions_.begin(); iter != versions_.end();) {
+      auto& versions = iter->second;
+      while (!versions.empty() && versions.front().ts <= min_ts) {
+        versions.pop_front();
+        ++reclaimed;
+      }
+      if (versions.empty()) {
+        iter = versions_.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+    num_.fetch_sub(reclaimed);
+    return reclaimed;
+  }
+
+  size_t size() const { return num_.load(); }
+
+ private:
+  struct version_t {
+    uint32_t ts;
+    std::string value;
+  };
+
+  // deque的push_back和pop_front不移动其他元素，find返回的指针保持有效
+  std::unordered_map<uint64_t, std::deque<version_t>> versions_;
+  mutable std::shared_mutex mutex_;
+  std::atomic<uint32_t> max_ts_{0};
+  std::atomic<size_t> num_{0};
+};
+
+// 邻接表中v到nbr的边在CellVersions中的key
+inline uint64_t edge_version_key(uint32_t v, uint32_t nbr) {
+  return (static_cast<uint64_t>(v) << 32) | nbr;
+}
+
+}  // namespace gs
+
+#endif  // GRAPHSCOPE_UTILS_CELL_VERSIONS_H_
@@ -26,6 +26,7 @@ limitations under the License.
 #include <mutex>
 #include <string_view>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include "flat_hash_map/flat_hash_map.hpp"
@@ -214,6 +215,7 @@ class LFIndexer {
       auto item1 = keys_.get(ind);
       gbp::BufferBlock::UpdateContent<int64_t>(
           [&](int64_t& item) { item = oid; }, item1);
+      keys_.mark_dirty(ind);
     }
     size_t index =
         hash_policy_.index_for_hash(hasher_(oid), num_slots_minus_one_);
@@ -253,6 +255,7 @@ class LFIndexer {
           },
           items, index - start_index);
       if (mark) {
+        indices_.mark_dirty(index);
         break;
       }
       index = (index + 1) % num_slots_minus_one_;
@@ -378,10 +381,77 @@ class LFIndexer {
 
     return false;
   }
-  gbp::batch_request_type get_index_batch(int64_t oid, INDEX_T& ret,
-                                          bool& success) const {
-    assert(false);
-    return gbp::batch_request_type();
+  // 批量查找：先算出所有oid的hash槽位，落在同一页上的探测合并成一个请求，
+  // 一次GetBlockBatch取回后在内存中完成线性探测；探测越过页尾的oid进入下一轮
+  void get_index_batch(const std::vector<int64_t>& oids,
+                       std::vector<INDEX_T>& rets,
+                       std::vector<bool>& exists) const {
+    static constexpr INDEX_T sentinel = std::numeric_limits<INDEX_T>::max();
+    const size_t obj_num_perpage = indices_.OBJ_NUM_PERPAGE;
+    rets.resize(oids.size());
+    exists.assign(oids.size(), false);
+
+    std::vector<size_t> probes(oids.size());
+    std::vector<size_t> pending(oids.size());
+    for (size_t i = 0; i < oids.size(); ++i) {
+      probes[i] =
+          hash_policy_.index_for_hash(hasher_(oids[i]), num_slots_minus_one_);
+      pending[i] = i;
+    }
+
+    std::vector<gbp::batch_request_type> requests;
+    std::vector<gbp::BufferBlock> blocks;
+    std::vector<size_t> request_ids;
+    std::unordered_map<size_t, size_t> page_to_request;
+    while (!pending.empty()) {
+      requests.clear();
+      blocks.clear();
+      page_to_request.clear();
+      request_ids.resize(pending.size());
+      for (size_t k = 0; k < pending.size(); ++k) {
+        size_t page_id = probes[pending[k]] / obj_num_perpage;
+        auto iter = page_to_request.find(page_id);
+        if (iter == page_to_request.end()) {
+          size_t start = page_id * obj_num_perpage;
+          size_t len = std::min(obj_num_perpage, indices_.size() - start);
+          iter = page_to_request.emplace(page_id, requests.size()).first;
+          requests.emplace_back(indices_.get_batch(start, len));
+        }
+        request_ids[k] = iter->second;
+      }
+      blocks.reserve(requests.size());
+      gbp::BufferPoolManager::GetGlobalInstance().GetBlockBatch(requests,
+                                                                blocks);
+      record_block_batch(blocks);
+
+      size_t remaining = 0;
+      for (size_t k = 0; k < pending.size(); ++k) {
+        size_t i = pending[k];
+        size_t& index = probes[i];
+        size_t start = index / obj_num_perpage * obj_num_perpage;
+        size_t end = start + std::min(obj_num_perpage, indices_.size() - start);
+        auto& block = blocks[request_ids[k]];
+        bool finished = false;
+        while (index >= start && index < end) {
+          auto& item = gbp::BufferBlock::Ref<index_key_item<INDEX_T>>(
+              block, index - start);
+          if (item.index == sentinel) {
+            finished = true;
+            break;
+          } else if (item.key == oids[i]) {
+            rets[i] = item.index;
+            exists[i] = true;
+            finished = true;
+            break;
+          }
+          index = (index + 1) % num_slots_minus_one_;
+        }
+        if (!finished) {
+          pending[remaining++] = i;
+        }
+      }
+      pending.resize(remaining);
+    }
   }
 
   int64_t get_key(const INDEX_T& index) const {
@@ -431,6 +501,15 @@ class LFIndexer {
     dump_meta(snapshot_dir + "/" + name + ".meta");
   }
 
+#if !OV
+  // 与dump不同，checkpoint之后索引仍可继续插入，只写出上次以来的脏页
+  void checkpoint(const std::string& name, const std::string& snapshot_dir) {
+    keys_.checkpoint(snapshot_dir + "/" + name + ".keys");
+    indices_.checkpoint(snapshot_dir + "/" + name + ".indices");
+    dump_meta(snapshot_dir + "/" + name + ".meta");
+  }
+#endif
+
   void dump_meta(const std::string& filename) const {
     grape::InArchive arc;
     arc << num_slots_minus_one_ << hash_policy_.get_mod_function_index();
@@ -689,6 +768,9 @@ class IdIndexer {
 
   bool empty() const { return (num_elements_ == 0); }
 
+  // 清空后可以继续复用
+  void clear() { reset_to_empty_state(); }
+
   size_t size() const { return num_elements_; }
 
   bool get_key(INDEX_T lid, KEY_T& oid) const {
@@ -0,0 +1,106 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GRAPHSCOPE_UTILS_IO_COUNTERS_H_
+#define GRAPHSCOPE_UTILS_IO_COUNTERS_H_
+
+#include <sys/resource.h>
+#include <time.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gs {
+
+/**
+ * @brief 当前线程经由缓冲池取页的累计请求数和字节数，查询开始和结束时各取
+ * 一次求差。单次的get()和批量的GetBlockBatch都计入，不在取页路径上计时。
+ * faults是其他线程(如预取)代本线程取页时发生的major fault，由等待结果的
+ * 线程通过merge_io_counters()计入；本线程自己的major fault在
+ * io_counters_snapshot()中读取。
+ */
+struct IOCounters {
+  uint64_t requests = 0;
+  uint64_t bytes = 0;
+  uint64_t faults = 0;
+};
+
+inline IOCounters& thread_io_counters() {
+  static thread_local IOCounters counters;
+  return counters;
+}
+
+// CLOCK_MONOTONIC_COARSE精度不够，这里用vdso中的CLOCK_MONOTONIC
+inline uint64_t io_clock_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+inline void record_block_request(size_t bytes) {
+  auto& counters = thread_io_counters();
+  ++counters.requests;
+  counters.bytes += bytes;
+}
+
+// 批量取页的每个请求计一次，字节数按取回的块计
+template <typename BLOCK_T>
+inline void record_block_batch(const std::vector<BLOCK_T>& blocks) {
+  auto& counters = thread_io_counters();
+  counters.requests += blocks.size();
+  for (auto& block : blocks) {
+    counters.bytes += block.Size();
+  }
+}
+
+/**
+ * @brief 当前线程的major page fault累计数。缓冲池的同步接口不返回是否命中，
+ * 未命中的页由缺页从磁盘读入，major fault数即为未命中数(与
+ * PROFILE_PAGE_FAULT统计的是同一个量)。缓冲池自己的I/O线程上的读取不在
+ * 其中，/interactive/stats中注明了这一来源。
+ */
+inline uint64_t thread_major_faults() {
+  struct rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return usage.ru_majflt;
+}
+
+// 本线程的累计计数，faults包含本线程的major fault和其他线程代为取页的部分
+inline IOCounters io_counters_snapshot() {
+  IOCounters ret = thread_io_counters();
+  ret.faults += thread_major_faults();
+  return ret;
+}
+
+inline IOCounters operator-(const IOCounters& lhs, const IOCounters& rhs) {
+  IOCounters ret;
+  ret.requests = lhs.requests - rhs.requests;
+  ret.bytes = lhs.bytes - rhs.bytes;
+  ret.faults = lhs.faults - rhs.faults;
+  return ret;
+}
+
+// 把在其他线程上代为取页的开销(两次io_counters_snapshot()之差)计入本线程
+inline void merge_io_counters(const IOCounters& delta) {
+  auto& counters = thread_io_counters();
+  counters.requests += delta.requests;
+  counters.bytes += delta.bytes;
+  counters.faults += delta.faults;
+}
+
+}  // namespace gs
+
+#endif  // GRAPHSCOPE_UTILS_IO_COUNTERS_H_
@@ -18,7 +18,9 @@
 
 #include <assert.h>
 #include <fcntl.h>
+#include <linux/fs.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -28,10 +30,16 @@
 #include <algorithm>
 #include <atomic>
 #include <filesystem>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include "flex/graphscope_bufferpool/include/buffer_pool_manager.h"
+#include "flex/utils/io_counters.h"
 #include "glog/logging.h"
 
 namespace gs {
@@ -39,6 +47,29 @@ namespace gs {
 #define FILE_FLAG O_DIRECT
 #define MMAP_ADVICE_l MADV_RANDOM
 
+// 复制[offset, offset + len)，源和目的文件中的偏移相同
+inline bool copy_file_range_at(int src_fd, int dst_fd, off_t offset,
+                               size_t len) {
+  off_t src_off = offset, dst_off = offset;
+  while (len > 0) {
+    ssize_t ret = copy_file_range(src_fd, &src_off, dst_fd, &dst_off, len, 0);
+    if (ret == -1) {
+      perror("copy_file_range");
+      return false;
+    }
+    if (ret == 0) {
+      break;
+    }
+    len -= ret;
+  }
+  return true;
+}
+
+/**
+ * @brief 复制快照文件。优先用reflink(FICLONE)与src共享数据块，只有之后被
+ * 写入的页才会分配新的块，打开快照只需要修改元数据；文件系统不支持时只复制
+ * 有数据的区间，src中的空洞(例如预留的邻接表空间)在dst中仍是空洞。
+ */
 inline void copy_file(const std::string& src, const std::string& dst) {
   if (!std::filesystem::exists(src)) {
     LOG(ERROR) << "file not exists: " << src;
@@ -48,21 +79,206 @@ inline void copy_file(const std::string& src, const std::string& dst) {
   size_t len = std::filesystem::file_size(src);
 
   int src_fd = ::open(src.c_str(), O_RDONLY, 0777);
-  int dst_fd = ::open(dst.c_str(), O_WRONLY | O_CREAT, 0777);
+  int dst_fd = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0777);
+  if (src_fd == -1 || dst_fd == -1) {
+    perror("open");
+    if (src_fd != -1) {
+      ::close(src_fd);
+    }
+    if (dst_fd != -1) {
+      ::close(dst_fd);
+    }
+    return;
+  }
 
-  ssize_t ret;
-  do {
-    ret = copy_file_range(src_fd, NULL, dst_fd, NULL, len, 0);
-    if (ret == -1) {
-      perror("copy_file_range");
-      return;
+#ifdef FICLONE
+  if (::ioctl(dst_fd, FICLONE, src_fd) == 0) {
+    ::close(src_fd);
+    ::close(dst_fd);
+    return;
+  }
+#endif
+
+  if (::ftruncate(dst_fd, len) != 0) {
+    perror("ftruncate");
+  }
+  off_t data = ::lseek(src_fd, 0, SEEK_DATA);
+  if (data == -1 && errno != ENXIO) {
+    // 不支持SEEK_DATA时整个复制
+    copy_file_range_at(src_fd, dst_fd, 0, len);
+  } else {
+    while (data != -1 && static_cast<size_t>(data) < len) {
+      off_t hole = ::lseek(src_fd, data, SEEK_HOLE);
+      if (hole == -1) {
+        hole = len;
+      }
+      if (!copy_file_range_at(src_fd, dst_fd, data, hole - data)) {
+        break;
+      }
+      data = ::lseek(src_fd, hole, SEEK_DATA);
     }
-    len -= ret;
-  } while (len > 0 && ret > 0);
+  }
   ::close(src_fd);
   ::close(dst_fd);
 }
 
+#if !OV
+// 按页布局写文件时每次pwrite的页数
+constexpr size_t kWriteBatchPages = 64;
+
+/**
+ * @brief 按页布局顺序写入一个新文件，与mmap_array的文件格式相同。元素先写入
+ * 内存中的缓冲区，攒够kWriteBatchPages页之后一次写出，dump时代替逐个元素
+ * 经由缓冲池写入。
+ */
+template <typename T>
+class paged_file_writer {
+ public:
+  static constexpr size_t kObjNumPerPage = gbp::PAGE_SIZE_FILE / sizeof(T);
+
+  explicit paged_file_writer(const std::string& filename)
+      : filename_(filename),
+        buf_(kWriteBatchPages * gbp::PAGE_SIZE_FILE),
+        buf_offset_(0),
+        buf_size_(0),
+        size_(0) {
+    fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK_NE(fd_, -1) << "Failed to open " << filename;
+  }
+
+  ~paged_file_writer() { close(); }
+
+  void append(const T* data, size_t num) {
+    while (num > 0) {
+      size_t n = std::min(num, kObjNumPerPage - size_ % kObjNumPerPage);
+      size_t pos = offset_of(size_) - buf_offset_;
+      if (pos + n * sizeof(T) > buf_.size()) {
+        flush();
+        continue;
+      }
+      memcpy(buf_.data() + pos, data, n * sizeof(T));
+      buf_size_ = pos + n * sizeof(T);
+      data += n;
+      num -= n;
+      size_ += n;
+    }
+  }
+
+  void append(const T& item) { append(&item, 1); }
+
+  size_t size() const { return size_; }
+
+  void close() {
+    if (fd_ == -1) {
+      return;
+    }
+    flush();
+    CHECK_EQ(::ftruncate(fd_, offset_of(size_)), 0);
+    CHECK_EQ(::fdatasync(fd_), 0);
+    ::close(fd_);
+    fd_ = -1;
+  }
+
+ private:
+  static off_t offset_of(size_t idx) {
+    return (idx / kObjNumPerPage) * gbp::PAGE_SIZE_FILE +
+           (idx % kObjNumPerPage) * sizeof(T);
+  }
+
+  void flush() {
+    if (buf_size_ != 0) {
+      CHECK_EQ(::pwrite(fd_, buf_.data(), buf_size_, buf_offset_),
+               static_cast<ssize_t>(buf_size_))
+          << "Failed to write " << filename_;
+    }
+    buf_offset_ = offset_of(size_);
+    buf_size_ = 0;
+  }
+
+  std::string filename_;
+  int fd_;
+  std::vector<char> buf_;
+  off_t buf_offset_;  // 缓冲区对应的文件偏移
+  size_t buf_size_;
+  size_t size_;  // 已写入的元素数
+};
+
+/**
+ * @brief 记录自上次checkpoint以来被写过的页。两级位图，第二级按需分配，
+ * 标记和取出都是无锁的，可以与插入并发。
+ */
+class dirty_page_set {
+ public:
+  static constexpr size_t kPagesPerChunk = 1ul << 18;
+  static constexpr size_t kMaxChunkNum = 1ul << 10;
+  static constexpr size_t kWordsPerChunk = kPagesPerChunk / 64;
+
+  dirty_page_set()
+      : chunks_(new std::atomic<std::atomic<uint64_t>*>[kMaxChunkNum]) {
+    for (size_t k = 0; k < kMaxChunkNum; ++k) {
+      chunks_[k].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+  ~dirty_page_set() {
+    for (size_t k = 0; k < kMaxChunkNum; ++k) {
+      delete[] chunks_[k].load(std::memory_order_relaxed);
+    }
+  }
+
+  // 标记[first, last]号页
+  void mark(size_t first, size_t last) {
+    for (size_t page = first; page <= last; ++page) {
+      auto* chunk = get_chunk(page / kPagesPerChunk);
+      size_t bit = page % kPagesPerChunk;
+      auto& word = chunk[bit / 64];
+      uint64_t mask = 1ul << (bit % 64);
+      if ((word.load(std::memory_order_relaxed) & mask) == 0) {
+        word.fetch_or(mask, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // 取出并清空所有脏页号，按升序返回
+  std::vector<size_t> take() {
+    std::vector<size_t> pages;
+    for (size_t k = 0; k < kMaxChunkNum; ++k) {
+      auto* chunk = chunks_[k].load(std::memory_order_acquire);
+      if (chunk == nullptr) {
+        continue;
+      }
+      for (size_t w = 0; w < kWordsPerChunk; ++w) {
+        uint64_t bits = chunk[w].load(std::memory_order_relaxed) == 0
+                            ? 0
+                            : chunk[w].exchange(0, std::memory_order_relaxed);
+        while (bits != 0) {
+          size_t bit = __builtin_ctzll(bits);
+          pages.push_back(k * kPagesPerChunk + w * 64 + bit);
+          bits &= bits - 1;
+        }
+      }
+    }
+    return pages;
+  }
+
+ private:
+  std::atomic<uint64_t>* get_chunk(size_t chunk_id) {
+    CHECK_LT(chunk_id, kMaxChunkNum);
+    auto* chunk = chunks_[chunk_id].load(std::memory_order_acquire);
+    if (chunk != nullptr) {
+      return chunk;
+    }
+    auto* new_chunk = new std::atomic<uint64_t>[kWordsPerChunk]();
+    if (chunks_[chunk_id].compare_exchange_strong(chunk, new_chunk)) {
+      return new_chunk;
+    }
+    delete[] new_chunk;
+    return chunk;
+  }
+
+  std::unique_ptr<std::atomic<std::atomic<uint64_t>*>[]> chunks_;
+};
+#endif
+
 template <typename T>
 class mmap_array {
  public:
@@ -74,7 +290,8 @@ class mmap_array {
       : filename_(""),
         size_(0),
         read_only_(true),
-        fd_gbp_(gbp::INVALID_FILE_HANDLE) {
+        fd_gbp_(gbp::INVALID_FILE_HANDLE),
+        dirty_(new dirty_page_set()) {
     buffer_pool_manager_ = &gbp::BufferPoolManager::GetGlobalInstance();
   }
   mmap_array(const mmap_array& other) = delete;
@@ -170,6 +387,9 @@ class mmap_array {
     reset();
     filename_ = filename;
     read_only_ = read_only;
+    // 重新打开后内容与之前的image和脏页无关，下一次checkpoint写出全部元素
+    image_.clear();
+    dirty_->take();
     if (read_only) {
       if (!std::filesystem::exists(filename)) {
         LOG(ERROR) << "file not exists: " << filename;
@@ -305,10 +525,15 @@ class mmap_array {
     open(filename, false);
   }
 #else
+  // 快照文件不可修改，写入发生在filename上；copy_file尽量共享src的数据块，
+  // 打开的代价与文件大小无关
   void touch(const std::string& filename) {
     close();
-    copy_file(filename_, filename);
+    std::string src = filename_;
+    copy_file(src, filename);
     open(filename, false);
+    // 拷贝出的文件与src逐字节相同，增量checkpoint以src为底
+    image_ = src;
   }
 #endif
 
@@ -330,6 +555,85 @@ class mmap_array {
     buffer_pool_manager_->SetBlock(reinterpret_cast<const char*>(val),
                                    idx * sizeof(T), len * sizeof(T), fd_gbp_,
                                    false);
+    mark_dirty(idx, len);
+  }
+
+  std::vector<size_t> take_dirty_pages() { return dirty_->take(); }
+
+  // 通过get()返回的BufferBlock原地修改元素之后，调用方需标记对应的页
+  void mark_dirty(size_t idx, size_t len = 1) {
+    if (len != 0) {
+      dirty_->mark(idx / OBJ_NUM_PERPAGE, (idx + len - 1) / OBJ_NUM_PERPAGE);
+    }
+  }
+
+  /**
+   * @brief 增量checkpoint：以上一次持久化的同布局文件(image)为底，只写入
+   * 自那以后的脏页和超出image的部分；没有image时写入全部元素。只写前size个
+   * 元素，不改变本数组，完成后filename成为新的image。
+   */
+  void checkpoint(const std::string& filename,
+                  size_t size = std::numeric_limits<size_t>::max()) {
+    size = std::min(size, size_);
+    std::vector<size_t> dirty_pages = dirty_->take();
+    size_t image_size = 0;
+    if (!image_.empty() && std::filesystem::exists(image_)) {
+      copy_file(image_, filename);
+      size_t file_size = std::filesystem::file_size(image_);
+      image_size = (file_size / gbp::PAGE_SIZE_FILE) * OBJ_NUM_PERPAGE +
+                   (file_size % gbp::PAGE_SIZE_FILE) / sizeof(T);
+      image_size = std::min(image_size, size);
+    }
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT, 0644);
+    CHECK_NE(fd, -1) << "Failed to open " << filename;
+    for (auto page : dirty_pages) {
+      size_t begin = page * OBJ_NUM_PERPAGE;
+      if (begin >= image_size) {
+        break;
+      }
+      size_t end = std::min(begin + OBJ_NUM_PERPAGE, image_size);
+      write_to_file(fd, begin, end - begin, begin);
+    }
+    if (size > image_size) {
+      write_to_file(fd, image_size, size - image_size, image_size);
+    }
+    CHECK_EQ(::ftruncate(fd, file_offset(size)), 0);
+    CHECK_EQ(::fdatasync(fd), 0);
+    ::close(fd);
+    image_ = filename;
+  }
+
+  // 按页布局存放时idx号元素在文件中的偏移，也是前idx个元素的文件大小
+  static off_t file_offset(size_t idx) {
+    return (idx / OBJ_NUM_PERPAGE) * gbp::PAGE_SIZE_FILE +
+           (idx % OBJ_NUM_PERPAGE) * sizeof(T);
+  }
+
+  /**
+   * @brief 将[idx, idx + len)号元素按页布局写入fd中dst_idx号元素开始的位置。
+   * 按整页从缓冲池中复制，攒够kWriteBatchPages页再合并为一次pwrite。
+   */
+  void write_to_file(int fd, size_t idx, size_t len, size_t dst_idx) const {
+    std::vector<char> buf(kWriteBatchPages * gbp::PAGE_SIZE_FILE);
+    while (len > 0) {
+      off_t buf_offset = file_offset(dst_idx);
+      size_t buf_size = 0;
+      while (len > 0) {
+        size_t num = std::min({len, OBJ_NUM_PERPAGE - idx % OBJ_NUM_PERPAGE,
+                               OBJ_NUM_PERPAGE - dst_idx % OBJ_NUM_PERPAGE});
+        size_t pos = file_offset(dst_idx) - buf_offset;
+        if (pos + num * sizeof(T) > buf.size()) {
+          break;
+        }
+        get(idx, num).Copy(buf.data() + pos, num * sizeof(T));
+        buf_size = pos + num * sizeof(T);
+        idx += num;
+        dst_idx += num;
+        len -= num;
+      }
+      CHECK_EQ(::pwrite(fd, buf.data(), buf_size, buf_offset),
+               static_cast<ssize_t>(buf_size));
+    }
   }
 
   // // FIXME: 无法保证atomic
@@ -385,11 +689,14 @@ class mmap_array {
     // fd_gbp_);
 
 #if USING_DIRECT_CACHE
-    return buffer_pool_manager_->GetBlockWithDirectCacheSync(file_offset,
-                                                             buf_size, fd_gbp_);
+    auto ret = buffer_pool_manager_->GetBlockWithDirectCacheSync(
+        file_offset, buf_size, fd_gbp_);
 #else
-    return buffer_pool_manager_->GetBlockSync(file_offset, buf_size, fd_gbp_);
+    auto ret =
+        buffer_pool_manager_->GetBlockSync(file_offset, buf_size, fd_gbp_);
 #endif
+    record_block_request(buf_size);
+    return ret;
 
     // if (gbp::warmup_mark() == 1 && (fd_gbp_ == 165 || fd_gbp_ == 169)) {
     //   for (size_t id = 0; id < len; id++)
@@ -479,6 +786,8 @@ class mmap_array {
     std::swap(fd_gbp_, rhs.fd_gbp_);
     std::swap(size_, rhs.size_);
     std::swap(buffer_pool_manager_, rhs.buffer_pool_manager_);
+    std::swap(image_, rhs.image_);
+    std::swap(dirty_, rhs.dirty_);
     rhs.fd_gbp_ = gbp::INVALID_FILE_HANDLE;
   }
 
@@ -525,6 +834,8 @@ class mmap_array {
   size_t size_;
   bool read_only_;
   mutable bool restart_finish_ = false;
+  std::string image_;  // 最近一次与本数组内容一致的持久化文件
+  std::unique_ptr<dirty_page_set> dirty_;
 #endif
 };
 
@@ -566,6 +877,14 @@ class mmap_array<std::string_view> {
     items_.resize(size);
     data_.resize(data_size);
   }
+
+#if !OV
+  void checkpoint(const std::string& filename, size_t size,
+                  size_t data_size) {
+    items_.checkpoint(filename + ".items", size);
+    data_.checkpoint(filename + ".data", data_size);
+  }
+#endif
 #if OV
   void set(size_t idx, size_t offset, const std::string_view& val) {
     items_.set(idx, {offset, static_cast<uint32_t>(val.size())});
@@ -577,6 +896,12 @@ class mmap_array<std::string_view> {
     items_.set(idx, &string_item_obj);
     data_.set(offset, val.data(), val.size());
   }
+
+  // 只写入第idx行的位置，数据由调用方存放在别处
+  void set_item(size_t idx, size_t offset, size_t length) {
+    string_item string_item_obj = {offset, static_cast<uint32_t>(length)};
+    items_.set(idx, &string_item_obj);
+  }
 #endif
 
 #if OV
@@ -605,6 +930,15 @@ class mmap_array<std::string_view> {
     return items_.get_batch(idx);
   }
 
+  gbp::BufferBlock get_item(size_t idx) const { return items_.get(idx); }
+  gbp::BufferBlock get_data(size_t offset, size_t len) const {
+    return data_.get(offset, len);
+  }
+  std::future<gbp::BufferBlock> get_data_async(size_t offset,
+                                               size_t len) const {
+    return data_.get_async(offset, len);
+  }
+
 #endif
 
   size_t get_size_in_byte() const {
@@ -625,6 +959,149 @@ class mmap_array<std::string_view> {
   mmap_array<char> data_;
 };
 
+#if !OV
+/**
+ * @brief 运行期间按需增长的数组，由单独打开的mmap_array段组成。第k段容纳
+ * base_size << k个元素，创建时一次设置好文件大小，之后不再resize；增长只是
+ * 打开新的段再发布它的指针，已有段的文件和大小都不变，因此读者可以不加锁地
+ * 与增长并发访问已分配的元素。按区间访问的接口要求区间不跨段，分配时用
+ * fit()找到不跨段的位置。运行期间的内容在dump或checkpoint时另行写出，
+ * 每次open都从空开始。
+ */
+template <typename T>
+class segmented_mmap_array {
+ public:
+  static constexpr size_t kMaxSegmentNum = 32;
+  static constexpr size_t OBJ_NUM_PERPAGE = mmap_array<T>::OBJ_NUM_PERPAGE;
+
+  segmented_mmap_array()
+      : base_size_(OBJ_NUM_PERPAGE),
+        segments_(new std::atomic<mmap_array<T>*>[kMaxSegmentNum]) {
+    for (size_t k = 0; k < kMaxSegmentNum; ++k) {
+      segments_[k].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+  segmented_mmap_array(const segmented_mmap_array&) = delete;
+  segmented_mmap_array& operator=(const segmented_mmap_array&) = delete;
+  ~segmented_mmap_array() { reset(); }
+
+  // 段文件为<prefix>.<k>；base_size取整到整页，使段的边界与页对齐
+  void open(const std::string& prefix, size_t base_size) {
+    reset();
+    prefix_ = prefix;
+    base_size_ = std::max<size_t>(
+        (base_size + OBJ_NUM_PERPAGE - 1) / OBJ_NUM_PERPAGE * OBJ_NUM_PERPAGE,
+        OBJ_NUM_PERPAGE);
+  }
+
+  // 只能在没有读者时调用
+  void reset() {
+    for (size_t k = 0; k < kMaxSegmentNum; ++k) {
+      delete segments_[k].exchange(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  // 不小于begin、能放下[idx, idx + num)且不跨段的第一个位置idx
+  size_t fit(size_t begin, size_t num) const {
+    size_t k = segment_id(begin);
+    while (begin + num > segment_begin(k + 1)) {
+      ++k;
+      begin = segment_begin(k);
+    }
+    CHECK_LT(k, kMaxSegmentNum) << "Too many segments in " << prefix_;
+    return begin;
+  }
+
+  // 打开idx所在的段，可以与读者和其他ensure并发
+  void ensure(size_t idx) {
+    size_t k = segment_id(idx);
+    CHECK_LT(k, kMaxSegmentNum) << "Too many segments in " << prefix_;
+    if (segments_[k].load(std::memory_order_acquire) != nullptr) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(lock_);
+    if (segments_[k].load(std::memory_order_relaxed) != nullptr) {
+      return;
+    }
+    auto* segment = new mmap_array<T>();
+    segment->open(prefix_ + "." + std::to_string(k), false);
+    // 清除上一次运行留下的内容
+    segment->resize(0);
+    segment->resize(segment_size(k));
+    segments_[k].store(segment, std::memory_order_release);
+  }
+
+  bool contains(size_t idx) const {
+    size_t k = segment_id(idx);
+    return k < kMaxSegmentNum &&
+           segments_[k].load(std::memory_order_acquire) != nullptr;
+  }
+
+  // idx所在段的结束位置
+  size_t segment_end(size_t idx) const {
+    return segment_begin(segment_id(idx) + 1);
+  }
+
+  // idx所在的段，offset返回段内的下标
+  const mmap_array<T>* segment(size_t idx, size_t& offset) const {
+    size_t k = segment_id(idx);
+    offset = idx - segment_begin(k);
+    return segments_[k].load(std::memory_order_acquire);
+  }
+  mmap_array<T>* segment(size_t idx, size_t& offset) {
+    size_t k = segment_id(idx);
+    offset = idx - segment_begin(k);
+    return segments_[k].load(std::memory_order_acquire);
+  }
+
+  const gbp::BufferBlock get(size_t idx, size_t len = 1) const {
+    size_t offset;
+    return segment(idx, offset)->get(offset, len);
+  }
+
+  const std::future<gbp::BufferBlock> get_async(size_t idx,
+                                                size_t len = 1) const {
+    size_t offset;
+    return segment(idx, offset)->get_async(offset, len);
+  }
+
+  const gbp::batch_request_type get_batch(size_t idx, size_t len = 1) const {
+    size_t offset;
+    return segment(idx, offset)->get_batch(offset, len);
+  }
+
+  void set(size_t idx, const T* val, size_t len = 1) {
+    size_t offset;
+    segment(idx, offset)->set(offset, val, len);
+  }
+
+  size_t get_size_in_byte() const {
+    size_t ret = 0;
+    for (size_t k = 0; k < kMaxSegmentNum; ++k) {
+      auto* segment = segments_[k].load(std::memory_order_acquire);
+      if (segment != nullptr) {
+        ret += segment->get_size_in_byte();
+      }
+    }
+    return ret;
+  }
+
+ private:
+  size_t segment_id(size_t idx) const {
+    return 63 - __builtin_clzll(idx / base_size_ + 1);
+  }
+  size_t segment_begin(size_t k) const {
+    return base_size_ * ((1ul << k) - 1);
+  }
+  size_t segment_size(size_t k) const { return base_size_ << k; }
+
+  std::string prefix_;
+  size_t base_size_;
+  std::unique_ptr<std::atomic<mmap_array<T>*>[]> segments_;
+  std::mutex lock_;
+};
+#endif
+
 }  // namespace gs
 
 #endif  // GRAPHSCOPE_UTILS_MMAP_ARRAY_H_
@@ -30,6 +30,9 @@ class TypedEmptyColumn : public ColumnBase {
             const std::string& work_dir) override {}
   void touch(const std::string& filename) override {}
   void dump(const std::string& filename) override {}
+#if !OV
+  void checkpoint(const std::string& filename, size_t size) override {}
+#endif
   size_t size() const override { return 0; }
   void resize(size_t size) override {}
 
@@ -91,7 +94,16 @@ std::shared_ptr<ColumnBase> CreateColumn(PropertyType type,
                  << static_cast<int>(type);
       return nullptr;
     }
+  } else if (strategy == StorageStrategy::kDict &&
+             type == PropertyType::kString) {
+    return std::make_shared<StringDictColumn>(strategy);
   } else {
+    if (strategy == StorageStrategy::kDict) {
+      LOG(WARNING) << "Dictionary encoding only applies to string columns, "
+                      "use Mem for type "
+                   << static_cast<int>(type);
+      strategy = StorageStrategy::kMem;
+    }
     if (type == PropertyType::kInt32) {
       return std::make_shared<IntColumn>(strategy);
     } else if (type == PropertyType::kInt64) {
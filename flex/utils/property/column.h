@@ -16,9 +16,14 @@
 #ifndef GRAPHSCOPE_PROPERTY_COLUMN_H_
 #define GRAPHSCOPE_PROPERTY_COLUMN_H_
 
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 
+#include "flex/utils/cell_versions.h"
 #include "flex/utils/mmap_array.h"
 #include "flex/utils/property/types.h"
 #include "grape/serialization/out_archive.h"
@@ -35,6 +40,11 @@ class ColumnBase {
 
   virtual void dump(const std::string& filename) = 0;
 
+#if !OV
+  // 不改变列本身，把前size行写到filename处的快照中；能增量时只写变化的页
+  virtual void checkpoint(const std::string& filename, size_t size) = 0;
+#endif
+
   virtual size_t size() const = 0;
 
   virtual void resize(size_t size) = 0;
@@ -55,9 +65,36 @@ class ColumnBase {
   virtual void ingest(uint32_t index, grape::OutArchive& arc) = 0;
 
   virtual StorageStrategy storage_strategy() const = 0;
+
+  // 更新事务原地修改的旧版本，key为行号
+  CellVersions& versions() { return versions_; }
+  const CellVersions& versions() const { return versions_; }
+
+ private:
+  CellVersions versions_;
 };
 
 #if !OV
+// 读时间戳为ts时index处的值，之后被原地修改过时返回修改之前的值
+inline gbp::BufferBlock get_versioned(const ColumnBase& column, size_t index,
+                                      uint32_t ts) {
+  auto ret = column.get(index);
+  auto* old = column.versions().find(index, ts);
+  if (old != nullptr) {
+    ret = gbp::BufferBlock(old->size());
+    ::memcpy(ret.Data(), old->data(), old->size());
+  }
+  return ret;
+}
+
+// 覆盖index处的值之前，把当前的值以ts记为旧版本
+inline void save_version(ColumnBase& column, size_t index, uint32_t ts) {
+  auto item = column.get(index);
+  std::string value(item.Size(), '\0');
+  item.Copy(&value[0], value.size());
+  column.versions().push(index, ts, std::move(value));
+}
+
 class ColumnBaseAsync {
  public:
   virtual ~ColumnBaseAsync() {}
@@ -106,6 +143,10 @@ class TypedColumn : public ColumnBase {
 
     extra_buffer_.open(work_dir + "/" + name, false);
     extra_size_ = extra_buffer_.size();
+#if !OV
+    image_.clear();
+    image_size_ = 0;
+#endif
   }
 
   void touch(const std::string& filename) override {
@@ -158,32 +199,63 @@ class TypedColumn : public ColumnBase {
     } else if (basic_size_ == 0 && extra_size_ != 0) {
       extra_buffer_.dump(filename);
     } else {
-      mmap_array<T> tmp;
-      tmp.open(filename, false);
-      tmp.resize(basic_size_ + extra_size_);
+      // 按整页复制，不经由缓冲池逐行写入新文件
+      int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      CHECK_NE(fd, -1) << "Failed to open " << filename;
+      basic_buffer_.write_to_file(fd, 0, basic_size_, 0);
+      extra_buffer_.write_to_file(fd, 0, extra_size_, basic_size_);
+      CHECK_EQ(::ftruncate(fd, mmap_array<T>::file_offset(basic_size_ +
+                                                           extra_size_)),
+               0);
+      CHECK_EQ(::fdatasync(fd), 0);
+      ::close(fd);
+    }
+  }
 
-      auto basic_buffer_items_old = basic_buffer_.get(0, basic_size_);
-      auto basic_buffer_items_new = tmp.get(0, basic_size_);
-      for (size_t i = 0; i < basic_size_; i++)
-        gbp::BufferBlock::UpdateContent<T>(
-            [&](T& item) {
-              memcpy(&item,
-                     &gbp::BufferBlock::Ref<T>(basic_buffer_items_old, i),
-                     sizeof(T));
-            },
-            basic_buffer_items_new, i);
-
-      auto extra_buffer_items_old = extra_buffer_.get(0, extra_size_);
-      auto extra_buffer_items_new = tmp.get(basic_size_, extra_size_);
-      for (size_t i = 0; i < extra_size_; i++)
-        gbp::BufferBlock::UpdateContent<T>(
-            [&](T& item) {
-              memcpy(&item,
-                     &gbp::BufferBlock::Ref<T>(extra_buffer_items_old, i),
-                     sizeof(T));
-            },
-            extra_buffer_items_new, i);
+  /**
+   * @brief 快照文件的布局为basic之后接extra。basic在运行时只读，因此以上一次
+   * 的快照文件(最初就是basic)为底，只写入extra中的脏页和新增的行。
+   */
+  void checkpoint(const std::string& filename, size_t size) override {
+    static constexpr size_t kObjNum = mmap_array<T>::OBJ_NUM_PERPAGE;
+    size = std::min(size, basic_size_ + extra_size_);
+    std::string image = image_;
+    size_t image_size = image_size_;
+    if (image.empty() && basic_size_ != 0) {
+      image = basic_buffer_.filename();
+      image_size = basic_size_;
+    }
+    image_size = std::min(image_size, size);
+    std::vector<size_t> dirty_pages = extra_buffer_.take_dirty_pages();
+    if (!image.empty()) {
+      copy_file(image, filename);
+    }
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT, 0644);
+    CHECK_NE(fd, -1) << "Failed to open " << filename;
+    for (auto page : dirty_pages) {
+      size_t begin = basic_size_ + page * kObjNum;
+      if (begin >= image_size) {
+        break;
+      }
+      size_t end = std::min(begin + kObjNum, image_size);
+      extra_buffer_.write_to_file(fd, begin - basic_size_, end - begin, begin);
     }
+    size_t from = image_size;
+    if (from < std::min(size, basic_size_)) {
+      size_t to = std::min(size, basic_size_);
+      basic_buffer_.write_to_file(fd, from, to - from, from);
+      from = to;
+    }
+    if (from < size) {
+      extra_buffer_.write_to_file(fd, from - basic_size_, size - from, from);
+    }
+    size_t file_size = (size / kObjNum) * gbp::PAGE_SIZE_FILE +
+                       (size % kObjNum) * sizeof(T);
+    CHECK_EQ(::ftruncate(fd, file_size), 0);
+    CHECK_EQ(::fdatasync(fd), 0);
+    ::close(fd);
+    image_ = filename;
+    image_size_ = size;
   }
 #endif
   size_t size() const override { return basic_size_ + extra_size_; }
@@ -230,6 +302,7 @@ class TypedColumn : public ColumnBase {
     else {
       auto item_t = extra_buffer_.get(index - basic_size_);
       gbp::BufferBlock::UpdateContent<T>([&](T& item) { item = val; }, item_t);
+      extra_buffer_.mark_dirty(index - basic_size_);
     }
   }
 
@@ -283,6 +356,10 @@ class TypedColumn : public ColumnBase {
   size_t basic_size_;
   mmap_array<T> extra_buffer_;
   size_t extra_size_;
+#if !OV
+  std::string image_;  // 最近一次checkpoint写出的快照文件
+  size_t image_size_ = 0;
+#endif
   StorageStrategy strategy_;
 };
 
@@ -313,6 +390,9 @@ class StringColumn : public ColumnBase
     extra_buffer_.open(work_dir + "/" + name, false);
     extra_size_ = extra_buffer_.size();
     pos_.store(extra_buffer_.data_size());
+#if !OV
+    reset_heap(work_dir + "/" + name);
+#endif
   }
 #if OV
   void touch(const std::string& filename) override {
@@ -341,22 +421,23 @@ class StringColumn : public ColumnBase
 #else
 
   void touch(const std::string& filename) override {
+    if (extra_size_ == 0 && basic_size_ != 0) {
+      // 没有新增的行时直接整文件拷贝，offset保持不变
+      basic_buffer_.touch(filename);
+      size_t data_size = basic_buffer_.data_size();
+      basic_buffer_.resize(basic_size_, data_size);
+      extra_buffer_.swap(basic_buffer_);
+      extra_size_ = basic_size_;
+      basic_size_ = 0;
+      basic_buffer_.reset();
+      pos_.store(data_size);
+      reset_heap(filename);
+      return;
+    }
     mmap_array<std::string_view> tmp;
     tmp.open(filename, false);
-    tmp.resize(basic_size_ + extra_size_, (basic_size_ + extra_size_) * width_);
-    size_t offset = 0;
-    for (size_t k = 0; k < basic_size_; ++k) {
-      auto item = basic_buffer_.get(k);
-      std::string_view val = {&item.Obj<char>(), item.Size()};
-      tmp.set(k, offset, val);
-      offset += val.size();
-    }
-    for (size_t k = 0; k < extra_size_; ++k) {
-      auto item = extra_buffer_.get(k);
-      std::string_view val = {&item.Obj<char>(), item.Size()};
-      tmp.set(k + basic_size_, offset, val);
-      offset += val.size();
-    }
+    size_t offset = copy_rows_to(tmp);
+    tmp.resize(tmp.size(), offset);
 
     basic_size_ = 0;
     basic_buffer_.reset();
@@ -364,22 +445,30 @@ class StringColumn : public ColumnBase
     extra_buffer_.swap(tmp);
 
     pos_.store(offset);
+    reset_heap(filename);
   }
 #endif
 
   void dump(const std::string& filename) override {
     if (basic_size_ != 0 && extra_size_ == 0) {
       basic_buffer_.dump(filename);
+#if OV
     } else if (basic_size_ == 0 && extra_size_ != 0) {
       extra_buffer_.resize(extra_size_, pos_.load());
       extra_buffer_.dump(filename);
+#else
+    } else if (basic_size_ == 0 && extra_size_ != 0 &&
+               pos_.load() == heap_base_) {
+      // 堆中没有数据时extra的文件就是完整的列
+      extra_buffer_.dump(filename);
+#endif
     } else {
       mmap_array<std::string_view> tmp;
       tmp.open(filename, false);
-      tmp.resize(basic_size_ + extra_size_,
-                 (basic_size_ + extra_size_) * width_);
       size_t offset = 0;
 #if OV
+      tmp.resize(basic_size_ + extra_size_,
+                 (basic_size_ + extra_size_) * width_);
       for (size_t k = 0; k < basic_size_; ++k) {
         std::string_view val = basic_buffer_.get(k);
         tmp.set(k, offset, val);
@@ -391,24 +480,37 @@ class StringColumn : public ColumnBase
         offset += val.size();
       }
 #else
-      // for (size_t k = 0; k < basic_size_; ++k) {
-      //   auto item = basic_buffer_.get(k);
-      //   std::string_view val = {item.Data(), item.Size()};
-      //   tmp.set(k, offset, val);
-      //   offset += val.size();
-      // }
-      // for (size_t k = 0; k < extra_size_; ++k) {
-      //   auto item = extra_buffer_.get(k);
-      //   std::string_view val = {item.Data(), item.Size()};
-      //   tmp.set(k + basic_size_, offset, val);
-      //   offset += val.size();
-      // }
-      assert(false);
+      offset = copy_rows_to(tmp);
 #endif
       tmp.resize(basic_size_ + extra_size_, offset);
     }
   }
 
+#if !OV
+  // 变长的数据在basic和extra合并时需要重排offset，因此整列顺序写出
+  void checkpoint(const std::string& filename, size_t size) override {
+    static_assert(gbp::PAGE_SIZE_FILE % sizeof(string_item) == 0);
+    size = std::min(size, basic_size_ + extra_size_);
+    FILE* items_out = fopen((filename + ".items").c_str(), "wb");
+    FILE* data_out = fopen((filename + ".data").c_str(), "wb");
+    CHECK(items_out != nullptr && data_out != nullptr)
+        << "Failed to open " << filename;
+    size_t offset = 0;
+    for (size_t k = 0; k < size; ++k) {
+      auto item = get_inner(k);
+      string_item si = {offset, static_cast<uint32_t>(item.Size())};
+      fwrite(&item.Obj<char>(), 1, item.Size(), data_out);
+      fwrite(&si, sizeof(string_item), 1, items_out);
+      offset += item.Size();
+    }
+    for (auto fout : {items_out, data_out}) {
+      fflush(fout);
+      CHECK_EQ(::fdatasync(fileno(fout)), 0);
+      fclose(fout);
+    }
+  }
+#endif
+
   size_t size() const override { return basic_size_ + extra_size_; }
 
   void resize(size_t size) override {
@@ -418,7 +520,13 @@ class StringColumn : public ColumnBase
     } else {
       basic_size_ = basic_buffer_.size();
       extra_size_ = size - basic_size_;
+#if OV
       extra_buffer_.resize(extra_size_, extra_size_ * width_);
+#else
+      // 新写入的数据在heap_中，extra的数据区大小不变，不再为每行预留
+      // width_字节
+      extra_buffer_.resize(extra_size_, extra_buffer_.data_size());
+#endif
     }
   }
 
@@ -430,8 +538,14 @@ class StringColumn : public ColumnBase
 #if ASSERT_ENABLE
     assert(idx >= basic_size_ && idx < basic_size_ + extra_size_);
 #endif
+#if OV
     size_t offset = pos_.fetch_add(val.size());
     extra_buffer_.set(idx - basic_size_, offset, val);
+#else
+    size_t offset = allocate_data(val.size());
+    heap_.set(offset - heap_base_, val.data(), val.size());
+    extra_buffer_.set_item(idx - basic_size_, offset, val.size());
+#endif
   }
 
   void set_any(size_t idx, const Any& value) override {
@@ -449,14 +563,23 @@ class StringColumn : public ColumnBase
   }
 #else
   gbp::BufferBlock get_inner(size_t idx) const {
-    return idx < basic_size_ ? basic_buffer_.get(idx)
-                             : extra_buffer_.get(idx - basic_size_);
+    if (idx < basic_size_) {
+      return basic_buffer_.get(idx);
+    }
+    auto value = extra_buffer_.get_item(idx - basic_size_);
+    auto& item = gbp::BufferBlock::Ref<string_item>(value);
+    return in_heap(item.offset, item.length)
+               ? heap_.get(item.offset - heap_base_, item.length)
+               : extra_buffer_.get_data(item.offset, item.length);
   }
   gbp::BufferBlock get(size_t idx) const override { return get_inner(idx); }
   gbp::batch_request_type get_batch(size_t idx, size_t offset,
                                     size_t len) const override {
-    return idx < basic_size_ ? basic_buffer_.get_string_batch(offset, len)
-                             : extra_buffer_.get_string_batch(offset, len);
+    if (idx < basic_size_) {
+      return basic_buffer_.get_string_batch(offset, len);
+    }
+    return in_heap(offset, len) ? heap_.get_batch(offset - heap_base_, len)
+                                : extra_buffer_.get_string_batch(offset, len);
   }
   gbp::batch_request_type get_stringview_batch(size_t idx) const override {
     return idx < basic_size_
@@ -465,24 +588,34 @@ class StringColumn : public ColumnBase
   }
 
   std::future<gbp::BufferBlock> get_inner_async(size_t idx) const {
-    return idx < basic_size_ ? basic_buffer_.get_async(idx)
-                             : extra_buffer_.get_async(idx - basic_size_);
+    if (idx < basic_size_) {
+      return basic_buffer_.get_async(idx);
+    }
+    auto value = extra_buffer_.get_item(idx - basic_size_);
+    auto& item = gbp::BufferBlock::Ref<string_item>(value);
+    return in_heap(item.offset, item.length)
+               ? heap_.get_async(item.offset - heap_base_, item.length)
+               : extra_buffer_.get_data_async(item.offset, item.length);
   }
   std::future<gbp::BufferBlock> get_async(size_t idx) const override {
     return get_inner_async(idx);
   }
 
-  // TODO: 优化掉不必要的copy
+  // value可能跨页，先复制到连续的缓冲区
   void set(size_t idx, const gbp::BufferBlock& value) override {
-    std::string sv(value.Size(), 'a');
-    value.Copy(sv.data(), value.Size());
-    set_value(idx, sv);
-    assert(false);
+    std::string val(value.Size(), '\0');
+    value.Copy(val.data(), value.Size());
+    set_value(idx, val);
   }
 
 #endif
   size_t get_size_in_byte() const override {
+#if OV
     return basic_buffer_.get_size_in_byte() + extra_buffer_.get_size_in_byte();
+#else
+    return basic_buffer_.get_size_in_byte() +
+           extra_buffer_.get_size_in_byte() + heap_.get_size_in_byte();
+#endif
   }
 
   void ingest(uint32_t index, grape::OutArchive& arc) override {
@@ -496,15 +629,407 @@ class StringColumn : public ColumnBase
   const mmap_array<std::string_view>& buffer() const { return basic_buffer_; }
 
  private:
+#if !OV
+  // heap_第一个段的字节数，之后的段依次翻倍
+  static constexpr size_t kHeapSegmentSize = gbp::PAGE_SIZE_FILE * 16;
+
+  // extra的数据区在运行期间不再resize，之后写入的字符串存放在heap_中，
+  // 偏移从heap_base_开始编址
+  void reset_heap(const std::string& prefix) {
+    heap_.open(prefix + ".heap", kHeapSegmentSize);
+    heap_base_ = pos_.load();
+  }
+
+  // 空串不占空间，与之前一样从extra的数据区读取
+  bool in_heap(size_t offset, size_t len) const {
+    return len != 0 && offset >= heap_base_;
+  }
+
+  // 在heap_中分配len字节，同一个字符串不跨段。空串指向extra数据区的末尾
+  size_t allocate_data(size_t len) {
+    if (len == 0) {
+      return heap_base_;
+    }
+    size_t pos = pos_.load();
+    size_t begin;
+    do {
+      begin = heap_.fit(pos - heap_base_, len) + heap_base_;
+    } while (!pos_.compare_exchange_weak(pos, begin + len));
+    heap_.ensure(begin - heap_base_);
+    return begin;
+  }
+
+  // 将basic和extra中的所有行依次写入tmp，返回写入的字节数
+  size_t copy_rows_to(mmap_array<std::string_view>& tmp) const {
+    tmp.resize(basic_size_ + extra_size_,
+               basic_buffer_.data_size() + pos_.load());
+    size_t offset = 0;
+    for (size_t k = 0; k < basic_size_ + extra_size_; ++k) {
+      auto item = get_inner(k);
+      std::string_view val = {&item.Obj<char>(), item.Size()};
+      tmp.set(k, offset, val);
+      offset += val.size();
+    }
+    return offset;
+  }
+#endif
+
   mmap_array<std::string_view> basic_buffer_;
   size_t basic_size_;
   mmap_array<std::string_view> extra_buffer_;
   size_t extra_size_;
   std::atomic<size_t> pos_;
+#if !OV
+  segmented_mmap_array<char> heap_;
+  size_t heap_base_ = 0;
+#endif
   StorageStrategy strategy_;
   size_t width_;
 };  // namespace gs
 
+// 低基数string列(如gender、browserUsed、language)的字典编码实现。每行只存
+// 一个编码，字典常驻内存；快照中编码宽度(1/2/4字节)由字典大小决定，运行时新增
+// 的行统一使用4字节编码，dump时再压缩。
+class StringDictColumn : public ColumnBase
+#if !OV
+    ,
+                         public ColumnBaseAsync
+#endif
+{
+#if OV
+  using entry_type = std::string;
+#else
+  using entry_type = gbp::BufferBlock;  // 持有BufferBlock使字典所在页常驻
+#endif
+
+ public:
+  static constexpr size_t kChunkSize = 4096;
+  static constexpr size_t kMaxChunkNum = 1024;
+
+  StringDictColumn(StorageStrategy strategy)
+      : basic_size_(0),
+        basic_width_(1),
+        extra_size_(0),
+        dict_size_(0),
+        dict_pos_(0),
+        strategy_(strategy) {
+    chunks_.reserve(kMaxChunkNum);
+  }
+  ~StringDictColumn() {}
+
+  static uint8_t code_width(size_t dict_size) {
+    return dict_size <= (1 << 8) ? 1 : (dict_size <= (1 << 16) ? 2 : 4);
+  }
+
+  void open(const std::string& name, const std::string& snapshot_dir,
+            const std::string& work_dir) {
+    std::string basic_path = snapshot_dir + "/" + name;
+    extra_codes_.open(work_dir + "/" + name + ".codes", false);
+    extra_size_ = extra_codes_.size();
+
+    bool has_snapshot = std::filesystem::exists(basic_path + ".codes");
+    if (has_snapshot) {
+      mmap_array<std::string_view> basic_dict;
+      basic_dict.open(basic_path + ".dict", true);
+      basic_codes_.open(basic_path + ".codes", true);
+      basic_width_ = code_width(basic_dict.size());
+      basic_size_ = basic_codes_.size() / basic_width_;
+    } else {
+      basic_size_ = 0;
+    }
+    // 运行时的字典只追加，work_dir中已有新增的行时沿用work_dir中的字典
+    if (has_snapshot && extra_size_ == 0) {
+      dict_.open(basic_path + ".dict", true);
+      dict_.touch(work_dir + "/" + name + ".dict");
+    } else {
+      dict_.open(work_dir + "/" + name + ".dict", false);
+    }
+    load_dict();
+  }
+
+  void touch(const std::string& filename) override {
+    // 所有行改为4字节编码写入work_dir；tmp可能与extra_codes_是同一个文件，
+    // 因此先读出全部编码
+    size_t size = basic_size_ + extra_size_;
+    std::vector<uint32_t> codes(size);
+    for (size_t k = 0; k < size; ++k) {
+      codes[k] = get_code(k);
+    }
+    mmap_array<uint32_t> tmp;
+    tmp.open(filename + ".codes", false);
+    tmp.resize(size);
+#if OV
+    memcpy(tmp.data(), codes.data(), size * sizeof(uint32_t));
+#else
+    for (size_t k = 0; k < size; k += tmp.OBJ_NUM_PERPAGE) {
+      size_t len = std::min(size - k, size_t(tmp.OBJ_NUM_PERPAGE));
+      tmp.set(k, codes.data() + k, len);
+    }
+#endif
+    basic_size_ = 0;
+    basic_codes_.reset();
+    extra_size_ = size;
+    extra_codes_.swap(tmp);
+  }
+
+  void dump(const std::string& filename) override {
+    size_t dict_size = dict_size_.load();
+    dict_.resize(dict_size, dict_pos_);
+    dict_.dump(filename + ".dict");
+
+    uint8_t width = code_width(dict_size);
+    if (extra_size_ == 0 && basic_size_ != 0 && width == basic_width_) {
+      basic_codes_.dump(filename + ".codes");
+      return;
+    }
+    size_t size = basic_size_ + extra_size_;
+    mmap_array<char> tmp;
+    tmp.open(filename + ".codes", false);
+    tmp.resize(size * width);
+    std::vector<char> buf(gbp::PAGE_SIZE_FILE);
+    for (size_t k = 0; k < size;) {
+      size_t len = std::min(size - k, gbp::PAGE_SIZE_FILE / width);
+      for (size_t i = 0; i < len; ++i) {
+        uint32_t code = get_code(k + i);
+        memcpy(buf.data() + i * width, &code, width);
+      }
+#if OV
+      memcpy(tmp.data() + k * width, buf.data(), len * width);
+#else
+      tmp.set(k * width, buf.data(), len * width);
+#endif
+      k += len;
+    }
+  }
+
+#if !OV
+  // 字典只追加，增量写出；编码按当前字典大小重新压缩后整列写出
+  void checkpoint(const std::string& filename, size_t size) override {
+    size_t dict_size, dict_pos;
+    {
+      std::lock_guard<std::mutex> lock(dict_lock_);
+      dict_size = dict_size_.load();
+      dict_pos = dict_pos_;
+    }
+    dict_.checkpoint(filename + ".dict", dict_size, dict_pos);
+
+    size = std::min(size, basic_size_ + extra_size_);
+    uint8_t width = code_width(dict_size);
+    FILE* fout = fopen((filename + ".codes").c_str(), "wb");
+    CHECK(fout != nullptr) << "Failed to open " << filename << ".codes";
+    std::vector<char> buf(gbp::PAGE_SIZE_FILE);
+    for (size_t k = 0; k < size;) {
+      size_t len = std::min(size - k, gbp::PAGE_SIZE_FILE / width);
+      for (size_t i = 0; i < len; ++i) {
+        uint32_t code = get_code(k + i);
+        memcpy(buf.data() + i * width, &code, width);
+      }
+      fwrite(buf.data(), 1, len * width, fout);
+      k += len;
+    }
+    fflush(fout);
+    CHECK_EQ(::fdatasync(fileno(fout)), 0);
+    fclose(fout);
+  }
+#endif
+
+  size_t size() const override { return basic_size_ + extra_size_; }
+
+  void resize(size_t size) override {
+    if (size < basic_size_) {
+      basic_size_ = size;
+      extra_size_ = 0;
+    } else {
+      extra_size_ = size - basic_size_;
+      extra_codes_.resize(extra_size_);
+    }
+  }
+
+  PropertyType type() const override {
+    return AnyConverter<std::string_view>::type;
+  }
+
+  void set_value(size_t idx, const std::string_view& val) {
+#if ASSERT_ENABLE
+    assert(idx >= basic_size_ && idx < basic_size_ + extra_size_);
+#endif
+    uint32_t code = encode(val);
+#if OV
+    extra_codes_.set(idx - basic_size_, code);
+#else
+    auto item = extra_codes_.get(idx - basic_size_);
+    gbp::BufferBlock::UpdateContent<uint32_t>([&](uint32_t& c) { c = code; },
+                                              item);
+    extra_codes_.mark_dirty(idx - basic_size_);
+#endif
+  }
+
+  void set_any(size_t idx, const Any& value) override {
+    set_value(idx, AnyConverter<std::string_view>::from_any(value));
+  }
+
+  uint32_t get_code(size_t idx) const {
+#if OV
+    if (idx < basic_size_) {
+      return decode_code(basic_codes_.data() + idx * basic_width_,
+                         basic_width_);
+    }
+    return extra_codes_.get(idx - basic_size_);
+#else
+    if (idx < basic_size_) {
+      auto item = basic_codes_.get(idx * basic_width_, basic_width_);
+      return decode_code(&item.Obj<char>(), basic_width_);
+    }
+    auto item = extra_codes_.get(idx - basic_size_);
+    return gbp::BufferBlock::Ref<uint32_t>(item);
+#endif
+  }
+
+  const entry_type& entry(uint32_t code) const {
+#if ASSERT_ENABLE
+    assert(code < dict_size_.load(std::memory_order_acquire));
+#endif
+    return chunks_[code / kChunkSize][code % kChunkSize];
+  }
+
+#if OV
+  std::string_view get_view(size_t idx) const { return entry(get_code(idx)); }
+
+  Any get(size_t idx) const override {
+    return AnyConverter<std::string_view>::to_any(get_view(idx));
+  }
+#else
+  gbp::BufferBlock get(size_t idx) const override {
+    return entry(get_code(idx));
+  }
+
+  // 批量读取时第一轮只取编码，再用decode换成字典中的字符串
+  gbp::batch_request_type get_stringview_batch(size_t idx) const override {
+    return idx < basic_size_
+               ? basic_codes_.get_batch(idx * basic_width_, basic_width_)
+               : extra_codes_.get_batch(idx - basic_size_);
+  }
+
+  gbp::BufferBlock decode(size_t idx, const gbp::BufferBlock& code_item) const {
+    uint32_t code = idx < basic_size_
+                        ? decode_code(&code_item.Obj<char>(), basic_width_)
+                        : gbp::BufferBlock::Ref<uint32_t>(code_item);
+    return entry(code);
+  }
+
+  // 字符串常驻内存中的字典，没有按(offset, len)读取数据的第二轮：
+  // 用get_stringview_batch取编码，再用decode解码
+  gbp::batch_request_type get_batch(size_t idx, size_t offset,
+                                    size_t len) const override {
+    LOG(FATAL) << "StringDictColumn has no string data pages to batch; use "
+                  "get_stringview_batch() and decode() instead";
+    return gbp::batch_request_type();
+  }
+
+  std::future<gbp::BufferBlock> get_async(size_t idx) const override {
+    std::promise<gbp::BufferBlock> promise;
+    promise.set_value(get(idx));
+    return promise.get_future();
+  }
+
+  void set(size_t idx, const gbp::BufferBlock& value) override {
+    std::string val(value.Size(), '\0');
+    value.Copy(val.data(), value.Size());
+    set_value(idx, val);
+  }
+#endif
+
+  size_t dict_size() const { return dict_size_.load(); }
+
+  size_t get_size_in_byte() const override {
+    return basic_codes_.get_size_in_byte() + extra_codes_.get_size_in_byte() +
+           dict_.get_size_in_byte();
+  }
+
+  void ingest(uint32_t index, grape::OutArchive& arc) override {
+    std::string_view val;
+    arc >> val;
+    set_value(index, val);
+  }
+
+  StorageStrategy storage_strategy() const override { return strategy_; }
+
+ private:
+  static uint32_t decode_code(const char* ptr, uint8_t width) {
+    if (width == 1) {
+      return *reinterpret_cast<const uint8_t*>(ptr);
+    } else if (width == 2) {
+      return *reinterpret_cast<const uint16_t*>(ptr);
+    }
+    return *reinterpret_cast<const uint32_t*>(ptr);
+  }
+
+  void load_dict() {
+    size_t dict_size = dict_.size();
+    dict_pos_ = dict_.data_size();
+    for (size_t code = 0; code < dict_size; ++code) {
+#if OV
+      std::string val(dict_.get(code));
+      publish(code, std::string(val));
+#else
+      auto item = dict_.get(code);
+      std::string val(item.Size(), '\0');
+      item.Copy(val.data(), item.Size());
+      publish(code, std::move(item));
+#endif
+      dict_index_.emplace(std::move(val), code);
+    }
+    dict_size_.store(dict_size, std::memory_order_release);
+  }
+
+  // 新的值追加到字典末尾；先写入chunks_再增加dict_size_，读者不会看到未完成的项
+  uint32_t encode(const std::string_view& val) {
+    std::lock_guard<std::mutex> lock(dict_lock_);
+    std::string key(val);
+    auto iter = dict_index_.find(key);
+    if (iter != dict_index_.end()) {
+      return iter->second;
+    }
+    uint32_t code = dict_size_.load(std::memory_order_relaxed);
+    CHECK_LT(code, kChunkSize * kMaxChunkNum)
+        << "Too many distinct values for dictionary encoded column";
+    dict_.resize(code + 1, dict_pos_ + val.size());
+    dict_.set(code, dict_pos_, val);
+    dict_pos_ += val.size();
+#if OV
+    publish(code, std::string(val));
+#else
+    publish(code, dict_.get(code));
+#endif
+    dict_index_.emplace(std::move(key), code);
+    dict_size_.store(code + 1, std::memory_order_release);
+    return code;
+  }
+
+  void publish(size_t code, entry_type&& value) {
+    if (code / kChunkSize == chunks_.size()) {
+      chunks_.emplace_back(new entry_type[kChunkSize]);
+    }
+    chunks_[code / kChunkSize][code % kChunkSize] = std::move(value);
+  }
+
+  mmap_array<char> basic_codes_;
+  size_t basic_size_;
+  uint8_t basic_width_;
+  mmap_array<uint32_t> extra_codes_;
+  size_t extra_size_;
+
+  mmap_array<std::string_view> dict_;
+  // chunks_预留了kMaxChunkNum个位置，追加时不会重新分配，读者无需加锁
+  std::vector<std::unique_ptr<entry_type[]>> chunks_;
+  std::atomic<size_t> dict_size_;
+  size_t dict_pos_;
+  std::unordered_map<std::string, uint32_t> dict_index_;
+  std::mutex dict_lock_;
+
+  StorageStrategy strategy_;
+};
+
 std::shared_ptr<ColumnBase> CreateColumn(
     PropertyType type, StorageStrategy strategy = StorageStrategy::kMem);
 
@@ -86,6 +86,17 @@ void Table::dump(const std::string& name, const std::string& snapshot_dir) {
   column_ptrs_.clear();
 }
 
+#if !OV
+void Table::checkpoint(const std::string& name, const std::string& snapshot_dir,
+                       size_t rows) {
+  int i = 0;
+  for (auto col : columns_) {
+    col->checkpoint(snapshot_dir + "/" + name + ".col_" + std::to_string(i++),
+                    rows);
+  }
+}
+#endif
+
 void Table::reset_header(const std::vector<std::string>& col_name) {
   IdIndexer<std::string, int> new_col_id_indexer;
   size_t col_num = col_name.size();
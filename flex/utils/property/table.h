@@ -47,6 +47,12 @@ class Table {
 
   void dump(const std::string& name, const std::string& snapshot_dir);
 
+#if !OV
+  // 把前rows行写到snapshot_dir下的新快照，表本身保持可用
+  void checkpoint(const std::string& name, const std::string& snapshot_dir,
+                  size_t rows);
+#endif
+
   void reset_header(const std::vector<std::string>& col_name);
 
   std::vector<std::string> column_names() const;
@@ -30,6 +30,7 @@ namespace gs {
 enum class StorageStrategy {
   kNone,
   kMem,
+  kDict,  // 字典编码，仅用于低基数的string列
 };
 
 enum class PropertyType {
@@ -49,6 +50,10 @@ struct Date {
 
   std::string to_string() const;
 
+  bool operator<(const Date& rhs) const {
+    return milli_second < rhs.milli_second;
+  }
+
   int64_t milli_second;
 };
 